@@ -0,0 +1,156 @@
+// Snapshot compression benchmark
+//
+// Writes one large session with JsonMessageStore in each format, with and
+// without compression, and reports bytes on disk next to the time to save it,
+// load it back whole and load its last TAIL_MESSAGES through the index.
+//
+// Usage: agent_sdk_bench_compress [session_dir]
+// session_dir is a recorded session (a directory holding messages.json or
+// messages.bin, e.g. ~/.agent-sdk/sessions/<id>). Without it a synthetic
+// session of code, logs and JSON tool outputs is used.
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "core/compress.hpp"
+#include "core/json_store.hpp"
+#include "core/uuid.hpp"
+
+using namespace agent;
+namespace fs = std::filesystem;
+
+static constexpr size_t SYNTHETIC_TURNS = 2000;
+static constexpr size_t TAIL_MESSAGES = 50;
+static constexpr int LOAD_RUNS = 5;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static uintmax_t directory_size(const fs::path& dir) {
+  uintmax_t total = 0;
+  std::error_code ec;
+  for (const auto& entry : fs::recursive_directory_iterator(dir, ec)) {
+    if (entry.is_regular_file(ec)) total += entry.file_size(ec);
+  }
+  return total;
+}
+
+static std::string synthetic_output(size_t turn) {
+  std::string out;
+  switch (turn % 3) {
+    case 0:  // Source file
+      for (int i = 0; i < 80; ++i) {
+        out += "  if (value_" + std::to_string(i) + " > limit) {\n    result.push_back(compute(value_" + std::to_string(i) + ", " +
+               std::to_string(turn) + "));\n  }\n";
+      }
+      break;
+    case 1:  // Build log
+      for (int i = 0; i < 120; ++i) {
+        out += "[" + std::to_string(i * 100 / 120) + "%] Building CXX object src/module_" + std::to_string(i) + ".cpp.o\n";
+      }
+      break;
+    default:  // JSON
+      out = "[";
+      for (int i = 0; i < 60; ++i) {
+        out += std::string(i ? "," : "") + "{\"id\":" + std::to_string(i) + ",\"name\":\"item-" + std::to_string(turn + i) +
+               "\",\"tags\":[\"alpha\",\"beta\"],\"active\":true}";
+      }
+      out += "]";
+      break;
+  }
+  return out;
+}
+
+static std::vector<Message> synthetic_session(const SessionId& session_id) {
+  std::vector<Message> messages;
+  for (size_t turn = 0; turn < SYNTHETIC_TURNS; ++turn) {
+    auto user = Message::user("Please look at part " + std::to_string(turn) + " of the project and fix what is broken.");
+    auto call = Message::assistant("Let me check that.");
+    call.add_tool_call("tc_" + std::to_string(turn), "read", {{"filePath", "/src/part_" + std::to_string(turn) + ".cpp"}});
+    auto result = Message::user("");
+    result.add_tool_result("tc_" + std::to_string(turn), "read", synthetic_output(turn));
+    for (auto* msg : {&user, &call, &result}) {
+      msg->set_session_id(session_id);
+      messages.push_back(std::move(*msg));
+    }
+  }
+  return messages;
+}
+
+static std::vector<Message> recorded_session(const fs::path& session_dir, const SessionId& session_id) {
+  JsonMessageStore store(session_dir.parent_path());
+  auto messages = store.list(session_dir.filename().string());
+  for (auto& msg : messages) {
+    msg.set_session_id(session_id);
+    // Resolve lazily loaded outputs before the source store goes away
+    for (const auto* result : msg.tool_results()) result->output.str();
+  }
+  return messages;
+}
+
+static void run_case(const char* name, MessageFormat format, bool compress, const std::vector<Message>& messages, const SessionId& session_id) {
+  auto dir = fs::temp_directory_path() / ("agent_bench_" + UUID::generate());
+  JsonStoreOptions options;
+  options.mode = StoreMode::Journal;
+  options.format = format;
+  options.compress = compress;
+  options.journal_compact_threshold = messages.size() + 1;
+
+  auto start = std::chrono::steady_clock::now();
+  {
+    JsonMessageStore store(dir, options);
+    for (const auto& msg : messages) store.save(msg);
+    store.compact(session_id);
+  }
+  auto save_ms = elapsed_ms(start);
+
+  double load_ms = 0, tail_ms = 0;
+  for (int run = 0; run < LOAD_RUNS; ++run) {
+    JsonMessageStore store(dir, options);
+    start = std::chrono::steady_clock::now();
+    store.list(session_id);
+    load_ms += elapsed_ms(start) / LOAD_RUNS;
+
+    start = std::chrono::steady_clock::now();
+    store.list_range(session_id, messages.size() > TAIL_MESSAGES ? messages.size() - TAIL_MESSAGES : 0, TAIL_MESSAGES);
+    tail_ms += elapsed_ms(start) / LOAD_RUNS;
+  }
+
+  std::printf("%-16s %12.2f %10.1f %10.1f %10.2f\n", name, directory_size(dir) / (1024.0 * 1024.0), save_ms, load_ms, tail_ms);
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+int main(int argc, char* argv[]) {
+  SessionId session_id = "bench-session";
+  auto messages = argc > 1 ? recorded_session(argv[1], session_id) : synthetic_session(session_id);
+  if (messages.empty()) {
+    std::fprintf(stderr, "No messages found in %s\n", argv[1]);
+    return 1;
+  }
+
+  // Raw codec throughput on the session's JSON
+  std::string raw;
+  for (const auto& msg : messages) raw += msg.to_json().dump();
+  auto start = std::chrono::steady_clock::now();
+  auto packed = compress(raw);
+  auto compress_ms = elapsed_ms(start);
+  start = std::chrono::steady_clock::now();
+  auto unpacked = decompress(packed);
+  auto decompress_ms = elapsed_ms(start);
+  double mib = raw.size() / (1024.0 * 1024.0);
+  std::printf("%zu messages, %.1f MiB of JSON: ratio %.2f, compress %.0f MiB/s, decompress %.0f MiB/s\n\n", messages.size(), mib,
+              static_cast<double>(raw.size()) / packed.size(), mib / (compress_ms / 1000), mib / (decompress_ms / 1000));
+
+  std::printf("%-16s %12s %10s %10s %10s\n", "format", "disk MiB", "save ms", "load ms", "tail ms");
+  run_case("json", MessageFormat::Json, false, messages, session_id);
+  run_case("json + lz", MessageFormat::Json, true, messages, session_id);
+  run_case("binary", MessageFormat::Binary, false, messages, session_id);
+  run_case("binary + lz", MessageFormat::Binary, true, messages, session_id);
+  return 0;
+}
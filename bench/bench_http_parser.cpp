@@ -0,0 +1,244 @@
+// HTTP response parsing benchmark
+//
+// Reads a large chunked SSE response (the shape of a streamed LLM reply)
+// the way HttpClient used to (headers via asio::streambuf, std::istream and
+// std::regex; the body decoded byte by byte into a scratch string, then
+// copied again for the stream callback) and the way it does now
+// (HttpResponseParser over the read buffer, body data passed as views).
+// Input arrives in 16 KiB reads, as from the socket; each path copies a read
+// into its buffer first, as the socket would.
+//
+// Usage: agent_sdk_bench_http_parser [events] [rounds]
+
+#include <algorithm>
+#include <asio.hpp>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <istream>
+#include <map>
+#include <regex>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "net/http_parser.hpp"
+
+using namespace agent::net;
+
+static constexpr int DEFAULT_EVENTS = 50000;
+static constexpr int DEFAULT_ROUNDS = 10;
+static constexpr size_t READ_SIZE = 16 * 1024;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// One chunk per SSE event, as streaming servers send them
+static std::string make_response(int events) {
+  std::string response =
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: text/event-stream\r\n"
+      "Cache-Control: no-cache\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "\r\n";
+  char size[32];
+  for (int i = 0; i < events; ++i) {
+    std::string event = "event: content_block_delta\ndata: {\"type\":\"content_block_delta\",\"index\":0,\"delta\":{\"type\":\"text_delta\",\"text\":\"token " +
+                        std::to_string(i) + "\"}}\n\n";
+    std::snprintf(size, sizeof(size), "%zx\r\n", event.size());
+    response += size;
+    response += event;
+    response += "\r\n";
+  }
+  response += "0\r\n\r\n";
+  return response;
+}
+
+// Stands in for the SSE consumer: appends, and drops what it has handled
+struct Sink {
+  std::string buffer;
+  size_t total = 0;
+
+  void append(std::string_view data) {
+    buffer.append(data);
+    total += data.size();
+    if (buffer.size() > 64 * 1024) buffer.clear();
+  }
+};
+
+// --- Previous path ---
+
+// The chunked part of the former BodyDecoder
+class PreviousChunkedDecoder {
+ public:
+  bool feed(std::string_view data, std::string& out) {
+    while (!data.empty()) {
+      char c = data.front();
+      switch (state_) {
+        case State::Size:
+        case State::Extension:
+          data.remove_prefix(1);
+          if (c == '\n') {
+            state_ = remaining_ > 0 ? State::Data : State::Trailer;
+            line_length_ = 0;
+          } else if (state_ == State::Extension || c == '\r') {
+            // Chunk extensions are ignored
+          } else if (c == ';' || c == ' ' || c == '\t') {
+            state_ = State::Extension;
+          } else if (std::isxdigit(static_cast<unsigned char>(c)) && remaining_ >> 60 == 0) {
+            remaining_ = remaining_ * 16 + static_cast<uint64_t>(std::isdigit(static_cast<unsigned char>(c)) ? c - '0' : (c | 0x20) - 'a' + 10);
+          } else {
+            return false;
+          }
+          break;
+        case State::Data: {
+          size_t take = std::min<size_t>(remaining_, data.size());
+          out.append(data.data(), take);
+          data.remove_prefix(take);
+          remaining_ -= take;
+          if (remaining_ == 0) state_ = State::DataEnd;
+          break;
+        }
+        case State::DataEnd:
+          data.remove_prefix(1);
+          if (c == '\n') {
+            state_ = State::Size;
+          } else if (c != '\r') {
+            return false;
+          }
+          break;
+        case State::Trailer:
+          data.remove_prefix(1);
+          if (c == '\n') {
+            if (line_length_ == 0) state_ = State::Done;
+            line_length_ = 0;
+          } else if (c != '\r') {
+            line_length_++;
+          }
+          break;
+        case State::Done:
+          return true;
+      }
+    }
+    return true;
+  }
+
+  bool done() const {
+    return state_ == State::Done;
+  }
+
+ private:
+  enum class State { Size, Extension, Data, DataEnd, Trailer, Done };
+
+  State state_ = State::Size;
+  uint64_t remaining_ = 0;
+  size_t line_length_ = 0;
+};
+
+static size_t run_previous(const std::string& response, Sink& sink) {
+  asio::streambuf buffer;
+  size_t offset = 0;
+  auto read = [&] {
+    size_t size = std::min(READ_SIZE, response.size() - offset);
+    auto target = buffer.prepare(size);
+    std::memcpy(target.data(), response.data() + offset, size);
+    buffer.commit(size);
+    offset += size;
+  };
+
+  // Headers (async_read_until "\r\n\r\n")
+  std::string_view head_end("\r\n\r\n");
+  while (std::string_view(static_cast<const char*>(buffer.data().data()), buffer.size()).find(head_end) == std::string_view::npos) {
+    read();
+  }
+  std::istream stream(&buffer);
+  std::string status_line;
+  std::getline(stream, status_line);
+  std::regex status_regex(R"(HTTP/([\d.]+) (\d+))");
+  std::smatch match;
+  if (!std::regex_search(status_line, match, status_regex)) return 0;
+  int status = std::stoi(match[2].str());
+
+  std::map<std::string, std::string> headers;
+  std::string header_line;
+  while (std::getline(stream, header_line) && header_line != "\r") {
+    auto colon = header_line.find(':');
+    if (colon != std::string::npos) {
+      std::string value = header_line.substr(colon + 1);
+      value.erase(0, value.find_first_not_of(" \t"));
+      value.erase(value.find_last_not_of(" \t\r\n") + 1);
+      headers[header_line.substr(0, colon)] = value;
+    }
+  }
+
+  // Body
+  PreviousChunkedDecoder decoder;
+  std::string decoded;
+  auto on_data = [&](const std::string& chunk) {
+    sink.append(chunk);
+  };
+  while (true) {
+    decoded.clear();
+    decoder.feed(std::string_view(static_cast<const char*>(buffer.data().data()), buffer.size()), decoded);
+    buffer.consume(buffer.size());
+    if (!decoded.empty()) on_data(std::string(decoded));
+    if (decoder.done() || offset == response.size()) break;
+    read();
+  }
+  return static_cast<size_t>(status) + headers.size();
+}
+
+// --- Current path ---
+
+static size_t run_current(const std::string& response, Sink& sink) {
+  std::vector<char> buffer(READ_SIZE);
+  HttpResponseParser parser;
+  size_t headers = 0;
+  parser.on_header = [&](std::string_view, std::string_view) {
+    headers++;
+  };
+  parser.on_body = [&](std::string_view data) {
+    sink.append(data);
+  };
+
+  for (size_t offset = 0; offset < response.size() && !parser.complete() && !parser.failed();) {
+    size_t size = std::min(READ_SIZE, response.size() - offset);
+    std::memcpy(buffer.data(), response.data() + offset, size);
+    parser.feed(std::string_view(buffer.data(), size));
+    offset += size;
+  }
+  return static_cast<size_t>(parser.status_code()) + headers;
+}
+
+int main(int argc, char* argv[]) {
+  int events = argc > 1 ? std::atoi(argv[1]) : DEFAULT_EVENTS;
+  int rounds = argc > 2 ? std::atoi(argv[2]) : DEFAULT_ROUNDS;
+  std::string response = make_response(events);
+
+  auto run = [&](size_t (*parse)(const std::string&, Sink&)) {
+    Sink sink;
+    size_t check = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+      check += parse(response, sink);
+    }
+    double ms = elapsed_ms(start) / rounds;
+    return std::make_tuple(ms, sink.total / static_cast<size_t>(rounds), check);
+  };
+
+  auto previous = run(run_previous);
+  auto current = run(run_current);
+
+  double mib = static_cast<double>(response.size()) / (1024 * 1024);
+  std::printf("chunked SSE response: %d events, %.2f MiB, %zu-byte reads, %d rounds\n\n", events, mib, READ_SIZE, rounds);
+  std::printf("%-36s %10s %10s %12s\n", "path", "ms", "MiB/s", "body bytes");
+  auto row = [&](const char* name, const std::tuple<double, size_t, size_t>& result) {
+    std::printf("%-36s %10.3f %10.1f %12zu\n", name, std::get<0>(result), mib / (std::get<0>(result) / 1000), std::get<1>(result));
+  };
+  row("streambuf + istream/regex + copies", previous);
+  row("HttpResponseParser + views", current);
+  return std::get<1>(previous) == std::get<1>(current) ? 0 : 1;
+}
@@ -0,0 +1,133 @@
+// Request body serialization benchmark
+//
+// Builds the Anthropic request body for a long synthetic conversation the way
+// providers used to (a json tree per request, dump(), then the HTTP request
+// assembled in an ostringstream) and the way they do now (JsonWriter straight
+// from the message parts into a reused buffer, sent next to the head with a
+// gather write), and reports the time per request.
+//
+// Usage: agent_sdk_bench_request_body [turns]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "llm/provider.hpp"
+
+using namespace agent;
+using namespace agent::llm;
+
+static constexpr size_t DEFAULT_TURNS = 350;  // About 150k tokens
+static constexpr int RUNS = 20;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string synthetic_output(size_t turn) {
+  std::string out;
+  for (int i = 0; i < 20; ++i) {
+    out += "  if (value_" + std::to_string(i) + " > limit) {\n    result.push_back(\"" + std::to_string(turn) + "\\t\" + name);\n  }\n";
+  }
+  return out;
+}
+
+static LlmRequest synthetic_request(size_t turns) {
+  LlmRequest request;
+  request.model = "claude-sonnet-4-20250514";
+  request.system_prompt = "You are a coding agent. Use the tools to inspect and change the project.";
+  for (size_t turn = 0; turn < turns; ++turn) {
+    request.messages.push_back(Message::user("Please look at part " + std::to_string(turn) + " of the project and fix what is broken."));
+    auto call = Message::assistant("Let me check that.");
+    call.add_tool_call("tc_" + std::to_string(turn), "read", {{"filePath", "/src/part_" + std::to_string(turn) + ".cpp"}});
+    request.messages.push_back(std::move(call));
+    auto result = Message::user("");
+    result.add_tool_result("tc_" + std::to_string(turn), "read", synthetic_output(turn));
+    request.messages.push_back(std::move(result));
+  }
+  return request;
+}
+
+// The previous path: a json tree for the whole request
+static std::string tree_body(const LlmRequest& request) {
+  json body;
+  body["model"] = request.model;
+  body["max_tokens"] = request.max_tokens.value_or(8192);
+  body["system"] = request.system_prompt;
+
+  json msgs = json::array();
+  for (const auto& msg : request.messages) {
+    json content = json::array();
+    for (const auto& part : msg.parts()) {
+      if (auto* text = std::get_if<TextPart>(&part)) {
+        content.push_back({{"type", "text"}, {"text", text->text}});
+      } else if (auto* tc = std::get_if<ToolCallPart>(&part)) {
+        content.push_back({{"type", "tool_use"}, {"id", tc->id}, {"name", tc->name}, {"input", tc->arguments}});
+      } else if (auto* tr = std::get_if<ToolResultPart>(&part)) {
+        content.push_back({{"type", "tool_result"}, {"tool_use_id", tr->tool_call_id}, {"content", tr->output.str()}, {"is_error", tr->is_error}});
+      }
+    }
+    if (content.size() == 1 && content[0]["type"] == "text") content = content[0]["text"];
+    msgs.push_back({{"role", msg.role() == Role::User ? "user" : "assistant"}, {"content", std::move(content)}});
+  }
+  body["messages"] = std::move(msgs);
+  body["stream"] = true;
+  return body.dump();
+}
+
+static std::string http_request(const std::string& body) {
+  std::ostringstream req;
+  req << "POST /v1/messages HTTP/1.1\r\nHost: api.anthropic.com\r\nConnection: close\r\n";
+  req << "Content-Length: " << body.size() << "\r\n\r\n";
+  req << body;
+  return req.str();
+}
+
+int main(int argc, char* argv[]) {
+  size_t turns = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : DEFAULT_TURNS;
+  auto request = synthetic_request(turns);
+
+  auto reference = tree_body(request);
+  if (json::parse(reference) != json::parse(request.anthropic_body(true))) {
+    std::fprintf(stderr, "Bodies differ\n");
+    return 1;
+  }
+  std::printf("%zu messages, %.2f MiB body\n\n", request.messages.size(), reference.size() / (1024.0 * 1024.0));
+
+  // Previous path: tree, dump, then the body copied into the request string
+  size_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int run = 0; run < RUNS; ++run) {
+    sink += http_request(tree_body(request)).size();
+  }
+  auto tree_ms = elapsed_ms(start) / RUNS;
+
+  // Fresh buffer per request (what anthropic_body() does)
+  start = std::chrono::steady_clock::now();
+  for (int run = 0; run < RUNS; ++run) {
+    sink += request.anthropic_body(true).size();
+  }
+  auto fresh_ms = elapsed_ms(start) / RUNS;
+
+  // Reused buffer: no allocation once it has grown to the body size
+  std::string buffer;
+  start = std::chrono::steady_clock::now();
+  for (int run = 0; run < RUNS; ++run) {
+    buffer.clear();
+    request.write_anthropic_body(buffer, true);
+    sink += buffer.size();
+  }
+  auto reused_ms = elapsed_ms(start) / RUNS;
+
+  std::printf("%-28s %10s %10s\n", "path", "ms", "MiB/s");
+  auto row = [&](const char* name, double ms) {
+    std::printf("%-28s %10.2f %10.0f\n", name, ms, reference.size() / (1024.0 * 1024.0) / (ms / 1000));
+  };
+  row("json tree + dump + copy", tree_ms);
+  row("writer, fresh buffer", fresh_ms);
+  row("writer, reused buffer", reused_ms);
+  return sink == 0;
+}
@@ -0,0 +1,153 @@
+// Message store benchmark
+//
+// Compares InMemoryMessageStore, JsonMessageStore (snapshot and journal
+// modes) and LogMessageStore on the workload a session produces: append
+// messages, update a few, fetch by id, list whole sessions.
+//
+// Usage: agent_sdk_bench_store [message_count ...]   (default: 10000 100000)
+// Snapshot mode rewrites the whole session on every save and is only run up
+// to SNAPSHOT_LIMIT messages.
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "core/json_store.hpp"
+#include "core/log_store.hpp"
+#include "core/uuid.hpp"
+
+using namespace agent;
+namespace fs = std::filesystem;
+
+static constexpr size_t SESSIONS = 100;
+static constexpr size_t SNAPSHOT_LIMIT = 10000;
+static constexpr size_t LOOKUPS = 1000;
+
+struct StoreCase {
+  std::string name;
+  std::function<std::unique_ptr<MessageStore>(const fs::path&)> make;
+  size_t max_messages = SIZE_MAX;
+};
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::vector<Message> make_messages(size_t count) {
+  std::vector<Message> messages;
+  messages.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    auto msg = i % 2 == 0 ? Message::user("Question " + std::to_string(i) + ": " + std::string(200, 'q'))
+                          : Message::assistant("Answer " + std::to_string(i) + ": " + std::string(600, 'a'));
+    msg.set_session_id("session-" + std::to_string(i % SESSIONS));
+    messages.push_back(std::move(msg));
+  }
+  return messages;
+}
+
+static uintmax_t directory_size(const fs::path& dir) {
+  uintmax_t total = 0;
+  std::error_code ec;
+  for (const auto& entry : fs::recursive_directory_iterator(dir, ec)) {
+    if (entry.is_regular_file(ec)) total += entry.file_size(ec);
+  }
+  return total;
+}
+
+static void run_case(const StoreCase& store_case, const std::vector<Message>& messages) {
+  auto dir = fs::temp_directory_path() / ("agent_bench_" + UUID::generate());
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<size_t> pick(0, messages.size() - 1);
+
+  double save_ms = 0, update_ms = 0, get_ms = 0, list_ms = 0, reopen_ms = 0;
+  {
+    auto store = store_case.make(dir);
+
+    auto start = std::chrono::steady_clock::now();
+    for (const auto& msg : messages) {
+      store->save(msg);
+    }
+    save_ms = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < LOOKUPS; ++i) {
+      auto msg = messages[pick(rng)];
+      msg.add_text(" (edited)");
+      store->update(msg);
+    }
+    update_ms = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < LOOKUPS; ++i) {
+      store->get(messages[pick(rng)].id());
+    }
+    get_ms = elapsed_ms(start);
+
+    start = std::chrono::steady_clock::now();
+    for (size_t s = 0; s < SESSIONS; ++s) {
+      store->list("session-" + std::to_string(s));
+    }
+    list_ms = elapsed_ms(start);
+  }
+
+  // Cold start: a fresh instance listing one session
+  {
+    auto start = std::chrono::steady_clock::now();
+    auto store = store_case.make(dir);
+    store->list("session-0");
+    reopen_ms = elapsed_ms(start);
+  }
+
+  std::printf("%-22s %10.1f %10.1f %10.1f %10.1f %10.1f %10.1f\n", store_case.name.c_str(), save_ms, update_ms, get_ms, list_ms, reopen_ms,
+              directory_size(dir) / (1024.0 * 1024.0));
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+int main(int argc, char* argv[]) {
+  std::vector<size_t> counts;
+  for (int i = 1; i < argc; ++i) {
+    counts.push_back(std::stoul(argv[i]));
+  }
+  if (counts.empty()) {
+    counts = {10000, 100000};
+  }
+
+  std::vector<StoreCase> cases = {
+      {"in-memory", [](const fs::path&) { return std::make_unique<InMemoryMessageStore>(); }},
+      {"json-snapshot", [](const fs::path& dir) { return std::make_unique<JsonMessageStore>(dir); }, SNAPSHOT_LIMIT},
+      {"json-journal",
+       [](const fs::path& dir) {
+         JsonStoreOptions options;
+         options.mode = StoreMode::Journal;
+         return std::make_unique<JsonMessageStore>(dir, options);
+       }},
+      {"log", [](const fs::path& dir) { return std::make_unique<LogMessageStore>(dir); }},
+      {"log (no fsync)",
+       [](const fs::path& dir) {
+         LogStoreOptions options;
+         options.fsync = false;
+         return std::make_unique<LogMessageStore>(dir, options);
+       }},
+  };
+
+  for (auto count : counts) {
+    auto messages = make_messages(count);
+    std::printf("\n%zu messages, %zu sessions, %zu updates/gets (times in ms)\n", count, SESSIONS, LOOKUPS);
+    std::printf("%-22s %10s %10s %10s %10s %10s %10s\n", "store", "save", "update", "get", "list-all", "reopen", "disk MiB");
+    for (const auto& store_case : cases) {
+      if (count > store_case.max_messages) {
+        std::printf("%-22s %10s\n", store_case.name.c_str(), "skipped");
+        continue;
+      }
+      run_case(store_case, messages);
+    }
+  }
+  return 0;
+}
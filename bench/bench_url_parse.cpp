@@ -0,0 +1,116 @@
+// URL and status-line parsing benchmark
+//
+// Parses the URLs of provider requests and the status lines of their
+// responses the way the network layer used to (a std::regex built for every
+// call, then std::regex_match / std::regex_search with std::smatch) and the
+// way it does now (ParsedUrl::parse and parse_status_line, hand-written, over
+// string views).
+//
+// Usage: agent_sdk_bench_url_parse [iterations]
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "net/http_parser.hpp"
+#include "net/url.hpp"
+
+using namespace agent::net;
+
+static constexpr int DEFAULT_ITERATIONS = 20000;
+
+static double elapsed_ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static const std::vector<std::string> URLS = {
+    "https://api.anthropic.com/v1/messages",
+    "https://api.openai.com/v1/chat/completions",
+    "https://dashscope.aliyuncs.com/compatible-mode/v1/chat/completions",
+    "http://localhost:11434/v1/chat/completions",
+    "https://example.com/search?q=agent&page=2",
+    "http://127.0.0.1:8080/mcp",
+};
+
+static const std::vector<std::string> STATUS_LINES = {
+    "HTTP/1.1 200 OK",
+    "HTTP/1.1 429 Too Many Requests",
+    "HTTP/1.1 500 Internal Server Error",
+    "HTTP/1.0 404 Not Found",
+};
+
+// --- Previous path ---
+
+static std::optional<ParsedUrl> previous_parse_url(const std::string& url) {
+  std::regex url_regex(R"(^(https?):\/\/([^:\/\s]+)(?::(\d+))?(\/[^\?\s]*)?(\?[^\s]*)?)");
+  std::smatch match;
+  if (!std::regex_match(url, match, url_regex)) return std::nullopt;
+
+  ParsedUrl result;
+  result.scheme = match[1].str();
+  result.host = match[2].str();
+  result.port = match[3].str();
+  result.path = match[4].str().empty() ? "/" : match[4].str();
+  result.query = match[5].str();
+  return result;
+}
+
+static int previous_parse_status(const std::string& line) {
+  std::regex status_regex(R"(HTTP/([\d.]+) (\d+))");
+  std::smatch match;
+  if (!std::regex_search(line, match, status_regex)) return 0;
+  return std::stoi(match[2].str());
+}
+
+// --- Current path ---
+
+static std::optional<ParsedUrl> current_parse_url(const std::string& url) {
+  return ParsedUrl::parse(url);
+}
+
+static int current_parse_status(const std::string& line) {
+  auto status = parse_status_line(line);
+  return status ? status->code : 0;
+}
+
+int main(int argc, char* argv[]) {
+  int iterations = argc > 1 ? std::atoi(argv[1]) : DEFAULT_ITERATIONS;
+
+  auto run_urls = [&](std::optional<ParsedUrl> (*parse)(const std::string&)) {
+    size_t check = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      for (const auto& url : URLS) {
+        auto parsed = parse(url);
+        if (parsed) check += parsed->host.size() + parsed->path.size();
+      }
+    }
+    return std::make_pair(elapsed_ms(start) * 1e6 / (static_cast<double>(iterations) * URLS.size()), check);
+  };
+
+  auto run_status = [&](int (*parse)(const std::string&)) {
+    size_t check = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+      for (const auto& line : STATUS_LINES) check += static_cast<size_t>(parse(line));
+    }
+    return std::make_pair(elapsed_ms(start) * 1e6 / (static_cast<double>(iterations) * STATUS_LINES.size()), check);
+  };
+
+  auto previous_urls = run_urls(previous_parse_url);
+  auto current_urls = run_urls(current_parse_url);
+  auto previous_status = run_status(previous_parse_status);
+  auto current_status = run_status(current_parse_status);
+
+  std::printf("%d iterations over %zu URLs and %zu status lines\n\n", iterations, URLS.size(), STATUS_LINES.size());
+  std::printf("%-36s %12s\n", "path", "ns/parse");
+  std::printf("%-36s %12.1f\n", "URL: std::regex", previous_urls.first);
+  std::printf("%-36s %12.1f\n", "URL: ParsedUrl::parse", current_urls.first);
+  std::printf("%-36s %12.1f\n", "status line: std::regex", previous_status.first);
+  std::printf("%-36s %12.1f\n", "status line: parse_status_line", current_status.first);
+  return previous_urls.second == current_urls.second && previous_status.second == current_status.second ? 0 : 1;
+}
@@ -107,8 +107,16 @@ struct StreamDelta {
 
 struct TokensUsed {
   std::string session_id;
-  int64_t input_tokens;
+  int64_t input_tokens;  // Not read from or written to the prompt cache
   int64_t output_tokens;
+  int64_t cache_read_tokens = 0;
+  int64_t cache_write_tokens = 0;
+
+  // Share of the prompt read from the prompt cache
+  double cache_hit_ratio() const {
+    auto prompt = input_tokens + cache_read_tokens + cache_write_tokens;
+    return prompt > 0 ? static_cast<double>(cache_read_tokens) / prompt : 0.0;
+  }
 };
 
 struct ContextCompacted {
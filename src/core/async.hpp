@@ -0,0 +1,114 @@
+#pragma once
+
+#include <asio.hpp>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+namespace agent {
+
+// Helpers for code running as asio coroutines (asio::awaitable) that waits
+// for work finishing on other threads, without blocking the thread the
+// coroutine runs on.
+
+// Wakes one waiting coroutine. notify() may be called from any thread; one
+// that comes before async_wait() is kept, so the wait returns at once.
+class AsyncEvent {
+ public:
+  void notify() {
+    std::function<void()> waiter;
+    {
+      std::lock_guard lock(mutex_);
+      if (!waiter_) {
+        notified_ = true;
+        return;
+      }
+      waiter = std::move(waiter_);
+      waiter_ = nullptr;
+    }
+    waiter();
+  }
+
+  template <typename CompletionToken>
+  auto async_wait(CompletionToken&& token) {
+    return asio::async_initiate<CompletionToken, void()>(
+        [this](auto handler) {
+          // Resumes through the waiter's executor, which has work until then
+          auto work = asio::make_work_guard(handler);
+          auto shared = std::make_shared<decltype(handler)>(std::move(handler));
+          std::function<void()> resume = [shared, work]() mutable {
+            asio::post(work.get_executor(), [shared] {
+              std::move(*shared)();
+            });
+            work.reset();
+          };
+
+          {
+            std::lock_guard lock(mutex_);
+            if (!notified_) {
+              waiter_ = std::move(resume);
+              return;
+            }
+            notified_ = false;
+          }
+          resume();
+        },
+        token);
+  }
+
+ private:
+  std::mutex mutex_;
+  std::function<void()> waiter_;
+  bool notified_ = false;
+};
+
+// Result of a future. One that is not ready yet is waited for on a helper
+// thread; meant for futures completed by a person or another thread pool
+// (permission prompts), not for hot paths.
+template <typename T>
+asio::awaitable<T> await_future(std::future<T> future) {
+  if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    auto event = std::make_shared<AsyncEvent>();
+    auto waited = std::make_shared<std::future<T>>(std::move(future));
+    std::thread([waited, event] {
+      waited->wait();
+      event->notify();
+    }).detach();
+    co_await event->async_wait(asio::use_awaitable);
+    co_return waited->get();
+  }
+  co_return future.get();
+}
+
+// Runs a coroutine to completion on the calling thread and returns its
+// result (or rethrows its exception), for blocking entry points
+template <typename T>
+T run_blocking(asio::awaitable<T> task) {
+  asio::io_context ctx;
+  std::optional<T> result;
+  std::exception_ptr error;
+  asio::co_spawn(ctx, std::move(task), [&](std::exception_ptr e, T value) {
+    error = e;
+    if (!e) result = std::move(value);
+  });
+  ctx.run();
+  if (error) std::rethrow_exception(error);
+  return std::move(*result);
+}
+
+inline void run_blocking(asio::awaitable<void> task) {
+  asio::io_context ctx;
+  std::exception_ptr error;
+  asio::co_spawn(ctx, std::move(task), [&](std::exception_ptr e) {
+    error = e;
+  });
+  ctx.run();
+  if (error) std::rethrow_exception(error);
+}
+
+}  // namespace agent
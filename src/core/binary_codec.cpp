@@ -0,0 +1,259 @@
+#include "binary_codec.hpp"
+
+#include <openssl/evp.h>
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <fstream>
+#include <stdexcept>
+
+#include "compress.hpp"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace agent {
+
+namespace fs = std::filesystem;
+
+// Payload tags
+static constexpr uint8_t PAYLOAD_INLINE = 0;
+static constexpr uint8_t PAYLOAD_BLOB = 1;        // bytes ref
+static constexpr uint8_t PAYLOAD_BLOB_SIZED = 2;  // bytes ref | i64 size
+
+static std::string sha256_hex(std::string_view data) {
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_len = 0;
+  EVP_Digest(data.data(), data.size(), digest, &digest_len, EVP_sha256(), nullptr);
+
+  static const char hex[] = "0123456789abcdef";
+  std::string out;
+  out.reserve(digest_len * 2);
+  for (unsigned int i = 0; i < digest_len; ++i) {
+    out.push_back(hex[digest[i] >> 4]);
+    out.push_back(hex[digest[i] & 0x0f]);
+  }
+  return out;
+}
+
+// --- DirectoryBlobStore ---
+
+DirectoryBlobStore::DirectoryBlobStore(fs::path dir, bool compress) : dir_(std::move(dir)), compress_(compress) {}
+
+// Unique per writer: concurrent puts of the same payload must not share one
+static fs::path unique_tmp_path(const fs::path& path) {
+  static std::atomic<uint64_t> counter{0};
+  auto tmp_path = path;
+#ifdef _WIN32
+  tmp_path += "." + std::to_string(_getpid());
+#else
+  tmp_path += "." + std::to_string(::getpid());
+#endif
+  tmp_path += "." + std::to_string(counter.fetch_add(1)) + ".tmp";
+  return tmp_path;
+}
+
+std::string DirectoryBlobStore::put(std::string_view data) {
+  auto ref = sha256_hex(data);
+  auto path = dir_ / ref;
+
+  std::error_code ec;
+  if (fs::exists(path, ec)) {
+    return ref;
+  }
+
+  // Hash of the plain content either way, so compressed and plain copies dedupe
+  std::string packed;
+  if (compress_) {
+    packed = compress(data);
+    if (packed.size() < data.size()) {
+      data = packed;
+    }
+  }
+
+  fs::create_directories(dir_, ec);
+  auto tmp_path = unique_tmp_path(path);
+  {
+    std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+    file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    file.close();
+    if (!file) {
+      spdlog::warn("Failed to write blob {}", path.string());
+      fs::remove(tmp_path, ec);
+      return {};
+    }
+  }
+  // Same content under the same name: whichever rename lands last wins
+  fs::rename(tmp_path, path, ec);
+  if (ec) {
+    spdlog::warn("Failed to rename blob {}: {}", path.string(), ec.message());
+    fs::remove(tmp_path, ec);
+    return {};
+  }
+  return ref;
+}
+
+std::optional<std::string> DirectoryBlobStore::get(const std::string& ref) {
+  return read_file_decompressed(dir_ / ref);
+}
+
+// --- LazyText ---
+
+LazyText LazyText::from_blob(std::shared_ptr<BlobStore> store, std::string ref, size_t size) {
+  LazyText text;
+  text.store_ = std::move(store);
+  text.ref_ = std::move(ref);
+  text.size_ = size;
+  return text;
+}
+
+const std::string& LazyText::str() const {
+  if (store_) {
+    auto resolved = store_->get(ref_);
+    if (resolved) {
+      text_ = std::move(*resolved);
+    } else {
+      spdlog::warn("Missing blob {}", ref_);
+    }
+    store_.reset();
+  }
+  return text_;
+}
+
+// --- BinaryWriter ---
+
+void BinaryWriter::u32(uint32_t v) {
+  for (int i = 0; i < 4; ++i) {
+    out_.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+  }
+}
+
+void BinaryWriter::i64(int64_t v) {
+  auto u = static_cast<uint64_t>(v);
+  for (int i = 0; i < 8; ++i) {
+    out_.push_back(static_cast<char>((u >> (8 * i)) & 0xff));
+  }
+}
+
+void BinaryWriter::bytes(std::string_view data) {
+  u32(static_cast<uint32_t>(data.size()));
+  out_.append(data.data(), data.size());
+}
+
+void BinaryWriter::payload(std::string_view data, BlobStore* blobs, size_t inline_limit) {
+  if (blobs && data.size() > inline_limit) {
+    // A payload the store could not take stays inline
+    auto ref = blobs->put(data);
+    if (!ref.empty()) {
+      u8(PAYLOAD_BLOB_SIZED);
+      bytes(ref);
+      i64(static_cast<int64_t>(data.size()));
+      return;
+    }
+  }
+  u8(PAYLOAD_INLINE);
+  bytes(data);
+}
+
+void BinaryWriter::lazy_payload(const LazyText& text, BlobStore* blobs, size_t inline_limit) {
+  if (text.is_blob_in(blobs)) {
+    u8(PAYLOAD_BLOB_SIZED);
+    bytes(text.blob_ref());
+    i64(static_cast<int64_t>(text.size()));
+    return;
+  }
+  payload(std::string_view(text.str()), blobs, inline_limit);
+}
+
+size_t BinaryWriter::reserve_u32() {
+  auto pos = out_.size();
+  u32(0);
+  return pos;
+}
+
+void BinaryWriter::patch_u32(size_t pos, uint32_t v) {
+  for (int i = 0; i < 4; ++i) {
+    out_[pos + i] = static_cast<char>((v >> (8 * i)) & 0xff);
+  }
+}
+
+// --- BinaryReader ---
+
+void BinaryReader::need(size_t n) const {
+  if (data_.size() - pos_ < n) {
+    throw std::runtime_error("binary data truncated");
+  }
+}
+
+uint8_t BinaryReader::u8() {
+  need(1);
+  return static_cast<uint8_t>(data_[pos_++]);
+}
+
+uint32_t BinaryReader::u32() {
+  need(4);
+  uint32_t v = 0;
+  for (int i = 0; i < 4; ++i) {
+    v |= static_cast<uint32_t>(static_cast<uint8_t>(data_[pos_ + i])) << (8 * i);
+  }
+  pos_ += 4;
+  return v;
+}
+
+int64_t BinaryReader::i64() {
+  need(8);
+  uint64_t v = 0;
+  for (int i = 0; i < 8; ++i) {
+    v |= static_cast<uint64_t>(static_cast<uint8_t>(data_[pos_ + i])) << (8 * i);
+  }
+  pos_ += 8;
+  return static_cast<int64_t>(v);
+}
+
+std::string_view BinaryReader::bytes() {
+  auto len = u32();
+  need(len);
+  auto view = data_.substr(pos_, len);
+  pos_ += len;
+  return view;
+}
+
+std::string BinaryReader::payload(BlobStore* blobs) {
+  auto tag = u8();
+  auto data = bytes();
+  if (tag == PAYLOAD_INLINE) {
+    return std::string(data);
+  }
+  if (tag == PAYLOAD_BLOB_SIZED) {
+    i64();
+  } else if (tag != PAYLOAD_BLOB) {
+    throw std::runtime_error("unknown payload tag " + std::to_string(tag));
+  }
+
+  std::string ref(data);
+  auto resolved = blobs ? blobs->get(ref) : std::nullopt;
+  if (!resolved) {
+    throw std::runtime_error("missing blob " + ref);
+  }
+  return std::move(*resolved);
+}
+
+LazyText BinaryReader::lazy_payload(BlobStore* blobs) {
+  auto shared = blobs ? blobs->weak_from_this().lock() : nullptr;
+  if (!shared || remaining() < 1 || static_cast<uint8_t>(data_[pos_]) != PAYLOAD_BLOB_SIZED) {
+    return LazyText(payload(blobs));
+  }
+
+  u8();
+  std::string ref(bytes());
+  auto size = i64();
+  if (size < 0) {
+    throw std::runtime_error("negative blob size");
+  }
+  return LazyText::from_blob(std::move(shared), std::move(ref), static_cast<size_t>(size));
+}
+
+}  // namespace agent
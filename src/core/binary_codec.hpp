@@ -0,0 +1,188 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace agent {
+
+// Little-endian, length-prefixed binary encoding primitives.
+//
+// Used by Message::to_binary/from_binary. Strings are a u32 length followed
+// by raw bytes; "payload" strings (message text, tool output, file content)
+// additionally carry a one-byte tag so large values can live out-of-line in a
+// BlobStore and be referenced by key.
+
+// Out-of-line storage for large string payloads. A store owned by a
+// shared_ptr lets readers hand out LazyText references instead of reading
+// payloads up front.
+class BlobStore : public std::enable_shared_from_this<BlobStore> {
+ public:
+  virtual ~BlobStore() = default;
+
+  // Store data and return a reference that get() can resolve; empty if it
+  // could not be stored, in which case callers keep the data themselves
+  virtual std::string put(std::string_view data) = 0;
+
+  virtual std::optional<std::string> get(const std::string& ref) = 0;
+};
+
+// BlobStore keeping one file per payload, named by a hash of its content so
+// rewriting the same payload is a no-op. With compress, payloads are written
+// block-compressed (see compress.hpp); get() reads either form.
+class DirectoryBlobStore : public BlobStore {
+ public:
+  explicit DirectoryBlobStore(std::filesystem::path dir, bool compress = false);
+
+  std::string put(std::string_view data) override;
+  std::optional<std::string> get(const std::string& ref) override;
+
+  std::filesystem::path path(const std::string& ref) const {
+    return dir_ / ref;
+  }
+
+  const std::filesystem::path& dir() const {
+    return dir_;
+  }
+
+  bool compressed() const {
+    return compress_;
+  }
+
+ private:
+  std::filesystem::path dir_;
+  bool compress_ = false;
+};
+
+// String that may still live in a BlobStore. Holds either the text or a blob
+// reference plus its size; the text is read from the store on first access.
+// Like Message itself, not safe for concurrent first access.
+class LazyText {
+ public:
+  LazyText() = default;
+
+  LazyText(std::string text) : text_(std::move(text)), size_(text_.size()) {}
+
+  LazyText(const char* text) : LazyText(std::string(text)) {}
+
+  static LazyText from_blob(std::shared_ptr<BlobStore> store, std::string ref, size_t size);
+
+  // Resolves the blob if needed; a missing blob reads as empty
+  const std::string& str() const;
+
+  operator const std::string&() const {
+    return str();
+  }
+
+  // Known without resolving
+  size_t size() const {
+    return size_;
+  }
+
+  bool empty() const {
+    return size_ == 0;
+  }
+
+  // False while the text is still only a blob reference
+  bool resolved() const {
+    return !store_;
+  }
+
+  // True while the text is only a reference into store
+  bool is_blob_in(const BlobStore* store) const {
+    return store_ && store_.get() == store;
+  }
+
+  const std::string& blob_ref() const {
+    return ref_;
+  }
+
+  friend bool operator==(const LazyText& a, const LazyText& b) {
+    return a.size() == b.size() && a.str() == b.str();
+  }
+
+  friend bool operator==(const LazyText& a, const std::string& b) {
+    return a.size() == b.size() && a.str() == b;
+  }
+
+  friend bool operator==(const LazyText& a, const char* b) {
+    return a.str() == b;
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const LazyText& text) {
+    return os << text.str();
+  }
+
+ private:
+  mutable std::string text_;
+  mutable std::shared_ptr<BlobStore> store_;  // Set while unresolved
+  std::string ref_;
+  size_t size_ = 0;
+};
+
+class BinaryWriter {
+ public:
+  void u8(uint8_t v) {
+    out_.push_back(static_cast<char>(v));
+  }
+
+  void u32(uint32_t v);
+  void i64(int64_t v);
+  void bytes(std::string_view data);  // u32 length + data
+
+  // Payload string: inline, or a BlobStore reference when larger than inline_limit
+  void payload(std::string_view data, BlobStore* blobs, size_t inline_limit);
+
+  // Same for text that may already be a reference into blobs (written without reading it)
+  void lazy_payload(const LazyText& text, BlobStore* blobs, size_t inline_limit);
+
+  // Reserve a u32 slot and patch it later (used for length prefixes)
+  size_t reserve_u32();
+  void patch_u32(size_t pos, uint32_t v);
+
+  std::string& str() {
+    return out_;
+  }
+
+  std::string take() {
+    return std::move(out_);
+  }
+
+ private:
+  std::string out_;
+};
+
+// Reads what BinaryWriter wrote. Throws std::runtime_error on truncated or malformed input.
+class BinaryReader {
+ public:
+  explicit BinaryReader(std::string_view data) : data_(data) {}
+
+  uint8_t u8();
+  uint32_t u32();
+  int64_t i64();
+  std::string_view bytes();
+  std::string payload(BlobStore* blobs);
+
+  // Payload whose blob is read on first access when blobs is owned by a shared_ptr
+  LazyText lazy_payload(BlobStore* blobs);
+
+  bool at_end() const {
+    return pos_ >= data_.size();
+  }
+
+  size_t remaining() const {
+    return data_.size() - pos_;
+  }
+
+ private:
+  void need(size_t n) const;
+
+  std::string_view data_;
+  size_t pos_ = 0;
+};
+
+}  // namespace agent
@@ -0,0 +1,405 @@
+#include "compress.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include "binary_codec.hpp"
+
+namespace agent {
+
+namespace fs = std::filesystem;
+
+static constexpr char COMPRESS_MAGIC[4] = {'A', 'G', 'L', 'Z'};
+static constexpr uint8_t COMPRESS_VERSION = 1;
+static constexpr size_t COMPRESS_FIXED_HEADER = sizeof(COMPRESS_MAGIC) + 1 + 4 + 8 + 4;
+static constexpr uint32_t BLOCK_STORED = 0x80000000u;  // Block kept uncompressed
+
+// LZ4 block format parameters
+static constexpr size_t MIN_MATCH = 4;
+static constexpr size_t LAST_LITERALS = 5;  // The last bytes of a block are always literals
+static constexpr size_t MATCH_FIND_LIMIT = 12;  // No match starts this close to the end
+static constexpr size_t MAX_OFFSET = 65535;
+static constexpr int HASH_BITS = 14;
+
+// --- LZ4 block codec ---
+
+static uint32_t load32(const char* p) {
+  uint32_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint32_t hash32(uint32_t v) {
+  return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static void write_length(std::string& out, size_t length) {
+  length -= 15;
+  while (length >= 255) {
+    out.push_back(static_cast<char>(255));
+    length -= 255;
+  }
+  out.push_back(static_cast<char>(length));
+}
+
+// One sequence: literals, then (unless this is the last sequence) a match
+static void emit_sequence(std::string& out, const char* literals, size_t literal_length, size_t offset, size_t match_length) {
+  auto token_pos = out.size();
+  out.push_back(0);
+
+  uint8_t token = static_cast<uint8_t>(std::min<size_t>(literal_length, 15) << 4);
+  if (literal_length >= 15) write_length(out, literal_length);
+  out.append(literals, literal_length);
+
+  if (match_length > 0) {
+    out.push_back(static_cast<char>(offset & 0xff));
+    out.push_back(static_cast<char>(offset >> 8));
+    auto extra = match_length - MIN_MATCH;
+    token |= static_cast<uint8_t>(std::min<size_t>(extra, 15));
+    if (extra >= 15) write_length(out, extra);
+  }
+  out[token_pos] = static_cast<char>(token);
+}
+
+std::string compress_block(std::string_view data) {
+  const char* src = data.data();
+  size_t n = data.size();
+  size_t anchor = 0;
+
+  std::string out;
+  out.reserve(n + n / 255 + 16);
+
+  if (n > MATCH_FIND_LIMIT) {
+    std::vector<uint32_t> table(size_t{1} << HASH_BITS, 0);
+    size_t match_limit = n - MATCH_FIND_LIMIT;
+    size_t match_end = n - LAST_LITERALS;
+    size_t pos = 0;
+    size_t misses = 0;
+
+    while (pos < match_limit) {
+      auto sequence = load32(src + pos);
+      auto& slot = table[hash32(sequence)];
+      size_t candidate = slot;
+      slot = static_cast<uint32_t>(pos);
+
+      if (candidate < pos && pos - candidate <= MAX_OFFSET && load32(src + candidate) == sequence) {
+        size_t length = MIN_MATCH;
+        while (pos + length < match_end && src[candidate + length] == src[pos + length]) ++length;
+        emit_sequence(out, src + anchor, pos - anchor, pos - candidate, length);
+        pos += length;
+        anchor = pos;
+        misses = 0;
+      } else {
+        // Skip ahead faster through data that does not compress
+        pos += 1 + (misses++ >> 6);
+      }
+    }
+  }
+
+  emit_sequence(out, src + anchor, n - anchor, 0, 0);
+  return out;
+}
+
+std::string decompress_block(std::string_view data, size_t raw_size) {
+  auto corrupt = [] {
+    return std::runtime_error("corrupt compressed block");
+  };
+
+  std::string out(raw_size, '\0');
+  size_t op = 0;
+  size_t ip = 0;
+  size_t n = data.size();
+
+  auto read_length = [&](size_t length) {
+    if (length == 15) {
+      uint8_t b = 0;
+      do {
+        if (ip >= n) throw corrupt();
+        b = static_cast<uint8_t>(data[ip++]);
+        length += b;
+      } while (b == 255);
+    }
+    return length;
+  };
+
+  while (true) {
+    if (ip >= n) throw corrupt();
+    auto token = static_cast<uint8_t>(data[ip++]);
+
+    auto literal_length = read_length(token >> 4);
+    if (literal_length > n - ip || literal_length > raw_size - op) throw corrupt();
+    std::memcpy(out.data() + op, data.data() + ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+    if (ip == n) break;  // Last sequence has no match
+
+    if (n - ip < 2) throw corrupt();
+    size_t offset = static_cast<uint8_t>(data[ip]) | (static_cast<size_t>(static_cast<uint8_t>(data[ip + 1])) << 8);
+    ip += 2;
+    if (offset == 0 || offset > op) throw corrupt();
+
+    auto match_length = read_length(token & 0x0f) + MIN_MATCH;
+    if (match_length > raw_size - op) throw corrupt();
+    size_t from = op - offset;
+    if (offset >= match_length) {
+      std::memcpy(out.data() + op, out.data() + from, match_length);
+    } else {
+      // Overlapping match repeats the last offset bytes
+      for (size_t i = 0; i < match_length; ++i) out[op + i] = out[from + i];
+    }
+    op += match_length;
+  }
+
+  if (op != raw_size) throw corrupt();
+  return out;
+}
+
+// --- Framing ---
+
+namespace {
+
+struct FrameHeader {
+  size_t block_size = 0;
+  uint64_t raw_size = 0;
+  std::vector<uint32_t> stored_sizes;
+  size_t header_size = 0;
+
+  size_t raw_block_size(size_t index) const {
+    return static_cast<size_t>(std::min<uint64_t>(block_size, raw_size - static_cast<uint64_t>(index) * block_size));
+  }
+};
+
+}  // namespace
+
+// Reads the header; data must contain at least all of it
+static FrameHeader parse_header(std::string_view data) {
+  if (!is_compressed(data)) {
+    throw std::runtime_error("not a compressed file");
+  }
+  BinaryReader in(data.substr(sizeof(COMPRESS_MAGIC)));
+  auto version = in.u8();
+  if (version != COMPRESS_VERSION) {
+    throw std::runtime_error("unsupported compressed file version " + std::to_string(version));
+  }
+
+  FrameHeader header;
+  header.block_size = in.u32();
+  header.raw_size = static_cast<uint64_t>(in.i64());
+  auto count = in.u32();
+  if (header.block_size == 0 || header.block_size >= BLOCK_STORED ||
+      count != (header.raw_size + header.block_size - 1) / header.block_size) {
+    throw std::runtime_error("malformed compressed file header");
+  }
+
+  header.stored_sizes.resize(count);
+  for (auto& size : header.stored_sizes) {
+    size = in.u32();
+  }
+  header.header_size = COMPRESS_FIXED_HEADER + count * sizeof(uint32_t);
+  return header;
+}
+
+static std::string decode_block(std::string_view stored, uint32_t stored_size, size_t raw_size) {
+  if (stored_size & BLOCK_STORED) {
+    if (stored.size() != raw_size) throw std::runtime_error("corrupt stored block");
+    return std::string(stored);
+  }
+  return decompress_block(stored, raw_size);
+}
+
+bool is_compressed(std::string_view data) {
+  return data.size() >= COMPRESS_FIXED_HEADER && data.compare(0, sizeof(COMPRESS_MAGIC), COMPRESS_MAGIC, sizeof(COMPRESS_MAGIC)) == 0;
+}
+
+std::string compress(std::string_view data, size_t block_size) {
+  if (block_size == 0 || block_size >= BLOCK_STORED) {
+    block_size = COMPRESS_BLOCK_SIZE;
+  }
+  auto count = (data.size() + block_size - 1) / block_size;
+
+  BinaryWriter out;
+  out.str().append(COMPRESS_MAGIC, sizeof(COMPRESS_MAGIC));
+  out.u8(COMPRESS_VERSION);
+  out.u32(static_cast<uint32_t>(block_size));
+  out.i64(static_cast<int64_t>(data.size()));
+  out.u32(static_cast<uint32_t>(count));
+  auto sizes_pos = out.str().size();
+  for (size_t i = 0; i < count; ++i) {
+    out.u32(0);
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    auto chunk = data.substr(i * block_size, block_size);
+    auto packed = compress_block(chunk);
+    if (packed.size() < chunk.size()) {
+      out.patch_u32(sizes_pos + i * sizeof(uint32_t), static_cast<uint32_t>(packed.size()));
+      out.str() += packed;
+    } else {
+      out.patch_u32(sizes_pos + i * sizeof(uint32_t), static_cast<uint32_t>(chunk.size()) | BLOCK_STORED);
+      out.str().append(chunk.data(), chunk.size());
+    }
+  }
+  return out.take();
+}
+
+std::string decompress(std::string_view data) {
+  auto header = parse_header(data);
+
+  std::string out;
+  out.reserve(static_cast<size_t>(header.raw_size));
+  size_t pos = header.header_size;
+  for (size_t i = 0; i < header.stored_sizes.size(); ++i) {
+    size_t stored_size = header.stored_sizes[i] & ~BLOCK_STORED;
+    if (stored_size > data.size() - pos) {
+      throw std::runtime_error("compressed data truncated");
+    }
+    out += decode_block(data.substr(pos, stored_size), header.stored_sizes[i], header.raw_block_size(i));
+    pos += stored_size;
+  }
+  return out;
+}
+
+std::string maybe_decompress(std::string data) {
+  if (is_compressed(data)) {
+    return decompress(data);
+  }
+  return data;
+}
+
+// --- CompressedFile ---
+
+CompressedFile::CompressedFile(const fs::path& path) : file_(path, std::ios::binary) {
+  if (!file_.is_open()) {
+    return;
+  }
+
+  std::string fixed(COMPRESS_FIXED_HEADER, '\0');
+  file_.read(fixed.data(), static_cast<std::streamsize>(fixed.size()));
+  fixed.resize(static_cast<size_t>(file_.gcount()));
+  file_.clear();
+
+  if (!is_compressed(fixed)) {
+    std::error_code ec;
+    size_ = fs::file_size(path, ec);
+    return;
+  }
+
+  // Read the block table after the fixed part, then parse the whole header
+  uint32_t count = 0;
+  for (int i = 0; i < 4; ++i) {
+    count |= static_cast<uint32_t>(static_cast<uint8_t>(fixed[COMPRESS_FIXED_HEADER - 4 + i])) << (8 * i);
+  }
+  std::error_code ec;
+  auto file_size = fs::file_size(path, ec);
+  if (ec || static_cast<uint64_t>(count) * sizeof(uint32_t) > file_size) {
+    throw std::runtime_error("malformed compressed file header: " + path.string());
+  }
+  std::string table(static_cast<size_t>(count) * sizeof(uint32_t), '\0');
+  file_.read(table.data(), static_cast<std::streamsize>(table.size()));
+  if (!file_) {
+    throw std::runtime_error("compressed file header truncated: " + path.string());
+  }
+
+  auto header = parse_header(fixed + table);
+  compressed_ = true;
+  size_ = header.raw_size;
+  block_size_ = header.block_size;
+  stored_sizes_ = std::move(header.stored_sizes);
+  block_offsets_.reserve(stored_sizes_.size());
+  uint64_t offset = header.header_size;
+  for (auto stored_size : stored_sizes_) {
+    block_offsets_.push_back(offset);
+    offset += stored_size & ~BLOCK_STORED;
+  }
+}
+
+const std::string& CompressedFile::block(size_t index) {
+  if (cached_index_ == index) {
+    return cached_block_;
+  }
+
+  std::string stored(stored_sizes_[index] & ~BLOCK_STORED, '\0');
+  file_.seekg(static_cast<std::streamoff>(block_offsets_[index]));
+  file_.read(stored.data(), static_cast<std::streamsize>(stored.size()));
+  if (!file_) {
+    file_.clear();
+    throw std::runtime_error("compressed data truncated");
+  }
+
+  auto raw_size = static_cast<size_t>(std::min<uint64_t>(block_size_, size_ - static_cast<uint64_t>(index) * block_size_));
+  cached_block_ = decode_block(stored, stored_sizes_[index], raw_size);
+  cached_index_ = index;
+  return cached_block_;
+}
+
+std::string CompressedFile::read(uint64_t offset, size_t length) {
+  if (offset > size_ || length > size_ - offset) {
+    throw std::runtime_error("read beyond end of file");
+  }
+
+  std::string out;
+  if (!compressed_) {
+    out.resize(length);
+    file_.seekg(static_cast<std::streamoff>(offset));
+    file_.read(out.data(), static_cast<std::streamsize>(length));
+    if (!file_) {
+      file_.clear();
+      throw std::runtime_error("file shorter than expected");
+    }
+    return out;
+  }
+
+  out.reserve(length);
+  while (out.size() < length) {
+    auto pos = offset + out.size();
+    auto index = static_cast<size_t>(pos / block_size_);
+    const auto& data = block(index);
+    auto within = static_cast<size_t>(pos - static_cast<uint64_t>(index) * block_size_);
+    out.append(data, within, std::min(data.size() - within, length - out.size()));
+  }
+  return out;
+}
+
+// --- File helpers ---
+
+std::optional<std::string> read_file_decompressed(const fs::path& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return std::nullopt;
+  }
+  std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  try {
+    return maybe_decompress(std::move(data));
+  } catch (const std::exception& e) {
+    spdlog::warn("Failed to decompress {}: {}", path.string(), e.what());
+    return std::nullopt;
+  }
+}
+
+std::unique_ptr<std::istream> open_decompressed(const fs::path& path) {
+  auto file = std::make_unique<std::ifstream>(path, std::ios::binary);
+  if (!file->is_open()) {
+    return nullptr;
+  }
+
+  char magic[sizeof(COMPRESS_MAGIC)] = {};
+  file->read(magic, sizeof(magic));
+  bool compressed = file->gcount() == sizeof(magic) && std::memcmp(magic, COMPRESS_MAGIC, sizeof(magic)) == 0;
+  file->clear();
+  file->seekg(0);
+  if (!compressed) {
+    return file;
+  }
+
+  auto data = read_file_decompressed(path);
+  if (!data) {
+    return nullptr;
+  }
+  return std::make_unique<std::istringstream>(std::move(*data));
+}
+
+}  // namespace agent
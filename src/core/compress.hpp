@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace agent {
+
+// Block compression for persisted files.
+//
+// Data is split into independent blocks compressed with a small LZ77 codec
+// (LZ4 block format). Files start with a magic, so readers detect compressed
+// files and read plain ones unchanged; a block table in the header lets
+// CompressedFile decode only the blocks a byte range touches.
+//
+// File: "AGLZ" | u8 version | u32 block_size | i64 raw_size | u32 block_count |
+//       u32 stored_size[block_count] (high bit: block stored uncompressed) | blocks
+
+static constexpr size_t COMPRESS_BLOCK_SIZE = 64 * 1024;
+
+bool is_compressed(std::string_view data);
+
+std::string compress(std::string_view data, size_t block_size = COMPRESS_BLOCK_SIZE);
+
+// Throws std::runtime_error on malformed input
+std::string decompress(std::string_view data);
+
+// Decompresses data if it is compressed, otherwise returns it as is
+std::string maybe_decompress(std::string data);
+
+// Single LZ4 block without framing. decompress_block() needs the exact decoded size.
+std::string compress_block(std::string_view data);
+std::string decompress_block(std::string_view data, size_t raw_size);
+
+// Random-access reader over a compressed or plain file
+class CompressedFile {
+ public:
+  // Throws std::runtime_error if a compressed file has a malformed header
+  explicit CompressedFile(const std::filesystem::path& path);
+
+  bool is_open() const {
+    return file_.is_open();
+  }
+
+  bool compressed() const {
+    return compressed_;
+  }
+
+  // Decoded size
+  uint64_t size() const {
+    return size_;
+  }
+
+  // Throws std::runtime_error when the range is out of bounds or a block is corrupt
+  std::string read(uint64_t offset, size_t length);
+
+  std::string read_all() {
+    return read(0, static_cast<size_t>(size_));
+  }
+
+ private:
+  const std::string& block(size_t index);
+
+  std::ifstream file_;
+  bool compressed_ = false;
+  uint64_t size_ = 0;
+
+  size_t block_size_ = 0;
+  std::vector<uint32_t> stored_sizes_;
+  std::vector<uint64_t> block_offsets_;  // File offset of each block
+
+  std::optional<size_t> cached_index_;  // Last decoded block
+  std::string cached_block_;
+};
+
+// Whole file, decompressed if needed; nullopt if it cannot be read
+std::optional<std::string> read_file_decompressed(const std::filesystem::path& path);
+
+// Text stream over a file, decompressed if needed (for line-oriented readers)
+std::unique_ptr<std::istream> open_decompressed(const std::filesystem::path& path);
+
+}  // namespace agent
@@ -37,6 +37,7 @@ Config Config::load(const fs::path& path) {
             provider.headers[k] = v;
           }
         }
+        provider.http2 = provider_json.value("http2", false);
         config.providers[name] = provider;
       }
     }
@@ -112,6 +113,25 @@ Config Config::load(const fs::path& path) {
       config.context.prune_minimum_tokens = ctx.value("prune_minimum_tokens", 20000);
       config.context.truncate_max_lines = ctx.value("truncate_max_lines", 2000);
       config.context.truncate_max_bytes = ctx.value("truncate_max_bytes", 51200);
+      config.context.compact_background_ratio = ctx.value("compact_background_ratio", 0.6);
+      config.context.compact_blocking_ratio = ctx.value("compact_blocking_ratio", 0.8);
+      config.context.compact_chunk_tokens = ctx.value("compact_chunk_tokens", 20000);
+      config.context.compact_max_leaves = ctx.value("compact_max_leaves", 8);
+    }
+
+    // Load tool settings
+    if (j.contains("tools")) {
+      const auto& tools = j["tools"];
+      config.tools.max_parallel = tools.value("max_parallel", 8);
+      config.tools.speculative = tools.value("speculative", false);
+    }
+
+    // Load prompt cache policy
+    if (j.contains("prompt_cache")) {
+      const auto& cache = j["prompt_cache"];
+      config.prompt_cache.tools = cache.value("tools", true);
+      config.prompt_cache.system = cache.value("system", true);
+      config.prompt_cache.messages = cache.value("messages", true);
     }
 
     // Load instructions
@@ -170,6 +190,9 @@ void Config::save(const fs::path& path) const {
     if (!provider.headers.empty()) {
       p["headers"] = provider.headers;
     }
+    if (provider.http2) {
+      p["http2"] = true;
+    }
     providers_json[name] = p;
   }
   j["providers"] = providers_json;
@@ -220,7 +243,15 @@ void Config::save(const fs::path& path) const {
   j["context"] = {{"prune_protect_tokens", context.prune_protect_tokens},
                   {"prune_minimum_tokens", context.prune_minimum_tokens},
                   {"truncate_max_lines", context.truncate_max_lines},
-                  {"truncate_max_bytes", context.truncate_max_bytes}};
+                  {"truncate_max_bytes", context.truncate_max_bytes},
+                  {"compact_background_ratio", context.compact_background_ratio},
+                  {"compact_blocking_ratio", context.compact_blocking_ratio},
+                  {"compact_chunk_tokens", context.compact_chunk_tokens},
+                  {"compact_max_leaves", context.compact_max_leaves}};
+
+  // Save tool settings
+  j["tools"] = {{"max_parallel", tools.max_parallel}, {"speculative", tools.speculative}};
+  j["prompt_cache"] = {{"tools", prompt_cache.tools}, {"system", prompt_cache.system}, {"messages", prompt_cache.messages}};
 
   j["instructions"] = instructions;
 
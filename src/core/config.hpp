@@ -81,8 +81,26 @@ struct Config {
     int64_t prune_minimum_tokens = 20000;
     size_t truncate_max_lines = 2000;
     size_t truncate_max_bytes = 51200;
+    // Shares of the context window: above the first a summary is written in
+    // the background while the loop goes on; above the second the loop waits
+    // for it. Background compaction is off unless background < blocking.
+    double compact_background_ratio = 0.6;
+    double compact_blocking_ratio = 0.8;
+    // Rolling summaries: conversation tokens per summarized chunk, and chunk
+    // summaries kept before the oldest are merged into the root summary
+    int64_t compact_chunk_tokens = 20000;
+    size_t compact_max_leaves = 8;
   } context;
 
+  // Tool execution settings
+  struct ToolSettings {
+    size_t max_parallel = 8;  // Tool calls of one turn running at once (1 = one at a time)
+    bool speculative = false;  // Start read-only calls while the response is still streaming
+  } tools;
+
+  // Prompt caching (providers without explicit cache control ignore it)
+  PromptCachePolicy prompt_cache;
+
   // Logging
   std::string log_level = "info";
   std::optional<std::filesystem::path> log_file;
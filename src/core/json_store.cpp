@@ -4,11 +4,28 @@
 
 #include <algorithm>
 #include <fstream>
+#include <functional>
+
+#include "compress.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 namespace agent {
 
 namespace fs = std::filesystem;
 
+// Snapshot position index (messages.idx): "AGMI" | u32 version | u8 format |
+// i64 snapshot size | u32 count | (bytes id | i64 offset | u32 length | u8 flags)*
+static constexpr char SNAPSHOT_INDEX_MAGIC[4] = {'A', 'G', 'M', 'I'};
+static constexpr uint32_t SNAPSHOT_INDEX_VERSION = 1;
+static constexpr uint8_t SNAPSHOT_ENTRY_STARTS_CONTEXT = 1;
+
 // --- Timestamp helpers ---
 
 static int64_t timestamp_to_epoch(const Timestamp& ts) {
@@ -60,9 +77,162 @@ SessionMeta SessionMeta::from_json(const json& j) {
   return meta;
 }
 
+// --- Journal helpers ---
+
+static void sync_file(std::FILE* file) {
+  std::fflush(file);
+#ifdef _WIN32
+  _commit(_fileno(file));
+#else
+  fsync(fileno(file));
+#endif
+}
+
+// Persist a rename: the directory entry lives in the directory, not the file
+static void sync_directory(const fs::path& dir) {
+#ifndef _WIN32
+  int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd >= 0) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+#else
+  (void)dir;
+#endif
+}
+
+// Whether file is still the one at path. Another instance that compacts a
+// journal removes it; appends through the old handle would go nowhere.
+static bool still_at_path(std::FILE* file, const fs::path& path) {
+#ifndef _WIN32
+  struct stat open_stat {};
+  struct stat path_stat {};
+  if (::fstat(fileno(file), &open_stat) != 0 || ::stat(path.c_str(), &path_stat) != 0) {
+    return false;
+  }
+  return open_stat.st_dev == path_stat.st_dev && open_stat.st_ino == path_stat.st_ino;
+#else
+  // Open files cannot be removed on Windows
+  (void)file;
+  (void)path;
+  return true;
+#endif
+}
+
+// Apply one journal record to a message list. Replay must be idempotent: a
+// crash between writing the snapshot and truncating the journal leaves
+// records that are already part of the snapshot.
+static void apply_journal_record(const json& record, std::vector<Message>& messages, BlobStore* blobs) {
+  auto op = record.value("op", "");
+  if (op == "remove") {
+    auto id = record.value("id", "");
+    messages.erase(std::remove_if(messages.begin(), messages.end(),
+                                  [&id](const Message& m) {
+                                    return m.id() == id;
+                                  }),
+                   messages.end());
+    return;
+  }
+
+  if (!record.contains("message")) return;
+  auto msg = Message::from_json(record["message"], blobs);
+  auto it = std::find_if(messages.begin(), messages.end(), [&msg](const Message& m) {
+    return m.id() == msg.id();
+  });
+
+  if (it != messages.end()) {
+    *it = std::move(msg);
+  } else if (op == "save") {
+    messages.push_back(std::move(msg));
+  }
+}
+
+// Replace the message with the same id, if present
+static void replace_message(std::vector<Message>& messages, const Message& msg) {
+  for (auto& existing : messages) {
+    if (existing.id() == msg.id()) {
+      existing = msg;
+      return;
+    }
+  }
+}
+
+// Parse a messages.json array one element at a time. Each message object is
+// converted and dropped from the DOM as soon as it closes, so peak memory is
+// the resulting Messages plus one message's JSON rather than the whole tree.
+static void stream_messages_json(std::istream& in, BlobStore* blobs, const std::function<void(Message&&)>& sink) {
+  json::parser_callback_t callback = [&](int depth, json::parse_event_t event, json& parsed) {
+    if (depth == 1 && event == json::parse_event_t::object_end) {
+      sink(Message::from_json(parsed, blobs));
+      return false;
+    }
+    return true;
+  };
+  auto rest = json::parse(in, callback);  // Every element was dropped: an empty array
+}
+
+// Latest finished summary, which starts the context window (see Session::get_context_messages)
+static bool starts_context(const Message& msg) {
+  return msg.is_summary() && msg.is_finished();
+}
+
+// [first, last) of a session with total messages: [begin, begin + count), or
+// from the last message that starts the context (nullopt begin) to the end
+template <typename StartsContext>
+static std::pair<size_t, size_t> select_range(size_t total, std::optional<size_t> begin, size_t count, StartsContext&& starts_context_at) {
+  if (begin) {
+    auto first = std::min(*begin, total);
+    return {first, first + std::min(count, total - first)};
+  }
+  for (size_t i = total; i-- > 0;) {
+    if (starts_context_at(i)) return {i, total};
+  }
+  return {0, total};
+}
+
+static MessageRange slice_messages(std::vector<Message> messages, std::optional<size_t> begin, size_t count) {
+  auto [first, last] = select_range(messages.size(), begin, count, [&](size_t i) {
+    return starts_context(messages[i]);
+  });
+
+  MessageRange range;
+  range.begin = first;
+  range.total = messages.size();
+  range.messages.assign(std::make_move_iterator(messages.begin() + first), std::make_move_iterator(messages.begin() + last));
+  return range;
+}
+
+// Indent continuation lines so an element dumped on its own matches json::dump(2) of the whole array
+static std::string indent_element(const std::string& element) {
+  std::string out;
+  out.reserve(element.size() + element.size() / 16);
+  for (char c : element) {
+    out.push_back(c);
+    if (c == '\n') out += "  ";
+  }
+  return out;
+}
+
+// Move blobs from a per-session directory (older Binary snapshots) into the
+// shared one. Blobs are content-addressed, so existing files are identical.
+static void adopt_legacy_blobs(const fs::path& legacy_dir, const fs::path& shared_dir) {
+  std::error_code ec;
+  if (!fs::is_directory(legacy_dir, ec)) return;
+
+  fs::create_directories(shared_dir, ec);
+  for (const auto& entry : fs::directory_iterator(legacy_dir, ec)) {
+    auto target = shared_dir / entry.path().filename();
+    if (!fs::exists(target, ec)) {
+      fs::rename(entry.path(), target, ec);
+    }
+  }
+  fs::remove_all(legacy_dir, ec);
+}
+
 // --- JsonMessageStore ---
 
-JsonMessageStore::JsonMessageStore(const fs::path& base_dir) : base_dir_(base_dir) {
+JsonMessageStore::JsonMessageStore(const fs::path& base_dir, JsonStoreOptions options)
+    : base_dir_(base_dir), options_(options), blobs_(std::make_shared<DirectoryBlobStore>(base_dir / "blobs", options.compress)) {
   std::error_code ec;
   fs::create_directories(base_dir_, ec);
   if (ec) {
@@ -70,6 +240,30 @@ JsonMessageStore::JsonMessageStore(const fs::path& base_dir) : base_dir_(base_di
   }
 }
 
+JsonMessageStore::~JsonMessageStore() {
+  std::lock_guard lock(mutex_);
+  flush_cache();
+
+  for (auto& [id, journal] : journals_) {
+    if (journal.file) {
+      sync_file(journal.file);
+      std::fclose(journal.file);
+    }
+  }
+  journals_.clear();
+
+  if (id_index_file_) {
+    std::fclose(id_index_file_);
+    id_index_file_ = nullptr;
+  }
+
+  if (sessions_journal_.file) {
+    sync_file(sessions_journal_.file);
+    std::fclose(sessions_journal_.file);
+    sessions_journal_.file = nullptr;
+  }
+}
+
 // --- Path helpers ---
 
 fs::path JsonMessageStore::session_dir(const SessionId& id) const {
@@ -80,83 +274,441 @@ fs::path JsonMessageStore::messages_file(const SessionId& id) const {
   return session_dir(id) / "messages.json";
 }
 
+fs::path JsonMessageStore::binary_messages_file(const SessionId& id) const {
+  return session_dir(id) / "messages.bin";
+}
+
+// Binary snapshots used to keep blobs per session
+fs::path JsonMessageStore::legacy_blobs_dir(const SessionId& id) const {
+  return session_dir(id) / "blobs";
+}
+
+fs::path JsonMessageStore::journal_file(const SessionId& id) const {
+  return session_dir(id) / "messages.jsonl";
+}
+
 fs::path JsonMessageStore::sessions_index_file() const {
   return base_dir_ / "sessions.json";
 }
 
+fs::path JsonMessageStore::sessions_journal_file() const {
+  return base_dir_ / "sessions.jsonl";
+}
+
+fs::path JsonMessageStore::id_index_path() const {
+  return base_dir_ / "message_index.bin";
+}
+
 // --- Atomic write ---
 
-void JsonMessageStore::atomic_write(const fs::path& path, const std::string& content) {
+bool JsonMessageStore::atomic_write(const fs::path& path, const std::string& content) {
   auto tmp_path = path;
   tmp_path += ".tmp";
 
-  std::ofstream file(tmp_path, std::ios::trunc);
-  if (!file.is_open()) {
+  std::FILE* file = std::fopen(tmp_path.string().c_str(), "wb");
+  if (!file) {
     spdlog::warn("Failed to open temp file for writing: {}", tmp_path.string());
-    return;
+    return false;
   }
 
-  file << content;
-  file.close();
+  // The data must be on disk before the rename makes it the file of record
+  bool written = std::fwrite(content.data(), 1, content.size(), file) == content.size();
+  written = std::fflush(file) == 0 && written;
+  if (written) {
+    sync_file(file);
+  }
+  written = std::fclose(file) == 0 && written;
 
-  if (file.fail()) {
+  std::error_code ec;
+  if (!written) {
     spdlog::warn("Failed to write temp file: {}", tmp_path.string());
-    std::error_code ec;
     fs::remove(tmp_path, ec);
-    return;
+    return false;
   }
 
-  std::error_code ec;
   fs::rename(tmp_path, path, ec);
   if (ec) {
     spdlog::warn("Failed to rename temp file {} -> {}: {}", tmp_path.string(), path.string(), ec.message());
     fs::remove(tmp_path, ec);
+    return false;
   }
+
+  sync_directory(path.parent_path());
+  return true;
 }
 
 // --- Internal: messages.json ---
 
-std::vector<Message> JsonMessageStore::load_messages(const SessionId& session_id) {
-  auto path = messages_file(session_id);
-  if (!fs::exists(path)) {
-    return {};
-  }
-
-  std::ifstream file(path);
-  if (!file.is_open()) {
-    spdlog::warn("Failed to open messages file: {}", path.string());
-    return {};
+std::optional<fs::path> JsonMessageStore::snapshot_file(const SessionId& session_id, bool& binary) const {
+  // A format switch leaves at most one stale snapshot behind (if interrupted
+  // before the old file was removed); the newer one wins.
+  auto json_path = messages_file(session_id);
+  auto binary_path = binary_messages_file(session_id);
+  std::error_code json_ec, binary_ec;
+  auto json_time = fs::last_write_time(json_path, json_ec);
+  auto binary_time = fs::last_write_time(binary_path, binary_ec);
+  binary = !binary_ec && (json_ec || binary_time >= json_time);
+  if (!binary && json_ec) {
+    return std::nullopt;
   }
+  return binary ? binary_path : json_path;
+}
 
-  try {
-    json j = json::parse(file);
-    std::vector<Message> messages;
-    for (const auto& msg_json : j) {
-      messages.push_back(Message::from_json(msg_json));
+std::vector<Message> JsonMessageStore::load_messages(const SessionId& session_id) {
+  std::vector<Message> messages;
+
+  bool binary = false;
+  auto path = snapshot_file(session_id, binary);
+  if (path) {
+    // Compressed snapshots are detected by their header
+    auto file = open_decompressed(*path);
+    if (!file) {
+      spdlog::warn("Failed to open messages file: {}", path->string());
+    } else {
+      try {
+        if (binary) {
+          std::string data((std::istreambuf_iterator<char>(*file)), std::istreambuf_iterator<char>());
+          adopt_legacy_blobs(legacy_blobs_dir(session_id), blobs_->dir());
+          messages = messages_from_binary(data, blobs_.get());
+        } else {
+          stream_messages_json(*file, blobs_.get(), [&messages](Message&& msg) {
+            messages.push_back(std::move(msg));
+          });
+        }
+      } catch (const std::exception& e) {
+        spdlog::warn("Failed to parse messages file {}: {}", path->string(), e.what());
+        messages.clear();
+      }
     }
-    return messages;
-  } catch (const std::exception& e) {
-    spdlog::warn("Failed to parse messages file {}: {}", path.string(), e.what());
-    return {};
   }
+
+  replay_journal(session_id, messages);
+  return messages;
 }
 
-void JsonMessageStore::save_messages(const SessionId& session_id, const std::vector<Message>& messages) {
+bool JsonMessageStore::save_messages(const SessionId& session_id, const std::vector<Message>& messages) {
   // Ensure session directory exists
   auto dir = session_dir(session_id);
   std::error_code ec;
   fs::create_directories(dir, ec);
   if (ec) {
     spdlog::warn("Failed to create session directory {}: {}", dir.string(), ec.message());
+    return false;
+  }
+
+  // Record where each message lands so ranges can be read without parsing the rest
+  std::vector<SnapshotEntry> entries;
+  entries.reserve(messages.size());
+  std::string content;
+  bool binary = options_.format == MessageFormat::Binary;
+
+  if (binary) {
+    content = messages_to_binary(messages, write_blobs(), options_.blob_inline_limit);
+    BinaryReader in(content);
+    in.u32();  // magic
+    in.u32();  // version
+    in.u32();  // count
+    for (const auto& msg : messages) {
+      auto record = in.bytes();
+      entries.push_back({msg.id(), static_cast<uint64_t>(record.data() - content.data()), static_cast<uint32_t>(record.size()), starts_context(msg)});
+    }
+  } else {
+    content = "[";
+    for (size_t i = 0; i < messages.size(); ++i) {
+      auto element = indent_element(messages[i].to_json(write_blobs(), options_.blob_inline_limit).dump(2));
+      content += i == 0 ? "\n  " : ",\n  ";
+      entries.push_back({messages[i].id(), content.size(), static_cast<uint32_t>(element.size()), starts_context(messages[i])});
+      content += element;
+    }
+    content += messages.empty() ? "]" : "\n]";
+  }
+
+  // Index offsets refer to the decoded snapshot; CompressedFile maps them to blocks
+  if (options_.compress) {
+    content = compress(content);
+  }
+  if (!atomic_write(binary ? binary_messages_file(session_id) : messages_file(session_id), content)) {
+    // The journal still holds what the snapshot missed; keep it
+    return false;
+  }
+  fs::remove(binary ? messages_file(session_id) : binary_messages_file(session_id), ec);
+  write_snapshot_index(session_id, binary, content.size(), entries);
+
+  // The snapshot now contains everything the journal recorded
+  close_journal(session_id);
+  fs::remove(journal_file(session_id), ec);
+  return true;
+}
+
+// --- Internal: snapshot position index ---
+
+fs::path JsonMessageStore::snapshot_index_file(const SessionId& id) const {
+  return session_dir(id) / "messages.idx";
+}
+
+void JsonMessageStore::write_snapshot_index(const SessionId& session_id, bool binary, uint64_t snapshot_size,
+                                            const std::vector<SnapshotEntry>& entries) {
+  BinaryWriter out;
+  out.str().append(SNAPSHOT_INDEX_MAGIC, sizeof(SNAPSHOT_INDEX_MAGIC));
+  out.u32(SNAPSHOT_INDEX_VERSION);
+  out.u8(binary ? 1 : 0);
+  out.i64(static_cast<int64_t>(snapshot_size));
+  out.u32(static_cast<uint32_t>(entries.size()));
+  for (const auto& entry : entries) {
+    out.bytes(entry.id);
+    out.i64(static_cast<int64_t>(entry.offset));
+    out.u32(entry.length);
+    out.u8(entry.starts_context ? SNAPSHOT_ENTRY_STARTS_CONTEXT : 0);
+  }
+  atomic_write(snapshot_index_file(session_id), out.take());
+}
+
+std::optional<std::vector<JsonMessageStore::SnapshotEntry>> JsonMessageStore::load_snapshot_index(const SessionId& session_id, bool binary,
+                                                                                                  uint64_t snapshot_size) {
+  std::ifstream file(snapshot_index_file(session_id), std::ios::binary);
+  if (!file.is_open()) {
+    return std::nullopt;
+  }
+  std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  // Anything that does not describe the current snapshot exactly is ignored
+  try {
+    if (data.size() < sizeof(SNAPSHOT_INDEX_MAGIC) || data.compare(0, sizeof(SNAPSHOT_INDEX_MAGIC), SNAPSHOT_INDEX_MAGIC, sizeof(SNAPSHOT_INDEX_MAGIC)) != 0) {
+      return std::nullopt;
+    }
+    BinaryReader in(std::string_view(data).substr(sizeof(SNAPSHOT_INDEX_MAGIC)));
+    if (in.u32() != SNAPSHOT_INDEX_VERSION || in.u8() != (binary ? 1 : 0) || static_cast<uint64_t>(in.i64()) != snapshot_size) {
+      return std::nullopt;
+    }
+
+    std::vector<SnapshotEntry> entries(in.u32());
+    for (auto& entry : entries) {
+      entry.id = in.bytes();
+      entry.offset = static_cast<uint64_t>(in.i64());
+      entry.length = in.u32();
+      entry.starts_context = in.u8() & SNAPSHOT_ENTRY_STARTS_CONTEXT;
+    }
+    return entries;
+  } catch (const std::exception&) {
+    return std::nullopt;
+  }
+}
+
+MessageRange JsonMessageStore::load_range(const SessionId& session_id, std::optional<size_t> begin, size_t count) {
+  if (options_.cache_max_sessions > 0 && cache_.count(session_id)) {
+    return slice_messages(cached_session(session_id)->messages, begin, count);
+  }
+
+  bool binary = false;
+  auto snapshot = snapshot_file(session_id, binary);
+  std::vector<SnapshotEntry> entries;
+  if (snapshot) {
+    std::error_code ec;
+    auto size = fs::file_size(*snapshot, ec);
+    auto index = ec ? std::nullopt : load_snapshot_index(session_id, binary, size);
+    if (!index) {
+      // Snapshot written before the index existed, or interrupted: read it all
+      return slice_messages(load_messages(session_id), begin, count);
+    }
+    entries = std::move(*index);
+  }
+
+  // Lay the journal over the snapshot by id. Only journal messages are
+  // parsed up front; there are at most journal_compact_threshold of them.
+  struct Slot {
+    const SnapshotEntry* entry = nullptr;
+    std::optional<Message> message;
+    bool starts_context = false;
+    bool removed = false;
+  };
+  std::vector<Slot> slots;
+  slots.reserve(entries.size());
+  std::unordered_map<MessageId, size_t> slot_of;
+  for (const auto& entry : entries) {
+    slot_of[entry.id] = slots.size();
+    slots.push_back({&entry, std::nullopt, entry.starts_context});
+  }
+
+  for_each_journal_record(session_id, [&](const json& record) {
+    auto op = record.value("op", "");
+    if (op == "remove") {
+      auto it = slot_of.find(record.value("id", ""));
+      if (it != slot_of.end()) {
+        slots[it->second].removed = true;
+        slot_of.erase(it);
+      }
+      return;
+    }
+    if (!record.contains("message")) return;
+
+    auto msg = Message::from_json(record["message"], blobs_.get());
+    bool starts = starts_context(msg);
+    auto it = slot_of.find(msg.id());
+    if (it != slot_of.end()) {
+      slots[it->second].message = std::move(msg);
+      slots[it->second].starts_context = starts;
+    } else if (op == "save") {
+      slot_of[msg.id()] = slots.size();
+      slots.push_back({nullptr, std::move(msg), starts});
+    }
+  });
+  slots.erase(std::remove_if(slots.begin(), slots.end(),
+                             [](const Slot& slot) {
+                               return slot.removed;
+                             }),
+              slots.end());
+
+  auto [first, last] = select_range(slots.size(), begin, count, [&](size_t i) {
+    return slots[i].starts_context;
+  });
+
+  MessageRange range;
+  range.begin = first;
+  range.total = slots.size();
+  range.messages.reserve(last - first);
+
+  std::optional<CompressedFile> file;
+  try {
+    if (snapshot) {
+      file.emplace(*snapshot);
+    }
+    if (binary) {
+      adopt_legacy_blobs(legacy_blobs_dir(session_id), blobs_->dir());
+    }
+    for (size_t i = first; i < last; ++i) {
+      auto& slot = slots[i];
+      if (slot.message) {
+        range.messages.push_back(std::move(*slot.message));
+        continue;
+      }
+
+      auto bytes = file->read(slot.entry->offset, slot.entry->length);
+      range.messages.push_back(binary ? Message::from_binary(bytes, blobs_.get()) : Message::from_json(json::parse(bytes), blobs_.get()));
+    }
+  } catch (const std::exception& e) {
+    spdlog::warn("Failed to read indexed messages of session {}: {}", session_id, e.what());
+    return slice_messages(load_messages(session_id), begin, count);
+  }
+  return range;
+}
+
+// --- Internal: messages.jsonl journal ---
+
+void JsonMessageStore::for_each_journal_record(const SessionId& session_id, const std::function<void(const json&)>& fn) {
+  auto path = journal_file(session_id);
+  if (!fs::exists(path)) {
     return;
   }
 
-  json j = json::array();
-  for (const auto& msg : messages) {
-    j.push_back(msg.to_json());
+  // Make sure buffered records are visible to the reader
+  auto it = journals_.find(session_id);
+  if (it != journals_.end() && it->second.file) {
+    std::fflush(it->second.file);
+  }
+
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    spdlog::warn("Failed to open journal file: {}", path.string());
+    return;
+  }
+
+  std::string line;
+  size_t line_no = 0;
+  while (std::getline(file, line)) {
+    line_no++;
+    if (line.empty()) continue;
+    try {
+      fn(json::parse(line));
+    } catch (const std::exception& e) {
+      // A torn final line after a crash is expected; skip it
+      spdlog::warn("Skipping corrupt journal record {}:{}: {}", path.string(), line_no, e.what());
+    }
+  }
+}
+
+void JsonMessageStore::replay_journal(const SessionId& session_id, std::vector<Message>& messages) {
+  for_each_journal_record(session_id, [&](const json& record) {
+    apply_journal_record(record, messages, blobs_.get());
+  });
+}
+
+void JsonMessageStore::append_journal(const SessionId& session_id, const json& record) {
+  auto& journal = journals_[session_id];
+
+  if (journal.file && !still_at_path(journal.file, journal_file(session_id))) {
+    // Compacted by another instance: start a new journal
+    std::fclose(journal.file);
+    journal.file = nullptr;
+  }
+
+  if (!journal.file) {
+    auto dir = session_dir(session_id);
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    if (ec) {
+      spdlog::warn("Failed to create session directory {}: {}", dir.string(), ec.message());
+      journals_.erase(session_id);
+      return;
+    }
+
+    auto path = journal_file(session_id);
+
+    // Count records left by a previous process so compaction stays periodic
+    journal.records = 0;
+    std::ifstream existing(path);
+    std::string line;
+    while (std::getline(existing, line)) {
+      if (!line.empty()) journal.records++;
+    }
+
+    journal.file = std::fopen(path.string().c_str(), "ab");
+    if (!journal.file) {
+      spdlog::warn("Failed to open journal file for appending: {}", path.string());
+      journals_.erase(session_id);
+      return;
+    }
+  }
+
+  auto line = record.dump();
+  line += '\n';
+  if (std::fwrite(line.data(), 1, line.size(), journal.file) != line.size()) {
+    spdlog::warn("Failed to append to journal for session {}", session_id);
+    return;
+  }
+  // Flush to the OS so another instance compacting the journal includes it
+  std::fflush(journal.file);
+
+  journal.records++;
+  journal.unsynced++;
+
+  if (options_.journal_sync_every > 0 && journal.unsynced >= options_.journal_sync_every) {
+    sync_file(journal.file);
+    journal.unsynced = 0;
+  }
+
+  if (options_.journal_compact_threshold > 0 && journal.records >= options_.journal_compact_threshold) {
+    compact_journal(session_id);
   }
+}
 
-  atomic_write(messages_file(session_id), j.dump(2));
+void JsonMessageStore::compact_journal(const SessionId& session_id) {
+  if (!fs::exists(journal_file(session_id))) {
+    return;
+  }
+  // save_messages() writes the snapshot, then drops the journal
+  save_messages(session_id, load_messages(session_id));
+}
+
+void JsonMessageStore::close_journal(const SessionId& session_id) {
+  auto it = journals_.find(session_id);
+  if (it == journals_.end()) {
+    return;
+  }
+  if (it->second.file) {
+    sync_file(it->second.file);
+    std::fclose(it->second.file);
+  }
+  journals_.erase(it);
 }
 
 // --- Internal: sessions.json index ---
@@ -185,43 +737,526 @@ std::vector<SessionMeta> JsonMessageStore::load_sessions_index() {
   }
 }
 
-void JsonMessageStore::save_sessions_index(const std::vector<SessionMeta>& sessions) {
+bool JsonMessageStore::save_sessions_index(const std::vector<SessionMeta>& sessions) {
   json j = json::array();
   for (const auto& s : sessions) {
     j.push_back(s.to_json());
   }
-  atomic_write(sessions_index_file(), j.dump(2));
+  return atomic_write(sessions_index_file(), j.dump(2));
+}
+
+// --- Internal: write-back session cache ---
+
+JsonMessageStore::CachedSession* JsonMessageStore::cached_session(const SessionId& session_id) {
+  if (options_.cache_max_sessions == 0) {
+    return nullptr;
+  }
+
+  auto it = cache_.find(session_id);
+  if (it != cache_.end()) {
+    cache_lru_.splice(cache_lru_.begin(), cache_lru_, it->second.lru_pos);
+    return &it->second;
+  }
+
+  // Evict least recently used sessions, writing them back first
+  while (cache_.size() >= options_.cache_max_sessions && !cache_lru_.empty()) {
+    auto victim_id = cache_lru_.back();
+    auto victim = cache_.find(victim_id);
+    if (victim != cache_.end()) {
+      flush_session(victim_id, victim->second);
+      cache_.erase(victim);
+    }
+    cache_lru_.pop_back();
+  }
+
+  cache_lru_.push_front(session_id);
+  auto& entry = cache_[session_id];
+  entry.messages = load_messages(session_id);
+  entry.lru_pos = cache_lru_.begin();
+  return &entry;
+}
+
+void JsonMessageStore::mark_dirty(const SessionId& session_id, CachedSession& entry) {
+  if (!entry.dirty) {
+    entry.dirty = true;
+    entry.dirty_since = std::chrono::steady_clock::now();
+  }
+  entry.pending_changes++;
+
+  if (options_.cache_flush_after_changes > 0 && entry.pending_changes >= options_.cache_flush_after_changes) {
+    flush_session(session_id, entry);
+  }
+}
+
+void JsonMessageStore::flush_session(const SessionId& session_id, CachedSession& entry) {
+  if (!entry.dirty) {
+    return;
+  }
+  if (!save_messages(session_id, entry.messages)) {
+    return;  // Still dirty: retried on the next flush
+  }
+  entry.dirty = false;
+  entry.pending_changes = 0;
+}
+
+void JsonMessageStore::flush_expired() {
+  if (cache_.empty() || options_.cache_flush_interval.count() <= 0) {
+    return;
+  }
+  auto now = std::chrono::steady_clock::now();
+  for (auto& [session_id, entry] : cache_) {
+    if (entry.dirty && now - entry.dirty_since >= options_.cache_flush_interval) {
+      flush_session(session_id, entry);
+    }
+  }
+}
+
+void JsonMessageStore::flush_cache() {
+  for (auto& [session_id, entry] : cache_) {
+    flush_session(session_id, entry);
+  }
+}
+
+// --- Internal: message_index.bin ---
+//
+// Binary append-only log mapping message id -> session id:
+//   header:  "AGIX" u32 version
+//   record:  u8 op | u16 id_len | id | (put only) u16 session_len | session
+// Integers are little-endian. The log is replayed into id_index_ on first use
+// and rewritten once tombstones outnumber live entries. A missing or corrupt
+// file, or an entry pointing at the wrong session, triggers a full rebuild
+// from the session directories.
+
+static constexpr char INDEX_MAGIC[4] = {'A', 'G', 'I', 'X'};
+static constexpr uint32_t INDEX_VERSION = 1;
+static constexpr uint8_t INDEX_PUT = 1;
+static constexpr uint8_t INDEX_REMOVE = 2;
+
+static void put_u16(std::string& out, uint16_t v) {
+  out.push_back(static_cast<char>(v & 0xff));
+  out.push_back(static_cast<char>((v >> 8) & 0xff));
+}
+
+static void put_u32(std::string& out, uint32_t v) {
+  for (int i = 0; i < 4; ++i) {
+    out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+  }
+}
+
+static void put_short_string(std::string& out, const std::string& s) {
+  put_u16(out, static_cast<uint16_t>(std::min<size_t>(s.size(), UINT16_MAX)));
+  out.append(s.data(), std::min<size_t>(s.size(), UINT16_MAX));
+}
+
+static std::string encode_index_record(uint8_t op, const MessageId& id, const SessionId& session_id) {
+  std::string out;
+  out.push_back(static_cast<char>(op));
+  put_short_string(out, id);
+  if (op == INDEX_PUT) {
+    put_short_string(out, session_id);
+  }
+  return out;
+}
+
+bool JsonMessageStore::ensure_id_index() {
+  if (id_index_loaded_) {
+    return true;
+  }
+  if (!load_id_index()) {
+    rebuild_id_index();
+  }
+  return id_index_loaded_;
+}
+
+// Reads the index file; false if it is missing or not an index. Records are
+// applied to index in order; end is where the last complete one stops.
+static bool read_index_file(const fs::path& path, std::unordered_map<MessageId, SessionId>& index, size_t& records, size_t& end,
+                            size_t& size) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open()) {
+    return false;
+  }
+
+  std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  if (data.size() < 8 || data.compare(0, 4, INDEX_MAGIC, 4) != 0) {
+    return false;
+  }
+
+  auto u16_at = [&data](size_t pos) {
+    return static_cast<uint16_t>(static_cast<uint8_t>(data[pos]) | (static_cast<uint8_t>(data[pos + 1]) << 8));
+  };
+  uint32_t version = 0;
+  for (int i = 0; i < 4; ++i) {
+    version |= static_cast<uint32_t>(static_cast<uint8_t>(data[4 + i])) << (8 * i);
+  }
+  if (version != INDEX_VERSION) {
+    return false;
+  }
+
+  records = 0;
+  size_t pos = 8;
+  while (pos + 3 <= data.size()) {
+    uint8_t op = static_cast<uint8_t>(data[pos]);
+    size_t id_len = u16_at(pos + 1);
+    if (pos + 3 + id_len > data.size()) break;
+    std::string id = data.substr(pos + 3, id_len);
+    size_t next = pos + 3 + id_len;
+
+    if (op == INDEX_PUT) {
+      if (next + 2 > data.size()) break;
+      size_t sess_len = u16_at(next);
+      if (next + 2 + sess_len > data.size()) break;
+      index[id] = data.substr(next + 2, sess_len);
+      next += 2 + sess_len;
+    } else if (op == INDEX_REMOVE) {
+      index.erase(id);
+    } else {
+      return false;
+    }
+
+    records++;
+    pos = next;
+  }
+
+  end = pos;
+  size = data.size();
+  return true;
+}
+
+bool JsonMessageStore::load_id_index() {
+  // Appends reopen by path: another instance may have replaced the file
+  if (id_index_file_) {
+    std::fclose(id_index_file_);
+    id_index_file_ = nullptr;
+  }
+
+  std::unordered_map<MessageId, SessionId> index;
+  size_t records = 0, end = 0, size = 0;
+  if (!read_index_file(id_index_path(), index, records, end, size)) {
+    return false;
+  }
+
+  id_index_ = std::move(index);
+  id_index_records_ = records;
+  id_index_loaded_ = true;
+  id_index_size_ = size;
+
+  if (end != size) {
+    // Torn tail from an interrupted append; rewrite a clean copy
+    spdlog::debug("Message index has a truncated record, compacting");
+    write_id_index();
+  }
+
+  return true;
+}
+
+bool JsonMessageStore::id_index_changed_on_disk() const {
+  std::error_code ec;
+  auto size = fs::file_size(id_index_path(), ec);
+  return ec || size != id_index_size_;
+}
+
+void JsonMessageStore::rebuild_id_index() {
+  id_index_.clear();
+
+  std::error_code ec;
+  for (const auto& entry : fs::directory_iterator(base_dir_, ec)) {
+    if (!entry.is_directory() || entry.path() == blobs_->dir()) continue;
+
+    auto session_id = entry.path().filename().string();
+    if (cache_.count(session_id)) continue;
+    for (const auto& msg : load_messages(session_id)) {
+      id_index_[msg.id()] = session_id;
+    }
+  }
+
+  // Cached sessions may hold changes not yet written back
+  for (const auto& [session_id, cached] : cache_) {
+    for (const auto& msg : cached.messages) {
+      id_index_[msg.id()] = session_id;
+    }
+  }
+
+  spdlog::debug("Rebuilt message index with {} entries", id_index_.size());
+  id_index_loaded_ = true;
+  write_id_index(false);
+}
+
+void JsonMessageStore::write_id_index(bool merge_on_disk) {
+  if (id_index_file_) {
+    std::fclose(id_index_file_);
+    id_index_file_ = nullptr;
+  }
+
+  // Other instances append to the same log: fold in what they recorded
+  // rather than overwrite it with this instance's view. The file is the
+  // newer word on an id both know.
+  if (merge_on_disk) {
+    size_t records = 0, end = 0, size = 0;
+    auto merged = id_index_;
+    if (read_index_file(id_index_path(), merged, records, end, size)) {
+      id_index_ = std::move(merged);
+    }
+  }
+
+  std::string data(INDEX_MAGIC, 4);
+  put_u32(data, INDEX_VERSION);
+  for (const auto& [id, session_id] : id_index_) {
+    data += encode_index_record(INDEX_PUT, id, session_id);
+  }
+
+  atomic_write(id_index_path(), data);
+  id_index_records_ = id_index_.size();
+  id_index_size_ = data.size();
+}
+
+void JsonMessageStore::append_id_index_record(uint8_t op, const MessageId& id, const SessionId& session_id) {
+  if (!id_index_file_) {
+    id_index_file_ = std::fopen(id_index_path().string().c_str(), "ab");
+    if (!id_index_file_) {
+      spdlog::warn("Failed to open message index: {}", id_index_path().string());
+      return;
+    }
+  }
+
+  auto record = encode_index_record(op, id, session_id);
+  std::fwrite(record.data(), 1, record.size(), id_index_file_);
+  // Flush to the OS so other store instances and a restarted process see it
+  std::fflush(id_index_file_);
+  id_index_records_++;
+  id_index_size_ += record.size();
+
+  if (id_index_records_ > 2 * id_index_.size() + 1024) {
+    write_id_index();
+  }
+}
+
+std::optional<SessionId> JsonMessageStore::lookup_message_session(const MessageId& id) {
+  if (!ensure_id_index()) {
+    return std::nullopt;
+  }
+  auto it = id_index_.find(id);
+  if (it == id_index_.end()) {
+    // Another store instance may have appended since we loaded
+    if (!id_index_changed_on_disk()) {
+      return std::nullopt;
+    }
+    id_index_loaded_ = false;
+    if (!ensure_id_index()) {
+      return std::nullopt;
+    }
+    it = id_index_.find(id);
+    if (it == id_index_.end()) {
+      return std::nullopt;
+    }
+  }
+  return it->second;
+}
+
+void JsonMessageStore::index_put(const MessageId& id, const SessionId& session_id) {
+  if (!ensure_id_index()) {
+    return;
+  }
+  auto it = id_index_.find(id);
+  if (it != id_index_.end() && it->second == session_id) {
+    return;
+  }
+  id_index_[id] = session_id;
+  append_id_index_record(INDEX_PUT, id, session_id);
+}
+
+void JsonMessageStore::index_remove(const MessageId& id) {
+  if (!ensure_id_index()) {
+    return;
+  }
+  if (id_index_.erase(id) > 0) {
+    append_id_index_record(INDEX_REMOVE, id, "");
+  }
+}
+
+// --- Internal: incremental session index ---
+//
+// sessions.json holds a snapshot array; sessions.jsonl appends one
+// {"op":"upsert"|"remove", ...} record per change so save_session() is O(1).
+// The journal is folded into the snapshot every journal_compact_threshold records.
+
+std::pair<fs::file_time_type, uintmax_t> JsonMessageStore::current_sessions_signature() const {
+  std::error_code ec;
+  auto mtime = fs::last_write_time(sessions_index_file(), ec);
+  if (ec) mtime = fs::file_time_type::min();
+  auto size = fs::file_size(sessions_journal_file(), ec);
+  if (ec) size = 0;
+  return {mtime, size};
+}
+
+void JsonMessageStore::ensure_sessions_loaded() {
+  auto signature = current_sessions_signature();
+  if (sessions_loaded_ && signature == sessions_signature_) {
+    return;
+  }
+
+  // The journal may have been folded in and removed by another instance;
+  // appends reopen it by path
+  if (sessions_journal_.file) {
+    if (sessions_journal_.unsynced > 0) sync_file(sessions_journal_.file);
+    std::fclose(sessions_journal_.file);
+    sessions_journal_.file = nullptr;
+  }
+  sessions_journal_.unsynced = 0;
+
+  sessions_.clear();
+  session_pos_.clear();
+  sessions_by_updated_.clear();
+  for (const auto& meta : load_sessions_index()) {
+    upsert_session_entry(meta);
+  }
+
+  sessions_journal_.records = 0;
+  std::ifstream journal(sessions_journal_file());
+  std::string line;
+  while (std::getline(journal, line)) {
+    if (line.empty()) continue;
+    try {
+      auto record = json::parse(line);
+      if (record.value("op", "") == "remove") {
+        erase_session_entry(record.value("id", ""));
+      } else if (record.contains("session")) {
+        upsert_session_entry(SessionMeta::from_json(record["session"]));
+      }
+      sessions_journal_.records++;
+    } catch (const std::exception& e) {
+      spdlog::warn("Skipping corrupt session index record: {}", e.what());
+    }
+  }
+
+  sessions_loaded_ = true;
+  sessions_signature_ = signature;
+}
+
+void JsonMessageStore::upsert_session_entry(const SessionMeta& meta) {
+  auto it = session_pos_.find(meta.id);
+  if (it != session_pos_.end()) {
+    auto& existing = sessions_[it->second];
+    sessions_by_updated_.erase({existing.updated_at, existing.id});
+    existing = meta;
+  } else {
+    session_pos_[meta.id] = sessions_.size();
+    sessions_.push_back(meta);
+  }
+  sessions_by_updated_.insert({meta.updated_at, meta.id});
+}
+
+bool JsonMessageStore::erase_session_entry(const SessionId& id) {
+  auto it = session_pos_.find(id);
+  if (it == session_pos_.end()) {
+    return false;
+  }
+
+  auto pos = it->second;
+  sessions_by_updated_.erase({sessions_[pos].updated_at, id});
+  sessions_.erase(sessions_.begin() + pos);
+  session_pos_.erase(it);
+  for (size_t i = pos; i < sessions_.size(); ++i) {
+    session_pos_[sessions_[i].id] = i;
+  }
+  return true;
+}
+
+void JsonMessageStore::append_sessions_journal(const json& record) {
+  auto& journal = sessions_journal_;
+  if (!journal.file) {
+    journal.file = std::fopen(sessions_journal_file().string().c_str(), "ab");
+    if (!journal.file) {
+      // Fall back to rewriting the snapshot
+      spdlog::warn("Failed to open session index journal: {}", sessions_journal_file().string());
+      compact_sessions_index();
+      return;
+    }
+  }
+
+  auto line = record.dump();
+  line += '\n';
+  std::fwrite(line.data(), 1, line.size(), journal.file);
+  std::fflush(journal.file);
+  sessions_signature_.second += line.size();
+  journal.records++;
+  journal.unsynced++;
+
+  if (options_.journal_sync_every > 0 && journal.unsynced >= options_.journal_sync_every) {
+    sync_file(journal.file);
+    journal.unsynced = 0;
+  }
+
+  if (options_.journal_compact_threshold > 0 && journal.records >= options_.journal_compact_threshold) {
+    compact_sessions_index();
+  }
+}
+
+void JsonMessageStore::compact_sessions_index() {
+  if (!save_sessions_index(sessions_)) {
+    return;  // The journal still holds the changes
+  }
+
+  if (sessions_journal_.file) {
+    std::fclose(sessions_journal_.file);
+    sessions_journal_.file = nullptr;
+  }
+  std::error_code ec;
+  fs::remove(sessions_journal_file(), ec);
+  sessions_journal_.records = 0;
+  sessions_journal_.unsynced = 0;
+  sessions_signature_ = current_sessions_signature();
 }
 
 // --- MessageStore interface ---
 
 void JsonMessageStore::save(const Message& msg) {
   std::lock_guard lock(mutex_);
+  flush_expired();
 
   auto session_id = msg.session_id();
-  auto messages = load_messages(session_id);
-  messages.push_back(msg);
-  save_messages(session_id, messages);
+  auto* cached = cached_session(session_id);
+
+  if (options_.mode == StoreMode::Journal) {
+    append_journal(session_id, {{"op", "save"}, {"message", msg.to_json(write_blobs(), options_.blob_inline_limit)}});
+    if (cached) cached->messages.push_back(msg);
+  } else if (cached) {
+    cached->messages.push_back(msg);
+    mark_dirty(session_id, *cached);
+  } else {
+    auto messages = load_messages(session_id);
+    messages.push_back(msg);
+    save_messages(session_id, messages);
+  }
+
+  index_put(msg.id(), session_id);
 }
 
 std::optional<Message> JsonMessageStore::get(const MessageId& id) {
   std::lock_guard lock(mutex_);
+  flush_expired();
 
-  // Scan all session directories for the message
-  if (!fs::exists(base_dir_)) {
-    return std::nullopt;
-  }
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    auto session_id = lookup_message_session(id);
+    if (!session_id) {
+      return std::nullopt;
+    }
 
-  for (const auto& entry : fs::directory_iterator(base_dir_)) {
-    if (!entry.is_directory()) continue;
+    std::vector<Message> loaded;
+    auto* cached = cached_session(*session_id);
+    const auto& messages = cached ? cached->messages : loaded;
+    if (!cached) {
+      loaded = load_messages(*session_id);
+    }
 
-    auto session_id = entry.path().filename().string();
-    auto messages = load_messages(session_id);
     for (const auto& msg : messages) {
       if (msg.id() == id) {
         return msg;
       }
     }
+
+    // Index points at a session that no longer holds the message
+    rebuild_id_index();
   }
 
   return std::nullopt;
@@ -229,47 +1264,85 @@ std::optional<Message> JsonMessageStore::get(const MessageId& id) {
 
 std::vector<Message> JsonMessageStore::list(const SessionId& session_id) {
   std::lock_guard lock(mutex_);
+  flush_expired();
+
+  if (auto* cached = cached_session(session_id)) {
+    return cached->messages;
+  }
   return load_messages(session_id);
 }
 
+MessageRange JsonMessageStore::list_range(const SessionId& session_id, size_t begin, size_t count) {
+  std::lock_guard lock(mutex_);
+  flush_expired();
+  return load_range(session_id, begin, count);
+}
+
+MessageRange JsonMessageStore::list_since_last_summary(const SessionId& session_id) {
+  std::lock_guard lock(mutex_);
+  flush_expired();
+  return load_range(session_id, std::nullopt, 0);
+}
+
 void JsonMessageStore::update(const Message& msg) {
   std::lock_guard lock(mutex_);
+  flush_expired();
 
   auto session_id = msg.session_id();
-  auto messages = load_messages(session_id);
+  auto* cached = cached_session(session_id);
 
-  for (auto& existing : messages) {
-    if (existing.id() == msg.id()) {
-      existing = msg;
-      break;
-    }
+  if (options_.mode == StoreMode::Journal) {
+    append_journal(session_id, {{"op", "update"}, {"message", msg.to_json(write_blobs(), options_.blob_inline_limit)}});
+    if (cached) replace_message(cached->messages, msg);
+    return;
+  }
+
+  if (cached) {
+    replace_message(cached->messages, msg);
+    mark_dirty(session_id, *cached);
+    return;
   }
 
+  auto messages = load_messages(session_id);
+  replace_message(messages, msg);
   save_messages(session_id, messages);
 }
 
 void JsonMessageStore::remove(const MessageId& id) {
   std::lock_guard lock(mutex_);
+  flush_expired();
 
-  // Scan all session directories for the message
-  if (!fs::exists(base_dir_)) {
-    return;
-  }
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    auto session_id = lookup_message_session(id);
+    if (!session_id) {
+      return;
+    }
 
-  for (const auto& entry : fs::directory_iterator(base_dir_)) {
-    if (!entry.is_directory()) continue;
+    std::vector<Message> loaded;
+    auto* cached = cached_session(*session_id);
+    auto& messages = cached ? cached->messages : loaded;
+    if (!cached) {
+      loaded = load_messages(*session_id);
+    }
 
-    auto session_id = entry.path().filename().string();
-    auto messages = load_messages(session_id);
     auto it = std::remove_if(messages.begin(), messages.end(), [&id](const Message& msg) {
       return msg.id() == id;
     });
 
     if (it != messages.end()) {
       messages.erase(it, messages.end());
-      save_messages(session_id, messages);
+      if (options_.mode == StoreMode::Journal) {
+        append_journal(*session_id, {{"op", "remove"}, {"id", id}});
+      } else if (cached) {
+        mark_dirty(*session_id, *cached);
+      } else {
+        save_messages(*session_id, messages);
+      }
+      index_remove(id);
       return;
     }
+
+    rebuild_id_index();
   }
 }
 
@@ -278,56 +1351,79 @@ void JsonMessageStore::remove(const MessageId& id) {
 void JsonMessageStore::save_session(const SessionMeta& meta) {
   std::lock_guard lock(mutex_);
 
-  auto sessions = load_sessions_index();
+  ensure_sessions_loaded();
+  upsert_session_entry(meta);
+  append_sessions_journal({{"op", "upsert"}, {"session", meta.to_json()}});
+}
 
-  // Update existing or append
-  bool found = false;
-  for (auto& s : sessions) {
-    if (s.id == meta.id) {
-      s = meta;
-      found = true;
-      break;
-    }
-  }
+std::optional<SessionMeta> JsonMessageStore::get_session(const SessionId& id) {
+  std::lock_guard lock(mutex_);
 
-  if (!found) {
-    sessions.push_back(meta);
+  ensure_sessions_loaded();
+  auto it = session_pos_.find(id);
+  if (it == session_pos_.end()) {
+    return std::nullopt;
   }
+  return sessions_[it->second];
+}
 
-  save_sessions_index(sessions);
+std::vector<SessionMeta> JsonMessageStore::list_sessions() {
+  std::lock_guard lock(mutex_);
+  ensure_sessions_loaded();
+  return sessions_;
 }
 
-std::optional<SessionMeta> JsonMessageStore::get_session(const SessionId& id) {
+std::vector<SessionMeta> JsonMessageStore::list_sessions(size_t offset, size_t limit) {
   std::lock_guard lock(mutex_);
+  ensure_sessions_loaded();
 
-  auto sessions = load_sessions_index();
-  for (const auto& s : sessions) {
-    if (s.id == id) {
-      return s;
-    }
+  std::vector<SessionMeta> page;
+  if (offset >= sessions_by_updated_.size()) {
+    return page;
   }
 
-  return std::nullopt;
+  auto it = std::next(sessions_by_updated_.begin(), static_cast<std::ptrdiff_t>(offset));
+  for (; it != sessions_by_updated_.end() && page.size() < limit; ++it) {
+    page.push_back(sessions_[session_pos_.at(it->second)]);
+  }
+  return page;
 }
 
-std::vector<SessionMeta> JsonMessageStore::list_sessions() {
+size_t JsonMessageStore::session_count() {
   std::lock_guard lock(mutex_);
-  return load_sessions_index();
+  ensure_sessions_loaded();
+  return sessions_.size();
 }
 
 void JsonMessageStore::remove_session(const SessionId& id) {
   std::lock_guard lock(mutex_);
 
   // Remove from index
-  auto sessions = load_sessions_index();
-  sessions.erase(std::remove_if(sessions.begin(), sessions.end(),
-                                [&id](const SessionMeta& s) {
-                                  return s.id == id;
-                                }),
-                 sessions.end());
-  save_sessions_index(sessions);
+  ensure_sessions_loaded();
+  if (erase_session_entry(id)) {
+    append_sessions_journal({{"op", "remove"}, {"id", id}});
+  }
+
+  // Drop the session's messages from the id index
+  if (ensure_id_index()) {
+    // Collected first: an append may compact, which reloads id_index_
+    std::vector<MessageId> removed;
+    for (const auto& [message_id, session_id] : id_index_) {
+      if (session_id == id) removed.push_back(message_id);
+    }
+    for (const auto& message_id : removed) {
+      id_index_.erase(message_id);
+      append_id_index_record(INDEX_REMOVE, message_id, "");
+    }
+  }
 
   // Remove session directory
+  auto cached = cache_.find(id);
+  if (cached != cache_.end()) {
+    cache_lru_.erase(cached->second.lru_pos);
+    cache_.erase(cached);
+  }
+  close_journal(id);
   auto dir = session_dir(id);
   std::error_code ec;
   fs::remove_all(dir, ec);
@@ -336,4 +1432,21 @@ void JsonMessageStore::remove_session(const SessionId& id) {
   }
 }
 
+void JsonMessageStore::flush() {
+  std::lock_guard lock(mutex_);
+  flush_cache();
+
+  for (auto& [id, journal] : journals_) {
+    if (journal.file && journal.unsynced > 0) {
+      sync_file(journal.file);
+      journal.unsynced = 0;
+    }
+  }
+}
+
+void JsonMessageStore::compact(const SessionId& session_id) {
+  std::lock_guard lock(mutex_);
+  compact_journal(session_id);
+}
+
 }  // namespace agent
@@ -1,7 +1,14 @@
 #pragma once
 
+#include <chrono>
+#include <cstdio>
 #include <filesystem>
+#include <functional>
+#include <list>
+#include <map>
 #include <mutex>
+#include <set>
+#include <unordered_map>
 #include <vector>
 
 #include "message.hpp"
@@ -23,15 +30,76 @@ struct SessionMeta {
   static SessionMeta from_json(const json& j);
 };
 
+// Slice of a session's messages
+struct MessageRange {
+  std::vector<Message> messages;
+  size_t begin = 0;  // Position of messages[0] within the session
+  size_t total = 0;  // Messages in the session
+};
+
+// How per-session messages are persisted
+enum class StoreMode {
+  Snapshot,  // Rewrite messages.json on every change
+  Journal    // Append to messages.jsonl, periodically compacted into messages.json
+};
+
+// Encoding of messages snapshots
+enum class MessageFormat {
+  Json,   // messages.json (pretty-printed array)
+  Binary  // messages.bin (Message::to_binary records)
+};
+
+struct JsonStoreOptions {
+  StoreMode mode = StoreMode::Snapshot;
+  MessageFormat format = MessageFormat::Json;
+  size_t blob_inline_limit = 0;             // Store larger payloads in blobs/ (0 = keep everything inline)
+  size_t journal_sync_every = 32;           // fsync a journal after this many records (0 = only on flush())
+  size_t journal_compact_threshold = 1000;  // Fold a journal into messages.json after this many records
+  bool compress = false;                    // Block-compress snapshots and blobs (either form is read back)
+
+  // Write-back cache of parsed sessions (0 = disabled). The cache assumes this
+  // store is the only writer for the sessions it holds.
+  size_t cache_max_sessions = 0;               // LRU-evict beyond this many cached sessions
+  size_t cache_flush_after_changes = 64;       // Flush a dirty session after this many changes (0 = never)
+  std::chrono::milliseconds cache_flush_interval{5000};  // Flush sessions dirty for longer than this (0 = never)
+};
+
 // JSON file-based message store
 // Storage layout:
 //   base_dir/
-//     sessions.json                  — session index
+//     sessions.json                  — session index (snapshot)
+//     sessions.jsonl                 — session index upserts/removals since the snapshot
+//     message_index.bin              — message id -> session id index
+//     blobs/{sha256}                 — content-addressed payloads shared by all sessions (opt-in)
 //     {session_id}/
-//       messages.json                — messages for that session
+//       messages.json                — messages for that session (snapshot, Json format)
+//       messages.bin                 — messages for that session (snapshot, Binary format)
+//       messages.idx                 — byte range of each message in the snapshot
+//       messages.jsonl               — journal of changes since the snapshot (Journal mode)
+//
+// With blob_inline_limit set, payloads above it are written once to blobs/
+// and referenced by hash, so repeated tool outputs cost one file. Loaded
+// messages keep them as LazyText references that are only read when accessed.
+// Blobs outlive the sessions that reference them: nothing collects them, so
+// the option is off by default. References already on disk are read either way.
+//
+// With compress, snapshots and blobs are block-compressed (compress.hpp) and
+// readers detect either form. The journal stays plain appendable text; it is
+// bounded by journal_compact_threshold and folded into the snapshot.
+//
+// Loading always reads the snapshot (either format) and replays the journal
+// on top of it, so any mode/format combination can open a directory written
+// by another. The journal itself is always JSON lines.
+//
+// With cache_max_sessions > 0, parsed sessions stay in memory. Journal mode
+// still appends every change (write-through); Snapshot mode marks the session
+// dirty and rewrites messages.json according to the flush policy, on eviction,
+// on flush() and on destruction.
 class JsonMessageStore : public MessageStore {
  public:
-  explicit JsonMessageStore(const std::filesystem::path& base_dir);
+  explicit JsonMessageStore(const std::filesystem::path& base_dir, JsonStoreOptions options = {});
+
+  ~JsonMessageStore() override;
 
   // MessageStore interface
   void save(const Message& msg) override;
@@ -40,31 +108,156 @@ class JsonMessageStore : public MessageStore {
   void update(const Message& msg) override;
   void remove(const MessageId& id) override;
 
+  // Messages [begin, begin + count) of a session. Snapshots carry a position
+  // index (messages.idx), so only the returned messages are parsed.
+  MessageRange list_range(const SessionId& session_id, size_t begin, size_t count);
+
+  // The latest finished compaction summary and everything after it (the whole
+  // session if there is none): what Session::get_context_messages() works with
+  MessageRange list_since_last_summary(const SessionId& session_id);
+
   // Session management (extra methods beyond MessageStore)
   void save_session(const SessionMeta& meta);
   std::optional<SessionMeta> get_session(const SessionId& id);
-  std::vector<SessionMeta> list_sessions();
+  std::vector<SessionMeta> list_sessions();  // In creation order
   void remove_session(const SessionId& id);
 
+  // Page of sessions ordered by updated_at, most recent first
+  std::vector<SessionMeta> list_sessions(size_t offset, size_t limit);
+  size_t session_count();
+
+  // Write dirty cached sessions and fsync pending journal records
+  void flush();
+
+  // Fold a session's journal into messages.json
+  void compact(const SessionId& session_id);
+
+  const JsonStoreOptions& options() const {
+    return options_;
+  }
+
+  // Shared content-addressed store behind blobs/
+  const std::shared_ptr<DirectoryBlobStore>& blob_store() const {
+    return blobs_;
+  }
+
  private:
   std::filesystem::path base_dir_;
+  JsonStoreOptions options_;
+  std::shared_ptr<DirectoryBlobStore> blobs_;
   mutable std::mutex mutex_;
 
+  // Where writes put large payloads: nullptr unless blob_inline_limit is set
+  BlobStore* write_blobs() const {
+    return options_.blob_inline_limit > 0 ? blobs_.get() : nullptr;
+  }
+
+  // Open journal handle for a session
+  struct Journal {
+    std::FILE* file = nullptr;
+    size_t records = 0;   // Records in the journal since the last compaction
+    size_t unsynced = 0;  // Records written since the last fsync
+  };
+  std::map<SessionId, Journal> journals_;
+
+  // Cached parsed session
+  struct CachedSession {
+    std::vector<Message> messages;
+    bool dirty = false;
+    size_t pending_changes = 0;  // Changes since the last flush
+    std::chrono::steady_clock::time_point dirty_since;
+    std::list<SessionId>::iterator lru_pos;
+  };
+  std::unordered_map<SessionId, CachedSession> cache_;
+  std::list<SessionId> cache_lru_;  // Most recently used first
+
+  // Message id -> session id, loaded lazily from message_index.bin
+  std::unordered_map<MessageId, SessionId> id_index_;
+  bool id_index_loaded_ = false;
+  std::FILE* id_index_file_ = nullptr;
+  size_t id_index_records_ = 0;  // Records in the on-disk log, including tombstones
+  uintmax_t id_index_size_ = 0;  // Bytes of the on-disk log reflected in id_index_
+
+  // In-memory view of sessions.json + sessions.jsonl, reloaded when another
+  // store instance changes either file
+  std::vector<SessionMeta> sessions_;
+  std::unordered_map<SessionId, size_t> session_pos_;  // id -> index in sessions_
+  std::set<std::pair<Timestamp, SessionId>, std::greater<>> sessions_by_updated_;
+  bool sessions_loaded_ = false;
+  Journal sessions_journal_;
+  std::pair<std::filesystem::file_time_type, uintmax_t> sessions_signature_;  // snapshot mtime, journal size
+
   // Path helpers
   std::filesystem::path session_dir(const SessionId& id) const;
   std::filesystem::path messages_file(const SessionId& id) const;
+  std::filesystem::path binary_messages_file(const SessionId& id) const;
+  std::filesystem::path legacy_blobs_dir(const SessionId& id) const;
+  std::filesystem::path journal_file(const SessionId& id) const;
   std::filesystem::path sessions_index_file() const;
+  std::filesystem::path sessions_journal_file() const;
+  std::filesystem::path id_index_path() const;
 
-  // Atomic write: write to .tmp then rename
-  void atomic_write(const std::filesystem::path& path, const std::string& content);
+  // Atomic write: write to .tmp, fsync, then rename. False (and the old file
+  // untouched) if any step failed.
+  bool atomic_write(const std::filesystem::path& path, const std::string& content);
 
-  // Internal: load/save messages.json for a session
+  // Internal: load/save messages.json for a session. messages.json is parsed
+  // as a stream, one message at a time. save_messages() drops the journal
+  // only once the snapshot is on disk, and returns false if it is not.
+  std::optional<std::filesystem::path> snapshot_file(const SessionId& session_id, bool& binary) const;
   std::vector<Message> load_messages(const SessionId& session_id);
-  void save_messages(const SessionId& session_id, const std::vector<Message>& messages);
+  bool save_messages(const SessionId& session_id, const std::vector<Message>& messages);
+
+  // Internal: messages.jsonl journal
+  void replay_journal(const SessionId& session_id, std::vector<Message>& messages);
+  void for_each_journal_record(const SessionId& session_id, const std::function<void(const json&)>& fn);
+  void append_journal(const SessionId& session_id, const json& record);
+  void compact_journal(const SessionId& session_id);
+  void close_journal(const SessionId& session_id);
+
+  // Internal: snapshot position index (messages.idx), written with every snapshot
+  struct SnapshotEntry {
+    MessageId id;
+    uint64_t offset = 0;  // Byte range of the message within the snapshot
+    uint32_t length = 0;
+    bool starts_context = false;  // Finished compaction summary
+  };
+  std::filesystem::path snapshot_index_file(const SessionId& id) const;
+  void write_snapshot_index(const SessionId& session_id, bool binary, uint64_t snapshot_size, const std::vector<SnapshotEntry>& entries);
+  std::optional<std::vector<SnapshotEntry>> load_snapshot_index(const SessionId& session_id, bool binary, uint64_t snapshot_size);
+  MessageRange load_range(const SessionId& session_id, std::optional<size_t> begin, size_t count);
+
+  // Internal: write-back session cache
+  CachedSession* cached_session(const SessionId& session_id);
+  void mark_dirty(const SessionId& session_id, CachedSession& entry);
+  void flush_session(const SessionId& session_id, CachedSession& entry);
+  void flush_expired();
+  void flush_cache();
+
+  // Internal: message_index.bin (id -> session)
+  bool ensure_id_index();
+  bool load_id_index();
+  bool id_index_changed_on_disk() const;
+  void rebuild_id_index();
+  // Rewrites the log compacted; merge_on_disk folds in records other
+  // instances appended, which a rebuild from the session files already has
+  void write_id_index(bool merge_on_disk = true);
+  void append_id_index_record(uint8_t op, const MessageId& id, const SessionId& session_id);
+  std::optional<SessionId> lookup_message_session(const MessageId& id);
+  void index_put(const MessageId& id, const SessionId& session_id);
+  void index_remove(const MessageId& id);
 
   // Internal: load/save sessions.json index
   std::vector<SessionMeta> load_sessions_index();
-  void save_sessions_index(const std::vector<SessionMeta>& sessions);
+  bool save_sessions_index(const std::vector<SessionMeta>& sessions);
+
+  // Internal: incremental session index
+  std::pair<std::filesystem::file_time_type, uintmax_t> current_sessions_signature() const;
+  void ensure_sessions_loaded();
+  void upsert_session_entry(const SessionMeta& meta);
+  bool erase_session_entry(const SessionId& id);
+  void append_sessions_journal(const json& record);
+  void compact_sessions_index();
 };
 
 }  // namespace agent
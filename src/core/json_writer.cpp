@@ -0,0 +1,225 @@
+#include "json_writer.hpp"
+
+#include <cstring>
+
+namespace agent {
+
+// --- String escaping ---
+
+static constexpr uint64_t ONES = 0x0101010101010101ull;
+static constexpr uint64_t HIGH_BITS = 0x8080808080808080ull;
+
+// Whether any byte of word is below n (n <= 0x80)
+static constexpr uint64_t has_less(uint64_t word, uint8_t n) {
+  return (word - ONES * n) & ~word & HIGH_BITS;
+}
+
+static constexpr uint64_t has_byte(uint64_t word, uint8_t byte) {
+  return has_less(word ^ (ONES * byte), 1);
+}
+
+// Bytes that are copied as is: printable ASCII other than '"' and '\'
+static bool is_plain(unsigned char c) {
+  return c >= 0x20 && c < 0x80 && c != '"' && c != '\\';
+}
+
+// Length of the run of plain bytes at the start of text
+static size_t plain_run(std::string_view text) {
+  size_t i = 0;
+  // 8 bytes at a time while none needs attention
+  while (i + 8 <= text.size()) {
+    uint64_t word;
+    std::memcpy(&word, text.data() + i, sizeof(word));
+    if ((word & HIGH_BITS) || has_less(word, 0x20) || has_byte(word, '"') || has_byte(word, '\\')) break;
+    i += 8;
+  }
+  while (i < text.size() && is_plain(static_cast<unsigned char>(text[i]))) ++i;
+  return i;
+}
+
+// Length of the valid UTF-8 sequence at the start of text, 0 if invalid
+static size_t utf8_sequence(std::string_view text) {
+  auto byte = [&](size_t i) {
+    return static_cast<unsigned char>(text[i]);
+  };
+  auto continuation = [&](size_t i) {
+    return i < text.size() && (byte(i) & 0xC0) == 0x80;
+  };
+
+  unsigned char c = byte(0);
+  if (c >= 0xC2 && c <= 0xDF) {
+    return continuation(1) ? 2 : 0;
+  }
+  if (c >= 0xE0 && c <= 0xEF) {
+    if (!continuation(1) || !continuation(2)) return 0;
+    uint32_t cp = ((c & 0x0F) << 12) | ((byte(1) & 0x3F) << 6) | (byte(2) & 0x3F);
+    return cp >= 0x800 && (cp < 0xD800 || cp > 0xDFFF) ? 3 : 0;
+  }
+  if (c >= 0xF0 && c <= 0xF4) {
+    if (!continuation(1) || !continuation(2) || !continuation(3)) return 0;
+    uint32_t cp = ((c & 0x07) << 18) | ((byte(1) & 0x3F) << 12) | ((byte(2) & 0x3F) << 6) | (byte(3) & 0x3F);
+    return cp >= 0x10000 && cp <= 0x10FFFF ? 4 : 0;
+  }
+  return 0;
+}
+
+void write_json_string(std::string& out, std::string_view text) {
+  static constexpr char HEX[] = "0123456789abcdef";
+
+  out.push_back('"');
+  while (!text.empty()) {
+    auto run = plain_run(text);
+    out.append(text.data(), run);
+    text.remove_prefix(run);
+    if (text.empty()) break;
+
+    auto c = static_cast<unsigned char>(text[0]);
+    size_t consumed = 1;
+    switch (c) {
+      case '"':
+        out += "\\\"";
+        break;
+      case '\\':
+        out += "\\\\";
+        break;
+      case '\b':
+        out += "\\b";
+        break;
+      case '\f':
+        out += "\\f";
+        break;
+      case '\n':
+        out += "\\n";
+        break;
+      case '\r':
+        out += "\\r";
+        break;
+      case '\t':
+        out += "\\t";
+        break;
+      default:
+        if (c < 0x20) {
+          out += "\\u00";
+          out.push_back(HEX[c >> 4]);
+          out.push_back(HEX[c & 0xF]);
+        } else if (auto length = utf8_sequence(text)) {
+          out.append(text.data(), length);
+          consumed = length;
+        } else {
+          out += "\xEF\xBF\xBD";  // U+FFFD
+        }
+        break;
+    }
+    text.remove_prefix(consumed);
+  }
+  out.push_back('"');
+}
+
+// --- JsonWriter ---
+
+void JsonWriter::before_value() {
+  if (after_key_) {
+    after_key_ = false;
+    return;
+  }
+  if (!has_element_.empty()) {
+    if (has_element_.back()) out_.push_back(',');
+    has_element_.back() = true;
+  }
+}
+
+JsonWriter& JsonWriter::begin_object() {
+  before_value();
+  out_.push_back('{');
+  has_element_.push_back(false);
+  return *this;
+}
+
+JsonWriter& JsonWriter::end_object() {
+  out_.push_back('}');
+  has_element_.pop_back();
+  return *this;
+}
+
+JsonWriter& JsonWriter::begin_array() {
+  before_value();
+  out_.push_back('[');
+  has_element_.push_back(false);
+  return *this;
+}
+
+JsonWriter& JsonWriter::end_array() {
+  out_.push_back(']');
+  has_element_.pop_back();
+  return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name) {
+  before_value();
+  write_json_string(out_, name);
+  out_.push_back(':');
+  after_key_ = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text) {
+  before_value();
+  write_json_string(out_, text);
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(bool b) {
+  before_value();
+  out_ += b ? "true" : "false";
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(double number) {
+  before_value();
+  out_ += json(number).dump();  // Same shortest round-trip form as dump()
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(const json& j) {
+  switch (j.type()) {
+    case json::value_t::object:
+      begin_object();
+      for (auto it = j.begin(); it != j.end(); ++it) {
+        key(it.key());
+        value(it.value());
+      }
+      return end_object();
+    case json::value_t::array:
+      begin_array();
+      for (const auto& item : j) {
+        value(item);
+      }
+      return end_array();
+    case json::value_t::string:
+      return value(std::string_view(j.get_ref<const std::string&>()));
+    case json::value_t::boolean:
+      return value(j.get<bool>());
+    case json::value_t::number_integer:
+      return value(j.get<int64_t>());
+    case json::value_t::number_unsigned:
+      return value(j.get<uint64_t>());
+    case json::value_t::number_float:
+      return value(j.get<double>());
+    default:
+      return null();
+  }
+}
+
+JsonWriter& JsonWriter::null() {
+  before_value();
+  out_ += "null";
+  return *this;
+}
+
+JsonWriter& JsonWriter::raw(std::string_view json_text) {
+  before_value();
+  out_.append(json_text);
+  return *this;
+}
+
+}  // namespace agent
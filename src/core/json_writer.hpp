@@ -0,0 +1,78 @@
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace agent {
+
+using json = nlohmann::json;
+
+// Writes compact JSON straight into a string, without building a json tree.
+//
+// Output matches json::dump() for the same document, except that invalid
+// UTF-8 is replaced with U+FFFD instead of throwing. Commas are inserted
+// automatically; inside an object every value must follow a key().
+
+class JsonWriter {
+ public:
+  explicit JsonWriter(std::string& out) : out_(out) {}
+
+  JsonWriter& begin_object();
+  JsonWriter& end_object();
+  JsonWriter& begin_array();
+  JsonWriter& end_array();
+
+  JsonWriter& key(std::string_view name);
+
+  JsonWriter& value(std::string_view text);
+
+  JsonWriter& value(const char* text) {
+    return value(std::string_view(text));
+  }
+
+  JsonWriter& value(const std::string& text) {
+    return value(std::string_view(text));
+  }
+
+  JsonWriter& value(bool b);
+
+  template <std::integral T>
+    requires(!std::same_as<T, bool>)
+  JsonWriter& value(T number) {
+    before_value();
+    out_ += std::to_string(number);
+    return *this;
+  }
+
+  JsonWriter& value(double number);
+
+  JsonWriter& value(const json& j);
+
+  JsonWriter& null();
+
+  // Value that is already serialized JSON
+  JsonWriter& raw(std::string_view json_text);
+
+  // key() followed by value()
+  template <typename T>
+  JsonWriter& member(std::string_view name, T&& v) {
+    key(name);
+    return value(std::forward<T>(v));
+  }
+
+ private:
+  void before_value();
+
+  std::string& out_;
+  std::vector<bool> has_element_;  // Per open container
+  bool after_key_ = false;
+};
+
+// Appends text as a quoted JSON string
+void write_json_string(std::string& out, std::string_view text);
+
+}  // namespace agent
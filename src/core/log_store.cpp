@@ -0,0 +1,576 @@
+#include "log_store.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "binary_codec.hpp"
+#include "compress.hpp"
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+namespace agent {
+
+namespace fs = std::filesystem;
+
+// Record ops
+static constexpr uint8_t RECORD_SAVE = 1;
+static constexpr uint8_t RECORD_UPDATE = 2;
+static constexpr uint8_t RECORD_REMOVE = 3;
+static constexpr uint8_t RECORD_COMPRESSED = 0x80;  // Flag: message is u32 raw_size | bytes LZ block
+
+static constexpr size_t COMPRESS_MIN_MESSAGE = 256;  // Smaller messages are not worth compressing
+
+static constexpr size_t RECORD_HEADER_SIZE = 8;  // u32 body_length | u32 crc32
+
+static constexpr const char* SEGMENT_EXTENSION = ".seg";
+
+// --- Helpers ---
+
+static uint32_t crc32(std::string_view data) {
+  static const auto table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) {
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      }
+      t[i] = c;
+    }
+    return t;
+  }();
+
+  uint32_t crc = 0xFFFFFFFFu;
+  for (unsigned char ch : data) {
+    crc = table[(crc ^ ch) & 0xff] ^ (crc >> 8);
+  }
+  return crc ^ 0xFFFFFFFFu;
+}
+
+static uint32_t read_u32(const char* p) {
+  uint32_t v = 0;
+  for (int i = 0; i < 4; ++i) {
+    v |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+  }
+  return v;
+}
+
+static std::string encode_record(std::string_view body) {
+  BinaryWriter out;
+  out.u32(static_cast<uint32_t>(body.size()));
+  out.u32(crc32(body));
+  out.str().append(body.data(), body.size());
+  return out.take();
+}
+
+static std::string encode_body(uint8_t op, const MessageId& id, const SessionId& session_id, const Message* msg, bool compress) {
+  BinaryWriter out;
+  out.u8(op);
+  out.bytes(id);
+  out.bytes(session_id);
+  if (!msg) {
+    return out.take();
+  }
+
+  auto raw = msg->to_binary();
+  if (compress && raw.size() >= COMPRESS_MIN_MESSAGE) {
+    auto packed = compress_block(raw);
+    if (packed.size() + 8 < raw.size()) {
+      out.str()[0] = static_cast<char>(op | RECORD_COMPRESSED);
+      out.u32(static_cast<uint32_t>(raw.size()));
+      out.bytes(packed);
+      return out.take();
+    }
+  }
+  out.str() += raw;
+  return out.take();
+}
+
+static void sync_file(std::FILE* file) {
+  std::fflush(file);
+#ifdef _WIN32
+  _commit(_fileno(file));
+#else
+  fsync(fileno(file));
+#endif
+}
+
+// --- LogMessageStore ---
+
+LogMessageStore::LogMessageStore(const fs::path& base_dir, LogStoreOptions options) : base_dir_(base_dir), options_(options) {
+  std::error_code ec;
+  fs::create_directories(base_dir_, ec);
+  if (ec) {
+    spdlog::warn("Failed to create log store directory {}: {}", base_dir_.string(), ec.message());
+  }
+
+#ifndef _WIN32
+  lock_fd_ = ::open((base_dir_ / "LOCK").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (lock_fd_ < 0) {
+    spdlog::warn("Failed to open log store lock file in {}: {}", base_dir_.string(), std::strerror(errno));
+  }
+#endif
+}
+
+LogMessageStore::~LogMessageStore() {
+  close_active();
+#ifndef _WIN32
+  if (lock_fd_ >= 0) {
+    ::close(lock_fd_);
+  }
+#endif
+}
+
+fs::path LogMessageStore::segment_path(uint32_t segment) const {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%08u%s", segment, SEGMENT_EXTENSION);
+  return base_dir_ / name;
+}
+
+std::vector<uint32_t> LogMessageStore::list_segments() const {
+  std::vector<uint32_t> segments;
+  std::error_code ec;
+  for (const auto& entry : fs::directory_iterator(base_dir_, ec)) {
+    const auto& path = entry.path();
+    if (path.extension() != SEGMENT_EXTENSION) {
+      continue;
+    }
+    auto stem = path.stem().string();
+    if (stem.empty() || !std::all_of(stem.begin(), stem.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+      continue;
+    }
+    segments.push_back(static_cast<uint32_t>(std::stoul(stem)));
+  }
+  std::sort(segments.begin(), segments.end());
+  return segments;
+}
+
+uintmax_t LogMessageStore::disk_usage() const {
+  uintmax_t total = 0;
+  std::error_code ec;
+  for (auto segment : list_segments()) {
+    auto size = fs::file_size(segment_path(segment), ec);
+    if (!ec) total += size;
+  }
+  return total;
+}
+
+// --- Internal: file locking ---
+
+void LogMessageStore::lock_shared() {
+#ifndef _WIN32
+  if (lock_fd_ < 0) return;
+  while (::flock(lock_fd_, LOCK_SH) != 0 && errno == EINTR) {
+  }
+#endif
+}
+
+void LogMessageStore::lock_exclusive() {
+#ifndef _WIN32
+  if (lock_fd_ < 0) return;
+  while (::flock(lock_fd_, LOCK_EX) != 0 && errno == EINTR) {
+  }
+#endif
+}
+
+void LogMessageStore::unlock() {
+#ifndef _WIN32
+  if (lock_fd_ < 0) return;
+  ::flock(lock_fd_, LOCK_UN);
+#endif
+}
+
+// --- Internal: index ---
+
+void LogMessageStore::reset_index() {
+  index_.clear();
+  session_messages_.clear();
+  first_segment_ = 0;
+  tail_segment_ = 0;
+  tail_offset_ = 0;
+}
+
+void LogMessageStore::catch_up() {
+  auto segments = list_segments();
+
+  // Our first segment disappearing means another process compacted; start over
+  if (first_segment_ != 0 && (segments.empty() || segments.front() != first_segment_)) {
+    reset_index();
+  }
+  if (segments.empty()) {
+    return;
+  }
+  if (first_segment_ == 0) {
+    first_segment_ = segments.front();
+  }
+
+  for (auto segment : segments) {
+    if (segment < tail_segment_) {
+      continue;
+    }
+    scan_segment(segment, segment == tail_segment_ ? tail_offset_ : 0);
+  }
+}
+
+void LogMessageStore::scan_segment(uint32_t segment, uint64_t from) {
+  auto path = segment_path(segment);
+  std::error_code ec;
+  auto size = fs::file_size(path, ec);
+  tail_segment_ = segment;
+  tail_offset_ = from;
+  if (ec || size <= from) {
+    return;
+  }
+
+  std::ifstream file(path, std::ios::binary);
+  file.seekg(static_cast<std::streamoff>(from));
+  std::string data(size - from, '\0');
+  file.read(data.data(), static_cast<std::streamsize>(data.size()));
+  data.resize(static_cast<size_t>(file.gcount()));
+
+  // Stop at the first incomplete or corrupt record: that is a torn tail left
+  // by a crashed writer, which the next writer truncates away
+  size_t pos = 0;
+  while (data.size() - pos >= RECORD_HEADER_SIZE) {
+    auto length = read_u32(data.data() + pos);
+    auto crc = read_u32(data.data() + pos + 4);
+    if (data.size() - pos - RECORD_HEADER_SIZE < length) {
+      break;
+    }
+    std::string_view body(data.data() + pos + RECORD_HEADER_SIZE, length);
+    if (crc32(body) != crc) {
+      spdlog::warn("Checksum mismatch in {} at offset {}, ignoring the rest of the segment", path.string(), from + pos);
+      break;
+    }
+    apply_record(segment, from + pos, body);
+    pos += RECORD_HEADER_SIZE + length;
+  }
+  tail_offset_ = from + pos;
+}
+
+void LogMessageStore::apply_record(uint32_t segment, uint64_t offset, std::string_view body) {
+  try {
+    BinaryReader in(body);
+    auto op = in.u8();
+    MessageId id(in.bytes());
+    SessionId session_id(in.bytes());
+    Location loc{segment, offset, static_cast<uint32_t>(body.size()), session_id};
+
+    auto it = index_.find(id);
+    switch (op & ~RECORD_COMPRESSED) {
+      case RECORD_SAVE:
+        if (it == index_.end()) {
+          session_messages_[session_id].push_back(id);
+          index_.emplace(std::move(id), std::move(loc));
+        } else {
+          it->second.segment = loc.segment;
+          it->second.offset = loc.offset;
+          it->second.length = loc.length;
+        }
+        break;
+      case RECORD_UPDATE:
+        if (it != index_.end()) {
+          it->second.segment = loc.segment;
+          it->second.offset = loc.offset;
+          it->second.length = loc.length;
+        }
+        break;
+      case RECORD_REMOVE:
+        if (it != index_.end()) {
+          auto& ids = session_messages_[it->second.session_id];
+          ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+          if (ids.empty()) {
+            session_messages_.erase(it->second.session_id);
+          }
+          index_.erase(it);
+        }
+        break;
+      default:
+        spdlog::warn("Unknown log record op {} in segment {}", op, segment);
+        break;
+    }
+  } catch (const std::exception& e) {
+    spdlog::warn("Malformed log record in segment {} at offset {}: {}", segment, offset, e.what());
+  }
+}
+
+std::optional<std::string> LogMessageStore::read_body(const Location& loc, SegmentReaders& readers) {
+  auto& file = readers[loc.segment];
+  if (!file.is_open()) {
+    file.open(segment_path(loc.segment), std::ios::binary);
+  }
+
+  std::string body(loc.length, '\0');
+  file.seekg(static_cast<std::streamoff>(loc.offset + RECORD_HEADER_SIZE));
+  file.read(body.data(), static_cast<std::streamsize>(body.size()));
+  if (!file) {
+    file.clear();
+    spdlog::warn("Failed to read record from segment {} at offset {}", loc.segment, loc.offset);
+    return std::nullopt;
+  }
+  return body;
+}
+
+std::optional<Message> LogMessageStore::read_message(const Location& loc, SegmentReaders& readers) {
+  auto body = read_body(loc, readers);
+  if (!body) {
+    return std::nullopt;
+  }
+  try {
+    BinaryReader in(*body);
+    auto op = in.u8();
+    in.bytes();
+    in.bytes();
+    if (op & RECORD_COMPRESSED) {
+      auto raw_size = in.u32();
+      return Message::from_binary(decompress_block(in.bytes(), raw_size));
+    }
+    return Message::from_binary(in);
+  } catch (const std::exception& e) {
+    spdlog::warn("Failed to decode message in segment {} at offset {}: {}", loc.segment, loc.offset, e.what());
+    return std::nullopt;
+  }
+}
+
+// --- Internal: group commit ---
+
+void LogMessageStore::commit(std::string body) {
+  auto record = encode_record(body);
+
+  std::unique_lock lock(commit_mutex_);
+  commit_queue_.push_back(std::move(record));
+  auto seq = ++queued_seq_;
+
+  while (committed_seq_ < seq) {
+    if (committing_) {
+      commit_cv_.wait(lock);
+      continue;
+    }
+
+    // Become the leader: write everything queued so far as one group
+    committing_ = true;
+    auto group = std::move(commit_queue_);
+    commit_queue_.clear();
+    auto group_end = queued_seq_;
+    lock.unlock();
+
+    write_group(group);
+
+    lock.lock();
+    committed_seq_ = group_end;
+    committing_ = false;
+    commit_cv_.notify_all();
+  }
+}
+
+void LogMessageStore::write_group(const std::vector<std::string>& group) {
+  std::lock_guard lock(mutex_);
+  lock_exclusive();
+  catch_up();
+
+  uint64_t group_bytes = 0;
+  for (const auto& record : group) {
+    group_bytes += record.size();
+  }
+
+  auto segment = tail_segment_ == 0 ? 1 : tail_segment_;
+  auto offset = tail_offset_;
+  if (offset > 0 && offset + group_bytes > options_.segment_max_bytes) {
+    ++segment;
+    offset = 0;
+  }
+
+  // Drop a torn tail left by a crashed writer so new records stay reachable
+  auto path = segment_path(segment);
+  std::error_code ec;
+  auto size = fs::file_size(path, ec);
+  if (!ec && size != offset) {
+    close_active();
+    fs::resize_file(path, offset, ec);
+    if (ec) {
+      spdlog::warn("Failed to truncate segment {}: {}", path.string(), ec.message());
+    }
+  }
+
+  if (!active_file_ || active_segment_ != segment) {
+    close_active();
+    active_file_ = std::fopen(path.string().c_str(), "ab");
+    active_segment_ = segment;
+  }
+  if (!active_file_) {
+    spdlog::warn("Failed to open segment {} for writing", path.string());
+    unlock();
+    return;
+  }
+
+  bool ok = true;
+  for (const auto& record : group) {
+    if (std::fwrite(record.data(), 1, record.size(), active_file_) != record.size()) {
+      ok = false;
+      break;
+    }
+  }
+  if (options_.fsync) {
+    sync_file(active_file_);
+  } else {
+    std::fflush(active_file_);
+  }
+  if (!ok || std::ferror(active_file_)) {
+    spdlog::warn("Failed to append {} records to segment {}", group.size(), path.string());
+    close_active();
+    fs::resize_file(path, offset, ec);
+    unlock();
+    return;
+  }
+
+  for (const auto& record : group) {
+    apply_record(segment, offset, std::string_view(record).substr(RECORD_HEADER_SIZE));
+    offset += record.size();
+  }
+  if (first_segment_ == 0) {
+    first_segment_ = segment;
+  }
+  tail_segment_ = segment;
+  tail_offset_ = offset;
+  unlock();
+}
+
+void LogMessageStore::close_active() {
+  if (active_file_) {
+    std::fclose(active_file_);
+    active_file_ = nullptr;
+  }
+  active_segment_ = 0;
+}
+
+// --- MessageStore interface ---
+
+void LogMessageStore::save(const Message& msg) {
+  commit(encode_body(RECORD_SAVE, msg.id(), msg.session_id(), &msg, options_.compress));
+}
+
+std::optional<Message> LogMessageStore::get(const MessageId& id) {
+  std::lock_guard lock(mutex_);
+  lock_shared();
+  catch_up();
+
+  std::optional<Message> result;
+  auto it = index_.find(id);
+  if (it != index_.end()) {
+    SegmentReaders readers;
+    result = read_message(it->second, readers);
+  }
+  unlock();
+  return result;
+}
+
+std::vector<Message> LogMessageStore::list(const SessionId& session_id) {
+  std::lock_guard lock(mutex_);
+  lock_shared();
+  catch_up();
+
+  std::vector<Message> result;
+  auto it = session_messages_.find(session_id);
+  if (it != session_messages_.end()) {
+    SegmentReaders readers;
+    result.reserve(it->second.size());
+    for (const auto& id : it->second) {
+      if (auto msg = read_message(index_.at(id), readers)) {
+        result.push_back(std::move(*msg));
+      }
+    }
+  }
+  unlock();
+  return result;
+}
+
+void LogMessageStore::update(const Message& msg) {
+  commit(encode_body(RECORD_UPDATE, msg.id(), msg.session_id(), &msg, options_.compress));
+}
+
+void LogMessageStore::remove(const MessageId& id) {
+  commit(encode_body(RECORD_REMOVE, id, SessionId{}, nullptr, false));
+}
+
+void LogMessageStore::compact() {
+  std::lock_guard lock(mutex_);
+  lock_exclusive();
+  catch_up();
+
+  auto segments = list_segments();
+  if (segments.empty()) {
+    unlock();
+    return;
+  }
+
+  auto target = segments.back() + 1;
+  auto target_path = segment_path(target);
+  auto tmp_path = target_path;
+  tmp_path += ".tmp";
+
+  std::FILE* out = std::fopen(tmp_path.string().c_str(), "wb");
+  if (!out) {
+    spdlog::warn("Failed to create {}", tmp_path.string());
+    unlock();
+    return;
+  }
+
+  // Live records only, session by session in list order. Updates become
+  // saves since the original save record is not carried over.
+  bool ok = true;
+  SegmentReaders readers;
+  for (const auto& [session_id, ids] : session_messages_) {
+    for (const auto& id : ids) {
+      auto body = read_body(index_.at(id), readers);
+      if (!body) {
+        ok = false;
+        break;
+      }
+      (*body)[0] = static_cast<char>(RECORD_SAVE | (static_cast<uint8_t>((*body)[0]) & RECORD_COMPRESSED));
+      auto record = encode_record(*body);
+      if (std::fwrite(record.data(), 1, record.size(), out) != record.size()) {
+        ok = false;
+        break;
+      }
+    }
+    if (!ok) break;
+  }
+  readers.clear();
+  sync_file(out);
+  ok = ok && !std::ferror(out);
+  std::fclose(out);
+
+  std::error_code ec;
+  if (ok) {
+    fs::rename(tmp_path, target_path, ec);
+    ok = !ec;
+  }
+  if (!ok) {
+    spdlog::warn("Failed to compact log store {}", base_dir_.string());
+    fs::remove(tmp_path, ec);
+    unlock();
+    return;
+  }
+
+  // A crash before all old segments are gone is harmless: replaying them
+  // ahead of the compacted segment yields the same index
+  close_active();
+  for (auto segment : segments) {
+    fs::remove(segment_path(segment), ec);
+  }
+  reset_index();
+  catch_up();
+  unlock();
+}
+
+}  // namespace agent
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "message.hpp"
+#include "types.hpp"
+
+namespace agent {
+
+struct LogStoreOptions {
+  uint64_t segment_max_bytes = 64 * 1024 * 1024;  // Start a new segment beyond this size
+  bool fsync = true;                              // fsync each commit group
+  bool compress = false;                          // LZ-compress message records (read back either way)
+};
+
+// Log-structured message store
+// Storage layout:
+//   base_dir/
+//     LOCK                — flock()ed: shared while reading, exclusive while writing
+//     {n:08}.seg          — append-only segments, the highest number is active
+//
+// Record: u32 body_length | u32 crc32(body) | body
+// Body:   u8 op | bytes message_id | bytes session_id | (save/update) Message::to_binary
+//         With op flag 0x80 the message is u32 raw_size | bytes compressed (compress.hpp)
+//
+// Each process keeps an in-memory index (message id -> record location,
+// session -> ordered message ids) and tails the segments before every
+// operation, so several processes can read and write one directory.
+// Concurrent writes within a process are group-committed: while one thread
+// writes and fsyncs a group, later writers queue up and go out together in
+// the next group.
+//
+// Superseded and removed records stay on disk until compact().
+// File locking is POSIX-only; on Windows the store is safe within one process.
+class LogMessageStore : public MessageStore {
+ public:
+  explicit LogMessageStore(const std::filesystem::path& base_dir, LogStoreOptions options = {});
+
+  ~LogMessageStore() override;
+
+  // MessageStore interface
+  void save(const Message& msg) override;
+  std::optional<Message> get(const MessageId& id) override;
+  std::vector<Message> list(const SessionId& session_id) override;
+  void update(const Message& msg) override;
+  void remove(const MessageId& id) override;
+
+  // Rewrite live records into a fresh segment and delete the old ones
+  void compact();
+
+  // Bytes in all segments, including superseded records
+  uintmax_t disk_usage() const;
+
+  const LogStoreOptions& options() const {
+    return options_;
+  }
+
+ private:
+  struct Location {
+    uint32_t segment = 0;
+    uint64_t offset = 0;  // Start of the record header
+    uint32_t length = 0;  // Body length
+    SessionId session_id;
+  };
+
+  using SegmentReaders = std::map<uint32_t, std::ifstream>;
+
+  std::filesystem::path base_dir_;
+  LogStoreOptions options_;
+
+  // Guards the index, the tail position, the active segment and the file lock
+  std::mutex mutex_;
+  std::unordered_map<MessageId, Location> index_;
+  std::unordered_map<SessionId, std::vector<MessageId>> session_messages_;
+  uint32_t first_segment_ = 0;  // Lowest segment indexed; if it vanishes another process compacted
+  uint32_t tail_segment_ = 0;   // Segment and offset up to which the index is current
+  uint64_t tail_offset_ = 0;
+
+  std::FILE* active_file_ = nullptr;
+  uint32_t active_segment_ = 0;
+
+  // Group commit
+  std::mutex commit_mutex_;
+  std::condition_variable commit_cv_;
+  std::vector<std::string> commit_queue_;
+  uint64_t queued_seq_ = 0;
+  uint64_t committed_seq_ = 0;
+  bool committing_ = false;
+
+  int lock_fd_ = -1;
+
+  std::filesystem::path segment_path(uint32_t segment) const;
+  std::vector<uint32_t> list_segments() const;
+
+  // Cross-process locking on base_dir/LOCK (caller holds mutex_)
+  void lock_shared();
+  void lock_exclusive();
+  void unlock();
+
+  // Bring the index up to date with the segments on disk (caller holds mutex_ and a file lock)
+  void catch_up();
+  void reset_index();
+  void scan_segment(uint32_t segment, uint64_t from);
+  void apply_record(uint32_t segment, uint64_t offset, std::string_view body);
+
+  std::optional<std::string> read_body(const Location& loc, SegmentReaders& readers);
+  std::optional<Message> read_message(const Location& loc, SegmentReaders& readers);
+
+  // Queue a record body and block until its commit group is on disk
+  void commit(std::string body);
+  void write_group(const std::vector<std::string>& group);
+  void close_active();
+};
+
+}  // namespace agent
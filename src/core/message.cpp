@@ -1,6 +1,9 @@
 #include "message.hpp"
 
+#include <spdlog/spdlog.h>
+
 #include <algorithm>
+#include <stdexcept>
 
 namespace agent {
 
@@ -108,7 +111,25 @@ std::vector<const ToolResultPart*> Message::tool_results() const {
   return result;
 }
 
-json Message::to_json() const {
+// Tool output stored inline ("output") or by reference ("output_blob")
+static LazyText read_output(const json& part_json, BlobStore* blobs) {
+  if (!part_json.contains("output_blob")) {
+    return LazyText(part_json.value("output", ""));
+  }
+
+  auto ref = part_json["output_blob"].get<std::string>();
+  if (auto shared = blobs ? blobs->weak_from_this().lock() : nullptr) {
+    return LazyText::from_blob(std::move(shared), std::move(ref), part_json.value("output_size", size_t{0}));
+  }
+  auto resolved = blobs ? blobs->get(ref) : std::nullopt;
+  if (!resolved) {
+    spdlog::warn("Missing blob {} for tool output", ref);
+    return LazyText();
+  }
+  return LazyText(std::move(*resolved));
+}
+
+json Message::to_json(BlobStore* blobs, size_t inline_limit) const {
   json j;
   j["id"] = id_;
   j["role"] = to_string(role_);
@@ -140,7 +161,16 @@ json Message::to_json() const {
       part_json["type"] = "tool_result";
       part_json["tool_call_id"] = tr->tool_call_id;
       part_json["tool_name"] = tr->tool_name;
-      part_json["output"] = tr->output;
+      std::string ref;
+      if (blobs && (tr->output.is_blob_in(blobs) || tr->output.size() > inline_limit)) {
+        ref = tr->output.is_blob_in(blobs) ? tr->output.blob_ref() : blobs->put(tr->output.str());
+      }
+      if (!ref.empty()) {
+        part_json["output_blob"] = ref;
+        part_json["output_size"] = tr->output.size();
+      } else {
+        part_json["output"] = tr->output;  // Small, or the store could not take it
+      }
       part_json["is_error"] = tr->is_error;
       part_json["compacted"] = tr->compacted;
     }
@@ -158,7 +188,7 @@ json Message::to_json() const {
   return j;
 }
 
-Message Message::from_json(const json& j) {
+Message Message::from_json(const json& j, BlobStore* blobs) {
   Message msg;
   msg.id_ = j.value("id", UUID::generate());
   msg.role_ = role_from_string(j.value("role", "user"));
@@ -182,7 +212,7 @@ Message Message::from_json(const json& j) {
         msg.parts_.push_back(ToolCallPart{part_json["id"], part_json["name"], part_json["arguments"], part_json.value("started", false),
                                           part_json.value("completed", false)});
       } else if (type == "tool_result") {
-        msg.parts_.push_back(ToolResultPart{part_json["tool_call_id"], part_json["tool_name"], part_json["output"],
+        msg.parts_.push_back(ToolResultPart{part_json["tool_call_id"], part_json["tool_name"], read_output(part_json, blobs),
                                             part_json.value("is_error", false), std::nullopt, json::object(), part_json.value("compacted", false),
                                             std::nullopt});
       }
@@ -204,6 +234,275 @@ Message Message::from_json(const json& j) {
   return msg;
 }
 
+// --- Binary serialization ---
+//
+// message: u8 version | bytes id | u8 role | u8 flags | [bytes parent_id]
+//          | bytes session_id | u8 finish_reason | i64 x4 usage
+//          | i64 created_at (ms since epoch) | u32 part_count | part*
+// part:    u8 variant index | u32 body length | body
+// Unknown part types are skipped using the body length.
+
+namespace {
+
+enum MessageFlags : uint8_t {
+  FLAG_FINISHED = 1 << 0,
+  FLAG_SUMMARY = 1 << 1,
+  FLAG_SYNTHETIC = 1 << 2,
+  FLAG_HAS_PARENT = 1 << 3,
+};
+
+enum ToolResultFlags : uint8_t {
+  RESULT_IS_ERROR = 1 << 0,
+  RESULT_COMPACTED = 1 << 1,
+  RESULT_HAS_TITLE = 1 << 2,
+  RESULT_HAS_COMPACTED_AT = 1 << 3,
+};
+
+constexpr char BINARY_FILE_MAGIC[4] = {'A', 'G', 'M', 'B'};
+constexpr uint32_t BINARY_FILE_VERSION = 1;
+
+int64_t to_millis(const Timestamp& ts) {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(ts.time_since_epoch()).count();
+}
+
+Timestamp from_millis(int64_t ms) {
+  return Timestamp(std::chrono::duration_cast<Timestamp::duration>(std::chrono::milliseconds(ms)));
+}
+
+void write_json(BinaryWriter& out, const json& j, BlobStore* blobs, size_t inline_limit) {
+  auto cbor = json::to_cbor(j);
+  out.payload(std::string_view(reinterpret_cast<const char*>(cbor.data()), cbor.size()), blobs, inline_limit);
+}
+
+json read_json(BinaryReader& in, BlobStore* blobs) {
+  return json::from_cbor(in.payload(blobs));
+}
+
+void write_part(BinaryWriter& out, const MessagePart& part, BlobStore* blobs, size_t inline_limit) {
+  out.u8(static_cast<uint8_t>(part.index()));
+  auto length_pos = out.reserve_u32();
+  auto body_start = out.str().size();
+
+  if (auto* text = std::get_if<TextPart>(&part)) {
+    out.payload(text->text, blobs, inline_limit);
+  } else if (auto* tc = std::get_if<ToolCallPart>(&part)) {
+    out.bytes(tc->id);
+    out.bytes(tc->name);
+    write_json(out, tc->arguments, blobs, inline_limit);
+    out.u8(static_cast<uint8_t>((tc->started ? 1 : 0) | (tc->completed ? 2 : 0)));
+  } else if (auto* tr = std::get_if<ToolResultPart>(&part)) {
+    out.bytes(tr->tool_call_id);
+    out.bytes(tr->tool_name);
+    out.lazy_payload(tr->output, blobs, inline_limit);
+    uint8_t flags = 0;
+    if (tr->is_error) flags |= RESULT_IS_ERROR;
+    if (tr->compacted) flags |= RESULT_COMPACTED;
+    if (tr->title) flags |= RESULT_HAS_TITLE;
+    if (tr->compacted_at) flags |= RESULT_HAS_COMPACTED_AT;
+    out.u8(flags);
+    if (tr->title) out.bytes(*tr->title);
+    if (tr->compacted_at) out.i64(to_millis(*tr->compacted_at));
+    write_json(out, tr->metadata, blobs, inline_limit);
+  } else if (auto* img = std::get_if<ImagePart>(&part)) {
+    out.payload(img->url, blobs, inline_limit);
+    out.bytes(img->media_type);
+  } else if (auto* file = std::get_if<FilePart>(&part)) {
+    out.bytes(file->path);
+    out.payload(file->content, blobs, inline_limit);
+    out.u8(file->truncated ? 1 : 0);
+  } else if (auto* cp = std::get_if<CompactionPart>(&part)) {
+    out.bytes(cp->parent_id);
+    out.u8(cp->completed ? 1 : 0);
+  } else if (auto* st = std::get_if<SubtaskPart>(&part)) {
+    out.bytes(st->task_id);
+    out.payload(st->prompt, blobs, inline_limit);
+    out.u8(static_cast<uint8_t>(st->agent_type));
+    out.u8(static_cast<uint8_t>((st->completed ? 1 : 0) | (st->result ? 2 : 0)));
+    if (st->result) out.payload(*st->result, blobs, inline_limit);
+  }
+
+  out.patch_u32(length_pos, static_cast<uint32_t>(out.str().size() - body_start));
+}
+
+std::optional<MessagePart> read_part(BinaryReader& in, BlobStore* blobs) {
+  auto index = in.u8();
+  BinaryReader body(in.bytes());
+
+  switch (index) {
+    case 0:
+      return TextPart{body.payload(blobs)};
+    case 1: {
+      ToolCallPart tc;
+      tc.id = body.bytes();
+      tc.name = body.bytes();
+      tc.arguments = read_json(body, blobs);
+      auto flags = body.u8();
+      tc.started = flags & 1;
+      tc.completed = flags & 2;
+      return tc;
+    }
+    case 2: {
+      ToolResultPart tr;
+      tr.tool_call_id = body.bytes();
+      tr.tool_name = body.bytes();
+      tr.output = body.lazy_payload(blobs);
+      auto flags = body.u8();
+      tr.is_error = flags & RESULT_IS_ERROR;
+      tr.compacted = flags & RESULT_COMPACTED;
+      if (flags & RESULT_HAS_TITLE) tr.title = std::string(body.bytes());
+      if (flags & RESULT_HAS_COMPACTED_AT) tr.compacted_at = from_millis(body.i64());
+      tr.metadata = read_json(body, blobs);
+      return tr;
+    }
+    case 3: {
+      ImagePart img;
+      img.url = body.payload(blobs);
+      img.media_type = body.bytes();
+      return img;
+    }
+    case 4: {
+      FilePart file;
+      file.path = body.bytes();
+      file.content = body.payload(blobs);
+      file.truncated = body.u8() != 0;
+      return file;
+    }
+    case 5: {
+      CompactionPart cp;
+      cp.parent_id = body.bytes();
+      cp.completed = body.u8() != 0;
+      return cp;
+    }
+    case 6: {
+      SubtaskPart st;
+      st.task_id = body.bytes();
+      st.prompt = body.payload(blobs);
+      st.agent_type = static_cast<AgentType>(body.u8());
+      auto flags = body.u8();
+      st.completed = flags & 1;
+      if (flags & 2) st.result = body.payload(blobs);
+      return st;
+    }
+  }
+  // Part type from a newer writer
+  return std::nullopt;
+}
+
+}  // namespace
+
+void Message::to_binary(BinaryWriter& out, BlobStore* blobs, size_t inline_limit) const {
+  out.u8(BINARY_VERSION);
+  out.bytes(id_);
+  out.u8(static_cast<uint8_t>(role_));
+
+  uint8_t flags = 0;
+  if (finished_) flags |= FLAG_FINISHED;
+  if (is_summary_) flags |= FLAG_SUMMARY;
+  if (is_synthetic_) flags |= FLAG_SYNTHETIC;
+  if (parent_id_) flags |= FLAG_HAS_PARENT;
+  out.u8(flags);
+  if (parent_id_) out.bytes(*parent_id_);
+
+  out.bytes(session_id_);
+  out.u8(static_cast<uint8_t>(finish_reason_));
+  out.i64(usage_.input_tokens);
+  out.i64(usage_.output_tokens);
+  out.i64(usage_.cache_read_tokens);
+  out.i64(usage_.cache_write_tokens);
+  out.i64(to_millis(created_at_));
+
+  out.u32(static_cast<uint32_t>(parts_.size()));
+  for (const auto& part : parts_) {
+    write_part(out, part, blobs, inline_limit);
+  }
+}
+
+std::string Message::to_binary(BlobStore* blobs, size_t inline_limit) const {
+  BinaryWriter out;
+  to_binary(out, blobs, inline_limit);
+  return out.take();
+}
+
+Message Message::from_binary(BinaryReader& in, BlobStore* blobs) {
+  auto version = in.u8();
+  if (version != BINARY_VERSION) {
+    throw std::runtime_error("unsupported message binary version " + std::to_string(version));
+  }
+
+  Message msg;
+  msg.id_ = in.bytes();
+  msg.role_ = static_cast<Role>(in.u8());
+
+  auto flags = in.u8();
+  msg.finished_ = flags & FLAG_FINISHED;
+  msg.is_summary_ = flags & FLAG_SUMMARY;
+  msg.is_synthetic_ = flags & FLAG_SYNTHETIC;
+  if (flags & FLAG_HAS_PARENT) msg.parent_id_ = std::string(in.bytes());
+
+  msg.session_id_ = in.bytes();
+  msg.finish_reason_ = static_cast<FinishReason>(in.u8());
+  msg.usage_.input_tokens = in.i64();
+  msg.usage_.output_tokens = in.i64();
+  msg.usage_.cache_read_tokens = in.i64();
+  msg.usage_.cache_write_tokens = in.i64();
+  msg.created_at_ = from_millis(in.i64());
+
+  auto part_count = in.u32();
+  msg.parts_.reserve(std::min<size_t>(part_count, in.remaining()));
+  for (uint32_t i = 0; i < part_count; ++i) {
+    if (auto part = read_part(in, blobs)) {
+      msg.parts_.push_back(std::move(*part));
+    }
+  }
+
+  return msg;
+}
+
+Message Message::from_binary(std::string_view data, BlobStore* blobs) {
+  BinaryReader in(data);
+  return from_binary(in, blobs);
+}
+
+std::string messages_to_binary(const std::vector<Message>& messages, BlobStore* blobs, size_t inline_limit) {
+  BinaryWriter out;
+  for (char c : BINARY_FILE_MAGIC) out.u8(static_cast<uint8_t>(c));
+  out.u32(BINARY_FILE_VERSION);
+  out.u32(static_cast<uint32_t>(messages.size()));
+
+  for (const auto& msg : messages) {
+    auto length_pos = out.reserve_u32();
+    auto start = out.str().size();
+    msg.to_binary(out, blobs, inline_limit);
+    out.patch_u32(length_pos, static_cast<uint32_t>(out.str().size() - start));
+  }
+  return out.take();
+}
+
+std::vector<Message> messages_from_binary(std::string_view data, BlobStore* blobs) {
+  if (!is_binary_messages(data)) {
+    throw std::runtime_error("not a binary message file");
+  }
+
+  BinaryReader in(data.substr(sizeof(BINARY_FILE_MAGIC)));
+  auto version = in.u32();
+  if (version != BINARY_FILE_VERSION) {
+    throw std::runtime_error("unsupported message file version " + std::to_string(version));
+  }
+
+  auto count = in.u32();
+  std::vector<Message> messages;
+  messages.reserve(std::min<size_t>(count, in.remaining()));
+  for (uint32_t i = 0; i < count; ++i) {
+    BinaryReader record(in.bytes());
+    messages.push_back(Message::from_binary(record, blobs));
+  }
+  return messages;
+}
+
+bool is_binary_messages(std::string_view data) {
+  return data.size() >= sizeof(BINARY_FILE_MAGIC) && data.compare(0, sizeof(BINARY_FILE_MAGIC), std::string_view(BINARY_FILE_MAGIC, 4)) == 0;
+}
+
 json Message::to_api_format() const {
   // Convert to OpenAI-style format (also works with Anthropic via adapter)
   json msg;
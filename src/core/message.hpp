@@ -7,17 +7,30 @@
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
+#include "binary_codec.hpp"
 #include "types.hpp"
 #include "uuid.hpp"
 
 namespace agent {
 
+class Tokenizer;
+
+// Token count of a part, filled in by count_part_tokens() (tokenizer.hpp)
+struct TokenCountCache {
+  const Tokenizer* tokenizer = nullptr;
+  size_t size = 0;  // Size of the counted text
+  int64_t tokens = 0;
+};
+
 // Message part types
 struct TextPart {
   std::string text;
+
+  mutable TokenCountCache token_count;
 };
 
 struct ToolCallPart {
@@ -28,12 +41,14 @@ struct ToolCallPart {
   // Execution state
   bool started = false;
   bool completed = false;
+
+  mutable TokenCountCache token_count;
 };
 
 struct ToolResultPart {
   std::string tool_call_id;
   std::string tool_name;
-  std::string output;
+  LazyText output;  // May be a reference into the store's BlobStore until read
   bool is_error = false;
 
   // Metadata
@@ -43,6 +58,8 @@ struct ToolResultPart {
   // Context management
   bool compacted = false;  // Content cleared during pruning
   std::optional<Timestamp> compacted_at;
+
+  mutable TokenCountCache token_count;
 };
 
 struct ImagePart {
@@ -200,10 +217,27 @@ class Message {
 
   std::vector<const ToolResultPart*> tool_results() const;
 
-  // Serialization
-  json to_json() const;
+  static constexpr size_t DEFAULT_INLINE_LIMIT = 64 * 1024;
+
+  // Serialization. With a BlobStore, tool outputs larger than inline_limit
+  // are stored there and referenced by hash ("output_blob"), so identical
+  // outputs are kept once; from_json resolves them lazily when the store is
+  // owned by a shared_ptr.
+  json to_json(BlobStore* blobs = nullptr, size_t inline_limit = DEFAULT_INLINE_LIMIT) const;
+
+  static Message from_json(const json& j, BlobStore* blobs = nullptr);
 
-  static Message from_json(const json& j);
+  // Compact binary serialization. Covers every MessagePart variant; payloads
+  // larger than inline_limit go to blobs when one is given.
+  static constexpr uint8_t BINARY_VERSION = 1;
+
+  void to_binary(BinaryWriter& out, BlobStore* blobs = nullptr, size_t inline_limit = DEFAULT_INLINE_LIMIT) const;
+
+  std::string to_binary(BlobStore* blobs = nullptr, size_t inline_limit = DEFAULT_INLINE_LIMIT) const;
+
+  static Message from_binary(BinaryReader& in, BlobStore* blobs = nullptr);
+
+  static Message from_binary(std::string_view data, BlobStore* blobs = nullptr);
 
   // Convert to LLM API format
   json to_api_format() const;
@@ -226,6 +260,19 @@ class Message {
   Timestamp created_at_ = std::chrono::system_clock::now();
 };
 
+// Binary message list file: "AGMB" | u32 version | u32 count | (u32 length | message)*
+std::string messages_to_binary(const std::vector<Message>& messages, BlobStore* blobs = nullptr,
+                               size_t inline_limit = Message::DEFAULT_INLINE_LIMIT);
+
+std::vector<Message> messages_from_binary(std::string_view data, BlobStore* blobs = nullptr);
+
+bool is_binary_messages(std::string_view data);
+
+// LazyText serializes as its resolved string
+inline void to_json(json& j, const LazyText& text) {
+  j = text.str();
+}
+
 // Message storage interface
 class MessageStore {
  public:
@@ -0,0 +1,434 @@
+#include "tokenizer.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "config.hpp"
+
+namespace agent {
+
+namespace fs = std::filesystem;
+
+static constexpr uint32_t NO_RANK = std::numeric_limits<uint32_t>::max();
+static constexpr size_t MAX_PIECE_BYTES = 256;  // Longer pieces are merged in chunks (merging is quadratic)
+
+// --- Byte scanning ---
+
+// Bytes are tested 8 at a time in a 64-bit word (SWAR); the word tricks
+// assume little-endian byte order, other targets scan byte by byte.
+static constexpr bool SWAR = std::endian::native == std::endian::little;
+static constexpr uint64_t ONES = 0x0101010101010101ull;
+static constexpr uint64_t HIGH_BITS = 0x8080808080808080ull;
+
+static uint64_t load64(const char* p) {
+  uint64_t v;
+  std::memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static bool is_ascii_letter(unsigned char c) {
+  return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+}
+
+// Length of a UTF-8 sequence from its first byte (1 for stray bytes)
+static size_t utf8_length(unsigned char c) {
+  if (c >= 0xF0) return 4;
+  if (c >= 0xE0) return 3;
+  if (c >= 0xC0) return 2;
+  return 1;
+}
+
+// Number of ASCII letters at the start of [p, end)
+static size_t ascii_letters(const char* p, const char* end) {
+  const char* start = p;
+  if constexpr (SWAR) {
+    while (end - p >= 8) {
+      uint64_t word = load64(p);
+      uint64_t lower = word | (0x20 * ONES);
+      // High bit of each byte set where 'a' <= byte <= 'z'. A byte at or above
+      // 0x80 can carry into the next one, but only bytes after the first
+      // non-letter are affected.
+      uint64_t letters = (lower + (0x80 - 'a') * ONES) & ~(lower + (0x80 - 'z' - 1) * ONES) & ~word & HIGH_BITS;
+      if (letters != HIGH_BITS) {
+        return (p - start) + std::countr_zero(~letters & HIGH_BITS) / 8;
+      }
+      p += 8;
+    }
+  }
+  while (p < end && is_ascii_letter(static_cast<unsigned char>(*p))) ++p;
+  return p - start;
+}
+
+enum class CharClass { Letter, Digit, Space, Newline, Other };
+
+static CharClass classify(unsigned char c) {
+  if (c >= 0x80 || is_ascii_letter(c)) return CharClass::Letter;
+  if (c >= '0' && c <= '9') return CharClass::Digit;
+  if (c == '\n' || c == '\r') return CharClass::Newline;
+  if (c == ' ' || c == '\t' || c == '\v' || c == '\f') return CharClass::Space;
+  return CharClass::Other;
+}
+
+// End of the run of letters starting at pos
+static size_t letter_run(std::string_view text, size_t pos) {
+  const char* end = text.data() + text.size();
+  while (pos < text.size()) {
+    pos += ascii_letters(text.data() + pos, end);
+    if (pos >= text.size() || static_cast<unsigned char>(text[pos]) < 0x80) break;
+    pos = std::min(pos + utf8_length(static_cast<unsigned char>(text[pos])), text.size());
+  }
+  return pos;
+}
+
+// Length of the contraction ('s 't 'm 'd 're 've 'll, any case) at pos, or 0
+static size_t contraction_length(std::string_view text, size_t pos) {
+  size_t n = text.size();
+  if (pos + 1 >= n || text[pos] != '\'') return 0;
+  char a = static_cast<char>(text[pos + 1] | 0x20);
+  if (a == 's' || a == 't' || a == 'm' || a == 'd') return 2;
+  if (pos + 2 < n) {
+    char b = static_cast<char>(text[pos + 2] | 0x20);
+    if ((a == 'r' && b == 'e') || (a == 'v' && b == 'e') || (a == 'l' && b == 'l')) return 3;
+  }
+  return 0;
+}
+
+// End of the run starting at pos of upper (or lower) case ASCII letters and
+// non-ASCII characters, which count as either
+static size_t cased_run(std::string_view text, size_t pos, bool upper) {
+  char first = upper ? 'A' : 'a';
+  while (pos < text.size()) {
+    auto c = static_cast<unsigned char>(text[pos]);
+    if (c >= 0x80) {
+      pos = std::min(pos + utf8_length(c), text.size());
+    } else if (c >= first && c <= first + 25) {
+      ++pos;
+    } else {
+      break;
+    }
+  }
+  return pos;
+}
+
+// o200k letter piece: upper case letters, then lower case ones, then an
+// optional contraction. "HTMLParser" stays whole, "camelCase" splits before C.
+static size_t o200k_letter_run(std::string_view text, size_t pos) {
+  auto end = cased_run(text, cased_run(text, pos, true), false);
+  return end + contraction_length(text, end);
+}
+
+size_t next_piece(std::string_view text, size_t pos, PieceRules rules) {
+  size_t n = text.size();
+  if (pos >= n) return n;
+  auto cls = [&](size_t i) {
+    return classify(static_cast<unsigned char>(text[i]));
+  };
+  bool o200k = rules == PieceRules::O200k;
+
+  // Contractions on their own (o200k attaches them to the word before)
+  if (!o200k) {
+    if (auto length = contraction_length(text, pos)) return pos + length;
+  }
+
+  // Letters, with at most one leading character that is not a letter, digit or newline
+  auto c = cls(pos);
+  size_t letters = std::string_view::npos;
+  if (c == CharClass::Letter) {
+    letters = pos;
+  } else if ((c == CharClass::Space || c == CharClass::Other) && pos + 1 < n && cls(pos + 1) == CharClass::Letter) {
+    letters = pos + 1;
+  }
+  if (letters != std::string_view::npos) {
+    return o200k ? o200k_letter_run(text, letters) : letter_run(text, letters);
+  }
+
+  // Up to three digits
+  if (c == CharClass::Digit) {
+    size_t end = pos + 1;
+    while (end < n && end < pos + 3 && cls(end) == CharClass::Digit) ++end;
+    return end;
+  }
+
+  // Punctuation with an optional leading space, and the newlines after it
+  // (o200k: newlines and slashes)
+  size_t end = pos;
+  if (text[end] == ' ' && end + 1 < n && cls(end + 1) == CharClass::Other) ++end;
+  if (cls(end) == CharClass::Other) {
+    while (end < n && cls(end) == CharClass::Other) ++end;
+    while (end < n && (cls(end) == CharClass::Newline || (o200k && text[end] == '/'))) ++end;
+    return end;
+  }
+
+  // Whitespace: up to the last newline in the run, otherwise all but the
+  // last space, which leads the next piece
+  end = pos;
+  size_t last_newline = std::string_view::npos;
+  while (end < n && (cls(end) == CharClass::Space || cls(end) == CharClass::Newline)) {
+    if (cls(end) == CharClass::Newline) last_newline = end;
+    ++end;
+  }
+  if (last_newline != std::string_view::npos) return last_newline + 1;
+  if (end < n && end - pos > 1) return end - 1;
+  return end;
+}
+
+// --- ApproximateTokenizer ---
+
+size_t ApproximateTokenizer::count(std::string_view text) const {
+  // Quarter tokens: 1 per ASCII byte, 2 per 2-byte character, 4 per longer one
+  size_t units = 0;
+  const char* p = text.data();
+  const char* end = p + text.size();
+  while (p < end) {
+    if constexpr (SWAR) {
+      while (end - p >= 8 && (load64(p) & HIGH_BITS) == 0) {
+        units += 8;
+        p += 8;
+      }
+      if (p >= end) break;
+    }
+    auto c = static_cast<unsigned char>(*p);
+    auto length = utf8_length(c);
+    units += c < 0x80 ? 1 : (length == 2 ? 2 : 4);
+    p += std::min<size_t>(length, end - p);
+  }
+  return units / 4;
+}
+
+// --- BpeTokenizer ---
+
+BpeTokenizer::BpeTokenizer(std::string name, std::vector<std::pair<std::string, uint32_t>> ranks)
+    : name_(std::move(name)), rules_(name_.starts_with("o200k") ? PieceRules::O200k : PieceRules::Cl100k) {
+  ranks_.reserve(ranks.size());
+  for (auto& [bytes, rank] : ranks) {
+    ranks_.emplace(std::move(bytes), rank);
+  }
+}
+
+static bool base64_decode(std::string_view in, std::string& out) {
+  out.clear();
+  uint32_t buffer = 0;
+  int bits = 0;
+  for (char ch : in) {
+    int value;
+    if (ch >= 'A' && ch <= 'Z') {
+      value = ch - 'A';
+    } else if (ch >= 'a' && ch <= 'z') {
+      value = ch - 'a' + 26;
+    } else if (ch >= '0' && ch <= '9') {
+      value = ch - '0' + 52;
+    } else if (ch == '+') {
+      value = 62;
+    } else if (ch == '/') {
+      value = 63;
+    } else if (ch == '=') {
+      break;
+    } else {
+      return false;
+    }
+    buffer = (buffer << 6) | static_cast<uint32_t>(value);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out.push_back(static_cast<char>((buffer >> bits) & 0xff));
+    }
+  }
+  return true;
+}
+
+std::shared_ptr<BpeTokenizer> BpeTokenizer::load(const fs::path& path, std::string name) {
+  std::ifstream file(path);
+  if (!file.is_open()) {
+    return nullptr;
+  }
+
+  std::vector<std::pair<std::string, uint32_t>> ranks;
+  std::string line;
+  std::string bytes;
+  size_t line_number = 0;
+  while (std::getline(file, line)) {
+    ++line_number;
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (line.empty()) continue;
+
+    auto space = line.find(' ');
+    unsigned long rank = 0;
+    bool ok = space != std::string::npos && base64_decode(std::string_view(line).substr(0, space), bytes) && !bytes.empty();
+    if (ok) {
+      try {
+        rank = std::stoul(line.substr(space + 1));
+      } catch (const std::exception&) {
+        ok = false;
+      }
+    }
+    if (!ok || rank >= NO_RANK) {
+      spdlog::warn("Invalid tokenizer vocabulary {} (line {})", path.string(), line_number);
+      return nullptr;
+    }
+    ranks.emplace_back(bytes, static_cast<uint32_t>(rank));
+  }
+
+  if (ranks.empty()) {
+    spdlog::warn("Empty tokenizer vocabulary {}", path.string());
+    return nullptr;
+  }
+  return std::make_shared<BpeTokenizer>(std::move(name), std::move(ranks));
+}
+
+uint32_t BpeTokenizer::rank(std::string_view bytes) const {
+  auto it = ranks_.find(bytes);
+  return it == ranks_.end() ? NO_RANK : it->second;
+}
+
+void BpeTokenizer::merge(std::string_view piece, std::vector<size_t>& bounds) const {
+  bounds.resize(piece.size() + 1);
+  for (size_t i = 0; i <= piece.size(); ++i) bounds[i] = i;
+
+  // pair_ranks[i]: rank of the token that merging bounds[i]..bounds[i + 2] would make
+  auto pair_rank = [&](size_t i) {
+    return i + 2 < bounds.size() ? rank(piece.substr(bounds[i], bounds[i + 2] - bounds[i])) : NO_RANK;
+  };
+  std::vector<uint32_t> pair_ranks(bounds.size());
+  for (size_t i = 0; i < bounds.size(); ++i) pair_ranks[i] = pair_rank(i);
+
+  // Apply the lowest-ranked merge until none is left
+  while (bounds.size() > 2) {
+    auto lowest = std::min_element(pair_ranks.begin(), pair_ranks.end());
+    if (*lowest == NO_RANK) break;
+    size_t i = lowest - pair_ranks.begin();
+    bounds.erase(bounds.begin() + i + 1);
+    pair_ranks.erase(pair_ranks.begin() + i + 1);
+    pair_ranks[i] = pair_rank(i);
+    if (i > 0) pair_ranks[i - 1] = pair_rank(i - 1);
+  }
+}
+
+size_t BpeTokenizer::count(std::string_view text) const {
+  size_t tokens = 0;
+  std::vector<size_t> bounds;
+  for (size_t pos = 0; pos < text.size();) {
+    auto end = next_piece(text, pos, rules_);
+    for (size_t chunk = pos; chunk < end; chunk += MAX_PIECE_BYTES) {
+      auto piece = text.substr(chunk, std::min(MAX_PIECE_BYTES, end - chunk));
+      if (rank(piece) != NO_RANK) {
+        ++tokens;
+        continue;
+      }
+      merge(piece, bounds);
+      tokens += bounds.size() - 1;
+    }
+    pos = end;
+  }
+  return tokens;
+}
+
+std::vector<uint32_t> BpeTokenizer::encode(std::string_view text) const {
+  std::vector<uint32_t> tokens;
+  std::vector<size_t> bounds;
+  for (size_t pos = 0; pos < text.size();) {
+    auto end = next_piece(text, pos, rules_);
+    for (size_t chunk = pos; chunk < end; chunk += MAX_PIECE_BYTES) {
+      auto piece = text.substr(chunk, std::min(MAX_PIECE_BYTES, end - chunk));
+      merge(piece, bounds);
+      for (size_t i = 0; i + 1 < bounds.size(); ++i) {
+        auto token = rank(piece.substr(bounds[i], bounds[i + 1] - bounds[i]));
+        if (token != NO_RANK) tokens.push_back(token);
+      }
+    }
+    pos = end;
+  }
+  return tokens;
+}
+
+// --- Registry ---
+
+std::shared_ptr<const Tokenizer> approximate_tokenizer() {
+  static auto tokenizer = std::make_shared<const ApproximateTokenizer>();
+  return tokenizer;
+}
+
+TokenizerRegistry& TokenizerRegistry::instance() {
+  static TokenizerRegistry instance;
+  return instance;
+}
+
+void TokenizerRegistry::register_tokenizer(std::shared_ptr<const Tokenizer> tokenizer) {
+  std::lock_guard lock(mutex_);
+  missing_.erase(tokenizer->name());
+  tokenizers_[tokenizer->name()] = std::move(tokenizer);
+}
+
+std::shared_ptr<const Tokenizer> TokenizerRegistry::get(const std::string& name) {
+  if (name.empty()) {
+    return approximate_tokenizer();
+  }
+
+  std::lock_guard lock(mutex_);
+  if (auto it = tokenizers_.find(name); it != tokenizers_.end()) {
+    return it->second;
+  }
+
+  if (!missing_.contains(name)) {
+    auto path = config_paths::config_dir() / "tokenizers" / (name + ".tiktoken");
+    if (auto tokenizer = BpeTokenizer::load(path, name)) {
+      spdlog::debug("Loaded tokenizer {} ({} tokens)", name, tokenizer->vocab_size());
+      tokenizers_[name] = tokenizer;
+      return tokenizer;
+    }
+    spdlog::debug("No vocabulary for tokenizer {} at {}, estimating token counts", name, path.string());
+    missing_.insert(name);
+  }
+  return approximate_tokenizer();
+}
+
+// --- Message parts ---
+
+template <typename Counter>
+static int64_t cached_count(const Tokenizer& tokenizer, TokenCountCache& cache, size_t size, Counter&& counter) {
+  if (cache.tokenizer != &tokenizer || cache.size != size) {
+    cache.tokens = static_cast<int64_t>(counter());
+    cache.tokenizer = &tokenizer;
+    cache.size = size;
+  }
+  return cache.tokens;
+}
+
+int64_t count_part_tokens(const Tokenizer& tokenizer, const MessagePart& part) {
+  if (auto* text = std::get_if<TextPart>(&part)) {
+    return cached_count(tokenizer, text->token_count, text->text.size(), [&] {
+      return tokenizer.count(text->text);
+    });
+  }
+  if (auto* call = std::get_if<ToolCallPart>(&part)) {
+    // Arguments do not change once the call is complete
+    return cached_count(tokenizer, call->token_count, 0, [&] {
+      return tokenizer.count(call->name) + tokenizer.count(call->arguments.dump());
+    });
+  }
+  if (auto* result = std::get_if<ToolResultPart>(&part)) {
+    if (result->compacted) return 0;
+    // Outputs still on disk are estimated rather than read just to be counted
+    if (!result->output.resolved()) {
+      return static_cast<int64_t>(result->output.size() / 4);
+    }
+    return cached_count(tokenizer, result->token_count, result->output.size(), [&] {
+      return tokenizer.count(result->output.str());
+    });
+  }
+  return 0;
+}
+
+int64_t count_message_tokens(const Tokenizer& tokenizer, const Message& msg) {
+  int64_t total = 0;
+  for (const auto& part : msg.parts()) {
+    total += count_part_tokens(tokenizer, part);
+  }
+  return total;
+}
+
+}  // namespace agent
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "message.hpp"
+
+namespace agent {
+
+// Token counting for context sizing.
+//
+// ModelInfo::tokenizer names the vocabulary a model uses. BpeTokenizer counts
+// with a tiktoken rank file, exactly for ASCII text (see next_piece() for
+// where non-ASCII text can differ); ApproximateTokenizer is the fallback when
+// no vocabulary is available. Counts are cached in the message parts.
+
+class Tokenizer {
+ public:
+  virtual ~Tokenizer() = default;
+
+  virtual const std::string& name() const = 0;
+
+  virtual size_t count(std::string_view text) const = 0;
+};
+
+// About 4 bytes of ASCII per token, one token per CJK (3-byte UTF-8) character
+// and one per two 2-byte characters
+class ApproximateTokenizer : public Tokenizer {
+ public:
+  const std::string& name() const override {
+    return name_;
+  }
+
+  size_t count(std::string_view text) const override;
+
+ private:
+  std::string name_ = "approximate";
+};
+
+// Pre-tokenizer rules of a vocabulary family
+enum class PieceRules { Cl100k, O200k };
+
+// Byte-level BPE (the scheme of cl100k_base / o200k_base). A name starting
+// with "o200k" selects the o200k pre-tokenizer, any other the cl100k one.
+class BpeTokenizer : public Tokenizer {
+ public:
+  BpeTokenizer(std::string name, std::vector<std::pair<std::string, uint32_t>> ranks);
+
+  // tiktoken rank file: one "<base64 token> <rank>" per line; nullptr if it cannot be read
+  static std::shared_ptr<BpeTokenizer> load(const std::filesystem::path& path, std::string name);
+
+  const std::string& name() const override {
+    return name_;
+  }
+
+  size_t count(std::string_view text) const override;
+
+  // Bytes with no token of their own are dropped
+  std::vector<uint32_t> encode(std::string_view text) const;
+
+  size_t vocab_size() const {
+    return ranks_.size();
+  }
+
+ private:
+  struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const {
+      return std::hash<std::string_view>{}(s);
+    }
+  };
+
+  // Token boundaries of one pre-tokenized piece (offsets, first 0, last piece.size())
+  void merge(std::string_view piece, std::vector<size_t>& bounds) const;
+
+  uint32_t rank(std::string_view bytes) const;
+
+  std::string name_;
+  PieceRules rules_;
+  std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> ranks_;
+};
+
+// End of the pre-tokenizer piece starting at pos. Cl100k pieces are
+// contractions, letter runs with one leading non-letter, up to three digits,
+// punctuation runs, and whitespace. O200k splits letter runs where lower case
+// turns to upper case ("camel", "Case"; "HTMLParser" stays whole), attaches a
+// contraction to the word before it ("they're") and lets punctuation runs end
+// in slashes. Both treat every non-ASCII character as a letter, and o200k as
+// one without case, so text with non-ASCII punctuation, digits or cased
+// letters can split differently from tiktoken.
+size_t next_piece(std::string_view text, size_t pos, PieceRules rules = PieceRules::Cl100k);
+
+std::shared_ptr<const Tokenizer> approximate_tokenizer();
+
+class TokenizerRegistry {
+ public:
+  static TokenizerRegistry& instance();
+
+  void register_tokenizer(std::shared_ptr<const Tokenizer> tokenizer);
+
+  // Registered tokenizer, else <config dir>/tokenizers/<name>.tiktoken,
+  // else the approximate one (also for an empty name)
+  std::shared_ptr<const Tokenizer> get(const std::string& name);
+
+ private:
+  TokenizerRegistry() = default;
+
+  std::mutex mutex_;
+  std::map<std::string, std::shared_ptr<const Tokenizer>> tokenizers_;
+  std::set<std::string> missing_;
+};
+
+// Tokens a part adds to the context, cached in the part. Parts that are not
+// sent as text, and compacted tool results, count 0.
+int64_t count_part_tokens(const Tokenizer& tokenizer, const MessagePart& part);
+
+int64_t count_message_tokens(const Tokenizer& tokenizer, const Message& msg);
+
+}  // namespace agent
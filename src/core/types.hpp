@@ -64,6 +64,17 @@ struct TokenUsage {
     return input_tokens + output_tokens;
   }
 
+  // Prompt tokens, cached or not (input_tokens excludes the cached ones)
+  int64_t prompt_tokens() const {
+    return input_tokens + cache_read_tokens + cache_write_tokens;
+  }
+
+  // Share of the prompt read from the provider's prompt cache
+  double cache_hit_ratio() const {
+    auto prompt = prompt_tokens();
+    return prompt > 0 ? static_cast<double>(cache_read_tokens) / prompt : 0.0;
+  }
+
   TokenUsage& operator+=(const TokenUsage& other) {
     input_tokens += other.input_tokens;
     output_tokens += other.output_tokens;
@@ -121,6 +132,15 @@ struct ModelInfo {
   int64_t max_output_tokens = 8192;
   bool supports_vision = false;
   bool supports_tools = true;
+  std::string tokenizer;  // Vocabulary name for TokenizerRegistry; empty: approximate counts
+};
+
+// Where to place prompt cache breakpoints (Anthropic cache_control). Each
+// breakpoint caches the request prefix up to it.
+struct PromptCachePolicy {
+  bool tools = true;  // After the tool definitions
+  bool system = true;  // After the system prompt
+  bool messages = true;  // Rolling: on the last message and the user message before it
 };
 
 // Provider configuration
@@ -130,6 +150,7 @@ struct ProviderConfig {
   std::string base_url;
   std::optional<std::string> organization;
   std::map<std::string, std::string> headers;
+  bool http2 = false;  // Offer HTTP/2 to the API host (ALPN); HTTP/1.1 if it declines
 };
 
 }  // namespace agent
@@ -5,7 +5,7 @@
 namespace agent::llm {
 
 AnthropicProvider::AnthropicProvider(const ProviderConfig& config, asio::io_context& io_ctx)
-    : config_(config), io_ctx_(io_ctx), http_client_(io_ctx) {
+    : config_(config), io_ctx_(io_ctx), http_client_(io_ctx, net::HttpPoolOptions{.http2 = config.http2}) {
   if (!config.base_url.empty()) {
     base_url_ = config.base_url;
   }
@@ -23,11 +23,9 @@ std::future<LlmResponse> AnthropicProvider::complete(const LlmRequest& request)
   auto promise = std::make_shared<std::promise<LlmResponse>>();
   auto future = promise->get_future();
 
-  auto body = request.to_anthropic_format();
-
   net::HttpOptions options;
   options.method = "POST";
-  options.body = body.dump();
+  options.body = request.anthropic_body(false);
   options.headers = {{"Content-Type", "application/json"}, {"x-api-key", config_.api_key}, {"anthropic-version", api_version_}};
 
   // Add any custom headers
@@ -35,7 +33,7 @@ std::future<LlmResponse> AnthropicProvider::complete(const LlmRequest& request)
     options.headers[key] = value;
   }
 
-  http_client_.request(base_url_ + "/v1/messages", options, [promise](net::HttpResponse response) {
+  http_client_.request(base_url_ + "/v1/messages", std::move(options), [promise](net::HttpResponse response) {
     LlmResponse result;
 
     if (!response.error.empty()) {
@@ -109,9 +107,6 @@ std::future<LlmResponse> AnthropicProvider::complete(const LlmRequest& request)
 }
 
 void AnthropicProvider::stream(const LlmRequest& request, StreamCallback callback, std::function<void()> on_complete) {
-  auto body = request.to_anthropic_format();
-  body["stream"] = true;
-
   std::map<std::string, std::string> headers = {
       {"Content-Type", "application/json"}, {"Accept", "text/event-stream"}, {"x-api-key", config_.api_key}, {"anthropic-version", api_version_}};
 
@@ -121,10 +116,11 @@ void AnthropicProvider::stream(const LlmRequest& request, StreamCallback callbac
 
   // Reset state
   tool_calls_.clear();
+  stream_usage_ = {};
 
   net::HttpOptions options;
   options.method = "POST";
-  options.body = body.dump();
+  options.body = request.anthropic_body(true);
   options.headers = headers;
 
   auto shared_callback = std::make_shared<StreamCallback>(std::move(callback));
@@ -133,10 +129,10 @@ void AnthropicProvider::stream(const LlmRequest& request, StreamCallback callbac
 
   // Use streaming HTTP request for real-time SSE processing
   http_client_.request_stream(
-      base_url_ + "/v1/messages", options,
-      [this, shared_callback, sse_buffer](const std::string& chunk) {
+      base_url_ + "/v1/messages", std::move(options),
+      [this, shared_callback, sse_buffer](std::string_view chunk) {
         // Accumulate chunk into SSE buffer and parse complete events
-        *sse_buffer += chunk;
+        sse_buffer->append(chunk);
 
         // Process complete SSE events (ended by \n\n or \r\n\r\n)
         size_t pos;
@@ -240,14 +236,23 @@ void AnthropicProvider::parse_sse_event(const std::string& data, StreamCallback&
         finish.reason = FinishReason::Stop;
       }
 
+      // Prompt usage comes with message_start; counts repeated here are cumulative
+      finish.usage = stream_usage_;
       if (j.contains("usage")) {
-        finish.usage.output_tokens = j["usage"].value("output_tokens", 0);
+        const auto& usage = j["usage"];
+        finish.usage.input_tokens = usage.value("input_tokens", finish.usage.input_tokens);
+        finish.usage.output_tokens = usage.value("output_tokens", 0);
+        finish.usage.cache_read_tokens = usage.value("cache_read_input_tokens", finish.usage.cache_read_tokens);
+        finish.usage.cache_write_tokens = usage.value("cache_creation_input_tokens", finish.usage.cache_write_tokens);
       }
 
       callback(finish);
     } else if (type == "message_start") {
       if (j.contains("message") && j["message"].contains("usage")) {
-        // Initial usage info (input tokens)
+        const auto& usage = j["message"]["usage"];
+        stream_usage_.input_tokens = usage.value("input_tokens", 0);
+        stream_usage_.cache_read_tokens = usage.value("cache_read_input_tokens", 0);
+        stream_usage_.cache_write_tokens = usage.value("cache_creation_input_tokens", 0);
       }
     } else if (type == "error") {
       StreamError error;
@@ -28,7 +28,7 @@ class AnthropicProvider : public Provider {
 
   ProviderConfig config_;
   asio::io_context& io_ctx_;
-  net::HttpClient http_client_;
+  net::HttpClient http_client_;  // With config.http2, HTTP/2 when the host offers it: sessions share one connection
   std::unique_ptr<net::SseClient> sse_client_;
 
   std::string base_url_ = "https://api.anthropic.com";
@@ -41,6 +41,8 @@ class AnthropicProvider : public Provider {
     std::string args_json;
   };
   std::map<int, ToolCallInfo> tool_calls_;
+
+  TokenUsage stream_usage_;  // Prompt usage from message_start
 };
 
 }  // namespace agent::llm
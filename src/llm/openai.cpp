@@ -25,7 +25,8 @@ std::string get_auth_header(const ProviderConfig& config) {
 }
 }  // namespace
 
-OpenAIProvider::OpenAIProvider(const ProviderConfig& config, asio::io_context& io_ctx) : config_(config), io_ctx_(io_ctx), http_client_(io_ctx) {
+OpenAIProvider::OpenAIProvider(const ProviderConfig& config, asio::io_context& io_ctx)
+    : config_(config), io_ctx_(io_ctx), http_client_(io_ctx, net::HttpPoolOptions{.http2 = config.http2}) {
   if (!config.base_url.empty()) {
     base_url_ = config.base_url;
   }
@@ -33,10 +34,10 @@ OpenAIProvider::OpenAIProvider(const ProviderConfig& config, asio::io_context& i
 
 std::vector<ModelInfo> OpenAIProvider::models() const {
   return {
-      {"gpt-4.1", "openai", 1047576, 32768, true, true},      {"gpt-4.1-mini", "openai", 1047576, 32768, true, true},
-      {"gpt-4.1-nano", "openai", 1047576, 32768, true, true}, {"gpt-4o", "openai", 128000, 16384, true, true},
-      {"gpt-4o-mini", "openai", 128000, 16384, true, true},   {"o3", "openai", 200000, 100000, true, true},
-      {"o3-mini", "openai", 200000, 100000, false, true},     {"o4-mini", "openai", 200000, 100000, true, true},
+      {"gpt-4.1", "openai", 1047576, 32768, true, true, "o200k_base"},      {"gpt-4.1-mini", "openai", 1047576, 32768, true, true, "o200k_base"},
+      {"gpt-4.1-nano", "openai", 1047576, 32768, true, true, "o200k_base"}, {"gpt-4o", "openai", 128000, 16384, true, true, "o200k_base"},
+      {"gpt-4o-mini", "openai", 128000, 16384, true, true, "o200k_base"},   {"o3", "openai", 200000, 100000, true, true, "o200k_base"},
+      {"o3-mini", "openai", 200000, 100000, false, true, "o200k_base"},     {"o4-mini", "openai", 200000, 100000, true, true, "o200k_base"},
   };
 }
 
@@ -44,11 +45,9 @@ std::future<LlmResponse> OpenAIProvider::complete(const LlmRequest& request) {
   auto promise = std::make_shared<std::promise<LlmResponse>>();
   auto future = promise->get_future();
 
-  auto body = request.to_openai_format();
-
   net::HttpOptions options;
   options.method = "POST";
-  options.body = body.dump();
+  options.body = request.openai_body(false);
   options.headers = {{"Content-Type", "application/json"}, {"Authorization", get_auth_header(config_)}};
 
   // Add organization header if configured
@@ -61,7 +60,7 @@ std::future<LlmResponse> OpenAIProvider::complete(const LlmRequest& request) {
     options.headers[key] = value;
   }
 
-  http_client_.request(base_url_ + "/v1/chat/completions", options, [promise](net::HttpResponse response) {
+  http_client_.request(base_url_ + "/v1/chat/completions", std::move(options), [promise](net::HttpResponse response) {
     LlmResponse result;
 
     if (!response.error.empty()) {
@@ -153,9 +152,6 @@ std::future<LlmResponse> OpenAIProvider::complete(const LlmRequest& request) {
 }
 
 void OpenAIProvider::stream(const LlmRequest& request, StreamCallback callback, std::function<void()> on_complete) {
-  auto body = request.to_openai_format();
-  body["stream"] = true;
-
   std::map<std::string, std::string> headers = {
       {"Content-Type", "application/json"}, {"Accept", "text/event-stream"}, {"Authorization", get_auth_header(config_)}};
 
@@ -172,7 +168,7 @@ void OpenAIProvider::stream(const LlmRequest& request, StreamCallback callback,
 
   net::HttpOptions options;
   options.method = "POST";
-  options.body = body.dump();
+  options.body = request.openai_body(true);
   options.headers = headers;
 
   spdlog::debug("OpenAI request URL: {}/v1/chat/completions", base_url_);
@@ -184,10 +180,10 @@ void OpenAIProvider::stream(const LlmRequest& request, StreamCallback callback,
 
   // Use streaming HTTP request for real-time SSE processing
   http_client_.request_stream(
-      base_url_ + "/v1/chat/completions", options,
-      [this, shared_callback, sse_buffer](const std::string& chunk) {
+      base_url_ + "/v1/chat/completions", std::move(options),
+      [this, shared_callback, sse_buffer](std::string_view chunk) {
         // Accumulate chunk into SSE buffer and parse complete events
-        *sse_buffer += chunk;
+        sse_buffer->append(chunk);
 
         // Process complete SSE events (ended by \n\n or \r\n\r\n)
         size_t pos;
@@ -28,7 +28,7 @@ class OpenAIProvider : public Provider {
 
   ProviderConfig config_;
   asio::io_context& io_ctx_;
-  net::HttpClient http_client_;
+  net::HttpClient http_client_;  // With config.http2, HTTP/2 when the host offers it: sessions share one connection
   std::unique_ptr<net::SseClient> sse_client_;
 
   std::string base_url_ = "https://api.openai.com";
@@ -1,5 +1,8 @@
 #include "provider.hpp"
 
+#include <algorithm>
+
+#include "core/json_writer.hpp"
 #include "llm/anthropic.hpp"
 #include "llm/openai.hpp"
 
@@ -46,99 +49,202 @@ void ProviderFactory::register_provider(const std::string& name, FactoryFunc fac
   factories_[name] = std::move(factory);
 }
 
-// Helper to convert messages to Anthropic format
-json LlmRequest::to_anthropic_format() const {
-  json request;
-  request["model"] = model;
-  request["max_tokens"] = max_tokens.value_or(8192);
+// --- Request bodies ---
+
+// Rough serialized size, to size the output buffer once
+static size_t estimated_body_size(const LlmRequest& request) {
+  size_t size = 1024 + request.system_prompt.size();
+  for (const auto& msg : request.messages) {
+    size += 64;
+    for (const auto& part : msg.parts()) {
+      if (auto* text = std::get_if<TextPart>(&part)) {
+        size += text->text.size() + 32;
+      } else if (auto* tr = std::get_if<ToolResultPart>(&part)) {
+        size += tr->output.size() + 96;
+      } else if (auto* img = std::get_if<ImagePart>(&part)) {
+        size += img->url.size() + 96;
+      } else {
+        size += 256;
+      }
+    }
+  }
+  if (request.tool_schemas) {
+    size += request.tool_schemas->serialized(ToolSchemaFormat::Anthropic).size();
+  }
+  return size;
+}
+
+static void write_tools(JsonWriter& writer, const LlmRequest& request, ToolSchemaFormat format) {
+  if (request.tools.empty()) return;
+  writer.key("tools");
+  if (request.tool_schemas) {
+    writer.raw(request.tool_schemas->serialized(format));
+  } else {
+    writer.raw(ToolSchemaSet(request.tools, 0).serialized(format));
+  }
+}
+
+static void write_cache_breakpoint(JsonWriter& writer) {
+  writer.key("cache_control").begin_object().member("type", "ephemeral").end_object();
+}
+
+// Base64 image from a data: URL; nullopt for other URLs
+static std::optional<std::pair<std::string_view, std::string_view>> data_url_image(const ImagePart& img) {
+  std::string_view url = img.url;
+  if (!url.starts_with("data:")) return std::nullopt;
+  auto comma = url.find(',');
+  if (comma == std::string_view::npos) return std::nullopt;
+  auto media_type = url.substr(5, url.find(';') - 5);
+  return std::make_pair(media_type, url.substr(comma + 1));
+}
+
+static const TextPart* first_text(const Message& msg) {
+  for (const auto& part : msg.parts()) {
+    if (auto* text = std::get_if<TextPart>(&part)) return text;
+  }
+  return nullptr;
+}
+
+// Content blocks a message has in Anthropic format
+static size_t anthropic_block_count(const Message& msg) {
+  size_t count = 0;
+  for (const auto& part : msg.parts()) {
+    if (std::holds_alternative<TextPart>(part) || std::holds_alternative<ToolCallPart>(part) || std::holds_alternative<ToolResultPart>(part)) {
+      ++count;
+    } else if (auto* img = std::get_if<ImagePart>(&part); img && data_url_image(*img)) {
+      ++count;
+    }
+  }
+  return count;
+}
+
+void LlmRequest::write_anthropic_body(std::string& out, bool stream) const {
+  JsonWriter writer(out);
+  writer.begin_object();
+  writer.member("model", model);
+  writer.member("max_tokens", max_tokens.value_or(8192));
 
   if (!system_prompt.empty()) {
-    request["system"] = system_prompt;
+    writer.key("system");
+    if (prompt_cache && prompt_cache->system) {
+      writer.begin_array().begin_object().member("type", "text").member("text", system_prompt);
+      write_cache_breakpoint(writer);
+      writer.end_object().end_array();
+    } else {
+      writer.value(system_prompt);
+    }
   }
 
   if (temperature) {
-    request["temperature"] = *temperature;
+    writer.member("temperature", *temperature);
   }
 
   if (stop_sequences && !stop_sequences->empty()) {
-    request["stop_sequences"] = *stop_sequences;
+    writer.key("stop_sequences").begin_array();
+    for (const auto& stop : *stop_sequences) writer.value(stop);
+    writer.end_array();
+  }
+
+  // Rolling cache breakpoints: the last message caches the whole conversation
+  // for the next step, and the user message before it is where the previous
+  // step put its breakpoint, so this step reads that prefix from the cache
+  size_t cache_last = messages.size();
+  size_t cache_previous = messages.size();
+  if (prompt_cache && prompt_cache->messages) {
+    for (size_t i = messages.size(); i-- > 0;) {
+      if (messages[i].role() == Role::System || messages[i].parts().empty()) continue;
+      if (cache_last == messages.size()) {
+        cache_last = i;
+      } else if (messages[i].role() == Role::User) {
+        cache_previous = i;
+        break;
+      }
+    }
   }
 
   // Convert messages
-  json msgs = json::array();
-  for (const auto& msg : messages) {
+  writer.key("messages").begin_array();
+  for (size_t i = 0; i < messages.size(); ++i) {
+    const auto& msg = messages[i];
     if (msg.role() == Role::System) continue;  // System handled separately
 
-    json m;
-    m["role"] = msg.role() == Role::User ? "user" : "assistant";
+    writer.begin_object();
+    writer.member("role", msg.role() == Role::User ? "user" : "assistant");
+
+    auto blocks = anthropic_block_count(msg);
+    bool breakpoint = (i == cache_last || i == cache_previous) && blocks > 0;
 
-    json content = json::array();
+    // A lone text block is sent as a plain string (text parts always make a block)
+    if (blocks == 1 && !breakpoint) {
+      if (auto* text = first_text(msg)) {
+        writer.member("content", text->text).end_object();
+        continue;
+      }
+    }
+
+    writer.key("content").begin_array();
+    size_t written = 0;
     for (const auto& part : msg.parts()) {
       if (auto* text = std::get_if<TextPart>(&part)) {
-        content.push_back({{"type", "text"}, {"text", text->text}});
+        writer.begin_object().member("type", "text").member("text", text->text);
       } else if (auto* tc = std::get_if<ToolCallPart>(&part)) {
-        content.push_back({{"type", "tool_use"}, {"id", tc->id}, {"name", tc->name}, {"input", tc->arguments}});
+        writer.begin_object().member("type", "tool_use").member("id", tc->id).member("name", tc->name).member("input", tc->arguments);
       } else if (auto* tr = std::get_if<ToolResultPart>(&part)) {
-        content.push_back({{"type", "tool_result"}, {"tool_use_id", tr->tool_call_id}, {"content", tr->output}, {"is_error", tr->is_error}});
+        writer.begin_object()
+            .member("type", "tool_result")
+            .member("tool_use_id", tr->tool_call_id)
+            .member("content", tr->output.str())
+            .member("is_error", tr->is_error);
       } else if (auto* img = std::get_if<ImagePart>(&part)) {
-        // Handle base64 images
-        if (img->url.starts_with("data:")) {
-          auto comma = img->url.find(',');
-          if (comma != std::string::npos) {
-            auto media_type_end = img->url.find(';');
-            std::string media_type = img->url.substr(5, media_type_end - 5);
-            std::string data = img->url.substr(comma + 1);
-            content.push_back({{"type", "image"}, {"source", {{"type", "base64"}, {"media_type", media_type}, {"data", data}}}});
-          }
-        }
+        auto image = data_url_image(*img);
+        if (!image) continue;
+        writer.begin_object().member("type", "image").key("source").begin_object();
+        writer.member("type", "base64").member("media_type", image->first).member("data", image->second).end_object();
+      } else {
+        continue;
       }
+      if (breakpoint && ++written == blocks) {
+        write_cache_breakpoint(writer);
+      }
+      writer.end_object();
     }
-
-    if (content.size() == 1 && content[0]["type"] == "text") {
-      m["content"] = content[0]["text"];
-    } else {
-      m["content"] = content;
-    }
-
-    msgs.push_back(m);
+    writer.end_array().end_object();
   }
-  request["messages"] = msgs;
+  writer.end_array();
 
-  // Convert tools
-  if (!tools.empty()) {
-    json tools_json = json::array();
-    for (const auto& tool : tools) {
-      tools_json.push_back(tool->to_json_schema());
-    }
-    request["tools"] = tools_json;
-  }
+  write_tools(writer, *this, prompt_cache && prompt_cache->tools ? ToolSchemaFormat::AnthropicCached : ToolSchemaFormat::Anthropic);
 
-  return request;
+  if (stream) {
+    writer.member("stream", true);
+  }
+  writer.end_object();
 }
 
-// Helper to convert messages to OpenAI format
-json LlmRequest::to_openai_format() const {
-  json request;
-  request["model"] = model;
+void LlmRequest::write_openai_body(std::string& out, bool stream) const {
+  JsonWriter writer(out);
+  writer.begin_object();
+  writer.member("model", model);
 
   if (max_tokens) {
-    request["max_tokens"] = *max_tokens;
+    writer.member("max_tokens", *max_tokens);
   }
 
   if (temperature) {
-    request["temperature"] = *temperature;
+    writer.member("temperature", *temperature);
   }
 
   if (stop_sequences && !stop_sequences->empty()) {
-    request["stop"] = *stop_sequences;
+    writer.key("stop").begin_array();
+    for (const auto& stop : *stop_sequences) writer.value(stop);
+    writer.end_array();
   }
 
   // Convert messages
-  json msgs = json::array();
+  writer.key("messages").begin_array();
 
   // Add system message if present
   if (!system_prompt.empty()) {
-    msgs.push_back({{"role", "system"}, {"content", system_prompt}});
+    writer.begin_object().member("role", "system").member("content", system_prompt).end_object();
   }
 
   for (const auto& msg : messages) {
@@ -150,38 +256,89 @@ json LlmRequest::to_openai_format() const {
       // Also include any text content from the message as a user message
       auto text = msg.text();
       if (!text.empty()) {
-        msgs.push_back({{"role", "user"}, {"content", text}});
+        writer.begin_object().member("role", "user").member("content", text).end_object();
       }
 
       for (const auto* tr : tool_results) {
-        json tool_msg;
-        tool_msg["role"] = "tool";
-        tool_msg["tool_call_id"] = tr->tool_call_id;
-        tool_msg["content"] = tr->output;
-        msgs.push_back(tool_msg);
+        writer.begin_object().member("role", "tool").member("tool_call_id", tr->tool_call_id).member("content", tr->output.str()).end_object();
       }
-    } else {
-      msgs.push_back(msg.to_api_format());
+      continue;
     }
-  }
-  request["messages"] = msgs;
-
-  // Convert tools
-  if (!tools.empty()) {
-    json tools_json = json::array();
-    for (const auto& tool : tools) {
-      auto schema = tool->to_json_schema();
-      // OpenAI uses "parameters" instead of "input_schema"
-      json func = {{"name", schema["name"]}, {"description", schema["description"]}};
-      if (schema.contains("input_schema")) {
-        func["parameters"] = schema["input_schema"];
+
+    // Same shape as Message::to_api_format()
+    writer.begin_object();
+    writer.member("role", to_string(msg.role()));
+
+    size_t blocks = 0;
+    const TextPart* only_text = nullptr;
+    for (const auto& part : msg.parts()) {
+      if (auto* text = std::get_if<TextPart>(&part)) {
+        ++blocks;
+        only_text = text;
+      } else if (std::holds_alternative<ImagePart>(part)) {
+        ++blocks;
+        only_text = nullptr;
       }
-      tools_json.push_back({{"type", "function"}, {"function", func}});
     }
-    request["tools"] = tools_json;
+    if (blocks == 1 && only_text) {
+      writer.member("content", only_text->text);
+    } else if (blocks > 0) {
+      writer.key("content").begin_array();
+      for (const auto& part : msg.parts()) {
+        if (auto* text = std::get_if<TextPart>(&part)) {
+          writer.begin_object().member("type", "text").member("text", text->text).end_object();
+        } else if (auto* img = std::get_if<ImagePart>(&part)) {
+          writer.begin_object().member("type", "image_url").key("image_url").begin_object().member("url", img->url).end_object().end_object();
+        }
+      }
+      writer.end_array();
+    }
+
+    bool has_tool_calls = std::any_of(msg.parts().begin(), msg.parts().end(), [](const MessagePart& part) {
+      return std::holds_alternative<ToolCallPart>(part);
+    });
+    if (has_tool_calls) {
+      writer.key("tool_calls").begin_array();
+      for (const auto& part : msg.parts()) {
+        if (auto* tc = std::get_if<ToolCallPart>(&part)) {
+          writer.begin_object().member("id", tc->id).member("type", "function").key("function").begin_object();
+          writer.member("name", tc->name).member("arguments", tc->arguments.dump()).end_object().end_object();
+        }
+      }
+      writer.end_array();
+    }
+    writer.end_object();
+  }
+  writer.end_array();
+
+  write_tools(writer, *this, ToolSchemaFormat::OpenAI);
+
+  if (stream) {
+    writer.member("stream", true);
   }
+  writer.end_object();
+}
+
+std::string LlmRequest::anthropic_body(bool stream) const {
+  std::string out;
+  out.reserve(estimated_body_size(*this));
+  write_anthropic_body(out, stream);
+  return out;
+}
+
+std::string LlmRequest::openai_body(bool stream) const {
+  std::string out;
+  out.reserve(estimated_body_size(*this));
+  write_openai_body(out, stream);
+  return out;
+}
 
-  return request;
+json LlmRequest::to_anthropic_format() const {
+  return json::parse(anthropic_body(false));
+}
+
+json LlmRequest::to_openai_format() const {
+  return json::parse(openai_body(false));
 }
 
 }  // namespace agent::llm
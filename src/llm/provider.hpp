@@ -56,13 +56,29 @@ struct LlmRequest {
 
   // Tool definitions
   std::vector<std::shared_ptr<Tool>> tools;
+  // Optional cache of the serialized definitions of tools (ToolRegistry::schemas_for_agent)
+  std::shared_ptr<const ToolSchemaSet> tool_schemas;
 
   // Generation parameters
   std::optional<double> temperature;
   std::optional<int> max_tokens;
   std::optional<std::vector<std::string>> stop_sequences;
 
-  // Convert to API-specific format
+  // Prompt cache breakpoints; none when unset
+  std::optional<PromptCachePolicy> prompt_cache;
+
+  // Request bodies, serialized straight from the messages. write_*_body()
+  // append to out, so a caller can reuse one buffer across requests. Tool
+  // definitions come from tool_schemas when set.
+  std::string anthropic_body(bool stream) const;
+
+  std::string openai_body(bool stream) const;
+
+  void write_anthropic_body(std::string& out, bool stream) const;
+
+  void write_openai_body(std::string& out, bool stream) const;
+
+  // The bodies as json (parsed back; for inspection and tests)
   json to_anthropic_format() const;
 
   json to_openai_format() const;
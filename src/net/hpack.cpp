@@ -0,0 +1,317 @@
+#include "hpack.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace agent::net {
+
+// --- Tables ---
+
+struct HuffmanCode {
+  uint32_t code;
+  uint8_t bits;
+};
+
+// By symbol; 256 is EOS
+static constexpr HuffmanCode HUFFMAN_CODES[257] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28}, {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28},
+    {0xfffffe7, 28}, {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28}, {0xfffffea, 28},
+    {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28}, {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28},
+    {0xffffff0, 28}, {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28}, {0xffffff4, 28},
+    {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28}, {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28},
+    {0xffffffb, 28}, {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12}, {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11}, {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6}, {0x0, 5}, {0x1, 5},
+    {0x2, 5}, {0x19, 6}, {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6}, {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10}, {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7}, {0x5f, 7},
+    {0x60, 7}, {0x61, 7}, {0x62, 7}, {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7}, {0x67, 7}, {0x68, 7}, {0x69, 7},
+    {0x6a, 7}, {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7}, {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7}, {0xfc, 8},
+    {0x73, 7}, {0xfd, 8}, {0x1ffb, 13}, {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6}, {0x7ffd, 15}, {0x3, 5},
+    {0x23, 6}, {0x4, 5}, {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6}, {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5}, {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5}, {0x9, 5}, {0x2d, 6},
+    {0x77, 7}, {0x78, 7}, {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15}, {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13},
+    {0xffffffc, 28}, {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20}, {0x3fffd3, 22}, {0x3fffd4, 22},
+    {0x3fffd5, 22}, {0x7fffd9, 23}, {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23}, {0x7fffdd, 23},
+    {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23}, {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+    {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23}, {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22},
+    {0x7fffe5, 23}, {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24}, {0x3fffda, 22}, {0x1fffdd, 21},
+    {0xfffe9, 20}, {0x3fffdb, 22}, {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21}, {0x7fffea, 23},
+    {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24}, {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21}, {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23},
+    {0x7fffef, 23}, {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22}, {0x7ffff0, 23}, {0x3fffe5, 22},
+    {0x3fffe6, 22}, {0x7ffff1, 23}, {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19}, {0x3fffe7, 22},
+    {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25}, {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26},
+    {0x7ffffde, 27}, {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25}, {0x7fff2, 19}, {0x1fffe3, 21},
+    {0x3ffffe6, 26}, {0x7ffffe0, 27}, {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26}, {0xffffffd, 28}, {0x7ffffe3, 27},
+    {0x7ffffe4, 27}, {0x7ffffe5, 27}, {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21}, {0x3fffe9, 22},
+    {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23}, {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+    {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23}, {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26},
+    {0x3ffffed, 26}, {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27}, {0x7ffffeb, 27},
+    {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27}, {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27},
+    {0x3ffffee, 26}, {0x3fffffff, 30}
+};
+
+static constexpr std::pair<std::string_view, std::string_view> STATIC_TABLE[] = {
+    {":authority", ""}, {":method", "GET"}, {":method", "POST"}, {":path", "/"}, {":path", "/index.html"},
+    {":scheme", "http"}, {":scheme", "https"}, {":status", "200"}, {":status", "204"}, {":status", "206"},
+    {":status", "304"}, {":status", "400"}, {":status", "404"}, {":status", "500"}, {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"}, {"accept-language", ""}, {"accept-ranges", ""}, {"accept", ""},
+    {"access-control-allow-origin", ""}, {"age", ""}, {"allow", ""}, {"authorization", ""}, {"cache-control", ""},
+    {"content-disposition", ""}, {"content-encoding", ""}, {"content-language", ""}, {"content-length", ""},
+    {"content-location", ""}, {"content-range", ""}, {"content-type", ""}, {"cookie", ""}, {"date", ""}, {"etag", ""},
+    {"expect", ""}, {"expires", ""}, {"from", ""}, {"host", ""}, {"if-match", ""}, {"if-modified-since", ""},
+    {"if-none-match", ""}, {"if-range", ""}, {"if-unmodified-since", ""}, {"last-modified", ""}, {"link", ""},
+    {"location", ""}, {"max-forwards", ""}, {"proxy-authenticate", ""}, {"proxy-authorization", ""}, {"range", ""},
+    {"referer", ""}, {"refresh", ""}, {"retry-after", ""}, {"server", ""}, {"set-cookie", ""},
+    {"strict-transport-security", ""}, {"transfer-encoding", ""}, {"user-agent", ""}, {"vary", ""}, {"via", ""},
+    {"www-authenticate", ""}
+};
+
+static constexpr size_t STATIC_TABLE_SIZE = std::size(STATIC_TABLE);
+static constexpr size_t ENTRY_OVERHEAD = 32;
+
+// The codes are canonical: within a length they are consecutive, in
+// symbol order. Decoding walks a code bit by bit and checks it against the
+// range of codes of its length so far.
+struct HuffmanDecodeTable {
+  std::array<uint32_t, 31> first{};  // First code of each length
+  std::array<uint16_t, 31> count{};  // Codes of each length
+  std::array<uint16_t, 31> offset{};  // Index in symbols of the first code
+  std::array<uint16_t, 257> symbols{};  // By length, then code
+
+  HuffmanDecodeTable() {
+    for (const auto& code : HUFFMAN_CODES) count[code.bits]++;
+    uint32_t next = 0;
+    uint16_t index = 0;
+    for (int bits = 1; bits <= 30; ++bits) {
+      next <<= 1;
+      first[bits] = next;
+      offset[bits] = index;
+      next += count[bits];
+      index += count[bits];
+    }
+    for (uint16_t symbol = 0; symbol < 257; ++symbol) {
+      const auto& code = HUFFMAN_CODES[symbol];
+      symbols[offset[code.bits] + (code.code - first[code.bits])] = symbol;
+    }
+  }
+};
+
+// --- Huffman coding ---
+
+size_t huffman_encoded_size(std::string_view text) {
+  size_t bits = 0;
+  for (unsigned char c : text) bits += HUFFMAN_CODES[c].bits;
+  return (bits + 7) / 8;
+}
+
+void huffman_encode(std::string_view text, std::string& out) {
+  uint64_t pending = 0;
+  int pending_bits = 0;
+  for (unsigned char c : text) {
+    const auto& code = HUFFMAN_CODES[c];
+    pending = (pending << code.bits) | code.code;
+    pending_bits += code.bits;
+    while (pending_bits >= 8) {
+      pending_bits -= 8;
+      out.push_back(static_cast<char>(pending >> pending_bits));
+    }
+  }
+  if (pending_bits > 0) {
+    // Padded with the most significant bits of EOS, all ones
+    out.push_back(static_cast<char>((pending << (8 - pending_bits)) | (0xff >> pending_bits)));
+  }
+}
+
+bool huffman_decode(std::string_view data, std::string& out) {
+  static const HuffmanDecodeTable table;
+  uint32_t code = 0;
+  int bits = 0;
+  bool all_ones = true;  // The bits of the current code so far
+  for (unsigned char byte : data) {
+    for (int i = 7; i >= 0; --i) {
+      uint32_t bit = (byte >> i) & 1;
+      code = (code << 1) | bit;
+      all_ones = all_ones && bit;
+      bits++;
+      if (bits > 30) return false;
+      if (code - table.first[bits] < table.count[bits]) {
+        uint16_t symbol = table.symbols[table.offset[bits] + (code - table.first[bits])];
+        if (symbol == 256) return false;  // EOS in a string
+        out.push_back(static_cast<char>(symbol));
+        code = 0;
+        bits = 0;
+        all_ones = true;
+      }
+    }
+  }
+  // Padding: fewer than 8 bits, all ones
+  return bits < 8 && all_ones;
+}
+
+// --- Primitives ---
+
+// Appends value with an N-bit prefix; first holds the bits above the prefix
+static void encode_integer(uint64_t value, int prefix_bits, uint8_t first, std::string& out) {
+  uint64_t max_prefix = (1u << prefix_bits) - 1;
+  if (value < max_prefix) {
+    out.push_back(static_cast<char>(first | value));
+    return;
+  }
+  out.push_back(static_cast<char>(first | max_prefix));
+  value -= max_prefix;
+  while (value >= 128) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+static bool decode_integer(std::string_view& data, int prefix_bits, uint64_t& value) {
+  if (data.empty()) return false;
+  uint64_t max_prefix = (1u << prefix_bits) - 1;
+  value = static_cast<uint8_t>(data.front()) & max_prefix;
+  data.remove_prefix(1);
+  if (value < max_prefix) return true;
+
+  for (int shift = 0;; shift += 7) {
+    if (data.empty() || shift > 28) return false;  // Truncated, or more than any limit here allows
+    auto byte = static_cast<uint8_t>(data.front());
+    data.remove_prefix(1);
+    value += static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80)) return true;
+  }
+}
+
+static void encode_string(std::string_view text, std::string& out) {
+  size_t huffman_size = huffman_encoded_size(text);
+  if (huffman_size < text.size()) {
+    encode_integer(huffman_size, 7, 0x80, out);
+    huffman_encode(text, out);
+  } else {
+    encode_integer(text.size(), 7, 0, out);
+    out.append(text);
+  }
+}
+
+static bool decode_string(std::string_view& data, std::string& out) {
+  if (data.empty()) return false;
+  bool huffman = static_cast<uint8_t>(data.front()) & 0x80;
+  uint64_t length = 0;
+  if (!decode_integer(data, 7, length) || length > data.size()) return false;
+  auto text = data.substr(0, length);
+  data.remove_prefix(length);
+  out.clear();
+  if (huffman) return huffman_decode(text, out);
+  out.assign(text);
+  return true;
+}
+
+// --- Encoder ---
+
+static bool is_sensitive(std::string_view name) {
+  return name == "authorization" || name == "proxy-authorization" || name == "cookie" || name == "x-api-key";
+}
+
+void HpackEncoder::encode(const HeaderList& headers, std::string& out) {
+  if (!table_size_sent_) {
+    // No dynamic table is used: say so once, so the peer keeps none for us
+    encode_integer(0, 5, 0x20, out);
+    table_size_sent_ = true;
+  }
+
+  for (const auto& [name, value] : headers) {
+    size_t name_index = 0;
+    size_t field_index = 0;
+    for (size_t i = 0; i < STATIC_TABLE_SIZE && !field_index; ++i) {
+      if (STATIC_TABLE[i].first != name) continue;
+      if (!name_index) name_index = i + 1;
+      if (STATIC_TABLE[i].second == value) field_index = i + 1;
+    }
+
+    if (field_index) {
+      encode_integer(field_index, 7, 0x80, out);
+      continue;
+    }
+    // Literal without indexing, or never indexed
+    encode_integer(name_index, 4, is_sensitive(name) ? 0x10 : 0, out);
+    if (!name_index) encode_string(name, out);
+    encode_string(value, out);
+  }
+}
+
+// --- Decoder ---
+
+bool HpackDecoder::decode(std::string_view block, HeaderList& headers) {
+  size_t list_size = 0;
+  bool fields_started = false;
+  while (!block.empty()) {
+    auto first = static_cast<uint8_t>(block.front());
+    std::pair<std::string, std::string> field;
+
+    if (first & 0x80) {
+      // Indexed field
+      uint64_t index = 0;
+      if (!decode_integer(block, 7, index) || !lookup(index, field)) return false;
+    } else if ((first & 0xe0) == 0x20) {
+      // Dynamic table size update, only ahead of the fields
+      uint64_t size = 0;
+      if (fields_started || !decode_integer(block, 5, size) || size > DEFAULT_TABLE_SIZE) return false;
+      max_table_size_ = size;
+      evict(max_table_size_);
+      continue;
+    } else {
+      // Literal: with incremental indexing (01), without (0000) or never indexed (0001)
+      bool indexing = first & 0x40;
+      uint64_t index = 0;
+      if (!decode_integer(block, indexing ? 6 : 4, index)) return false;
+      if (index) {
+        if (!lookup(index, field)) return false;
+      } else if (!decode_string(block, field.first)) {
+        return false;
+      }
+      if (!decode_string(block, field.second)) return false;
+      if (indexing) insert(field);
+    }
+
+    fields_started = true;
+    list_size += field.first.size() + field.second.size() + ENTRY_OVERHEAD;
+    if (list_size > MAX_HEADER_LIST_SIZE) return false;
+    headers.push_back(std::move(field));
+  }
+  return true;
+}
+
+bool HpackDecoder::lookup(uint64_t index, std::pair<std::string, std::string>& field) const {
+  if (index == 0) return false;
+  if (index <= STATIC_TABLE_SIZE) {
+    field = {std::string(STATIC_TABLE[index - 1].first), std::string(STATIC_TABLE[index - 1].second)};
+    return true;
+  }
+  index -= STATIC_TABLE_SIZE + 1;
+  if (index >= table_.size()) return false;
+  field = table_[index];
+  return true;
+}
+
+void HpackDecoder::insert(std::pair<std::string, std::string> field) {
+  size_t size = field.first.size() + field.second.size() + ENTRY_OVERHEAD;
+  if (size > max_table_size_) {
+    // Larger than the table: empties it
+    evict(0);
+    return;
+  }
+  evict(max_table_size_ - size);
+  table_size_ += size;
+  table_.push_front(std::move(field));
+}
+
+void HpackDecoder::evict(size_t max_size) {
+  while (table_size_ > max_size) {
+    const auto& oldest = table_.back();
+    table_size_ -= oldest.first.size() + oldest.second.size() + ENTRY_OVERHEAD;
+    table_.pop_back();
+  }
+}
+
+}  // namespace agent::net
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace agent::net {
+
+// HPACK header compression for HTTP/2 (RFC 7541)
+
+using HeaderList = std::vector<std::pair<std::string, std::string>>;
+
+// Encodes header blocks without a dynamic table: fields are sent as static
+// table references or literals, Huffman coded when that is shorter, so the
+// peer's table size never matters. Credentials are marked never-indexed.
+class HpackEncoder {
+ public:
+  // Appends the header block for headers (names in lower case) to out
+  void encode(const HeaderList& headers, std::string& out);
+
+ private:
+  bool table_size_sent_ = false;
+};
+
+class HpackDecoder {
+ public:
+  // The table size this side allows (SETTINGS_HEADER_TABLE_SIZE)
+  static constexpr size_t DEFAULT_TABLE_SIZE = 4096;
+  // Decoded size of a header list beyond which a block is rejected
+  static constexpr size_t MAX_HEADER_LIST_SIZE = 256 * 1024;
+
+  // Decodes a complete header block into headers. False if it is malformed,
+  // which is a connection error: the table is then out of step.
+  bool decode(std::string_view block, HeaderList& headers);
+
+  size_t table_size() const {
+    return table_size_;
+  }
+
+ private:
+  bool lookup(uint64_t index, std::pair<std::string, std::string>& field) const;
+  void insert(std::pair<std::string, std::string> field);
+  void evict(size_t max_size);
+
+  std::deque<std::pair<std::string, std::string>> table_;  // Newest first
+  size_t table_size_ = 0;  // Per RFC 7541 section 4.1
+  size_t max_table_size_ = DEFAULT_TABLE_SIZE;
+};
+
+// Huffman coding of header strings (RFC 7541 appendix B)
+void huffman_encode(std::string_view text, std::string& out);
+size_t huffman_encoded_size(std::string_view text);
+// False if data is not a valid encoding
+bool huffman_decode(std::string_view data, std::string& out);
+
+}  // namespace agent::net
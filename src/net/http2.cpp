@@ -0,0 +1,695 @@
+#include "http2.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace agent::net {
+
+namespace http2 {
+
+void append_u32(std::string& out, uint32_t value) {
+  out.push_back(static_cast<char>(value >> 24));
+  out.push_back(static_cast<char>(value >> 16));
+  out.push_back(static_cast<char>(value >> 8));
+  out.push_back(static_cast<char>(value));
+}
+
+uint32_t read_u32(std::string_view data) {
+  auto byte = [&](size_t i) {
+    return static_cast<uint32_t>(static_cast<uint8_t>(data[i]));
+  };
+  return (byte(0) << 24) | (byte(1) << 16) | (byte(2) << 8) | byte(3);
+}
+
+void append_frame_header(std::string& out, FrameType type, uint8_t flags, uint32_t stream_id, size_t length) {
+  out.push_back(static_cast<char>(length >> 16));
+  out.push_back(static_cast<char>(length >> 8));
+  out.push_back(static_cast<char>(length));
+  out.push_back(static_cast<char>(type));
+  out.push_back(static_cast<char>(flags));
+  append_u32(out, stream_id & 0x7fffffff);
+}
+
+void append_frame(std::string& out, FrameType type, uint8_t flags, uint32_t stream_id, std::string_view payload) {
+  append_frame_header(out, type, flags, stream_id, payload.size());
+  out.append(payload);
+}
+
+FrameStatus next_frame(std::string_view& data, uint32_t max_size, Frame& frame) {
+  if (data.size() < FRAME_HEADER_SIZE) return FrameStatus::Incomplete;
+  auto byte = [&](size_t i) {
+    return static_cast<uint32_t>(static_cast<uint8_t>(data[i]));
+  };
+  uint32_t length = (byte(0) << 16) | (byte(1) << 8) | byte(2);
+  if (length > max_size) return FrameStatus::TooLarge;
+  if (data.size() < FRAME_HEADER_SIZE + length) return FrameStatus::Incomplete;
+
+  frame.type = static_cast<FrameType>(byte(3));
+  frame.flags = static_cast<uint8_t>(byte(4));
+  frame.stream_id = read_u32(data.substr(5)) & 0x7fffffff;
+  frame.payload = data.substr(FRAME_HEADER_SIZE, length);
+  data.remove_prefix(FRAME_HEADER_SIZE + length);
+  return FrameStatus::Complete;
+}
+
+}  // namespace http2
+
+using namespace http2;
+
+static constexpr size_t READ_BUFFER_SIZE = 16 * 1024;
+
+static std::string error_name(ErrorCode code) {
+  switch (code) {
+    case ErrorCode::NoError:
+      return "NO_ERROR";
+    case ErrorCode::ProtocolError:
+      return "PROTOCOL_ERROR";
+    case ErrorCode::InternalError:
+      return "INTERNAL_ERROR";
+    case ErrorCode::FlowControlError:
+      return "FLOW_CONTROL_ERROR";
+    case ErrorCode::StreamClosed:
+      return "STREAM_CLOSED";
+    case ErrorCode::FrameSizeError:
+      return "FRAME_SIZE_ERROR";
+    case ErrorCode::RefusedStream:
+      return "REFUSED_STREAM";
+    case ErrorCode::Cancel:
+      return "CANCEL";
+    case ErrorCode::CompressionError:
+      return "COMPRESSION_ERROR";
+  }
+  return "error " + std::to_string(static_cast<uint32_t>(code));
+}
+
+// Header fields that only mean something to an HTTP/1.1 connection
+static bool is_connection_specific(std::string_view name) {
+  return name == "host" || name == "connection" || name == "keep-alive" || name == "proxy-connection" || name == "transfer-encoding" ||
+         name == "upgrade" || name == "content-length";
+}
+
+// A request that was not sent, or not processed by the server
+static void refuse(Http2Session::Request& request, const std::string& error) {
+  if (request.on_refused) {
+    request.on_refused(error);
+  } else if (request.on_done) {
+    request.on_done(0, error);
+  }
+}
+
+static std::chrono::steady_clock::rep now_ticks() {
+  return std::chrono::steady_clock::now().time_since_epoch().count();
+}
+
+void Http2Session::offer_alpn(SSL* ssl) {
+  static constexpr unsigned char PROTOCOLS[] = {2, 'h', '2', 8, 'h', 't', 't', 'p', '/', '1', '.', '1'};
+  SSL_set_alpn_protos(ssl, PROTOCOLS, sizeof(PROTOCOLS));
+}
+
+bool Http2Session::negotiated(SSL* ssl) {
+  const unsigned char* protocol = nullptr;
+  unsigned int length = 0;
+  SSL_get0_alpn_selected(ssl, &protocol, &length);
+  return length == 2 && std::memcmp(protocol, "h2", 2) == 0;
+}
+
+Http2Session::Http2Session(std::unique_ptr<TlsStream> stream)
+    : stream_(std::move(stream)), strand_(asio::make_strand(stream_->get_executor())), read_buffer_(READ_BUFFER_SIZE), idle_since_(now_ticks()) {}
+
+void Http2Session::start() {
+  asio::post(strand_, [self = shared_from_this()] {
+    auto& out = self->out_;
+    out.append(CLIENT_PREFACE);
+
+    std::string settings;
+    auto setting = [&settings](Setting id, uint32_t value) {
+      settings.push_back(static_cast<char>(static_cast<uint16_t>(id) >> 8));
+      settings.push_back(static_cast<char>(id));
+      append_u32(settings, value);
+    };
+    setting(Setting::EnablePush, 0);
+    setting(Setting::InitialWindowSize, LOCAL_STREAM_WINDOW);
+    setting(Setting::MaxHeaderListSize, HpackDecoder::MAX_HEADER_LIST_SIZE);
+    append_frame(out, FrameType::Settings, 0, 0, settings);
+
+    std::string increment;
+    append_u32(increment, LOCAL_CONNECTION_WINDOW - DEFAULT_WINDOW_SIZE);
+    append_frame(out, FrameType::WindowUpdate, 0, 0, increment);
+
+    self->flush();
+    self->read();
+  });
+}
+
+void Http2Session::submit(std::shared_ptr<Request> request) {
+  active_++;
+  asio::post(strand_, [self = shared_from_this(), request = std::move(request)]() mutable {
+    if (self->closed_ || !self->available_) {
+      self->request_ended();
+      refuse(*request, "HTTP/2 connection is closed");
+      return;
+    }
+    self->queued_.push_back(std::move(request));
+    self->open_streams();
+    self->flush();
+  });
+}
+
+void Http2Session::cancel(std::shared_ptr<Request> request) {
+  asio::post(strand_, [self = shared_from_this(), request = std::move(request)] {
+    auto queued = std::find(self->queued_.begin(), self->queued_.end(), request);
+    if (queued != self->queued_.end()) {
+      self->queued_.erase(queued);
+      self->request_ended();
+      return;
+    }
+    for (auto it = self->streams_.begin(); it != self->streams_.end(); ++it) {
+      if (it->second.request != request) continue;
+      self->reset_stream(it->first, ErrorCode::Cancel);
+      self->streams_.erase(it);
+      self->request_ended();
+      self->open_streams();
+      self->flush();
+      return;
+    }
+  });
+}
+
+void Http2Session::close() {
+  asio::post(strand_, [self = shared_from_this()] {
+    self->fail(ErrorCode::NoError, "HTTP/2 connection closed");
+  });
+}
+
+// --- Sending ---
+
+void Http2Session::open_streams() {
+  while (!closed_ && !queued_.empty() && streams_.size() < max_streams_) {
+    if (next_stream_id_ > MAX_WINDOW_SIZE) {
+      // Stream ids used up: the requests go elsewhere
+      available_ = false;
+      auto queued = std::move(queued_);
+      queued_.clear();
+      for (auto& request : queued) {
+        request_ended();
+        refuse(*request, "HTTP/2 stream ids exhausted");
+      }
+      return;
+    }
+    auto request = std::move(queued_.front());
+    queued_.pop_front();
+    open_stream(std::move(request));
+  }
+  send_data();
+}
+
+void Http2Session::open_stream(std::shared_ptr<Request> request) {
+  uint32_t id = next_stream_id_;
+  next_stream_id_ += 2;
+
+  HeaderList headers;
+  headers.reserve(request->headers.size() + 5);
+  headers.emplace_back(":method", request->method);
+  headers.emplace_back(":scheme", "https");
+  headers.emplace_back(":authority", request->authority);
+  headers.emplace_back(":path", request->path.empty() ? "/" : request->path);
+  for (const auto& [name, value] : request->headers) {
+    std::string lower(name);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) {
+      return static_cast<char>(std::tolower(c));
+    });
+    if (is_connection_specific(lower)) continue;
+    headers.emplace_back(std::move(lower), value);
+  }
+  if (!request->body.empty()) {
+    headers.emplace_back("content-length", std::to_string(request->body.size()));
+  }
+
+  std::string block;
+  encoder_.encode(headers, block);
+
+  // HEADERS, then CONTINUATION frames for a block larger than a frame
+  bool end_stream = request->body.empty();
+  std::string_view rest = block;
+  auto type = FrameType::Headers;
+  do {
+    auto piece = rest.substr(0, max_frame_size_);
+    rest.remove_prefix(piece.size());
+    uint8_t flags = rest.empty() ? FLAG_END_HEADERS : 0;
+    if (type == FrameType::Headers && end_stream) flags |= FLAG_END_STREAM;
+    append_frame(out_, type, flags, id, piece);
+    type = FrameType::Continuation;
+  } while (!rest.empty());
+
+  Stream stream;
+  stream.request = std::move(request);
+  stream.send_window = initial_window_;
+  stream.end_sent = end_stream;
+  streams_.emplace(id, std::move(stream));
+}
+
+// Sends request bodies as far as the flow control windows allow, streams
+// in the order they were opened
+void Http2Session::send_data() {
+  for (auto& [id, stream] : streams_) {
+    if (send_window_ <= 0) break;
+    auto body = stream.request->body;
+    while (!stream.end_sent) {
+      size_t remaining = body.size() - stream.body_sent;
+      int64_t window = std::min(send_window_, stream.send_window);
+      size_t size = std::min<size_t>(remaining, std::min<int64_t>(std::max<int64_t>(window, 0), max_frame_size_));
+      if (size == 0 && remaining > 0) break;  // Until a WINDOW_UPDATE
+
+      bool last = size == remaining;
+      append_frame(out_, FrameType::Data, last ? FLAG_END_STREAM : 0, id, body.substr(stream.body_sent, size));
+      stream.body_sent += size;
+      stream.send_window -= static_cast<int64_t>(size);
+      send_window_ -= static_cast<int64_t>(size);
+      stream.end_sent = last;
+    }
+  }
+}
+
+void Http2Session::flush() {
+  if (write_pending_ || out_.empty()) return;
+  writing_.swap(out_);
+  out_.clear();
+  write_pending_ = true;
+  asio::async_write(*stream_, asio::buffer(writing_), asio::bind_executor(strand_, [self = shared_from_this()](const asio::error_code& ec, size_t) {
+                      self->write_pending_ = false;
+                      self->writing_.clear();
+                      if (ec) {
+                        self->fail(ErrorCode::InternalError, "HTTP/2 write failed: " + ec.message(), false);
+                        self->close_socket();
+                        return;
+                      }
+                      self->flush();
+                      if (self->closed_ && !self->write_pending_) self->close_socket();
+                    }));
+}
+
+void Http2Session::reset_stream(uint32_t stream_id, ErrorCode code) {
+  std::string payload;
+  append_u32(payload, static_cast<uint32_t>(code));
+  append_frame(out_, FrameType::RstStream, 0, stream_id, payload);
+}
+
+// --- Receiving ---
+
+void Http2Session::read() {
+  stream_->async_read_some(asio::buffer(read_buffer_), asio::bind_executor(strand_, [self = shared_from_this()](const asio::error_code& ec, size_t bytes) {
+                             if (self->closed_) return;
+                             if (bytes > 0) {
+                               // Frames are taken straight from the read buffer; only a
+                               // frame split across reads is kept in in_
+                               std::string_view data;
+                               if (self->in_.empty()) {
+                                 data = std::string_view(self->read_buffer_.data(), bytes);
+                               } else {
+                                 self->in_.append(self->read_buffer_.data(), bytes);
+                                 data = self->in_;
+                               }
+                               if (!self->process(data)) {
+                                 self->flush();
+                                 return;
+                               }
+                               self->in_ = std::string(data);
+                               self->flush();
+                             }
+                             if (ec) {
+                               bool eof = ec == asio::error::eof || ec.category() == asio::error::get_ssl_category();
+                               self->fail(ErrorCode::NoError, eof ? "HTTP/2 connection closed by the server" : "HTTP/2 read failed: " + ec.message(),
+                                          false);
+                               return;
+                             }
+                             self->read();
+                           }));
+}
+
+bool Http2Session::process(std::string_view& data) {
+  while (!closed_) {
+    Frame frame;
+    auto status = next_frame(data, DEFAULT_MAX_FRAME_SIZE, frame);
+    if (status == FrameStatus::Incomplete) return true;
+    if (status == FrameStatus::TooLarge) {
+      fail(ErrorCode::FrameSizeError, "HTTP/2 frame larger than allowed");
+      return false;
+    }
+    if (!on_frame(frame)) return false;
+  }
+  return false;
+}
+
+bool Http2Session::on_frame(const Frame& frame) {
+  // A header block continued in CONTINUATION frames comes in one piece
+  if (header_stream_ && (frame.type != FrameType::Continuation || frame.stream_id != header_stream_)) {
+    fail(ErrorCode::ProtocolError, "HTTP/2 protocol error: header block interrupted");
+    return false;
+  }
+
+  auto payload = frame.payload;
+  switch (frame.type) {
+    case FrameType::Data:
+      return on_data(frame);
+
+    case FrameType::Headers: {
+      if (frame.stream_id == 0 || !strip_padding(frame, payload)) {
+        fail(ErrorCode::ProtocolError, "HTTP/2 protocol error: bad HEADERS frame");
+        return false;
+      }
+      if (frame.flags & FLAG_PRIORITY) {
+        if (payload.size() < 5) {
+          fail(ErrorCode::ProtocolError, "HTTP/2 protocol error: bad HEADERS frame");
+          return false;
+        }
+        payload.remove_prefix(5);
+      }
+      bool end_stream = frame.flags & FLAG_END_STREAM;
+      if (!(frame.flags & FLAG_END_HEADERS)) {
+        header_block_.assign(payload);
+        header_stream_ = frame.stream_id;
+        header_end_stream_ = end_stream;
+        return true;
+      }
+      return on_headers(frame.stream_id, payload, end_stream);
+    }
+
+    case FrameType::Continuation: {
+      if (!header_stream_) {
+        fail(ErrorCode::ProtocolError, "HTTP/2 protocol error: unexpected CONTINUATION frame");
+        return false;
+      }
+      header_block_.append(payload);
+      if (header_block_.size() > HpackDecoder::MAX_HEADER_LIST_SIZE) {
+        fail(ErrorCode::ProtocolError, "HTTP/2 header block too large");
+        return false;
+      }
+      if (!(frame.flags & FLAG_END_HEADERS)) return true;
+      header_stream_ = 0;
+      auto block = std::move(header_block_);
+      header_block_.clear();
+      return on_headers(frame.stream_id, block, header_end_stream_);
+    }
+
+    case FrameType::Settings:
+      return on_settings(frame);
+
+    case FrameType::Ping:
+      if (frame.stream_id != 0 || payload.size() != 8) {
+        fail(ErrorCode::FrameSizeError, "HTTP/2 protocol error: bad PING frame");
+        return false;
+      }
+      if (!(frame.flags & FLAG_ACK)) {
+        append_frame(out_, FrameType::Ping, FLAG_ACK, 0, payload);
+      }
+      return true;
+
+    case FrameType::Goaway:
+      if (frame.stream_id != 0 || payload.size() < 8) {
+        fail(ErrorCode::ProtocolError, "HTTP/2 protocol error: bad GOAWAY frame");
+        return false;
+      }
+      on_goaway(frame);
+      return !closed_;
+
+    case FrameType::WindowUpdate:
+      return on_window_update(frame);
+
+    case FrameType::RstStream: {
+      if (frame.stream_id == 0 || payload.size() != 4) {
+        fail(ErrorCode::ProtocolError, "HTTP/2 protocol error: bad RST_STREAM frame");
+        return false;
+      }
+      auto code = static_cast<ErrorCode>(read_u32(payload));
+      finish_stream(frame.stream_id, "HTTP/2 stream reset by the server (" + error_name(code) + ")", code == ErrorCode::RefusedStream);
+      return true;
+    }
+
+    case FrameType::PushPromise:
+      fail(ErrorCode::ProtocolError, "HTTP/2 protocol error: push is disabled");
+      return false;
+
+    default:
+      return true;  // PRIORITY, and types this side does not know, are ignored
+  }
+}
+
+bool Http2Session::strip_padding(const Frame& frame, std::string_view& payload) {
+  if (!(frame.flags & FLAG_PADDED)) return true;
+  if (payload.empty()) return false;
+  auto padding = static_cast<uint8_t>(payload.front());
+  payload.remove_prefix(1);
+  if (padding > payload.size()) return false;
+  payload.remove_suffix(padding);
+  return true;
+}
+
+bool Http2Session::on_headers(uint32_t stream_id, std::string_view block, bool end_stream) {
+  // Decoded even for a stream reset here, to keep the table in step
+  HeaderList fields;
+  if (!decoder_.decode(block, fields)) {
+    fail(ErrorCode::CompressionError, "HTTP/2 compression error: bad header block");
+    return false;
+  }
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end()) return true;
+  auto& stream = it->second;
+
+  if (stream.status == 0) {
+    int status = 0;
+    Headers headers;
+    for (auto& [name, value] : fields) {
+      if (name == ":status") {
+        bool digits = value.size() == 3 && std::all_of(value.begin(), value.end(), [](char c) {
+                        return c >= '0' && c <= '9';
+                      });
+        if (digits) status = std::stoi(value);
+      } else if (!name.starts_with(':')) {
+        headers[std::move(name)] = std::move(value);
+      }
+    }
+    if (status < 100 || (status < 200 && end_stream)) {
+      reset_stream(stream_id, ErrorCode::ProtocolError);
+      finish_stream(stream_id, "HTTP/2 protocol error: bad response head");
+      return true;
+    }
+    if (status < 200) return true;  // Interim response
+
+    stream.status = status;
+    if (stream.request->on_head) stream.request->on_head(status, std::move(headers));
+  }
+  // Otherwise trailer fields, which are dropped
+
+  if (end_stream) finish_stream(stream_id, "");
+  return true;
+}
+
+bool Http2Session::on_data(const Frame& frame) {
+  auto payload = frame.payload;
+  if (frame.stream_id == 0 || !strip_padding(frame, payload)) {
+    fail(ErrorCode::ProtocolError, "HTTP/2 protocol error: bad DATA frame");
+    return false;
+  }
+
+  // The whole frame counts against the windows, padding included. The
+  // connection window is given back even for a stream reset here.
+  auto flow = static_cast<uint32_t>(frame.payload.size());
+  recv_unacked_ += flow;
+  if (recv_unacked_ >= LOCAL_CONNECTION_WINDOW / 2) {
+    window_update(0, recv_unacked_);
+    recv_unacked_ = 0;
+  }
+
+  auto it = streams_.find(frame.stream_id);
+  if (it == streams_.end()) return true;
+  auto& stream = it->second;
+  if (stream.status == 0) {
+    reset_stream(frame.stream_id, ErrorCode::ProtocolError);
+    finish_stream(frame.stream_id, "HTTP/2 protocol error: data before the response head");
+    return true;
+  }
+
+  if (!payload.empty() && stream.request->on_body) stream.request->on_body(payload);
+  if (frame.flags & FLAG_END_STREAM) {
+    finish_stream(frame.stream_id, "");
+    return true;
+  }
+  // The callback has taken the data: the window is given back
+  stream.recv_unacked += flow;
+  if (stream.recv_unacked >= LOCAL_STREAM_WINDOW / 2) {
+    window_update(frame.stream_id, stream.recv_unacked);
+    stream.recv_unacked = 0;
+  }
+  return true;
+}
+
+bool Http2Session::on_settings(const Frame& frame) {
+  if (frame.stream_id != 0 || frame.payload.size() % 6 != 0 || ((frame.flags & FLAG_ACK) && !frame.payload.empty())) {
+    fail(ErrorCode::FrameSizeError, "HTTP/2 protocol error: bad SETTINGS frame");
+    return false;
+  }
+  if (frame.flags & FLAG_ACK) return true;
+
+  for (auto payload = frame.payload; !payload.empty(); payload.remove_prefix(6)) {
+    auto id = static_cast<Setting>((static_cast<uint8_t>(payload[0]) << 8) | static_cast<uint8_t>(payload[1]));
+    uint32_t value = read_u32(payload.substr(2));
+    switch (id) {
+      case Setting::MaxConcurrentStreams:
+        max_streams_ = value;
+        break;
+      case Setting::InitialWindowSize: {
+        if (value > MAX_WINDOW_SIZE) {
+          fail(ErrorCode::FlowControlError, "HTTP/2 flow control error: window too large");
+          return false;
+        }
+        // Applies to the streams already open as well
+        int64_t delta = static_cast<int64_t>(value) - initial_window_;
+        for (auto& [stream_id, stream] : streams_) stream.send_window += delta;
+        initial_window_ = value;
+        break;
+      }
+      case Setting::MaxFrameSize:
+        if (value < DEFAULT_MAX_FRAME_SIZE || value > 0xffffff) {
+          fail(ErrorCode::ProtocolError, "HTTP/2 protocol error: bad frame size setting");
+          return false;
+        }
+        max_frame_size_ = value;
+        break;
+      default:
+        break;  // The header table is not used for sending; the rest does not apply here
+    }
+  }
+
+  append_frame(out_, FrameType::Settings, FLAG_ACK, 0, {});
+  open_streams();
+  return true;
+}
+
+bool Http2Session::on_window_update(const Frame& frame) {
+  if (frame.payload.size() != 4) {
+    fail(ErrorCode::FrameSizeError, "HTTP/2 protocol error: bad WINDOW_UPDATE frame");
+    return false;
+  }
+  uint32_t increment = read_u32(frame.payload) & 0x7fffffff;
+
+  if (frame.stream_id == 0) {
+    send_window_ += increment;
+    if (increment == 0 || send_window_ > MAX_WINDOW_SIZE) {
+      fail(ErrorCode::FlowControlError, "HTTP/2 flow control error: bad connection window update");
+      return false;
+    }
+  } else {
+    auto it = streams_.find(frame.stream_id);
+    if (it == streams_.end()) return true;
+    it->second.send_window += increment;
+    if (increment == 0 || it->second.send_window > MAX_WINDOW_SIZE) {
+      reset_stream(frame.stream_id, ErrorCode::FlowControlError);
+      finish_stream(frame.stream_id, "HTTP/2 flow control error: bad stream window update");
+      return true;
+    }
+  }
+  send_data();
+  return true;
+}
+
+// The server takes no new streams; those above its last stream were not
+// processed and can be sent again
+void Http2Session::on_goaway(const Frame& frame) {
+  goaway_last_stream_ = read_u32(frame.payload) & 0x7fffffff;
+  auto code = static_cast<ErrorCode>(read_u32(frame.payload.substr(4)));
+  available_ = false;
+  spdlog::debug("HTTP/2 GOAWAY (last stream {}, {})", goaway_last_stream_, error_name(code));
+
+  std::string error = "HTTP/2 server is going away (" + error_name(code) + ")";
+  std::vector<uint32_t> unprocessed;
+  for (const auto& [id, stream] : streams_) {
+    if (id > goaway_last_stream_) unprocessed.push_back(id);
+  }
+  for (uint32_t id : unprocessed) finish_stream(id, error, true);
+
+  auto queued = std::move(queued_);
+  queued_.clear();
+  for (auto& request : queued) {
+    request_ended();
+    refuse(*request, error);
+  }
+  if (streams_.empty()) fail(ErrorCode::NoError, error);
+}
+
+void Http2Session::window_update(uint32_t stream_id, uint32_t increment) {
+  std::string payload;
+  append_u32(payload, increment);
+  append_frame(out_, FrameType::WindowUpdate, 0, stream_id, payload);
+}
+
+// --- Ending ---
+
+void Http2Session::finish_stream(uint32_t stream_id, const std::string& error, bool refused) {
+  auto it = streams_.find(stream_id);
+  if (it == streams_.end()) return;
+  auto stream = std::move(it->second);
+  streams_.erase(it);
+
+  // A complete response before the whole request was sent: the rest is not wanted
+  if (error.empty() && !stream.end_sent) reset_stream(stream_id, ErrorCode::Cancel);
+
+  request_ended();
+  if (refused) {
+    refuse(*stream.request, error);
+  } else if (stream.request->on_done) {
+    stream.request->on_done(stream.status, error);
+  }
+
+  if (goaway_last_stream_ != UINT32_MAX && streams_.empty()) {
+    fail(ErrorCode::NoError, "HTTP/2 server is going away");
+  } else {
+    open_streams();
+  }
+}
+
+void Http2Session::fail(ErrorCode code, const std::string& error, bool send_goaway) {
+  if (closed_) return;
+  closed_ = true;
+  available_ = false;
+  if (code != ErrorCode::NoError) spdlog::warn("{}", error);
+
+  if (send_goaway) {
+    std::string payload;
+    append_u32(payload, 0);  // No stream was opened by the server
+    append_u32(payload, static_cast<uint32_t>(code));
+    append_frame(out_, FrameType::Goaway, 0, 0, payload);
+  }
+
+  // Queued requests were never sent
+  auto queued = std::move(queued_);
+  queued_.clear();
+  auto streams = std::move(streams_);
+  streams_.clear();
+  for (auto& request : queued) {
+    request_ended();
+    refuse(*request, error);
+  }
+  for (auto& [id, stream] : streams) {
+    request_ended();
+    if (stream.request->on_done) stream.request->on_done(stream.status, error);
+  }
+
+  flush();
+  if (!write_pending_) close_socket();
+}
+
+void Http2Session::close_socket() {
+  asio::error_code ignored;
+  stream_->lowest_layer().close(ignored);
+}
+
+void Http2Session::request_ended() {
+  if (active_.fetch_sub(1) == 1) {
+    idle_since_ = now_ticks();
+  }
+}
+
+}  // namespace agent::net
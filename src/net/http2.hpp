@@ -0,0 +1,232 @@
+#pragma once
+
+#include <openssl/ssl.h>
+
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "hpack.hpp"
+
+namespace agent::net {
+
+// HTTP/2 framing (RFC 9113)
+namespace http2 {
+
+enum class FrameType : uint8_t {
+  Data = 0,
+  Headers = 1,
+  Priority = 2,
+  RstStream = 3,
+  Settings = 4,
+  PushPromise = 5,
+  Ping = 6,
+  Goaway = 7,
+  WindowUpdate = 8,
+  Continuation = 9,
+};
+
+enum class Setting : uint16_t {
+  HeaderTableSize = 1,
+  EnablePush = 2,
+  MaxConcurrentStreams = 3,
+  InitialWindowSize = 4,
+  MaxFrameSize = 5,
+  MaxHeaderListSize = 6,
+};
+
+enum class ErrorCode : uint32_t {
+  NoError = 0,
+  ProtocolError = 1,
+  InternalError = 2,
+  FlowControlError = 3,
+  StreamClosed = 5,
+  FrameSizeError = 6,
+  RefusedStream = 7,
+  Cancel = 8,
+  CompressionError = 9,
+};
+
+constexpr uint8_t FLAG_END_STREAM = 0x1;
+constexpr uint8_t FLAG_ACK = 0x1;
+constexpr uint8_t FLAG_END_HEADERS = 0x4;
+constexpr uint8_t FLAG_PADDED = 0x8;
+constexpr uint8_t FLAG_PRIORITY = 0x20;
+
+constexpr std::string_view CLIENT_PREFACE = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+constexpr size_t FRAME_HEADER_SIZE = 9;
+constexpr uint32_t DEFAULT_WINDOW_SIZE = 65535;
+constexpr uint32_t DEFAULT_MAX_FRAME_SIZE = 16384;
+constexpr uint32_t MAX_WINDOW_SIZE = 0x7fffffff;
+
+struct Frame {
+  FrameType type;
+  uint8_t flags;
+  uint32_t stream_id;
+  std::string_view payload;
+};
+
+enum class FrameStatus { Complete, Incomplete, TooLarge };
+
+// Takes the frame at the start of data. TooLarge once its header shows a
+// payload over max_size, without waiting for the payload.
+FrameStatus next_frame(std::string_view& data, uint32_t max_size, Frame& frame);
+
+void append_frame_header(std::string& out, FrameType type, uint8_t flags, uint32_t stream_id, size_t length);
+void append_frame(std::string& out, FrameType type, uint8_t flags, uint32_t stream_id, std::string_view payload);
+
+void append_u32(std::string& out, uint32_t value);
+uint32_t read_u32(std::string_view data);
+
+}  // namespace http2
+
+// A client HTTP/2 connection over TLS ("h2" chosen by ALPN), carrying
+// concurrent requests as streams.
+//
+// Requests beyond the server's concurrent stream limit wait in a queue.
+// Request bodies are sent as the server's stream and connection flow
+// control windows allow; on the receiving side each stream gets a 1 MiB
+// window and the connection 16 MiB, given back with WINDOW_UPDATE as the
+// callbacks take the data. All work runs on a strand of the stream's
+// executor; callbacks are called there.
+class Http2Session : public std::enable_shared_from_this<Http2Session> {
+ public:
+  using TlsStream = asio::ssl::stream<asio::ip::tcp::socket>;
+  using Headers = std::map<std::string, std::string>;
+
+  struct Request {
+    std::string method;
+    std::string authority;  // host[:port]
+    std::string path;  // With the query
+    Headers headers;  // Connection-specific ones are left out
+    std::string_view body;  // Must stay valid until the request ends
+
+    std::function<void(int status, Headers headers)> on_head;
+    std::function<void(std::string_view data)> on_body;
+    std::function<void(int status, const std::string& error)> on_done;
+    // Instead of on_done when the server did not process the request
+    // (refused its stream, or is going away): it can be sent again.
+    std::function<void(const std::string& error)> on_refused;
+  };
+
+  static constexpr uint32_t LOCAL_STREAM_WINDOW = 1 << 20;
+  static constexpr uint32_t LOCAL_CONNECTION_WINDOW = 1 << 24;
+  // Assumed until the server's SETTINGS say otherwise
+  static constexpr size_t DEFAULT_MAX_STREAMS = 100;
+
+  // Before the handshake: offers "h2", then "http/1.1"
+  static void offer_alpn(SSL* ssl);
+  // After the handshake: whether the server chose "h2"
+  static bool negotiated(SSL* ssl);
+
+  explicit Http2Session(std::unique_ptr<TlsStream> stream);
+
+  Http2Session(const Http2Session&) = delete;
+  Http2Session& operator=(const Http2Session&) = delete;
+
+  // Sends the connection preface and starts reading
+  void start();
+
+  // Sends request on a new stream. Thread-safe.
+  void submit(std::shared_ptr<Request> request);
+
+  // Resets the request's stream; its callbacks are not called after. Thread-safe.
+  void cancel(std::shared_ptr<Request> request);
+
+  // Closes the connection; requests still open fail. Thread-safe.
+  void close();
+
+  // Open, and the server has not asked to go away
+  bool available() const {
+    return available_;
+  }
+
+  // Requests open or queued
+  size_t active() const {
+    return active_;
+  }
+
+  // When the last request ended
+  std::chrono::steady_clock::time_point idle_since() const {
+    return std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(idle_since_.load()));
+  }
+
+ private:
+  struct Stream {
+    std::shared_ptr<Request> request;
+    int64_t send_window = 0;  // Negative when the server shrank the window
+    uint32_t recv_unacked = 0;  // Taken by callbacks, not yet given back
+    size_t body_sent = 0;
+    bool end_sent = false;
+    int status = 0;  // Of the final response head, once received
+  };
+
+  void open_streams();
+  void open_stream(std::shared_ptr<Request> request);
+  void send_data();
+  void flush();
+  void reset_stream(uint32_t stream_id, http2::ErrorCode code);
+  void window_update(uint32_t stream_id, uint32_t increment);
+
+  void read();
+  // Handles the whole frames at the start of data; false once the connection failed
+  bool process(std::string_view& data);
+  bool on_frame(const http2::Frame& frame);
+  bool on_headers(uint32_t stream_id, std::string_view block, bool end_stream);
+  bool on_data(const http2::Frame& frame);
+  bool on_settings(const http2::Frame& frame);
+  bool on_window_update(const http2::Frame& frame);
+  void on_goaway(const http2::Frame& frame);
+  static bool strip_padding(const http2::Frame& frame, std::string_view& payload);
+
+  // Ends a stream: on_refused if refused, otherwise on_done with error
+  void finish_stream(uint32_t stream_id, const std::string& error, bool refused = false);
+  // Ends the connection, with a GOAWAY unless the server ended it
+  void fail(http2::ErrorCode code, const std::string& error, bool send_goaway = true);
+  void close_socket();
+  void request_ended();
+
+  std::unique_ptr<TlsStream> stream_;
+  asio::strand<asio::any_io_executor> strand_;
+
+  std::vector<char> read_buffer_;
+  std::string in_;  // Received, not yet a whole frame
+  std::string out_;  // Frames waiting for the write in progress
+  std::string writing_;
+  bool write_pending_ = false;
+  bool closed_ = false;
+
+  HpackEncoder encoder_;
+  HpackDecoder decoder_;
+  std::string header_block_;  // Of a HEADERS frame continued in CONTINUATION frames
+  uint32_t header_stream_ = 0;  // Its stream, while continued
+  bool header_end_stream_ = false;
+
+  std::map<uint32_t, Stream> streams_;
+  std::deque<std::shared_ptr<Request>> queued_;
+  uint32_t next_stream_id_ = 1;
+  uint32_t goaway_last_stream_ = UINT32_MAX;
+
+  // The server's settings
+  size_t max_streams_ = DEFAULT_MAX_STREAMS;
+  uint32_t initial_window_ = http2::DEFAULT_WINDOW_SIZE;
+  uint32_t max_frame_size_ = http2::DEFAULT_MAX_FRAME_SIZE;
+
+  int64_t send_window_ = http2::DEFAULT_WINDOW_SIZE;  // Of the connection
+  uint32_t recv_unacked_ = 0;
+
+  std::atomic<bool> available_{true};
+  std::atomic<size_t> active_{0};
+  std::atomic<std::chrono::steady_clock::rep> idle_since_;
+};
+
+}  // namespace agent::net
@@ -4,60 +4,195 @@
 #include <openssl/ssl.h>
 #include <spdlog/spdlog.h>
 
-#include <regex>
-#include <sstream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <mutex>
 #include <thread>
+#include <tuple>
+
+#include "http2.hpp"
+#include "http_parser.hpp"
+#include "tls.hpp"
 
 namespace agent::net {
 
-// URL parsing
-std::optional<ParsedUrl> ParsedUrl::parse(const std::string& url) {
-  // Simple regex-based URL parser
-  std::regex url_regex(R"(^(https?):\/\/([^:\/\s]+)(?::(\d+))?(\/[^\?\s]*)?(\?[^\s]*)?)");
-  std::smatch match;
+namespace {
+
+using Headers = std::map<std::string, std::string>;
+
+// --- Connections ---
 
-  if (!std::regex_match(url, match, url_regex)) {
-    return std::nullopt;
+using TcpSocket = asio::ip::tcp::socket;
+using TlsStream = asio::ssl::stream<TcpSocket>;
+
+// A pooled connection, TLS or plain TCP. Used by one request at a time,
+// unless it carries HTTP/2.
+struct Connection {
+  static constexpr size_t READ_BUFFER_SIZE = 16 * 1024;
+
+  Connection(asio::io_context& io_ctx, asio::ssl::context* ssl_ctx, std::string key) : key(std::move(key)) {
+    if (ssl_ctx) {
+      tls = std::make_unique<TlsStream>(io_ctx, *ssl_ctx);
+    } else {
+      tcp = std::make_unique<TcpSocket>(io_ctx);
+    }
   }
 
-  ParsedUrl result;
-  result.scheme = match[1].str();
-  result.host = match[2].str();
-  result.port = match[3].str();
-  result.path = match[4].str().empty() ? "/" : match[4].str();
-  result.query = match[5].str();
+  ~Connection() {
+    if (h2) h2->close();
+  }
 
-  return result;
-}
+  TcpSocket& socket() {
+    return tls ? tls->next_layer() : *tcp;
+  }
 
-std::string ParsedUrl::port_or_default() const {
-  if (!port.empty()) return port;
-  return is_https() ? "443" : "80";
-}
+  template <typename Buffers, typename Handler>
+  void async_write(const Buffers& buffers, Handler&& handler) {
+    if (tls) {
+      asio::async_write(*tls, buffers, std::forward<Handler>(handler));
+    } else {
+      asio::async_write(*tcp, buffers, std::forward<Handler>(handler));
+    }
+  }
+
+  // Reads what has arrived, up to READ_BUFFER_SIZE bytes, into read_buffer
+  template <typename Handler>
+  void async_read_some(Handler&& handler) {
+    read_buffer.resize(READ_BUFFER_SIZE);
+    if (tls) {
+      tls->async_read_some(asio::buffer(read_buffer), std::forward<Handler>(handler));
+    } else {
+      tcp->async_read_some(asio::buffer(read_buffer), std::forward<Handler>(handler));
+    }
+  }
+
+  void close() {
+    if (h2) {
+      h2->close();
+      return;
+    }
+    asio::error_code ignored;
+    socket().close(ignored);
+  }
+
+  // Whether an idle connection can take another request: still open, and
+  // the server has neither closed it nor sent anything unasked
+  bool healthy() {
+    auto& sock = socket();
+    if (!sock.is_open()) return false;
+
+    char byte;
+    asio::error_code ec;
+    asio::error_code ignored;
+    sock.non_blocking(true, ec);
+    if (ec) return false;
+    size_t n = sock.receive(asio::buffer(&byte, 1), asio::socket_base::message_peek, ec);
+    sock.non_blocking(false, ignored);
+    return n == 0 && ec == asio::error::would_block;
+  }
+
+  std::string key;  // scheme://host:port
+  std::unique_ptr<TlsStream> tls;
+  std::unique_ptr<TcpSocket> tcp;
+  std::vector<char> read_buffer;
+  std::chrono::steady_clock::time_point idle_since;
+  std::atomic<bool> reused{false};  // Served a request before
+  // Offers HTTP/2; requests to its host wait until its protocol is known
+  bool probe = false;
+  // Once the server chose HTTP/2: owns the stream, and requests share it
+  std::shared_ptr<Http2Session> h2;
+};
+
+// A request waiting for a connection. Once cancelled, a connection handed to
+// it goes back to the pool.
+struct Waiter {
+  ParsedUrl url;
+  std::function<void(std::shared_ptr<Connection>, const std::string& error)> callback;
+  std::atomic<bool> cancelled{false};
+};
+
+// HTTP/2 connections shared by the HttpClients with http2 on, by io_context,
+// TLS settings and pool key: concurrent sessions and sub-agents, each with
+// a client of its own, multiplex their requests to a provider over one
+// connection. It closes when no client holds it any more.
+class SharedHttp2 {
+ public:
+  using Key = std::tuple<const asio::io_context*, const TlsContext*, std::string>;
+
+  static SharedHttp2& instance() {
+    static SharedHttp2 instance;
+    return instance;
+  }
+
+  std::shared_ptr<Connection> find(const Key& key) {
+    std::lock_guard lock(mutex_);
+    auto it = connections_.find(key);
+    if (it == connections_.end()) return nullptr;
+    auto conn = it->second.lock();
+    if (!conn || !conn->h2->available()) {
+      connections_.erase(it);
+      return nullptr;
+    }
+    return conn;
+  }
+
+  void add(const Key& key, const std::shared_ptr<Connection>& conn) {
+    std::lock_guard lock(mutex_);
+    connections_[key] = conn;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::map<Key, std::weak_ptr<Connection>> connections_;
+};
+
+}  // namespace
 
 // HTTP Client implementation
 class HttpClient::Impl {
  public:
-  explicit Impl(asio::io_context& io_ctx) : io_ctx_(io_ctx), ssl_ctx_(asio::ssl::context::tlsv12_client), resolver_(io_ctx) {
-    ssl_ctx_.set_default_verify_paths();
-    ssl_ctx_.set_verify_mode(asio::ssl::verify_peer);
+  Impl(asio::io_context& io_ctx, HttpPoolOptions pool, std::shared_ptr<TlsContext> tls)
+      : io_ctx_(io_ctx), tls_(tls ? std::move(tls) : TlsContext::shared()), resolver_(io_ctx), pool_options_(pool) {
+    pool_options_.max_per_host = std::max<size_t>(pool_options_.max_per_host, 1);
+  }
+
+  ~Impl() {
+    std::lock_guard lock(pool_mutex_);
+    for (auto& [key, host] : hosts_) {
+      for (auto& conn : host.idle) {
+        conn->close();
+      }
+    }
   }
 
-  void request(const std::string& url, const HttpOptions& options, std::function<void(HttpResponse)> callback) {
+  void request(const std::string& url, HttpOptions options, std::function<void(HttpResponse)> callback) {
     auto parsed = ParsedUrl::parse(url);
     if (!parsed) {
       callback(HttpResponse{0, {}, "", "Invalid URL"});
       return;
     }
 
-    if (parsed->is_https()) {
-      request_https(*parsed, options, std::move(callback));
-    } else {
-      request_http(*parsed, options, std::move(callback));
-    }
+    auto response = std::make_shared<HttpResponse>();
+    auto exchange = make_exchange(*parsed, options);
+    exchange->on_head = [response](int status, Headers headers) {
+      response->status_code = status;
+      response->headers = std::move(headers);
+    };
+    exchange->on_body = [response](std::string_view data) {
+      response->body.append(data);
+    };
+    exchange->on_done = [response, callback = std::move(callback)](int status, const std::string& error) {
+      response->status_code = status;
+      response->error = error;
+      callback(std::move(*response));
+    };
+    start(exchange, false);
   }
 
-  void request_stream(const std::string& url, const HttpOptions& options, StreamDataCallback on_data,
+  void request_stream(const std::string& url, HttpOptions options, StreamDataCallback on_data,
                       std::function<void(int, const std::string&)> on_complete) {
     auto parsed = ParsedUrl::parse(url);
     if (!parsed) {
@@ -65,581 +200,570 @@ class HttpClient::Impl {
       return;
     }
 
-    if (parsed->is_https()) {
-      request_stream_https(*parsed, options, std::move(on_data), std::move(on_complete));
-    } else {
-      request_stream_http(*parsed, options, std::move(on_data), std::move(on_complete));
+    // Error responses are collected and reported through on_complete
+    auto error_body = std::make_shared<std::string>();
+    auto success = std::make_shared<bool>(false);
+    auto exchange = make_exchange(*parsed, options);
+    exchange->on_head = [success](int status, Headers) {
+      *success = status >= 200 && status < 300;
+    };
+    exchange->on_body = [success, error_body, on_data = std::move(on_data)](std::string_view data) {
+      if (*success) {
+        on_data(data);
+      } else {
+        error_body->append(data);
+      }
+    };
+    exchange->on_done = [success, error_body, on_complete = std::move(on_complete)](int status, const std::string& error) {
+      if (error.empty() && status != 0 && !*success) {
+        on_complete(status, "HTTP error " + std::to_string(status) + ": " + *error_body);
+      } else {
+        on_complete(status, error);
+      }
+    };
+    start(exchange, false);
+  }
+
+  HttpPoolStats pool_stats() const {
+    HttpPoolStats stats;
+    stats.hits = hits_;
+    stats.misses = misses_;
+    std::lock_guard lock(pool_mutex_);
+    for (const auto& [key, host] : hosts_) {
+      stats.idle += host.idle.size();
+      stats.http2 += host.h2 != nullptr;
     }
+    return stats;
   }
 
  private:
-  // Helper: close the lowest-layer socket, ignoring errors
-  template <typename Socket>
-  static void close_socket(std::shared_ptr<Socket> socket) {
-    asio::error_code ignored;
-    socket->lowest_layer().close(ignored);
-  }
+  // Request head and body, sent with one gather write so the body is never
+  // copied next to the head
+  struct OutgoingRequest {
+    std::string head;
+    std::string body;
+    Headers headers;  // For HTTP/2, which encodes them itself
+
+    std::array<asio::const_buffer, 2> buffers() const {
+      return {asio::buffer(head), asio::buffer(body)};
+    }
+  };
 
-  static void close_socket(std::shared_ptr<asio::ip::tcp::socket> socket) {
-    asio::error_code ignored;
-    socket->close(ignored);
+  static std::shared_ptr<OutgoingRequest> make_request(const ParsedUrl& url, HttpOptions& options) {
+    auto outgoing = std::make_shared<OutgoingRequest>();
+    auto& head = outgoing->head;
+    head.reserve(256);
+    head += options.method + " " + url.path + url.query + " HTTP/1.1\r\n";
+    head += "Host: " + url.authority() + "\r\n";
+
+    for (const auto& [key, value] : options.headers) {
+      head += key + ": " + value + "\r\n";
+    }
+
+    if (!options.body.empty()) {
+      head += "Content-Length: " + std::to_string(options.body.size()) + "\r\n";
+    }
+
+    head += "\r\n";
+    outgoing->body = std::move(options.body);
+    outgoing->headers = std::move(options.headers);
+    return outgoing;
   }
 
-  // Start a timeout timer. When it fires, set the timed_out flag and close the socket.
-  template <typename Socket>
-  static std::shared_ptr<asio::steady_timer> start_timeout(asio::io_context& io_ctx, std::chrono::seconds timeout, std::shared_ptr<Socket> socket,
-                                                           std::shared_ptr<bool> timed_out) {
-    auto timer = std::make_shared<asio::steady_timer>(io_ctx);
-    timer->expires_after(timeout);
-    timer->async_wait([socket, timed_out, timer](const asio::error_code& ec) {
-      if (!ec) {
-        // Timer fired (not cancelled) — mark as timed out and close socket
-        *timed_out = true;
-        close_socket(socket);
+  // One request and its response on a pooled connection
+  struct Exchange {
+    ParsedUrl url;
+    std::string method;
+    std::shared_ptr<OutgoingRequest> outgoing;
+    std::chrono::seconds timeout;
+
+    std::function<void(int status, Headers headers)> on_head;
+    std::function<void(std::string_view data)> on_body;
+    std::function<void(int status, const std::string& error)> on_done;  // Once, at the end
+
+    std::mutex mutex;  // For conn and waiter, also touched by the timeout
+    std::shared_ptr<Connection> conn;
+    std::shared_ptr<Waiter> waiter;
+    std::shared_ptr<Http2Session::Request> stream;  // Over HTTP/2
+    std::shared_ptr<asio::steady_timer> timer;
+    std::atomic<bool> timed_out{false};
+    std::atomic<bool> finished{false};
+
+    int status = 0;
+    bool received = false;  // Any response bytes
+    bool retried = false;
+    HttpResponseParser parser;
+    Headers headers;
+  };
+
+  std::shared_ptr<Exchange> make_exchange(const ParsedUrl& url, HttpOptions& options) {
+    auto exchange = std::make_shared<Exchange>();
+    exchange->url = url;
+    exchange->method = options.method;
+    exchange->timeout = options.timeout;
+    exchange->outgoing = make_request(url, options);
+
+    // Views into the read buffer go straight to on_body
+    auto* raw = exchange.get();  // The parser is part of the exchange
+    exchange->parser = HttpResponseParser(options.method == "HEAD");
+    exchange->parser.on_header = [raw](std::string_view name, std::string_view value) {
+      if (!raw->parser.headers_complete()) {
+        raw->headers[std::string(name)] = value;
       }
-    });
-    return timer;
+    };
+    exchange->parser.on_headers_complete = [raw]() {
+      raw->status = raw->parser.status_code();
+      raw->on_head(raw->status, std::move(raw->headers));
+    };
+    exchange->parser.on_body = [raw](std::string_view data) {
+      raw->on_body(data);
+    };
+    return exchange;
   }
 
-  void request_https(const ParsedUrl& url, const HttpOptions& options, std::function<void(HttpResponse)> callback) {
-    auto socket = std::make_shared<asio::ssl::stream<asio::ip::tcp::socket>>(io_ctx_, ssl_ctx_);
-    auto response = std::make_shared<HttpResponse>();
-    auto request_str = std::make_shared<std::string>();
-    auto buffer = std::make_shared<asio::streambuf>();
-    auto timed_out = std::make_shared<bool>(false);
-
-    // Start timeout timer
-    auto timer = start_timeout(io_ctx_, options.timeout, socket, timed_out);
-
-    // Wrap callback to cancel timer and check timeout
-    auto guarded_callback = [timer, timed_out, callback](HttpResponse resp) {
-      timer->cancel();
-      if (*timed_out) {
-        resp.error = "Request timed out";
-        resp.status_code = 0;
+  static std::string pool_key(const ParsedUrl& url) {
+    return url.scheme + "://" + url.host + ":" + url.port_or_default();
+  }
+
+  // Sends the request on a pooled connection (a new one with fresh). The
+  // timeout covers waiting for the connection as well.
+  void start(std::shared_ptr<Exchange> exchange, bool fresh) {
+    if (!exchange->timer) {
+      exchange->timer = std::make_shared<asio::steady_timer>(io_ctx_, exchange->timeout);
+      exchange->timer->async_wait([this, exchange](const asio::error_code& ec) {
+        if (ec) return;  // Cancelled
+        exchange->timed_out = true;
+        std::unique_lock lock(exchange->mutex);
+        if (exchange->conn && !exchange->conn->h2) {
+          // The pending operation fails and finishes the exchange
+          exchange->conn->close();
+          return;
+        }
+        if (exchange->stream) exchange->conn->h2->cancel(exchange->stream);
+        if (exchange->waiter) exchange->waiter->cancelled = true;
+        lock.unlock();
+        finish(exchange, "", false);
+      });
+    }
+
+    auto waiter = std::make_shared<Waiter>();
+    waiter->url = exchange->url;
+    waiter->callback = [this, exchange](std::shared_ptr<Connection> conn, const std::string& error) {
+      if (!conn) {
+        finish(exchange, error, false);
+        return;
+      }
+      {
+        std::lock_guard lock(exchange->mutex);
+        if (exchange->timed_out) {
+          release(conn, true);
+          return;
+        }
+        exchange->conn = conn;
       }
-      callback(std::move(resp));
+      if (conn->h2) {
+        send_http2(exchange, conn->h2);
+        return;
+      }
+      conn->async_write(exchange->outgoing->buffers(), [this, exchange](const asio::error_code& ec, size_t) {
+        if (ec) {
+          if (!retry_stale(exchange)) finish(exchange, "Write failed: " + ec.message(), false);
+          return;
+        }
+        read_response(exchange);
+      });
     };
+    {
+      std::lock_guard lock(exchange->mutex);
+      exchange->waiter = waiter;
+    }
+    acquire(fresh, waiter);
+  }
 
-    // Build HTTP request
-    std::ostringstream req;
-    req << options.method << " " << url.path << url.query << " HTTP/1.1\r\n";
-    req << "Host: " << url.host << "\r\n";
-    req << "Connection: close\r\n";
-
-    for (const auto& [key, value] : options.headers) {
-      req << key << ": " << value << "\r\n";
+  // A connection that was idle may have been closed by the server just as
+  // the request went out; such a request is sent once more on a new one
+  bool retry_stale(const std::shared_ptr<Exchange>& exchange) {
+    std::shared_ptr<Connection> conn;
+    {
+      std::lock_guard lock(exchange->mutex);
+      if (!exchange->conn || !exchange->conn->reused || exchange->received || exchange->retried || exchange->timed_out) return false;
+      exchange->retried = true;
+      conn = std::move(exchange->conn);
     }
+    spdlog::debug("Pooled connection to {} was closed, retrying on a new one", conn->key);
+    release(conn, false);
+    start(exchange, true);
+    return true;
+  }
 
-    if (!options.body.empty()) {
-      req << "Content-Length: " << options.body.size() << "\r\n";
+  // Sends the exchange as a stream of the host's HTTP/2 connection
+  void send_http2(const std::shared_ptr<Exchange>& exchange, const std::shared_ptr<Http2Session>& session) {
+    const auto& url = exchange->url;
+    auto request = std::make_shared<Http2Session::Request>();
+    request->method = exchange->method;
+    request->authority = url.authority();
+    request->path = url.path + url.query;
+    request->headers = exchange->outgoing->headers;
+    request->body = exchange->outgoing->body;
+
+    request->on_head = [exchange](int status, Headers headers) {
+      exchange->status = status;
+      exchange->received = true;
+      exchange->on_head(status, std::move(headers));
+    };
+    request->on_body = [exchange](std::string_view data) {
+      if (!exchange->finished) exchange->on_body(data);
+    };
+    request->on_done = [this, exchange](int, const std::string& error) {
+      finish(exchange, error, true);
+    };
+    request->on_refused = [this, exchange](const std::string& error) {
+      if (!retry_refused(exchange)) finish(exchange, error, true);
+    };
+
+    {
+      std::lock_guard lock(exchange->mutex);
+      if (exchange->timed_out) return;  // Finished by the timeout
+      exchange->stream = request;
     }
+    session->submit(std::move(request));
+  }
 
-    req << "\r\n";
-    req << options.body;
-    *request_str = req.str();
+  // A request the HTTP/2 server did not process is sent once more: on the
+  // same connection if it still takes requests, otherwise on a new one
+  bool retry_refused(const std::shared_ptr<Exchange>& exchange) {
+    {
+      std::lock_guard lock(exchange->mutex);
+      if (exchange->retried || exchange->timed_out) return false;
+      exchange->retried = true;
+      exchange->conn.reset();
+      exchange->stream.reset();
+    }
+    start(exchange, false);
+    return true;
+  }
 
-    // Set SNI hostname
-    SSL_set_tlsext_host_name(socket->native_handle(), url.host.c_str());
+  void finish(const std::shared_ptr<Exchange>& exchange, const std::string& error, bool reusable) {
+    if (exchange->finished.exchange(true)) return;
+    exchange->timer->cancel();
 
-    // Resolve and connect
-    resolver_.async_resolve(
-        url.host, url.port_or_default(),
-        [this, socket, request_str, response, buffer, guarded_callback, url](const asio::error_code& ec,
-                                                                             asio::ip::tcp::resolver::results_type results) {
-          if (ec) {
-            response->error = "DNS resolution failed: " + ec.message();
-            guarded_callback(*response);
-            return;
-          }
+    std::shared_ptr<Connection> conn;
+    {
+      std::lock_guard lock(exchange->mutex);
+      conn = std::move(exchange->conn);
+      exchange->waiter.reset();  // Its callback holds the exchange
+    }
+    if (conn) {
+      release(conn, reusable && !exchange->timed_out);
+    }
 
-          asio::async_connect(
-              socket->lowest_layer(), results,
-              [this, socket, request_str, response, buffer, guarded_callback](const asio::error_code& ec, const asio::ip::tcp::endpoint&) {
-                if (ec) {
-                  response->error = "Connection failed: " + ec.message();
-                  guarded_callback(*response);
-                  return;
-                }
-
-                // SSL handshake
-                socket->async_handshake(asio::ssl::stream_base::client,
-                                        [this, socket, request_str, response, buffer, guarded_callback](const asio::error_code& ec) {
-                                          if (ec) {
-                                            response->error = "SSL handshake failed: " + ec.message();
-                                            guarded_callback(*response);
-                                            return;
-                                          }
-
-                                          // Send request
-                                          asio::async_write(*socket, asio::buffer(*request_str),
-                                                            [this, socket, response, buffer, guarded_callback](const asio::error_code& ec, size_t) {
-                                                              if (ec) {
-                                                                response->error = "Write failed: " + ec.message();
-                                                                guarded_callback(*response);
-                                                                return;
-                                                              }
-
-                                                              // Read response
-                                                              read_response(socket, response, buffer, guarded_callback);
-                                                            });
-                                        });
-              });
-        });
+    if (exchange->timed_out) {
+      exchange->on_done(0, "Request timed out");
+    } else {
+      exchange->on_done(exchange->status, error);
+    }
   }
 
-  void request_http(const ParsedUrl& url, const HttpOptions& options, std::function<void(HttpResponse)> callback) {
-    auto socket = std::make_shared<asio::ip::tcp::socket>(io_ctx_);
-    auto response = std::make_shared<HttpResponse>();
-    auto request_str = std::make_shared<std::string>();
-    auto buffer = std::make_shared<asio::streambuf>();
-    auto timed_out = std::make_shared<bool>(false);
-
-    // Start timeout timer
-    auto timer = start_timeout(io_ctx_, options.timeout, socket, timed_out);
-
-    // Wrap callback to cancel timer and check timeout
-    auto guarded_callback = [timer, timed_out, callback](HttpResponse resp) {
-      timer->cancel();
-      if (*timed_out) {
-        resp.error = "Request timed out";
-        resp.status_code = 0;
+  void read_response(std::shared_ptr<Exchange> exchange) {
+    auto conn = exchange->conn;
+    conn->async_read_some([this, exchange, conn](const asio::error_code& ec, size_t bytes_transferred) {
+      auto& parser = exchange->parser;
+      if (bytes_transferred > 0) {
+        exchange->received = true;
+        std::string_view data(conn->read_buffer.data(), bytes_transferred);
+        size_t used = parser.feed(data);
+        if (parser.failed()) {
+          finish(exchange, parser.error(), false);
+          return;
+        }
+        if (parser.complete()) {
+          // Bytes after the response would be out of step with the next request
+          finish(exchange, "", parser.keep_alive() && used == data.size());
+          return;
+        }
       }
-      callback(std::move(resp));
-    };
 
-    // Build HTTP request
-    std::ostringstream req;
-    req << options.method << " " << url.path << url.query << " HTTP/1.1\r\n";
-    req << "Host: " << url.host << "\r\n";
-    req << "Connection: close\r\n";
+      if (!ec) {
+        read_response(exchange);
+        return;
+      }
 
-    for (const auto& [key, value] : options.headers) {
-      req << key << ": " << value << "\r\n";
-    }
+      // SSL connections may return various errors on close
+      // Treat any SSL category error as potential EOF
+      bool is_eof = (ec == asio::error::eof) || (ec.category() == asio::error::get_ssl_category()) || ec == asio::ssl::error::stream_truncated;
+
+      if (!parser.headers_complete()) {
+        if (!retry_stale(exchange)) finish(exchange, "Read headers failed: " + ec.message(), false);
+      } else if (!is_eof) {
+        finish(exchange, "Read failed: " + ec.message(), false);
+      } else if (parser.finish()) {
+        finish(exchange, "", false);  // The end of a body without other framing
+      } else {
+        finish(exchange, parser.error(), false);
+      }
+    });
+  }
 
-    if (!options.body.empty()) {
-      req << "Content-Length: " << options.body.size() << "\r\n";
-    }
+  // --- Connection pool ---
 
-    req << "\r\n";
-    req << options.body;
-    *request_str = req.str();
+  struct HostPool {
+    std::vector<std::shared_ptr<Connection>> idle;  // Most recently used last
+    std::deque<std::shared_ptr<Waiter>> waiters;
+    size_t open = 0;  // Idle, in use or connecting
+    std::shared_ptr<Connection> h2;  // Shared by all requests to the host
+    bool h2_pending = false;  // A probe is connecting
+    bool http1_only = false;  // A probe found no HTTP/2
+  };
 
-    resolver_.async_resolve(
-        url.host, url.port_or_default(),
-        [this, socket, request_str, response, buffer, guarded_callback](const asio::error_code& ec, asio::ip::tcp::resolver::results_type results) {
-          if (ec) {
-            response->error = "DNS resolution failed: " + ec.message();
-            guarded_callback(*response);
+  bool http2_enabled(const ParsedUrl& url) const {
+    return pool_options_.http2 && url.is_https();
+  }
+
+  SharedHttp2::Key shared_key(const std::string& key) const {
+    return {&io_ctx_, tls_.get(), key};
+  }
+
+  // Hands waiter an idle connection, or a new one unless the host is at
+  // max_per_host, in which case it waits for one to be released
+  void acquire(bool fresh, std::shared_ptr<Waiter> waiter) {
+    auto key = pool_key(waiter->url);
+    std::shared_ptr<Connection> conn;
+    std::vector<std::shared_ptr<Connection>> stale;
+    {
+      std::lock_guard lock(pool_mutex_);
+      auto& host = hosts_[key];
+      auto now = std::chrono::steady_clock::now();
+      if (!fresh && host.h2) {
+        auto& session = *host.h2->h2;
+        bool expired = session.active() == 0 && now - session.idle_since() >= pool_options_.idle_timeout;
+        if (session.available() && !expired) {
+          conn = host.h2;
+        } else {
+          stale.push_back(std::move(host.h2));
+          host.open--;
+        }
+      }
+      if (!conn && http2_enabled(waiter->url) && !host.http1_only) {
+        // Another client's connection to the host, or the one being opened
+        if (auto shared = SharedHttp2::instance().find(shared_key(key))) {
+          host.h2 = shared;
+          host.open++;
+          conn = std::move(shared);
+        } else if (host.h2_pending) {
+          host.waiters.push_back(std::move(waiter));
+          return;
+        }
+      }
+      while (!fresh && !conn && !host.idle.empty()) {
+        auto candidate = std::move(host.idle.back());
+        host.idle.pop_back();
+        if (now - candidate->idle_since < pool_options_.idle_timeout && candidate->healthy()) {
+          conn = std::move(candidate);
+        } else {
+          stale.push_back(std::move(candidate));
+          host.open--;
+        }
+      }
+      if (!conn) {
+        if (host.open >= pool_options_.max_per_host) {
+          // Make room by closing an idle connection, or wait
+          if (host.idle.empty()) {
+            host.waiters.push_back(std::move(waiter));
             return;
           }
+          stale.push_back(std::move(host.idle.front()));
+          host.idle.erase(host.idle.begin());
+          host.open--;
+        }
+        host.open++;
+      }
+    }
+    for (auto& old : stale) {
+      old->close();
+    }
 
-          asio::async_connect(
-              *socket, results,
-              [this, socket, request_str, response, buffer, guarded_callback](const asio::error_code& ec, const asio::ip::tcp::endpoint&) {
-                if (ec) {
-                  response->error = "Connection failed: " + ec.message();
-                  guarded_callback(*response);
-                  return;
-                }
-
-                asio::async_write(*socket, asio::buffer(*request_str),
-                                  [this, socket, response, buffer, guarded_callback](const asio::error_code& ec, size_t) {
-                                    if (ec) {
-                                      response->error = "Write failed: " + ec.message();
-                                      guarded_callback(*response);
-                                      return;
-                                    }
-
-                                    read_response(socket, response, buffer, guarded_callback);
-                                  });
-              });
-        });
+    if (conn) {
+      deliver(waiter, conn, "");
+    } else {
+      connect(key, std::move(waiter));
+    }
   }
 
-  template <typename Socket>
-  void read_response(std::shared_ptr<Socket> socket, std::shared_ptr<HttpResponse> response, std::shared_ptr<asio::streambuf> buffer,
-                     std::function<void(HttpResponse)> callback) {
-    asio::async_read_until(*socket, *buffer, "\r\n\r\n",
-                           [this, socket, response, buffer, callback](const asio::error_code& ec, size_t bytes_transferred) {
-                             if (ec && ec != asio::error::eof) {
-                               response->error = "Read headers failed: " + ec.message();
-                               callback(*response);
-                               return;
-                             }
-
-                             // Parse status line and headers
-                             std::istream stream(buffer.get());
-                             std::string status_line;
-                             std::getline(stream, status_line);
-
-                             // Parse status code
-                             std::regex status_regex(R"(HTTP/[\d.]+ (\d+))");
-                             std::smatch match;
-                             if (std::regex_search(status_line, match, status_regex)) {
-                               try {
-                                 response->status_code = std::stoi(match[1].str());
-                               } catch (const std::exception&) {
-                                 response->error = "Invalid HTTP response: cannot parse status code";
-                                 callback(*response);
-                                 return;
-                               }
-                             }
-
-                             // Parse headers
-                             std::string header_line;
-                             while (std::getline(stream, header_line) && header_line != "\r") {
-                               auto colon = header_line.find(':');
-                               if (colon != std::string::npos) {
-                                 std::string key = header_line.substr(0, colon);
-                                 std::string value = header_line.substr(colon + 1);
-                                 // Trim whitespace
-                                 value.erase(0, value.find_first_not_of(" \t"));
-                                 value.erase(value.find_last_not_of(" \t\r\n") + 1);
-                                 response->headers[key] = value;
-                               }
-                             }
-
-                             // Read body
-                             read_body(socket, response, buffer, callback);
-                           });
-  }
-
-  template <typename Socket>
-  void read_body(std::shared_ptr<Socket> socket, std::shared_ptr<HttpResponse> response, std::shared_ptr<asio::streambuf> buffer,
-                 std::function<void(HttpResponse)> callback) {
-    // First, add any remaining data in buffer to body
-    if (buffer->size() > 0) {
-      std::istream stream(buffer.get());
-      std::ostringstream body;
-      body << stream.rdbuf();
-      response->body += body.str();
-    }
-
-    // Check if we have Content-Length and already have all data
-    auto it = response->headers.find("Content-Length");
-    if (it != response->headers.end()) {
-      try {
-        size_t content_length = std::stoull(it->second);
-        if (response->body.size() >= content_length) {
-          // We have all the data
-          callback(*response);
+  // Returns a connection after a request: kept idle if reusable, closed
+  // otherwise. Either way a waiting request of its host gets a connection.
+  void release(std::shared_ptr<Connection> conn, bool reusable) {
+    if (conn->h2) return;  // Stays the host's until it fails or idles
+    if (!reusable) conn->close();
+
+    std::shared_ptr<Waiter> waiter;
+    {
+      std::lock_guard lock(pool_mutex_);
+      auto& host = hosts_[conn->key];
+      while (!host.waiters.empty() && !waiter) {
+        waiter = std::move(host.waiters.front());
+        host.waiters.pop_front();
+        if (waiter->cancelled) waiter.reset();
+      }
+      if (reusable) {
+        conn->reused = true;
+        if (!waiter) {
+          conn->idle_since = std::chrono::steady_clock::now();
+          host.idle.push_back(std::move(conn));
           return;
         }
-      } catch (const std::exception&) {
-        // Invalid Content-Length, ignore and continue reading
+      } else if (!waiter) {
+        host.open--;
+        return;
       }
     }
 
-    // Continue reading until EOF or we have all data
-    asio::async_read(*socket, *buffer, asio::transfer_at_least(1),
-                     [this, socket, response, buffer, callback](const asio::error_code& ec, size_t bytes_transferred) {
-                       // SSL connections may return various errors on close
-                       // Treat any SSL category error as potential EOF
-                       bool is_eof =
-                           (ec == asio::error::eof) || (ec.category() == asio::error::get_ssl_category()) || ec == asio::ssl::error::stream_truncated;
-
-                       if (ec && !is_eof) {
-                         // Some error, but we may have partial data
-                         callback(*response);
-                         return;
-                       }
-
-                       // Append to body
-                       if (buffer->size() > 0) {
-                         std::istream stream(buffer.get());
-                         std::ostringstream more;
-                         more << stream.rdbuf();
-                         response->body += more.str();
-                       }
-
-                       if (is_eof) {
-                         callback(*response);
-                       } else {
-                         // Check Content-Length again
-                         auto it = response->headers.find("Content-Length");
-                         if (it != response->headers.end()) {
-                           try {
-                             size_t content_length = std::stoull(it->second);
-                             if (response->body.size() >= content_length) {
-                               callback(*response);
-                               return;
-                             }
-                           } catch (const std::exception&) {
-                             // Invalid Content-Length, ignore and continue reading
-                           }
-                         }
-                         read_body(socket, response, buffer, callback);
-                       }
-                     });
-  }
-
-  // Streaming request implementations
-  void request_stream_https(const ParsedUrl& url, const HttpOptions& options, StreamDataCallback on_data,
-                            std::function<void(int, const std::string&)> on_complete) {
-    auto socket = std::make_shared<asio::ssl::stream<asio::ip::tcp::socket>>(io_ctx_, ssl_ctx_);
-    auto request_str = std::make_shared<std::string>();
-    auto buffer = std::make_shared<asio::streambuf>();
-    auto status_code = std::make_shared<int>(0);
-    auto shared_on_data = std::make_shared<StreamDataCallback>(std::move(on_data));
-    auto timed_out = std::make_shared<bool>(false);
-
-    // Start timeout timer
-    auto timer = start_timeout(io_ctx_, options.timeout, socket, timed_out);
-
-    // Wrap on_complete to cancel timer and check timeout
-    auto shared_on_complete = std::make_shared<std::function<void(int, const std::string&)>>(
-        [timer, timed_out, on_complete = std::move(on_complete)](int code, const std::string& err) {
-          timer->cancel();
-          if (*timed_out) {
-            on_complete(0, "Request timed out");
-          } else {
-            on_complete(code, err);
-          }
-        });
+    if (reusable) {
+      deliver(waiter, conn, "");
+    } else {
+      // The closed connection's slot goes to the waiter
+      connect(conn->key, std::move(waiter));
+    }
+  }
 
-    // Build HTTP request
-    std::ostringstream req;
-    req << options.method << " " << url.path << url.query << " HTTP/1.1\r\n";
-    req << "Host: " << url.host << "\r\n";
-    req << "Connection: close\r\n";
+  void deliver(const std::shared_ptr<Waiter>& waiter, std::shared_ptr<Connection> conn, const std::string& error) {
+    if (conn) {
+      // An HTTP/2 connection is reused from its second request on
+      bool reused = conn->h2 ? conn->reused.exchange(true) : conn->reused.load();
+      (reused ? hits_ : misses_)++;
+    } else {
+      misses_++;
+    }
 
-    for (const auto& [key, value] : options.headers) {
-      req << key << ": " << value << "\r\n";
+    if (waiter->cancelled) {
+      if (conn) {
+        release(std::move(conn), true);
+      }
+      return;
     }
+    waiter->callback(std::move(conn), error);
+  }
 
-    if (!options.body.empty()) {
-      req << "Content-Length: " << options.body.size() << "\r\n";
+  // Opens a connection in a slot already counted in the host's open
+  void connect(const std::string& key, std::shared_ptr<Waiter> waiter) {
+    const auto& url = waiter->url;
+    auto conn = std::make_shared<Connection>(io_ctx_, url.is_https() ? &tls_->context() : nullptr, key);
+    if (http2_enabled(url)) {
+      std::lock_guard lock(pool_mutex_);
+      auto& host = hosts_[key];
+      conn->probe = !host.http1_only && !host.h2_pending && !host.h2;
+      host.h2_pending = host.h2_pending || conn->probe;
+    }
+    auto fail = [this, conn, waiter](const std::string& error) {
+      auto waiting = conn->probe ? settle_probe(conn, false) : std::deque<std::shared_ptr<Waiter>>{};
+      release(conn, false);
+      deliver(waiter, nullptr, error);
+      resume(waiting, nullptr);
+    };
+
+    if (conn->tls) {
+      tls_->prepare(conn->tls->native_handle(), url.host);
+      if (conn->probe) Http2Session::offer_alpn(conn->tls->native_handle());
     }
 
-    req << "\r\n";
-    req << options.body;
-    *request_str = req.str();
+    using Endpoints = asio::ip::tcp::resolver::results_type;
+    resolver_.async_resolve(url.host, url.port_or_default(), [this, conn, waiter, fail](const asio::error_code& ec, Endpoints results) {
+      if (ec) {
+        fail("DNS resolution failed: " + ec.message());
+        return;
+      }
 
-    // Set SNI hostname
-    SSL_set_tlsext_host_name(socket->native_handle(), url.host.c_str());
+      asio::async_connect(conn->socket(), results, [this, conn, waiter, fail](const asio::error_code& ec, const asio::ip::tcp::endpoint&) {
+        if (ec) {
+          fail("Connection failed: " + ec.message());
+          return;
+        }
+        if (!conn->tls) {
+          deliver(waiter, conn, "");
+          return;
+        }
 
-    // Resolve and connect
-    resolver_.async_resolve(
-        url.host, url.port_or_default(),
-        [this, socket, request_str, buffer, status_code, shared_on_data, shared_on_complete](const asio::error_code& ec,
-                                                                                             asio::ip::tcp::resolver::results_type results) {
+        // SSL handshake
+        conn->tls->async_handshake(asio::ssl::stream_base::client, [this, conn, waiter, fail](const asio::error_code& ec) {
           if (ec) {
-            (*shared_on_complete)(0, "DNS resolution failed: " + ec.message());
+            fail("SSL handshake failed: " + ec.message());
             return;
           }
-
-          asio::async_connect(
-              socket->lowest_layer(), results,
-              [this, socket, request_str, buffer, status_code, shared_on_data, shared_on_complete](const asio::error_code& ec,
-                                                                                                   const asio::ip::tcp::endpoint&) {
-                if (ec) {
-                  (*shared_on_complete)(0, "Connection failed: " + ec.message());
-                  return;
-                }
-
-                socket->async_handshake(asio::ssl::stream_base::client, [this, socket, request_str, buffer, status_code, shared_on_data,
-                                                                         shared_on_complete](const asio::error_code& ec) {
-                  if (ec) {
-                    (*shared_on_complete)(0, "SSL handshake failed: " + ec.message());
-                    return;
-                  }
-
-                  asio::async_write(*socket, asio::buffer(*request_str),
-                                    [this, socket, buffer, status_code, shared_on_data, shared_on_complete](const asio::error_code& ec, size_t) {
-                                      if (ec) {
-                                        (*shared_on_complete)(0, "Write failed: " + ec.message());
-                                        return;
-                                      }
-
-                                      read_stream_headers(socket, buffer, status_code, shared_on_data, shared_on_complete);
-                                    });
-                });
-              });
-        });
-  }
-
-  void request_stream_http(const ParsedUrl& url, const HttpOptions& options, StreamDataCallback on_data,
-                           std::function<void(int, const std::string&)> on_complete) {
-    auto socket = std::make_shared<asio::ip::tcp::socket>(io_ctx_);
-    auto request_str = std::make_shared<std::string>();
-    auto buffer = std::make_shared<asio::streambuf>();
-    auto status_code = std::make_shared<int>(0);
-    auto shared_on_data = std::make_shared<StreamDataCallback>(std::move(on_data));
-    auto timed_out = std::make_shared<bool>(false);
-
-    // Start timeout timer
-    auto timer = start_timeout(io_ctx_, options.timeout, socket, timed_out);
-
-    // Wrap on_complete to cancel timer and check timeout
-    auto shared_on_complete = std::make_shared<std::function<void(int, const std::string&)>>(
-        [timer, timed_out, on_complete = std::move(on_complete)](int code, const std::string& err) {
-          timer->cancel();
-          if (*timed_out) {
-            on_complete(0, "Request timed out");
-          } else {
-            on_complete(code, err);
+          if (!conn->probe) {
+            deliver(waiter, conn, "");
+            return;
           }
+          auto waiting = settle_probe(conn, true);
+          deliver(waiter, conn, "");
+          resume(waiting, conn->h2 ? conn : nullptr);
         });
+      });
+    });
+  }
 
-    // Build HTTP request
-    std::ostringstream req;
-    req << options.method << " " << url.path << url.query << " HTTP/1.1\r\n";
-    req << "Host: " << url.host << "\r\n";
-    req << "Connection: close\r\n";
+  // The protocol of a probe is known. With HTTP/2 it becomes the host's
+  // shared connection. Returns the requests that waited for it.
+  std::deque<std::shared_ptr<Waiter>> settle_probe(const std::shared_ptr<Connection>& conn, bool connected) {
+    bool h2 = connected && Http2Session::negotiated(conn->tls->native_handle());
+    if (h2) {
+      conn->h2 = std::make_shared<Http2Session>(std::move(conn->tls));
+      conn->h2->start();
+      SharedHttp2::instance().add(shared_key(conn->key), conn);
+      spdlog::debug("Using HTTP/2 for {}", conn->key);
+    }
 
-    for (const auto& [key, value] : options.headers) {
-      req << key << ": " << value << "\r\n";
+    std::deque<std::shared_ptr<Waiter>> waiting;
+    std::lock_guard lock(pool_mutex_);
+    auto& host = hosts_[conn->key];
+    host.h2_pending = false;
+    if (h2) {
+      host.h2 = conn;
+    } else if (connected) {
+      host.http1_only = true;
     }
+    waiting.swap(host.waiters);
+    return waiting;
+  }
 
-    if (!options.body.empty()) {
-      req << "Content-Length: " << options.body.size() << "\r\n";
-    }
-
-    req << "\r\n";
-    req << options.body;
-    *request_str = req.str();
-
-    resolver_.async_resolve(url.host, url.port_or_default(),
-                            [this, socket, request_str, buffer, status_code, shared_on_data, shared_on_complete](
-                                const asio::error_code& ec, asio::ip::tcp::resolver::results_type results) {
-                              if (ec) {
-                                (*shared_on_complete)(0, "DNS resolution failed: " + ec.message());
-                                return;
-                              }
-
-                              asio::async_connect(
-                                  *socket, results,
-                                  [this, socket, request_str, buffer, status_code, shared_on_data, shared_on_complete](
-                                      const asio::error_code& ec, const asio::ip::tcp::endpoint&) {
-                                    if (ec) {
-                                      (*shared_on_complete)(0, "Connection failed: " + ec.message());
-                                      return;
-                                    }
-
-                                    asio::async_write(
-                                        *socket, asio::buffer(*request_str),
-                                        [this, socket, buffer, status_code, shared_on_data, shared_on_complete](const asio::error_code& ec, size_t) {
-                                          if (ec) {
-                                            (*shared_on_complete)(0, "Write failed: " + ec.message());
-                                            return;
-                                          }
-
-                                          read_stream_headers(socket, buffer, status_code, shared_on_data, shared_on_complete);
-                                        });
-                                  });
-                            });
-  }
-
-  template <typename Socket>
-  void read_stream_headers(std::shared_ptr<Socket> socket, std::shared_ptr<asio::streambuf> buffer, std::shared_ptr<int> status_code,
-                           std::shared_ptr<StreamDataCallback> on_data, std::shared_ptr<std::function<void(int, const std::string&)>> on_complete) {
-    asio::async_read_until(*socket, *buffer, "\r\n\r\n",
-                           [this, socket, buffer, status_code, on_data, on_complete](const asio::error_code& ec, size_t bytes_transferred) {
-                             if (ec && ec != asio::error::eof) {
-                               (*on_complete)(0, "Read headers failed: " + ec.message());
-                               return;
-                             }
-
-                             // Parse status line
-                             std::istream stream(buffer.get());
-                             std::string status_line;
-                             std::getline(stream, status_line);
-
-                             std::regex status_regex(R"(HTTP/[\d.]+ (\d+))");
-                             std::smatch match;
-                             if (std::regex_search(status_line, match, status_regex)) {
-                               try {
-                                 *status_code = std::stoi(match[1].str());
-                               } catch (const std::exception&) {
-                                 (*on_complete)(0, "Invalid HTTP response: cannot parse status code");
-                                 return;
-                               }
-                             }
-
-                             // Skip headers
-                             std::string header_line;
-                             while (std::getline(stream, header_line) && header_line != "\r") {
-                               // Just consume headers
-                             }
-
-                             // Check status code
-                             if (*status_code < 200 || *status_code >= 300) {
-                               // Read error body
-                               std::ostringstream error_body;
-                               error_body << stream.rdbuf();
-                               (*on_complete)(*status_code, "HTTP error " + std::to_string(*status_code) + ": " + error_body.str());
-                               return;
-                             }
-
-                             // Process any remaining data in buffer as first chunk
-                             if (buffer->size() > 0) {
-                               std::ostringstream chunk;
-                               chunk << stream.rdbuf();
-                               std::string chunk_str = chunk.str();
-                               if (!chunk_str.empty()) {
-                                 (*on_data)(chunk_str);
-                               }
-                             }
-
-                             // Continue reading stream data
-                             read_stream_data(socket, buffer, status_code, on_data, on_complete);
-                           });
-  }
-
-  template <typename Socket>
-  void read_stream_data(std::shared_ptr<Socket> socket, std::shared_ptr<asio::streambuf> buffer, std::shared_ptr<int> status_code,
-                        std::shared_ptr<StreamDataCallback> on_data, std::shared_ptr<std::function<void(int, const std::string&)>> on_complete) {
-    asio::async_read(*socket, *buffer, asio::transfer_at_least(1),
-                     [this, socket, buffer, status_code, on_data, on_complete](const asio::error_code& ec, size_t bytes_transferred) {
-                       bool is_eof =
-                           (ec == asio::error::eof) || (ec.category() == asio::error::get_ssl_category()) || ec == asio::ssl::error::stream_truncated;
-
-                       if (ec && !is_eof) {
-                         (*on_complete)(*status_code, "Read failed: " + ec.message());
-                         return;
-                       }
-
-                       // Send chunk to callback
-                       if (buffer->size() > 0) {
-                         std::istream stream(buffer.get());
-                         std::ostringstream chunk;
-                         chunk << stream.rdbuf();
-                         std::string chunk_str = chunk.str();
-                         if (!chunk_str.empty()) {
-                           (*on_data)(chunk_str);
-                         }
-                       }
-
-                       if (is_eof) {
-                         (*on_complete)(*status_code, "");
-                       } else {
-                         read_stream_data(socket, buffer, status_code, on_data, on_complete);
-                       }
-                     });
+  // Requests that waited for a probe go over its HTTP/2 connection, or
+  // look for a connection again
+  void resume(std::deque<std::shared_ptr<Waiter>>& waiting, const std::shared_ptr<Connection>& h2) {
+    for (auto& waiter : waiting) {
+      if (waiter->cancelled) continue;
+      if (h2) {
+        deliver(waiter, h2, "");
+      } else {
+        acquire(false, std::move(waiter));
+      }
+    }
   }
 
   asio::io_context& io_ctx_;
-  asio::ssl::context ssl_ctx_;
+  std::shared_ptr<TlsContext> tls_;
   asio::ip::tcp::resolver resolver_;
+
+  HttpPoolOptions pool_options_;
+  mutable std::mutex pool_mutex_;
+  std::map<std::string, HostPool> hosts_;  // By pool_key()
+  std::atomic<uint64_t> hits_{0};
+  std::atomic<uint64_t> misses_{0};
 };
 
-HttpClient::HttpClient(asio::io_context& io_ctx) : impl_(std::make_unique<Impl>(io_ctx)) {}
+HttpClient::HttpClient(asio::io_context& io_ctx, HttpPoolOptions pool, std::shared_ptr<TlsContext> tls)
+    : impl_(std::make_unique<Impl>(io_ctx, pool, std::move(tls))) {}
 
 HttpClient::~HttpClient() = default;
 
-void HttpClient::request(const std::string& url, const HttpOptions& options, std::function<void(HttpResponse)> callback) {
-  impl_->request(url, options, std::move(callback));
+void HttpClient::request(const std::string& url, HttpOptions options, std::function<void(HttpResponse)> callback) {
+  impl_->request(url, std::move(options), std::move(callback));
 }
 
-std::future<HttpResponse> HttpClient::request(const std::string& url, const HttpOptions& options) {
+std::future<HttpResponse> HttpClient::request(const std::string& url, HttpOptions options) {
   if (options.max_retries <= 0) {
     // No retry — preserve original behavior
     auto promise = std::make_shared<std::promise<HttpResponse>>();
     auto future = promise->get_future();
 
-    impl_->request(url, options, [promise](HttpResponse response) {
+    impl_->request(url, std::move(options), [promise](HttpResponse response) {
       promise->set_value(std::move(response));
     });
 
@@ -647,7 +771,7 @@ std::future<HttpResponse> HttpClient::request(const std::string& url, const Http
   }
 
   // With retry — use std::async to drive the retry loop
-  return std::async(std::launch::async, [this, url, options]() -> HttpResponse {
+  return std::async(std::launch::async, [this, url, options = std::move(options)]() -> HttpResponse {
     auto is_retryable = [](const HttpResponse& resp) -> bool {
       // Connection/timeout errors (status_code == 0 means no HTTP response received)
       if (resp.status_code == 0) return true;
@@ -695,16 +819,16 @@ std::future<HttpResponse> HttpClient::request(const std::string& url, const Http
   });
 }
 
-void HttpClient::request_stream(const std::string& url, const HttpOptions& options, StreamDataCallback on_data,
+void HttpClient::request_stream(const std::string& url, HttpOptions options, StreamDataCallback on_data,
                                 std::function<void(int status_code, const std::string& error)> on_complete) {
-  impl_->request_stream(url, options, std::move(on_data), std::move(on_complete));
+  impl_->request_stream(url, std::move(options), std::move(on_data), std::move(on_complete));
 }
 
 std::future<HttpResponse> HttpClient::get(const std::string& url, const std::map<std::string, std::string>& headers) {
   HttpOptions options;
   options.method = "GET";
   options.headers = headers;
-  return request(url, options);
+  return request(url, std::move(options));
 }
 
 std::future<HttpResponse> HttpClient::post(const std::string& url, const std::string& body, const std::map<std::string, std::string>& headers) {
@@ -712,7 +836,11 @@ std::future<HttpResponse> HttpClient::post(const std::string& url, const std::st
   options.method = "POST";
   options.body = body;
   options.headers = headers;
-  return request(url, options);
+  return request(url, std::move(options));
+}
+
+HttpPoolStats HttpClient::pool_stats() const {
+  return impl_->pool_stats();
 }
 
 }  // namespace agent::net
@@ -9,6 +9,9 @@
 #include <memory>
 #include <optional>
 #include <string>
+#include <string_view>
+
+#include "url.hpp"
 
 namespace agent::net {
 
@@ -34,24 +37,52 @@ struct HttpOptions {
   std::chrono::milliseconds retry_delay{1000};  // Delay between retries
 };
 
-// Streaming data callback
-using StreamDataCallback = std::function<void(const std::string& chunk)>;
+// Streaming data callback; chunk points into the read buffer and is valid
+// during the call only
+using StreamDataCallback = std::function<void(std::string_view chunk)>;
+
+// Keep-alive connection pool, one per HttpClient. Connections are kept per
+// (scheme, host, port) and reused once a response has been read in full.
+//
+// With http2, https connections offer HTTP/2 through ALPN. When a host takes
+// it, all requests to the host, from every HttpClient with http2 on the same
+// io_context and TLS settings, share one connection as concurrent streams
+// (clients that first connect at the same moment may each open one);
+// otherwise the host is served over HTTP/1.1 as before.
+struct HttpPoolOptions {
+  std::chrono::seconds idle_timeout{30};  // Idle connections older than this are closed, not reused
+  size_t max_per_host = 6;  // Open connections per host; further requests wait for one
+  bool http2 = false;  // Offer HTTP/2 on https connections; off keeps every host on HTTP/1.1
+};
+
+struct HttpPoolStats {
+  uint64_t hits = 0;  // Requests sent on a connection that was already open
+  uint64_t misses = 0;  // Requests that had to open one
+  size_t idle = 0;  // Connections idle in the pool now
+  size_t http2 = 0;  // HTTP/2 connections held now
+};
+
+class TlsContext;
 
 // Async HTTP client using ASIO
 class HttpClient {
  public:
-  explicit HttpClient(asio::io_context& io_ctx);
+  // TLS settings come from TlsContext::shared() unless given
+  explicit HttpClient(asio::io_context& io_ctx, HttpPoolOptions pool = {}, std::shared_ptr<TlsContext> tls = nullptr);
 
   ~HttpClient();
 
+  // Requests take options by value: move them in to hand over the body
+  // without copying it.
+
   // Async request with callback
-  void request(const std::string& url, const HttpOptions& options, std::function<void(HttpResponse)> callback);
+  void request(const std::string& url, HttpOptions options, std::function<void(HttpResponse)> callback);
 
   // Async request returning future
-  std::future<HttpResponse> request(const std::string& url, const HttpOptions& options);
+  std::future<HttpResponse> request(const std::string& url, HttpOptions options);
 
   // Streaming request - calls on_data for each chunk received
-  void request_stream(const std::string& url, const HttpOptions& options, StreamDataCallback on_data,
+  void request_stream(const std::string& url, HttpOptions options, StreamDataCallback on_data,
                       std::function<void(int status_code, const std::string& error)> on_complete);
 
   // Convenience methods
@@ -59,27 +90,12 @@ class HttpClient {
 
   std::future<HttpResponse> post(const std::string& url, const std::string& body, const std::map<std::string, std::string>& headers = {});
 
+  HttpPoolStats pool_stats() const;
+
  private:
   class Impl;
 
   std::unique_ptr<Impl> impl_;
 };
 
-// URL parsing helper
-struct ParsedUrl {
-  std::string scheme;
-  std::string host;
-  std::string port;
-  std::string path;
-  std::string query;
-
-  bool is_https() const {
-    return scheme == "https";
-  }
-
-  std::string port_or_default() const;
-
-  static std::optional<ParsedUrl> parse(const std::string& url);
-};
-
 }  // namespace agent::net
@@ -0,0 +1,248 @@
+#include "http_parser.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace agent::net {
+
+static bool iequals(std::string_view a, std::string_view b) {
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+           return std::tolower(static_cast<unsigned char>(x)) == std::tolower(static_cast<unsigned char>(y));
+         });
+}
+
+static std::string_view trim(std::string_view text) {
+  while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+  while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+  return text;
+}
+
+// Whether a comma-separated field value lists token
+static bool has_token(std::string_view value, std::string_view token) {
+  while (!value.empty()) {
+    auto comma = value.find(',');
+    if (iequals(trim(value.substr(0, comma)), token)) return true;
+    if (comma == std::string_view::npos) break;
+    value.remove_prefix(comma + 1);
+  }
+  return false;
+}
+
+size_t HttpResponseParser::feed(std::string_view data) {
+  const size_t size = data.size();
+  while (!data.empty() && state_ != State::Complete && state_ != State::Failed) {
+    switch (state_) {
+      case State::Body:
+      case State::ChunkData: {
+        auto take = static_cast<size_t>(std::min<uint64_t>(remaining_, data.size()));
+        if (on_body) on_body(data.substr(0, take));
+        data.remove_prefix(take);
+        remaining_ -= take;
+        if (remaining_ == 0) {
+          state_ = state_ == State::Body ? State::Complete : State::ChunkDataEnd;
+        }
+        break;
+      }
+      case State::BodyUntilClose:
+        if (on_body) on_body(data);
+        data = {};
+        break;
+      default: {
+        std::string_view line;
+        if (!next_line(data, line)) break;
+        if (state_ == State::StatusLine) {
+          parse_status_line(line);
+        } else if (state_ == State::HeaderLine) {
+          if (line.empty()) {
+            end_headers();
+          } else {
+            parse_field(line, false);
+          }
+        } else if (state_ == State::ChunkSize) {
+          parse_chunk_size(line);
+        } else if (state_ == State::ChunkDataEnd) {
+          if (line.empty()) {
+            state_ = State::ChunkSize;
+          } else {
+            fail("Invalid chunked encoding: data longer than its chunk size");
+          }
+        } else if (state_ == State::TrailerLine) {
+          if (line.empty()) {
+            state_ = State::Complete;
+          } else {
+            parse_field(line, true);
+          }
+        }
+        break;
+      }
+    }
+  }
+  return size - data.size();
+}
+
+bool HttpResponseParser::finish() {
+  if (state_ == State::BodyUntilClose) {
+    state_ = State::Complete;
+  } else if (state_ != State::Complete && state_ != State::Failed) {
+    fail(headers_complete() ? "Connection closed before the response ended" : "Connection closed before the response headers");
+  }
+  return complete();
+}
+
+bool HttpResponseParser::next_line(std::string_view& data, std::string_view& line) {
+  if (partial_line_) {
+    partial_.clear();
+    partial_line_ = false;
+  }
+
+  auto newline = data.find('\n');
+  if (newline == std::string_view::npos) {
+    partial_.append(data);
+    data = {};
+    if (partial_.size() > MAX_HEADER_BYTES) fail("Response header too large");
+    return false;
+  }
+
+  if (partial_.empty()) {
+    line = data.substr(0, newline);
+  } else {
+    partial_.append(data.substr(0, newline));
+    line = partial_;
+    partial_line_ = true;
+  }
+  data.remove_prefix(newline + 1);
+  if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+  if (state_ == State::StatusLine || state_ == State::HeaderLine || state_ == State::TrailerLine) {
+    header_bytes_ += line.size() + 2;
+    if (header_bytes_ > MAX_HEADER_BYTES) {
+      fail("Response header too large");
+      return false;
+    }
+  }
+  return true;
+}
+
+std::optional<StatusLine> parse_status_line(std::string_view line) {
+  auto digit = [&](size_t i) {
+    return i < line.size() && line[i] >= '0' && line[i] <= '9';
+  };
+  // "HTTP/d.d ddd", then nothing or a space and the reason
+  if (!line.starts_with("HTTP/") || !digit(5) || line.size() < 12 || line[6] != '.' || !digit(7) || line[8] != ' ' || !digit(9) ||
+      !digit(10) || !digit(11) || (line.size() > 12 && line[12] != ' ')) {
+    return std::nullopt;
+  }
+  StatusLine status;
+  status.major = line[5] - '0';
+  status.minor = line[7] - '0';
+  status.code = (line[9] - '0') * 100 + (line[10] - '0') * 10 + (line[11] - '0');
+  if (line.size() > 12) status.reason = line.substr(13);
+  return status;
+}
+
+void HttpResponseParser::parse_status_line(std::string_view line) {
+  auto status = net::parse_status_line(line);
+  if (!status || status->major != 1) {
+    fail("Invalid HTTP response: cannot parse status line");
+    return;
+  }
+
+  status_code_ = status->code;
+  close_ = status->minor == 0;  // HTTP/1.0 closes unless it asks to keep alive
+  state_ = State::HeaderLine;
+}
+
+void HttpResponseParser::parse_field(std::string_view line, bool trailer) {
+  auto colon = line.find(':');
+  if (colon == std::string_view::npos || colon == 0) {
+    return;  // Not a field; ignored
+  }
+  auto name = line.substr(0, colon);
+  auto value = trim(line.substr(colon + 1));
+
+  if (!trailer) {
+    if (iequals(name, "Content-Length")) {
+      uint64_t length = 0;
+      if (value.empty() || value.size() > 18 || !std::all_of(value.begin(), value.end(), [](char c) {
+            return c >= '0' && c <= '9';
+          })) {
+        fail("Invalid Content-Length");
+        return;
+      }
+      for (char c : value) length = length * 10 + static_cast<uint64_t>(c - '0');
+      if (content_length_ && *content_length_ != length) {
+        fail("Conflicting Content-Length");
+        return;
+      }
+      content_length_ = length;
+    } else if (iequals(name, "Transfer-Encoding")) {
+      chunked_ = has_token(value, "chunked");
+    } else if (iequals(name, "Connection")) {
+      if (has_token(value, "close")) {
+        close_ = true;
+      } else if (has_token(value, "keep-alive")) {
+        close_ = false;
+      }
+    }
+  }
+
+  // An interim response's fields do not describe the final one
+  if (on_header && !interim()) on_header(name, value);
+}
+
+void HttpResponseParser::end_headers() {
+  if (interim()) {
+    // The final response follows on the same connection (RFC 9112 section 4)
+    state_ = State::StatusLine;
+    status_code_ = 0;
+    chunked_ = false;
+    content_length_.reset();
+    return;
+  }
+
+  headers_complete_ = true;
+  if (on_headers_complete) on_headers_complete();
+  if (state_ == State::Failed) return;
+
+  if (head_request_ || status_code_ == 101 || status_code_ == 204 || status_code_ == 304) {
+    state_ = State::Complete;
+  } else if (chunked_) {
+    // Takes precedence over Content-Length
+    state_ = State::ChunkSize;
+  } else if (content_length_) {
+    remaining_ = *content_length_;
+    state_ = remaining_ > 0 ? State::Body : State::Complete;
+  } else {
+    until_close_ = true;
+    state_ = State::BodyUntilClose;
+  }
+}
+
+// chunk-size [; chunk-ext]
+void HttpResponseParser::parse_chunk_size(std::string_view line) {
+  uint64_t size = 0;
+  size_t i = 0;
+  for (; i < line.size() && std::isxdigit(static_cast<unsigned char>(line[i])); ++i) {
+    if (size >> 60) {
+      fail("Invalid chunked encoding: chunk too large");
+      return;
+    }
+    char c = line[i];
+    size = size * 16 + static_cast<uint64_t>(c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10);
+  }
+  auto rest = trim(line.substr(i));
+  if (i == 0 || (!rest.empty() && rest.front() != ';')) {
+    fail("Invalid chunked encoding: bad chunk size");
+    return;
+  }
+
+  remaining_ = size;
+  state_ = size > 0 ? State::ChunkData : State::TrailerLine;
+}
+
+void HttpResponseParser::fail(std::string message) {
+  state_ = State::Failed;
+  error_ = std::move(message);
+}
+
+}  // namespace agent::net
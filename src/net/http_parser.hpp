@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace agent::net {
+
+// Incremental HTTP/1.1 response parser (RFC 9112): status line, header
+// fields, then a body framed by Content-Length, by chunked transfer coding
+// (trailer fields included) or by the connection closing.
+//
+// Interim (1xx) responses before the final one are skipped, fields and all;
+// 101 Switching Protocols ends the response, the connection is then no
+// longer HTTP.
+//
+// feed() takes the bytes as they arrive, split anywhere, and passes header
+// fields and body data to the callbacks as views into them; only a line
+// split across two feeds is copied. Views are valid during the call only.
+
+// HTTP-version SP status-code [SP reason-phrase]
+struct StatusLine {
+  int major = 0;
+  int minor = 0;
+  int code = 0;
+  std::string_view reason;
+};
+
+// Parses a status line without its line ending
+std::optional<StatusLine> parse_status_line(std::string_view line);
+
+class HttpResponseParser {
+ public:
+  // A response to HEAD has no body
+  explicit HttpResponseParser(bool head_request = false) : head_request_(head_request) {}
+
+  // Each header field, then each trailer field of a chunked body
+  std::function<void(std::string_view name, std::string_view value)> on_header;
+  // The status line and header fields are parsed
+  std::function<void()> on_headers_complete;
+  std::function<void(std::string_view data)> on_body;
+
+  // Parses data, which follows what was fed before. Returns how many bytes
+  // belong to this response: all of data unless it completed or failed.
+  size_t feed(std::string_view data);
+
+  // The connection was closed: ends a body that lasts until then. Returns
+  // whether the response is complete.
+  bool finish();
+
+  bool headers_complete() const {
+    return headers_complete_;
+  }
+
+  bool complete() const {
+    return state_ == State::Complete;
+  }
+
+  bool failed() const {
+    return state_ == State::Failed;
+  }
+
+  const std::string& error() const {
+    return error_;
+  }
+
+  int status_code() const {
+    return status_code_;
+  }
+
+  // Whether the connection can carry another request after this response
+  bool keep_alive() const {
+    return complete() && !close_ && !until_close_;
+  }
+
+ private:
+  enum class State { StatusLine, HeaderLine, Body, BodyUntilClose, ChunkSize, ChunkData, ChunkDataEnd, TrailerLine, Complete, Failed };
+
+  // Takes the next line (ended by LF or CRLF) from data; false if data ends first
+  bool next_line(std::string_view& data, std::string_view& line);
+
+  void parse_status_line(std::string_view line);
+  void parse_field(std::string_view line, bool trailer);
+  void parse_chunk_size(std::string_view line);
+  void end_headers();
+  void fail(std::string message);
+
+  // A 1xx response other than 101, before the final response
+  bool interim() const {
+    return status_code_ / 100 == 1 && status_code_ != 101;
+  }
+
+  static constexpr size_t MAX_HEADER_BYTES = 64 * 1024;
+
+  bool head_request_;
+  State state_ = State::StatusLine;
+  std::string partial_;  // Start of a line split across feeds
+  bool partial_line_ = false;  // The last line returned is in partial_
+  size_t header_bytes_ = 0;
+
+  bool headers_complete_ = false;
+  int status_code_ = 0;
+  bool close_ = false;  // Connection: close, or HTTP/1.0 without keep-alive
+  bool chunked_ = false;
+  bool until_close_ = false;
+  std::optional<uint64_t> content_length_;
+  uint64_t remaining_ = 0;  // Of the body or of the current chunk
+  std::string error_;
+};
+
+}  // namespace agent::net
@@ -1,15 +1,16 @@
 #include "sse_client.hpp"
 
-#include <regex>
 #include <sstream>
 
+#include "http_parser.hpp"
+#include "tls.hpp"
+#include "url.hpp"
+
 namespace agent::net {
 
 class SseClient::Impl {
  public:
-  explicit Impl(asio::io_context& io_ctx) : io_ctx_(io_ctx), ssl_ctx_(asio::ssl::context::tlsv12_client), resolver_(io_ctx) {
-    ssl_ctx_.set_default_verify_paths();
-  }
+  explicit Impl(asio::io_context& io_ctx) : io_ctx_(io_ctx), tls_(TlsContext::shared()), resolver_(io_ctx) {}
 
   void connect(const std::string& url, const std::map<std::string, std::string>& headers, std::function<void(const SseEvent&)> on_event,
                std::function<void(const std::string&)> on_error, std::function<void()> on_complete) {
@@ -17,25 +18,16 @@ class SseClient::Impl {
     on_error_ = std::move(on_error);
     on_complete_ = std::move(on_complete);
 
-    // Parse URL
-    std::regex url_regex(R"(^(https?):\/\/([^:\/\s]+)(?::(\d+))?(\/[^\?\s]*)?(\?[^\s]*)?)");
-    std::smatch match;
-
-    if (!std::regex_match(url, match, url_regex)) {
+    auto parsed = ParsedUrl::parse(url);
+    if (!parsed) {
       if (on_error_) on_error_("Invalid URL");
       return;
     }
 
-    bool is_https = match[1].str() == "https";
-    std::string host = match[2].str();
-    std::string port = match[3].str().empty() ? (is_https ? "443" : "80") : match[3].str();
-    std::string path = match[4].str().empty() ? "/" : match[4].str();
-    std::string query = match[5].str();
-
     // Build request
     std::ostringstream req;
-    req << "GET " << path << query << " HTTP/1.1\r\n";
-    req << "Host: " << host << "\r\n";
+    req << "GET " << parsed->path << parsed->query << " HTTP/1.1\r\n";
+    req << "Host: " << parsed->authority() << "\r\n";
     req << "Accept: text/event-stream\r\n";
     req << "Cache-Control: no-cache\r\n";
     req << "Connection: keep-alive\r\n";
@@ -47,10 +39,10 @@ class SseClient::Impl {
     req << "\r\n";
     request_ = req.str();
 
-    if (is_https) {
-      connect_https(host, port);
+    if (parsed->is_https()) {
+      connect_https(parsed->host, parsed->port_or_default());
     } else {
-      connect_http(host, port);
+      connect_http(parsed->host, parsed->port_or_default());
     }
   }
 
@@ -74,9 +66,9 @@ class SseClient::Impl {
 
  private:
   void connect_https(const std::string& host, const std::string& port) {
-    ssl_socket_ = std::make_unique<asio::ssl::stream<asio::ip::tcp::socket>>(io_ctx_, ssl_ctx_);
+    ssl_socket_ = std::make_unique<asio::ssl::stream<asio::ip::tcp::socket>>(io_ctx_, tls_->context());
 
-    SSL_set_tlsext_host_name(ssl_socket_->native_handle(), host.c_str());
+    tls_->prepare(ssl_socket_->native_handle(), host);
 
     resolver_.async_resolve(host, port, [this](const asio::error_code& ec, auto results) {
       if (ec || stopped_) {
@@ -150,8 +142,7 @@ class SseClient::Impl {
         if (on_error_) on_error_("Read headers failed: " + ec.message());
         return;
       }
-      process_headers();
-      read_events_ssl();
+      if (process_headers()) read_events_ssl();
     });
   }
 
@@ -161,17 +152,31 @@ class SseClient::Impl {
         if (on_error_) on_error_("Read headers failed: " + ec.message());
         return;
       }
-      process_headers();
-      read_events_tcp();
+      if (process_headers()) read_events_tcp();
     });
   }
 
-  void process_headers() {
+  // Consumes the response head; false, with the error reported, unless the
+  // status is 2xx
+  bool process_headers() {
     std::istream stream(&buffer_);
     std::string line;
+    std::getline(stream, line);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    auto status = parse_status_line(line);
     while (std::getline(stream, line) && line != "\r") {
       // Skip headers for now
     }
+
+    if (!status) {
+      if (on_error_) on_error_("Invalid HTTP response: cannot parse status line");
+      return false;
+    }
+    if (status->code < 200 || status->code >= 300) {
+      if (on_error_) on_error_("HTTP " + std::to_string(status->code));
+      return false;
+    }
+    return true;
   }
 
   void read_events_ssl() {
@@ -259,7 +264,7 @@ class SseClient::Impl {
   }
 
   asio::io_context& io_ctx_;
-  asio::ssl::context ssl_ctx_;
+  std::shared_ptr<TlsContext> tls_;
   asio::ip::tcp::resolver resolver_;
 
   std::unique_ptr<asio::ssl::stream<asio::ip::tcp::socket>> ssl_socket_;
@@ -0,0 +1,96 @@
+#include "tls.hpp"
+
+#include <openssl/ssl.h>
+#include <spdlog/spdlog.h>
+
+namespace agent::net {
+
+// Index of the owning TlsContext in SSL_CTX ex data
+static int context_index() {
+  static const int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+  return index;
+}
+
+std::shared_ptr<TlsContext> TlsContext::shared() {
+  static const auto instance = std::make_shared<TlsContext>();
+  return instance;
+}
+
+TlsContext::TlsContext() : context_(asio::ssl::context::tls_client) {
+  auto* ctx = context_.native_handle();
+  SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION);
+  context_.set_default_verify_paths();
+  context_.set_verify_mode(asio::ssl::verify_peer);
+
+  // Sessions are kept here, by host, rather than in OpenSSL's internal
+  // cache, which a client cannot look up by host
+  SSL_CTX_set_ex_data(ctx, context_index(), this);
+  SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(ctx, &TlsContext::on_new_session);
+}
+
+TlsContext::~TlsContext() {
+  clear_sessions();
+}
+
+void TlsContext::prepare(SSL* ssl, const std::string& host) {
+  SSL_set_tlsext_host_name(ssl, host.c_str());
+
+  SSL_SESSION* session = nullptr;
+  {
+    std::lock_guard lock(mutex_);
+    auto it = sessions_.find(host);
+    if (it == sessions_.end()) return;
+    // A copy: OpenSSL marks the session of a connection closed without
+    // close_notify as not resumable, which clients here routinely do
+    session = SSL_SESSION_dup(it->second);
+  }
+  if (session) {
+    SSL_set_session(ssl, session);  // Takes its own reference
+    SSL_SESSION_free(session);
+  }
+}
+
+size_t TlsContext::cached_sessions() const {
+  std::lock_guard lock(mutex_);
+  return sessions_.size();
+}
+
+void TlsContext::clear_sessions() {
+  std::lock_guard lock(mutex_);
+  for (auto& [host, session] : sessions_) {
+    SSL_SESSION_free(session);
+  }
+  sessions_.clear();
+}
+
+// Called by OpenSSL when the server issues a session (with TLS 1.3, after
+// the handshake, as the first response bytes are read). A copy is kept, for
+// the same reason as in prepare().
+int TlsContext::on_new_session(SSL* ssl, SSL_SESSION* issued) {
+  auto* self = static_cast<TlsContext*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), context_index()));
+  const char* host = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+  if (!self || !host || !SSL_SESSION_is_resumable(issued)) {
+    return 0;
+  }
+  SSL_SESSION* session = SSL_SESSION_dup(issued);
+  if (!session) {
+    return 0;
+  }
+
+  std::lock_guard lock(self->mutex_);
+  auto [it, inserted] = self->sessions_.try_emplace(host, session);
+  if (!inserted) {
+    SSL_SESSION_free(it->second);
+    it->second = session;
+  } else if (self->sessions_.size() > MAX_CACHED_HOSTS) {
+    // Rarely reached; any other host makes room
+    auto victim = it == self->sessions_.begin() ? std::next(it) : self->sessions_.begin();
+    SSL_SESSION_free(victim->second);
+    self->sessions_.erase(victim);
+  }
+  spdlog::debug("Cached TLS session for {}", host);
+  return 0;
+}
+
+}  // namespace agent::net
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <asio.hpp>
+#include <asio/ssl.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace agent::net {
+
+// Client TLS settings shared by every HttpClient and SseClient: one SSL
+// context, so the system CA store is read once per process, and a cache of
+// the latest TLS session per host, so that reconnecting to a host resumes
+// its session (an abbreviated handshake) instead of a full one.
+class TlsContext {
+ public:
+  // The process-wide context; clients hold the reference while they live
+  static std::shared_ptr<TlsContext> shared();
+
+  // TLS 1.2 or later, peers verified against the system CA store
+  TlsContext();
+
+  ~TlsContext();
+
+  TlsContext(const TlsContext&) = delete;
+  TlsContext& operator=(const TlsContext&) = delete;
+
+  asio::ssl::context& context() {
+    return context_;
+  }
+
+  // Before the handshake: sets SNI and offers the host's cached session
+  void prepare(SSL* ssl, const std::string& host);
+
+  size_t cached_sessions() const;
+
+  void clear_sessions();
+
+ private:
+  static int on_new_session(SSL* ssl, SSL_SESSION* session);
+
+  static constexpr size_t MAX_CACHED_HOSTS = 256;
+
+  asio::ssl::context context_;
+  mutable std::mutex mutex_;
+  std::map<std::string, SSL_SESSION*> sessions_;  // By SNI host name, owned
+};
+
+}  // namespace agent::net
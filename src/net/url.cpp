@@ -0,0 +1,174 @@
+#include "url.hpp"
+
+#include <algorithm>
+
+namespace agent::net {
+
+static int hex_value(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// Control characters and spaces end a URL in the wild; inside one they would
+// break the request line
+static bool is_forbidden(char c) {
+  auto byte = static_cast<unsigned char>(c);
+  return byte <= 0x20 || byte == 0x7f;
+}
+
+static bool equals_lower(std::string_view text, std::string_view lower) {
+  if (text.size() != lower.size()) return false;
+  for (size_t i = 0; i < text.size(); ++i) {
+    char c = text[i] >= 'A' && text[i] <= 'Z' ? static_cast<char>(text[i] | 0x20) : text[i];
+    if (c != lower[i]) return false;
+  }
+  return true;
+}
+
+// Every '%' starts a valid escape
+static bool valid_escapes(std::string_view text) {
+  for (size_t i = text.find('%'); i != std::string_view::npos; i = text.find('%', i + 3)) {
+    if (i + 2 >= text.size() || hex_value(text[i + 1]) < 0 || hex_value(text[i + 2]) < 0) return false;
+  }
+  return true;
+}
+
+bool percent_decode(std::string_view text, std::string& out) {
+  out.reserve(out.size() + text.size());
+  while (!text.empty()) {
+    auto escape = text.find('%');
+    out.append(text.substr(0, escape));
+    if (escape == std::string_view::npos) break;
+    if (escape + 2 >= text.size()) return false;
+    int high = hex_value(text[escape + 1]);
+    int low = hex_value(text[escape + 2]);
+    if (high < 0 || low < 0) return false;
+    out.push_back(static_cast<char>(high * 16 + low));
+    text.remove_prefix(escape + 3);
+  }
+  return true;
+}
+
+// Hex digits, colons and dots, with at least one colon; a zone id may
+// follow as "%25" and a name
+static bool valid_ipv6(std::string_view literal) {
+  auto zone = literal.find('%');
+  auto address = literal.substr(0, zone);
+  if (address.find(':') == std::string_view::npos) return false;
+  for (char c : address) {
+    if (c != ':' && c != '.' && hex_value(c) < 0) return false;
+  }
+  if (zone == std::string_view::npos) return true;
+  return literal.substr(zone).starts_with("%25") && literal.size() > zone + 3;
+}
+
+// Decimal, 0-65535
+static bool valid_port(std::string_view port) {
+  if (port.empty() || port.size() > 5) return false;
+  unsigned value = 0;
+  for (char c : port) {
+    if (c < '0' || c > '9') return false;
+    value = value * 10 + static_cast<unsigned>(c - '0');
+  }
+  return value <= 65535;
+}
+
+std::optional<ParsedUrl> ParsedUrl::parse(std::string_view url) {
+  auto separator = url.find("://");
+  if (separator == std::string_view::npos) return std::nullopt;
+  auto scheme = url.substr(0, separator);
+  bool https = equals_lower(scheme, "https");
+  if (!https && !equals_lower(scheme, "http")) return std::nullopt;
+  auto rest = url.substr(separator + 3);
+  for (char c : rest) {
+    if (is_forbidden(c)) return std::nullopt;
+  }
+
+  ParsedUrl result;
+  result.scheme = https ? "https" : "http";
+
+  // Authority: up to the path, query or fragment
+  auto authority_end = std::min(rest.find_first_of("/?#"), rest.size());
+  auto authority = rest.substr(0, authority_end);
+  rest.remove_prefix(authority_end);
+
+  // The last '@' ends the userinfo: the host cannot have one
+  auto at = authority.rfind('@');
+  if (at != std::string_view::npos) {
+    if (!percent_decode(authority.substr(0, at), result.userinfo)) return std::nullopt;
+    authority.remove_prefix(at + 1);
+  }
+
+  std::string_view port;
+  bool has_port = false;
+  if (authority.starts_with('[')) {
+    auto close = authority.find(']');
+    if (close == std::string_view::npos) return std::nullopt;
+    auto literal = authority.substr(1, close - 1);
+    if (!valid_ipv6(literal) || !percent_decode(literal, result.host)) return std::nullopt;
+    auto after = authority.substr(close + 1);
+    if (!after.empty()) {
+      if (after.front() != ':') return std::nullopt;
+      has_port = true;
+      port = after.substr(1);
+    }
+  } else {
+    auto colon = authority.find(':');
+    if (colon != std::string_view::npos) {
+      has_port = true;
+      port = authority.substr(colon + 1);
+    }
+    auto host = authority.substr(0, colon);
+    if (host.empty() || !percent_decode(host, result.host)) return std::nullopt;
+    // Decoded, a name still cannot hold what would split it up again
+    for (char c : result.host) {
+      if (is_forbidden(c) || std::string_view(":/?#@[]").find(c) != std::string_view::npos) return std::nullopt;
+    }
+  }
+  if (has_port) {
+    if (!valid_port(port)) return std::nullopt;
+    result.port = port;
+  }
+
+  // Path and query stay encoded; the fragment is not sent
+  rest = rest.substr(0, rest.find('#'));
+  auto query_start = std::min(rest.find('?'), rest.size());
+  auto path = rest.substr(0, query_start);
+  auto query = rest.substr(query_start);
+  if (!valid_escapes(path) || !valid_escapes(query)) return std::nullopt;
+  result.path = path.empty() ? std::string_view("/") : path;
+  result.query = query;
+  return result;
+}
+
+std::string ParsedUrl::port_or_default() const {
+  if (!port.empty()) return port;
+  return is_https() ? "443" : "80";
+}
+
+std::string ParsedUrl::authority() const {
+  std::string authority;
+  authority.reserve(host.size() + port.size() + 3);
+  if (is_ipv6()) {
+    authority += '[';
+    for (char c : host) {
+      if (c == '%') {
+        authority += "%25";  // Before a zone id
+      } else {
+        authority += c;
+      }
+    }
+    authority += ']';
+  } else {
+    authority += host;
+  }
+  if (!port.empty()) {
+    authority += ':';
+    authority += port;
+  }
+  return authority;
+}
+
+}  // namespace agent::net
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace agent::net {
+
+// An http or https URL (RFC 3986), split up for sending a request:
+//
+//   scheme://[userinfo@]host[:port][/path][?query][#fragment]
+//
+// The scheme is matched without regard to case and kept in lower case. An
+// IPv6 literal is written in brackets and kept without them. Percent escapes
+// are checked everywhere: userinfo and host are decoded, path and query are
+// kept encoded, as they go on the wire. The fragment is dropped.
+struct ParsedUrl {
+  std::string scheme;
+  std::string userinfo;  // Decoded; not sent
+  std::string host;
+  std::string port;  // Empty when the URL has none
+  std::string path;  // "/" when the URL has none
+  std::string query;  // With its '?', or empty
+
+  bool is_https() const {
+    return scheme == "https";
+  }
+
+  bool is_ipv6() const {
+    return host.find(':') != std::string::npos;
+  }
+
+  std::string port_or_default() const;
+
+  // host[:port], an IPv6 literal in brackets: for Host and :authority
+  std::string authority() const;
+
+  static std::optional<ParsedUrl> parse(std::string_view url);
+};
+
+// Appends text to out with its %XX escapes decoded; false if one is malformed
+bool percent_decode(std::string_view text, std::string& out);
+
+}  // namespace agent::net
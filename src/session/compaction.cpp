@@ -1,3 +1,3 @@
 // Stub file: context compaction logic is implemented in session.cpp
-// (needs_compaction, trigger_compaction, handle_compaction, collect_messages_for_compaction, stream_compaction).
+// (needs_compaction, trigger_compaction, handle_compaction, plan_compaction, run_compaction).
 // This file exists because CMakeLists.txt references it; do not add code here.
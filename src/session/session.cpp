@@ -2,16 +2,25 @@
 
 #include <spdlog/spdlog.h>
 
+#include <algorithm>
 #include <fstream>
 #include <functional>
 #include <sstream>
+#include <thread>
 
 #include "bus/bus.hpp"
+#include "core/tokenizer.hpp"
 #include "llm/anthropic.hpp"
+#include "tool/executor.hpp"
 #include "tool/permission.hpp"
 
 namespace agent {
 
+// Marker of a summary still being written in the background
+static bool is_pending_summary(const Message& msg) {
+  return msg.is_summary() && !msg.is_finished();
+}
+
 std::string to_string(SessionState state) {
   switch (state) {
     case SessionState::Idle:
@@ -63,6 +72,9 @@ Session::Session(asio::io_context& io_ctx, const Config& config, AgentType agent
     }
   }
 
+  auto model_info = provider_ ? provider_->get_model(model_name) : std::nullopt;
+  tokenizer_ = TokenizerRegistry::instance().get(model_info ? model_info->tokenizer : "");
+
   // Inject AGENTS.md / CLAUDE.md instructions into system_prompt
   auto instruction_files = config_paths::find_agent_instructions(config.working_dir);
   if (!instruction_files.empty()) {
@@ -117,6 +129,13 @@ void Session::add_message(Message msg) {
 
   const auto& added = messages_.back();
 
+  // A finished summary starts a new context window
+  if (added.is_summary() && added.is_finished()) {
+    context_begin_ = messages_.size() - 1;
+    context_tokens_ = 0;
+  }
+  context_tokens_ += count_message_tokens(*tokenizer_, added);
+
   // Persist to store
   if (store_) {
     store_->save(added);
@@ -139,39 +158,39 @@ void Session::add_message(Message msg) {
   }
 }
 
-std::vector<Message> Session::get_context_messages() const {
-  // Find most recent summary, return summary + everything after it
-  int summary_index = -1;
-  for (int i = static_cast<int>(messages_.size()) - 1; i >= 0; --i) {
-    if (messages_[i].is_summary() && messages_[i].is_finished()) {
-      summary_index = i;
-      break;
-    }
-  }
+std::span<const Message> Session::context_view() const {
+  return std::span<const Message>(messages_).subspan(context_begin_);
+}
 
-  if (summary_index < 0) {
-    // No summary found, return all messages
-    return messages_;
+std::vector<Message> Session::get_context_messages() const {
+  std::vector<Message> result;
+  for (const auto& msg : context_view()) {
+    if (!is_pending_summary(msg)) result.push_back(msg);
   }
+  return result;
+}
 
-  // Return summary + all messages after it
-  return std::vector<Message>(messages_.begin() + summary_index, messages_.end());
+bool Session::compaction_in_progress() const {
+  return pending_compaction_ && pending_compaction_->ready.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
 }
 
 int64_t Session::estimated_context_tokens() const {
-  // Rough estimation: 4 chars per token
-  int64_t total = 0;
-  for (const auto& msg : messages_) {
-    total += msg.text().size() / 4;
-    for (const auto& part : msg.parts()) {
-      if (auto* tr = std::get_if<ToolResultPart>(&part)) {
-        if (!tr->compacted) {
-          total += tr->output.size() / 4;
-        }
-      }
+  return context_tokens_;
+}
+
+void Session::recount_context() {
+  context_begin_ = 0;
+  for (size_t i = messages_.size(); i-- > 0;) {
+    if (messages_[i].is_summary() && messages_[i].is_finished()) {
+      context_begin_ = i;
+      break;
     }
   }
-  return total;
+
+  context_tokens_ = 0;
+  for (const auto& msg : context_view()) {
+    context_tokens_ += count_message_tokens(*tokenizer_, msg);
+  }
 }
 
 int64_t Session::context_window() const {
@@ -185,7 +204,30 @@ void Session::prompt(const std::string& text) {
 
 void Session::prompt(Message user_msg) {
   add_message(std::move(user_msg));
-  run_loop();
+  loop_executor_.reset();
+  run_blocking(run_loop());
+}
+
+asio::awaitable<void> Session::async_prompt(Message user_msg) {
+  add_message(std::move(user_msg));
+  loop_executor_ = co_await asio::this_coro::executor;
+  co_await run_loop();
+}
+
+void Session::start_prompt(Message user_msg) {
+  asio::co_spawn(
+      asio::make_strand(io_ctx_),
+      [self = shared_from_this(), user_msg = std::move(user_msg)]() mutable {
+        return self->async_prompt(std::move(user_msg));
+      },
+      [id = id_](std::exception_ptr error) {
+        if (!error) return;
+        try {
+          std::rethrow_exception(error);
+        } catch (const std::exception& e) {
+          spdlog::error("Session {} loop failed: {}", id, e.what());
+        }
+      });
 }
 
 void Session::cancel() {
@@ -204,7 +246,7 @@ void Session::cancel() {
   }
 }
 
-void Session::run_loop() {
+asio::awaitable<void> Session::run_loop() {
   // Reset abort signal for new run
   abort_signal_->store(false);
   state_ = SessionState::Running;
@@ -215,11 +257,17 @@ void Session::run_loop() {
   while (!abort_signal_->load() && step < max_steps) {
     step++;
 
-    auto context_msgs = get_context_messages();
+    // A summary written in the background meanwhile now starts the context
+    co_await finish_background_compaction(false);
 
-    // Find last assistant message
+    auto context_msgs = context_view();
+
+    // Find last message and last assistant message (ignoring a pending summary marker)
+    const Message* last_message = nullptr;
     const Message* last_assistant = nullptr;
     for (auto it = context_msgs.rbegin(); it != context_msgs.rend(); ++it) {
+      if (is_pending_summary(*it)) continue;
+      if (!last_message) last_message = &(*it);
       if (it->role() == Role::Assistant) {
         last_assistant = &(*it);
         break;
@@ -227,7 +275,7 @@ void Session::run_loop() {
     }
 
     // Check if the last message is from user (needs response)
-    bool needs_response = !context_msgs.empty() && context_msgs.back().role() == Role::User;
+    bool needs_response = last_message && last_message->role() == Role::User;
 
     // Check exit condition - stop if assistant has finished without requesting tools
     // AND there's no pending user message that needs a response
@@ -238,23 +286,31 @@ void Session::run_loop() {
 
     // Check for context overflow
     if (needs_compaction()) {
-      handle_compaction();
+      co_await handle_compaction();
       continue;
     }
 
+    bool pending_tool_calls = last_assistant && last_assistant->finish_reason() == FinishReason::ToolCalls;
+
+    // Only at a user message, so the messages kept after the summary start
+    // with the response (never with a tool result whose call was summarized)
+    if (needs_response && wants_background_compaction()) {
+      start_background_compaction();
+    }
+
     // If we have pending tool calls, execute them first
-    if (last_assistant && last_assistant->finish_reason() == FinishReason::ToolCalls) {
-      execute_tool_calls();
+    if (pending_tool_calls) {
+      co_await execute_tool_calls();
     }
 
     // Process LLM - get next response
-    process_stream();
+    co_await process_stream();
 
     // Check if the new response has tool calls
     if (!messages_.empty() && messages_.back().role() == Role::Assistant) {
       auto& new_assistant = messages_.back();
       if (new_assistant.finish_reason() == FinishReason::ToolCalls) {
-        execute_tool_calls();
+        co_await execute_tool_calls();
       }
     }
   }
@@ -278,11 +334,11 @@ void Session::run_loop() {
   Bus::instance().publish(events::SessionEnded{id_});
 }
 
-void Session::process_stream() {
+asio::awaitable<void> Session::process_stream() {
   if (!provider_) {
     if (on_error_) on_error_("No LLM provider configured");
     state_ = SessionState::Failed;
-    return;
+    co_return;
   }
 
   // Build request
@@ -290,15 +346,14 @@ void Session::process_stream() {
   request.model = agent_config_.model;
   request.system_prompt = agent_config_.system_prompt;
   request.messages = get_context_messages();
+  request.prompt_cache = config_.prompt_cache;
 
-  // Get available tools
-  for (const auto& tool : ToolRegistry::instance().for_agent(agent_config_)) {
-    request.tools.push_back(tool);
-  }
+  // Get available tools (definitions are serialized once per registry generation)
+  request.tool_schemas = ToolRegistry::instance().schemas_for_agent(agent_config_);
+  request.tools = request.tool_schemas->tools();
 
   // Use streaming API for real-time output
-  std::promise<void> stream_complete;
-  auto stream_future = stream_complete.get_future();
+  auto stream_complete = std::make_shared<AsyncEvent>();
 
   // Build message as we receive stream events
   std::string accumulated_text;
@@ -314,11 +369,20 @@ void Session::process_stream() {
   };
   std::vector<ToolCallBuilder> tool_call_builders;
 
+  // Message being built; created up front so speculative tool calls know its id
+  Message msg(Role::Assistant, "");
+  std::vector<ToolInvocation> streamed_calls;
+  auto on_tool_call_complete = [this, &msg, &streamed_calls](const llm::ToolCallComplete& call) {
+    if (config_.tools.speculative) {
+      start_speculative_call(call, msg.id(), streamed_calls);
+    }
+  };
+
   provider_->stream(
       request,
-      [this, &accumulated_text, &usage, &finish_reason, &error_message, &tool_call_builders](const llm::StreamEvent& event) {
+      [this, &accumulated_text, &usage, &finish_reason, &error_message, &tool_call_builders, &on_tool_call_complete](const llm::StreamEvent& event) {
         std::visit(
-            [this, &accumulated_text, &usage, &finish_reason, &error_message, &tool_call_builders](auto&& e) {
+            [this, &accumulated_text, &usage, &finish_reason, &error_message, &tool_call_builders, &on_tool_call_complete](auto&& e) {
               using T = std::decay_t<decltype(e)>;
 
               if constexpr (std::is_same_v<T, llm::TextDelta>) {
@@ -355,6 +419,7 @@ void Session::process_stream() {
                       on_tool_call_(builder.name, e.arguments);
                     }
                     Bus::instance().publish(events::ToolCallStarted{id_, builder.id, builder.name});
+                    on_tool_call_complete({builder.id, builder.name, e.arguments});
                     found = true;
                     break;
                   }
@@ -366,6 +431,7 @@ void Session::process_stream() {
                     on_tool_call_(e.name, e.arguments);
                   }
                   Bus::instance().publish(events::ToolCallStarted{id_, e.id, e.name});
+                  on_tool_call_complete(e);
                 }
               } else if constexpr (std::is_same_v<T, llm::FinishStep>) {
                 finish_reason = e.reason;
@@ -376,24 +442,28 @@ void Session::process_stream() {
             },
             event);
       },
-      [&stream_complete]() {
-        stream_complete.set_value();
+      [stream_complete]() {
+        stream_complete->notify();
       });
 
   // Wait for stream to complete
-  stream_future.wait();
+  co_await stream_complete->async_wait(asio::use_awaitable);
 
   // Check for errors
   if (error_message) {
+    // Results of speculative calls are dropped with the response
+    speculative_calls_.clear();
     if (on_error_) {
       on_error_(*error_message);
     }
     state_ = SessionState::Failed;
-    return;
+    co_return;
+  }
+  if (abort_signal_->load()) {
+    speculative_calls_.clear();
   }
 
   // Finalize message - build from accumulated data
-  Message msg(Role::Assistant, "");
 
   // Add accumulated text
   if (!accumulated_text.empty()) {
@@ -420,26 +490,37 @@ void Session::process_stream() {
 
   total_usage_ += usage;
 
-  Bus::instance().publish(events::TokensUsed{id_, usage.input_tokens, usage.output_tokens});
+  Bus::instance().publish(events::TokensUsed{id_, usage.input_tokens, usage.output_tokens, usage.cache_read_tokens, usage.cache_write_tokens});
 
   // Add the completed message
   add_message(std::move(msg));
 }
 
-void Session::execute_tool_calls() {
-  if (messages_.empty()) return;
+asio::awaitable<void> Session::execute_tool_calls() {
+  if (messages_.empty()) co_return;
 
   auto& last_msg = messages_.back();
-  if (last_msg.role() != Role::Assistant) return;
+  if (last_msg.role() != Role::Assistant) co_return;
 
   auto tool_calls = last_msg.tool_calls();
-  if (tool_calls.empty()) return;
+  if (tool_calls.empty()) co_return;
 
   state_ = SessionState::WaitingForTool;
 
   // Create user message for tool results
   Message result_msg(Role::User, "");
 
+  // Resolve and authorize calls in order (permission prompts stay sequential);
+  // approved calls then run as one batch. Rejected calls keep their error.
+  struct PendingCall {
+    ToolCallPart* tc;
+    std::optional<std::string> rejection;
+    size_t invocation = 0;  // Index into invocations
+  };
+  std::vector<PendingCall> pending;
+  std::vector<ToolInvocation> invocations;
+  std::vector<ToolCallPart*> invoked;  // Parallel to invocations
+
   for (auto* tc : tool_calls) {
     if (tc->completed) continue;
 
@@ -452,8 +533,7 @@ void Session::execute_tool_calls() {
     // Get tool
     auto tool = ToolRegistry::instance().get(tc->name);
     if (!tool) {
-      result_msg.add_tool_result(tc->id, tc->name, "Tool not found: " + tc->name, true);
-      tc->completed = true;
+      pending.push_back({tc, "Tool not found: " + tc->name});
       continue;
     }
 
@@ -461,16 +541,14 @@ void Session::execute_tool_calls() {
     auto perm = PermissionManager::instance().check_permission(tc->name, agent_config_);
     if (perm == Permission::Deny) {
       spdlog::info("Permission denied for tool: {}", tc->name);
-      result_msg.add_tool_result(tc->id, tc->name, "Permission denied: tool '" + tc->name + "' is not allowed", true);
-      tc->completed = true;
+      pending.push_back({tc, "Permission denied: tool '" + tc->name + "' is not allowed"});
       continue;
     }
     if (perm == Permission::Ask) {
       bool allowed = true;  // Default allow for non-interactive mode
       if (permission_handler_) {
         try {
-          auto future = permission_handler_(tc->name, "Tool '" + tc->name + "' requires permission to execute");
-          allowed = future.get();
+          allowed = co_await await_future(permission_handler_(tc->name, "Tool '" + tc->name + "' requires permission to execute"));
         } catch (const std::exception& e) {
           spdlog::warn("Permission handler error for tool {}: {}", tc->name, e.what());
           allowed = false;
@@ -479,63 +557,55 @@ void Session::execute_tool_calls() {
       if (!allowed) {
         spdlog::info("User denied permission for tool: {}", tc->name);
         PermissionManager::instance().deny(tc->name);
-        result_msg.add_tool_result(tc->id, tc->name, "Permission denied: tool '" + tc->name + "' is not allowed", true);
-        tc->completed = true;
+        pending.push_back({tc, "Permission denied: tool '" + tc->name + "' is not allowed"});
         continue;
       }
       PermissionManager::instance().grant(tc->name);
     }
 
-    // Build context
-    ToolContext ctx;
-    ctx.session_id = id_;
-    ctx.message_id = last_msg.id();
-    ctx.working_dir = config_.working_dir.string();
-    ctx.abort_signal = abort_signal_;
-    ctx.ask_permission = permission_handler_;
-    ctx.question_handler = question_handler_;
+    ToolInvocation invocation{tool, tc->arguments, make_tool_context(last_msg.id())};
 
-    // Provide child session creation callback for Task tool
-    auto self = shared_from_this();
-    ctx.create_child_session = [self](AgentType agent_type) {
-      return self->create_child(agent_type);
-    };
+    // Reuse a speculative run with the same arguments
+    auto speculative = speculative_calls_.find(tc->id);
+    if (speculative != speculative_calls_.end() && speculative->second.arguments == tc->arguments) {
+      invocation.started = speculative->second.result;
+    }
 
-    // Execute tool
     tc->started = true;
+    pending.push_back({tc, std::nullopt, invocations.size()});
+    invocations.push_back(std::move(invocation));
+    invoked.push_back(tc);
+  }
+  speculative_calls_.clear();
 
-    try {
-      auto future_result = tool->execute(tc->arguments, ctx);
-      auto result = future_result.get();
-
-      // Truncate if needed
-      auto truncated = Truncate::save_and_truncate(result.output, tc->name);
-
-      // Sanitize invalid UTF-8 bytes to prevent JSON serialization errors
-      auto safe_content = sanitize_utf8(truncated.content);
-
-      result_msg.add_tool_result(tc->id, tc->name, safe_content, result.is_error);
-
-      // Notify tool result callback
-      if (on_tool_result_) {
-        on_tool_result_(tc->name, safe_content, result.is_error);
-      }
-
-      Bus::instance().publish(events::ToolCallCompleted{id_, tc->id, tc->name, !result.is_error});
+  // Execute tools; independent calls overlap
+  std::vector<std::string> outputs(invocations.size());
+  auto results = co_await async_execute_tool_batch(invocations, config_.tools.max_parallel, [&](size_t index, const ToolResult& result) {
+    const auto& tc = *invoked[index];
 
-    } catch (const std::exception& e) {
-      std::string error_msg = std::string("Error: ") + e.what();
-      result_msg.add_tool_result(tc->id, tc->name, error_msg, true);
+    // Truncate if needed
+    auto truncated = Truncate::save_and_truncate(result.output, tc.name);
 
-      // Notify tool result callback
-      if (on_tool_result_) {
-        on_tool_result_(tc->name, error_msg, true);
-      }
+    // Sanitize invalid UTF-8 bytes to prevent JSON serialization errors
+    outputs[index] = sanitize_utf8(truncated.content);
 
-      Bus::instance().publish(events::ToolCallCompleted{id_, tc->id, tc->name, false});
+    // Notify tool result callback
+    if (on_tool_result_) {
+      on_tool_result_(tc.name, outputs[index], result.is_error);
     }
 
+    Bus::instance().publish(events::ToolCallCompleted{id_, tc.id, tc.name, !result.is_error});
+  });
+
+  // Results in call order
+  for (const auto& call : pending) {
+    auto* tc = call.tc;
     tc->completed = true;
+    if (call.rejection) {
+      result_msg.add_tool_result(tc->id, tc->name, *call.rejection, true);
+      continue;
+    }
+    result_msg.add_tool_result(tc->id, tc->name, outputs[call.invocation], results[call.invocation].is_error);
 
     // Track for doom loop detection
     recent_tool_calls_.push_back({tc->name, tc->arguments.dump()});
@@ -552,14 +622,65 @@ void Session::execute_tool_calls() {
   state_ = SessionState::Running;
 }
 
+ToolContext Session::make_tool_context(const MessageId& message_id) {
+  ToolContext ctx;
+  ctx.session_id = id_;
+  ctx.message_id = message_id;
+  ctx.working_dir = config_.working_dir.string();
+  ctx.abort_signal = abort_signal_;
+  ctx.ask_permission = permission_handler_;
+  ctx.question_handler = question_handler_;
+
+  // Provide child session creation callback for Task tool
+  auto self = shared_from_this();
+  ctx.create_child_session = [self](AgentType agent_type) {
+    return self->create_child(agent_type);
+  };
+  return ctx;
+}
+
+void Session::start_speculative_call(const llm::ToolCallComplete& call, const MessageId& message_id, std::vector<ToolInvocation>& streamed) {
+  auto tool = ToolRegistry::instance().get(call.name);
+  if (!tool || !call.arguments.is_object()) {
+    // Unknown calls fail later without running; later calls still wait for their turn
+    streamed.push_back({nullptr, call.arguments, {}});
+    return;
+  }
+
+  ToolInvocation invocation{tool, call.arguments, make_tool_context(message_id)};
+  bool independent = std::none_of(streamed.begin(), streamed.end(), [&](const ToolInvocation& earlier) {
+    return !earlier.tool || tool_calls_conflict(earlier, invocation);
+  });
+  // Calls that need a permission prompt wait for execute_tool_calls()
+  bool allowed = PermissionManager::instance().check_permission(call.name, agent_config_) == Permission::Allow;
+
+  if (independent && allowed && tool->parallel_safe() && !abort_signal_->load()) {
+    spdlog::debug("Session {} starting {} ({}) speculatively", id_, call.name, call.id);
+    try {
+      speculative_calls_[call.id] = {call.arguments, tool->execute(call.arguments, invocation.ctx).share()};
+    } catch (const std::exception& e) {
+      spdlog::warn("Speculative {} failed to start: {}", call.name, e.what());
+    }
+  }
+  streamed.push_back(std::move(invocation));
+}
+
 bool Session::needs_compaction() const {
   auto model_info = provider_ ? provider_->get_model(agent_config_.model) : std::nullopt;
   int64_t limit = model_info ? model_info->context_window : 100000;
 
-  return estimated_context_tokens() > limit * 0.8;  // 80% threshold
+  return estimated_context_tokens() > limit * config_.context.compact_blocking_ratio;
 }
 
-void Session::trigger_compaction() {
+bool Session::wants_background_compaction() const {
+  const auto& settings = config_.context;
+  if (pending_compaction_ || !provider_ || settings.compact_background_ratio >= settings.compact_blocking_ratio) {
+    return false;
+  }
+  return estimated_context_tokens() > context_window() * settings.compact_background_ratio;
+}
+
+asio::awaitable<void> Session::trigger_compaction() {
   state_ = SessionState::Compacting;
   spdlog::info("Session {} triggering compaction", id_);
 
@@ -567,138 +688,123 @@ void Session::trigger_compaction() {
     // No provider available, fall back to pruning only
     prune_old_outputs();
     state_ = SessionState::Running;
-    return;
+    co_return;
   }
 
-  // 1. Collect messages to summarize
-  auto messages_to_summarize = collect_messages_for_compaction();
+  // 1. Split what follows the latest summary into bounded chunks
+  auto plan = plan_compaction();
 
-  if (messages_to_summarize.empty()) {
+  if (plan.chunks.empty()) {
     prune_old_outputs();
     state_ = SessionState::Running;
-    return;
+    co_return;
   }
 
-  // 2. Build compaction request
-  llm::LlmRequest request;
-  request.model = agent_config_.model;
-  request.system_prompt =
-      "You are a conversation summarizer. Summarize the following conversation into a concise summary "
-      "that preserves all important context, decisions made, code changes, file paths, and any ongoing tasks. "
-      "The summary will be used to continue the conversation, so include all information needed to pick up "
-      "where the conversation left off.\n\n"
-      "Format your summary as a structured overview:\n"
-      "- **Topic/Goal**: What the user is working on\n"
-      "- **Progress**: What has been done so far\n"
-      "- **Key Decisions**: Important choices made\n"
-      "- **Current State**: Where things stand now\n"
-      "- **Pending Items**: What still needs to be done (if any)";
-  request.messages = std::move(messages_to_summarize);
-  // No tools for compaction agent
-
-  // 3. Call LLM to generate summary
-  std::string summary_text = stream_compaction(request);
+  // 2. Summarize the chunks and fold the oldest leaves into the root
+  auto nodes = co_await run_compaction(provider_, agent_config_.model, std::move(plan), config_.context.compact_max_leaves);
 
-  if (summary_text.empty()) {
+  if (!nodes) {
     spdlog::warn("Session {} compaction failed, falling back to prune", id_);
     prune_old_outputs();
     state_ = SessionState::Running;
-    return;
+    co_return;
   }
 
-  // 4. Create summary message
+  // 3. Create summary message: the root, then the leaves
   Message summary_msg(Role::Assistant, "");
-  summary_msg.add_text(summary_text);
+  for (const auto& node : *nodes) {
+    summary_msg.add_text(node);
+  }
   summary_msg.set_summary(true);
   summary_msg.set_finished(true);
   summary_msg.set_synthetic(true);
 
-  // 5. Add summary message (auto-persists via store)
+  // 4. Add summary message (auto-persists via store)
   add_message(std::move(summary_msg));
 
-  // 6. Prune old tool outputs
+  // 5. Prune old tool outputs
   prune_old_outputs();
 
   state_ = SessionState::Running;
   spdlog::info("Session {} compaction completed", id_);
 }
 
-std::vector<Message> Session::collect_messages_for_compaction() const {
-  // Find the most recent summary
-  int summary_index = -1;
-  for (int i = static_cast<int>(messages_.size()) - 1; i >= 0; --i) {
-    if (messages_[i].is_summary() && messages_[i].is_finished()) {
-      summary_index = i;
-      break;
-    }
+static constexpr const char* SUMMARIZER_PROMPT =
+    "You are a conversation summarizer. Summarize the following conversation into a concise summary "
+    "that preserves all important context, decisions made, code changes, file paths, and any ongoing tasks. "
+    "The summary will be used to continue the conversation, so include all information needed to pick up "
+    "where the conversation left off.\n\n"
+    "Format your summary as a structured overview:\n"
+    "- **Topic/Goal**: What the user is working on\n"
+    "- **Progress**: What has been done so far\n"
+    "- **Key Decisions**: Important choices made\n"
+    "- **Current State**: Where things stand now\n"
+    "- **Pending Items**: What still needs to be done (if any)";
+
+static constexpr size_t TOOL_OUTPUT_EXCERPT = 500;
+
+// Appends msg as the summarizer sees it, at most max_bytes of it
+static void append_transcript(std::string& out, const Message& msg, size_t max_bytes) {
+  const size_t start = out.size();
+
+  auto text = msg.text();
+  if (!text.empty()) {
+    out += msg.role() == Role::User ? "User: " : "Assistant: ";
+    out += text;
+    out += "\n\n";
   }
 
-  // Collect all messages (or all since last summary) to be summarized
-  // We pass the full context to the LLM so it can generate a comprehensive summary
-  std::vector<Message> result;
-
-  if (summary_index >= 0) {
-    // Include old summary + everything after it (to create a new combined summary)
-    for (int i = summary_index; i < static_cast<int>(messages_.size()); ++i) {
-      result.push_back(messages_[i]);
-    }
-  } else {
-    // No summary exists, include all messages
-    result = messages_;
+  // Include tool calls briefly
+  for (const auto* tc : msg.tool_calls()) {
+    out += "[Tool call: ";
+    out += tc->name;
+    out += "(";
+    out += tc->arguments.dump();
+    out += ")]\n";
   }
 
-  // Convert to a single user message containing the conversation for the summarizer
-  if (result.empty()) return {};
-
-  std::string conversation_text;
-  for (const auto& msg : result) {
-    if (msg.role() == Role::System) continue;
-
-    if (msg.is_summary()) {
-      conversation_text += "[Previous Summary]\n" + msg.text() + "\n\n";
+  // Include tool results briefly (skip compacted ones)
+  for (const auto* tr : msg.tool_results()) {
+    out += "[Tool result: ";
+    out += tr->tool_name;
+    if (tr->compacted) {
+      out += " (content cleared)]\n";
       continue;
     }
-
-    std::string role_str = (msg.role() == Role::User) ? "User" : "Assistant";
-    auto text = msg.text();
-
-    if (!text.empty()) {
-      conversation_text += role_str + ": " + text + "\n\n";
-    }
-
-    // Include tool calls briefly
-    for (const auto* tc : msg.tool_calls()) {
-      conversation_text += "[Tool call: " + tc->name + "(" + tc->arguments.dump() + ")]\n";
+    out += "]\n";
+    const std::string& output = tr->output.str();
+    if (output.size() > TOOL_OUTPUT_EXCERPT) {
+      out.append(output, 0, TOOL_OUTPUT_EXCERPT);
+      out += "... (truncated)";
+    } else {
+      out += output;
     }
+    out += "\n\n";
+  }
 
-    // Include tool results briefly (skip compacted ones)
-    for (const auto* tr : msg.tool_results()) {
-      if (tr->compacted) {
-        conversation_text += "[Tool result: " + tr->tool_name + " (content cleared)]\n";
-      } else {
-        auto output = tr->output;
-        if (output.size() > 500) {
-          output = output.substr(0, 500) + "... (truncated)";
-        }
-        conversation_text += "[Tool result: " + tr->tool_name + "]\n" + output + "\n\n";
-      }
-    }
+  if (out.size() - start > max_bytes) {
+    out.resize(start + max_bytes);
+    out += "... (truncated)\n\n";
   }
+}
 
-  // Return as a single user message asking for a summary
-  std::vector<Message> compaction_messages;
-  compaction_messages.push_back(Message::user("Please summarize the following conversation:\n\n" + conversation_text));
-  return compaction_messages;
+static llm::LlmRequest summary_request(const std::string& model, const std::string& prompt) {
+  llm::LlmRequest request;
+  request.model = model;
+  request.system_prompt = SUMMARIZER_PROMPT;
+  request.messages.push_back(Message::user(prompt));
+  // No tools for compaction agent
+  return request;
 }
 
-std::string Session::stream_compaction(const llm::LlmRequest& request) {
-  std::promise<void> done;
-  auto done_future = done.get_future();
+// Streams one summary; empty on error
+static asio::awaitable<std::string> stream_summary(llm::Provider& provider, llm::LlmRequest request) {
+  auto done = std::make_shared<AsyncEvent>();
 
   std::string accumulated_text;
   std::optional<std::string> error_message;
 
-  provider_->stream(
+  provider.stream(
       request,
       [&accumulated_text, &error_message](const llm::StreamEvent& event) {
         std::visit(
@@ -713,22 +819,189 @@ std::string Session::stream_compaction(const llm::LlmRequest& request) {
             },
             event);
       },
-      [&done]() {
-        done.set_value();
+      [done]() {
+        done->notify();
       });
 
-  done_future.wait();
+  co_await done->async_wait(asio::use_awaitable);
 
   if (error_message) {
     spdlog::warn("Compaction stream error: {}", *error_message);
-    return "";
+    co_return "";
+  }
+
+  co_return accumulated_text;
+}
+
+Session::CompactionPlan Session::plan_compaction() const {
+  CompactionPlan plan;
+
+  auto context = context_view();
+  if (!context.empty() && context.front().is_summary() && context.front().is_finished()) {
+    // Its nodes are kept as they are; only what follows is summarized
+    for (const auto& part : context.front().parts()) {
+      if (auto* text = std::get_if<TextPart>(&part)) {
+        plan.nodes.push_back(text->text);
+      }
+    }
+    context = context.subspan(1);
+  }
+
+  const int64_t chunk_tokens = std::max<int64_t>(config_.context.compact_chunk_tokens, 1);
+  const size_t chunk_bytes = static_cast<size_t>(chunk_tokens) * 4;  // A message larger than a chunk is cut
+  int64_t tokens = 0;
+  for (const auto& msg : context) {
+    if (msg.role() == Role::System || is_pending_summary(msg)) continue;
+
+    auto msg_tokens = count_message_tokens(*tokenizer_, msg);
+    if (plan.chunks.empty() || (!plan.chunks.back().empty() && tokens + msg_tokens > chunk_tokens)) {
+      plan.chunks.emplace_back();
+      tokens = 0;
+    }
+    tokens += msg_tokens;
+    append_transcript(plan.chunks.back(), msg, chunk_bytes);
+  }
+
+  if (!plan.chunks.empty() && plan.chunks.back().empty()) {
+    plan.chunks.pop_back();
+  }
+  return plan;
+}
+
+asio::awaitable<std::optional<std::vector<std::string>>> Session::run_compaction(std::shared_ptr<llm::Provider> provider, std::string model,
+                                                                                 CompactionPlan plan, size_t max_leaves) {
+  auto& nodes = plan.nodes;
+  for (const auto& chunk : plan.chunks) {
+    auto leaf = co_await stream_summary(*provider, summary_request(model, "Please summarize the following part of the conversation:\n\n" + chunk));
+    if (leaf.empty()) co_return std::nullopt;
+    nodes.push_back(std::move(leaf));
+  }
+
+  // The first node is the root: everything older than the leaves. Merge the
+  // oldest nodes into it, at most max_leaves + 1 summaries per request.
+  max_leaves = std::max<size_t>(max_leaves, 1);
+  while (nodes.size() > max_leaves + 1) {
+    size_t count = std::min(nodes.size() - max_leaves, max_leaves + 1);
+    std::string prompt = "Please merge the following summaries of consecutive parts of the conversation, oldest first, into one summary:\n\n";
+    for (size_t i = 0; i < count; ++i) {
+      prompt += "[Summary " + std::to_string(i + 1) + "]\n";
+      prompt += nodes[i];
+      prompt += "\n\n";
+    }
+
+    auto root = co_await stream_summary(*provider, summary_request(model, prompt));
+    if (root.empty()) co_return std::nullopt;
+    nodes.erase(nodes.begin() + 1, nodes.begin() + static_cast<std::ptrdiff_t>(count));
+    nodes[0] = std::move(root);
   }
+  co_return std::move(nodes);
+}
 
-  return accumulated_text;
+asio::awaitable<void> Session::handle_compaction() {
+  // A summary already being written covers most of the context: wait for it
+  // rather than starting another one
+  if (pending_compaction_) {
+    bool finished = co_await finish_background_compaction(true);
+    if (finished && !needs_compaction()) {
+      co_return;
+    }
+  }
+  co_await trigger_compaction();
 }
 
-void Session::handle_compaction() {
-  trigger_compaction();
+void Session::start_background_compaction() {
+  if (!compaction_provider_) {
+    // A provider of its own, so the summary streams next to the main requests
+    auto provider_config = config_.get_provider(provider_->name());
+    if (provider_config) {
+      compaction_provider_ = llm::ProviderFactory::instance().create(provider_->name(), *provider_config, io_ctx_);
+    }
+    if (!compaction_provider_) {
+      return;  // Compaction stays synchronous
+    }
+  }
+
+  auto plan = plan_compaction();
+  if (plan.chunks.empty()) {
+    return;
+  }
+
+  auto pending = std::make_shared<PendingCompaction>();
+  pending->ready = pending->done.get_future().share();
+
+  // Everything after the marker stays in the context once the summary is in
+  Message marker(Role::Assistant, "");
+  marker.set_summary(true);
+  marker.set_synthetic(true);
+  pending->marker_id = marker.id();
+  add_message(std::move(marker));
+  pending_compaction_ = pending;
+
+  spdlog::info("Session {} starting background compaction at {} tokens", id_, estimated_context_tokens());
+
+  // The chunk requests run one after another, as a coroutine next to the
+  // loop's own, or on a thread of their own under the blocking prompt()
+  auto task = run_compaction(compaction_provider_, agent_config_.model, std::move(plan), config_.context.compact_max_leaves);
+  auto complete = [pending](std::optional<std::vector<std::string>> nodes) {
+    pending->nodes = std::move(nodes);
+    pending->done.set_value();
+    pending->event.notify();
+  };
+  if (loop_executor_) {
+    asio::co_spawn(*loop_executor_, std::move(task), [complete](std::exception_ptr error, std::optional<std::vector<std::string>> nodes) {
+      complete(error ? std::nullopt : std::move(nodes));
+    });
+  } else {
+    std::thread([complete, task = std::move(task)]() mutable {
+      complete(run_blocking(std::move(task)));
+    }).detach();
+  }
+}
+
+asio::awaitable<bool> Session::finish_background_compaction(bool wait) {
+  if (!pending_compaction_) {
+    co_return false;
+  }
+
+  auto pending = pending_compaction_;
+  if (pending->ready.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    if (!wait) {
+      co_return false;
+    }
+    state_ = SessionState::Compacting;
+    co_await pending->event.async_wait(asio::use_awaitable);
+    state_ = SessionState::Running;
+  }
+  pending_compaction_.reset();
+
+  auto marker = std::find_if(messages_.rbegin(), messages_.rend(), [&pending](const Message& msg) {
+    return msg.id() == pending->marker_id;
+  });
+  if (marker == messages_.rend()) {
+    co_return false;
+  }
+
+  if (!pending->nodes) {
+    spdlog::warn("Session {} background compaction failed", id_);
+    if (store_) {
+      store_->remove(marker->id());
+    }
+    messages_.erase(std::next(marker).base());  // Holds no tokens and follows context_begin_
+    co_return false;
+  }
+
+  for (const auto& node : *pending->nodes) {
+    marker->add_text(node);
+  }
+  marker->set_finished(true);
+  if (store_) {
+    store_->update(*marker);
+  }
+  recount_context();
+  prune_old_outputs();
+
+  spdlog::info("Session {} background compaction completed", id_);
+  co_return true;
 }
 
 void Session::prune_old_outputs() {
@@ -746,7 +1019,7 @@ void Session::prune_old_outputs() {
     bool modified = false;
     for (auto& part : it->parts()) {
       if (auto* tr = std::get_if<ToolResultPart>(&part)) {
-        int64_t part_tokens = tr->output.size() / 4;
+        int64_t part_tokens = count_part_tokens(*tokenizer_, part);
 
         if (accumulated < protect_tokens) {
           accumulated += part_tokens;
@@ -759,6 +1032,9 @@ void Session::prune_old_outputs() {
           tr->compacted_at = std::chrono::system_clock::now();
           tr->output = "[Old tool result content cleared]";
           pruned += part_tokens;
+          if (static_cast<size_t>(messages_.rend() - it) > context_begin_) {
+            context_tokens_ -= part_tokens;
+          }
           modified = true;
         }
       }
@@ -800,7 +1076,7 @@ bool Session::detect_doom_loop(const std::string& tool_name, const json& args) {
 }
 
 std::shared_ptr<Session> Session::resume(asio::io_context& io_ctx, const Config& config, const SessionId& session_id,
-                                         std::shared_ptr<JsonMessageStore> store) {
+                                         std::shared_ptr<JsonMessageStore> store, bool from_last_summary) {
   if (!store) {
     spdlog::warn("Cannot resume session without a store");
     return nullptr;
@@ -822,7 +1098,23 @@ std::shared_ptr<Session> Session::resume(asio::io_context& io_ctx, const Config&
   session->total_usage_ = meta->total_usage;
 
   // Load messages from store
-  session->messages_ = store->list(session_id);
+  if (from_last_summary) {
+    auto tail = store->list_since_last_summary(session_id);
+    session->messages_ = std::move(tail.messages);
+    session->history_begin_ = tail.begin;
+  } else {
+    session->messages_ = store->list(session_id);
+  }
+
+  // The marker of a summary that was still being written when the process
+  // ended will never be filled in. Those in the loaded tail lie after
+  // history_begin_, so removing them from the store leaves it valid.
+  std::erase_if(session->messages_, [&store](const Message& msg) {
+    if (!is_pending_summary(msg)) return false;
+    store->remove(msg.id());
+    return true;
+  });
+  session->recount_context();
 
   spdlog::info("Resumed session {} with {} messages", session_id, session->messages_.size());
 
@@ -831,6 +1123,21 @@ std::shared_ptr<Session> Session::resume(asio::io_context& io_ctx, const Config&
   return session;
 }
 
+size_t Session::load_older_messages(size_t count) {
+  auto* json_store = dynamic_cast<JsonMessageStore*>(store_.get());
+  if (!json_store || history_begin_ == 0 || count == 0) {
+    return 0;
+  }
+
+  auto begin = history_begin_ > count ? history_begin_ - count : 0;
+  auto older = json_store->list_range(id_, begin, history_begin_ - begin);
+  std::erase_if(older.messages, is_pending_summary);  // Left by a process that ended, as in resume()
+  messages_.insert(messages_.begin(), std::make_move_iterator(older.messages.begin()), std::make_move_iterator(older.messages.end()));
+  history_begin_ = begin;
+  recount_context();
+  return older.messages.size();
+}
+
 void Session::sync_to_store() {
   auto* json_store = dynamic_cast<JsonMessageStore*>(store_.get());
   if (!json_store) {
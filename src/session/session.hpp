@@ -3,16 +3,20 @@
 #include <asio.hpp>
 #include <atomic>
 #include <functional>
+#include <map>
 #include <memory>
 #include <optional>
+#include <span>
 #include <string>
 #include <vector>
 
+#include "core/async.hpp"
 #include "core/config.hpp"
 #include "core/json_store.hpp"
 #include "core/message.hpp"
 #include "core/types.hpp"
 #include "llm/provider.hpp"
+#include "tool/executor.hpp"
 #include "tool/tool.hpp"
 
 namespace agent {
@@ -29,9 +33,11 @@ class Session : public std::enable_shared_from_this<Session> {
   static std::shared_ptr<Session> create(asio::io_context& io_ctx, const Config& config, AgentType agent_type = AgentType::Build,
                                          std::shared_ptr<MessageStore> store = nullptr);
 
-  // Resume a session from persistent store
+  // Resume a session from persistent store. With from_last_summary, only the
+  // latest compaction summary and what follows are loaded (the context the
+  // model sees); earlier history stays on disk until load_older_messages().
   static std::shared_ptr<Session> resume(asio::io_context& io_ctx, const Config& config, const SessionId& session_id,
-                                         std::shared_ptr<JsonMessageStore> store);
+                                         std::shared_ptr<JsonMessageStore> store, bool from_last_summary = false);
 
   // Create child session (for Task tool)
   std::shared_ptr<Session> create_child(AgentType agent_type);
@@ -73,13 +79,31 @@ class Session : public std::enable_shared_from_this<Session> {
     return messages_;
   }
 
-  std::vector<Message> get_context_messages() const;  // Filtered for LLM
+  // Latest finished summary and everything after it: what is sent to the LLM.
+  // The view is invalidated by any change to messages().
+  std::span<const Message> context_view() const;
+  // Copy of context_view() as sent to the LLM (without the marker of a
+  // summary still being written)
+  std::vector<Message> get_context_messages() const;
+
+  // History left on disk by resume(..., from_last_summary = true). Loads up to
+  // count earlier messages in front of messages() and returns how many were
+  // loaded. Call while the session is idle.
+  bool has_older_messages() const {
+    return history_begin_ > 0;
+  }
+  size_t load_older_messages(size_t count);
 
   // Token tracking
   TokenUsage total_usage() const {
     return total_usage_;
   }
 
+  // Whether a summary is being written in the background (see
+  // Config::context.compact_background_ratio)
+  bool compaction_in_progress() const;
+
+  // Estimate for context_view(), kept up to date as messages are added or pruned
   int64_t estimated_context_tokens() const;
   int64_t context_window() const;  // 返回模型的上下文窗口大小
 
@@ -88,11 +112,19 @@ class Session : public std::enable_shared_from_this<Session> {
     return agent_config_;
   }
 
-  // Send user message and run agent loop
+  // Send user message and run agent loop, blocking until it stops
   void prompt(const std::string& text);
 
   void prompt(Message user_msg);
 
+  // The same loop as a coroutine on the caller's executor. The session must
+  // not be used from another thread until it completes.
+  asio::awaitable<void> async_prompt(Message user_msg);
+
+  // Starts async_prompt() on a strand of the session's io_context and
+  // returns at once; the callbacks report progress and completion
+  void start_prompt(Message user_msg);
+
   // Cancel current operation
   void cancel();
 
@@ -146,24 +178,61 @@ class Session : public std::enable_shared_from_this<Session> {
   Session(asio::io_context& io_ctx, const Config& config, AgentType agent_type, std::shared_ptr<MessageStore> store);
 
   // The main agent loop
-  void run_loop();
+  asio::awaitable<void> run_loop();
 
-  void process_stream();
+  asio::awaitable<void> process_stream();
 
-  void execute_tool_calls();
+  asio::awaitable<void> execute_tool_calls();
 
-  void handle_compaction();
+  ToolContext make_tool_context(const MessageId& message_id);
+
+  // Speculative execution (Config::tools.speculative): start a streamed tool
+  // call right away if it is read-only, already allowed and independent of
+  // the calls streamed before it (all in streamed).
+  void start_speculative_call(const llm::ToolCallComplete& call, const MessageId& message_id, std::vector<ToolInvocation>& streamed);
+
+  asio::awaitable<void> handle_compaction();
 
   // Context management
   bool needs_compaction() const;
 
-  void trigger_compaction();
+  asio::awaitable<void> trigger_compaction();
+
+  // Background compaction (Config::context.compact_background_ratio): the
+  // summary is requested on a separate provider while the loop goes on. An
+  // unfinished summary message appended when it starts marks where it
+  // applies; once the summary arrives it fills that message, which then
+  // starts the context window.
+  bool wants_background_compaction() const;
+
+  void start_background_compaction();
+
+  // Swaps in the pending summary if it has arrived (with wait, once it does).
+  // Returns whether a summary was swapped in.
+  asio::awaitable<bool> finish_background_compaction(bool wait);
 
   void prune_old_outputs();
 
-  // Compaction helpers
-  std::vector<Message> collect_messages_for_compaction() const;
-  std::string stream_compaction(const llm::LlmRequest& request);
+  // Recomputes context_begin_ and context_tokens_ after messages_ is replaced
+  void recount_context();
+
+  // Rolling compaction. A summary message holds a two-level tree of
+  // summaries, one text part each: a root for the oldest history, then leaf
+  // summaries of chunks of at most Config::context.compact_chunk_tokens.
+  // Compaction summarizes only what follows the latest summary, chunk by
+  // chunk, and keeps that summary's nodes; once there are more than
+  // compact_max_leaves leaves, the oldest are merged into the root. Every
+  // request is bounded by a chunk or by compact_max_leaves + 1 summaries.
+  struct CompactionPlan {
+    std::vector<std::string> nodes;  // Of the latest summary: root, then leaves
+    std::vector<std::string> chunks;  // Transcripts of the messages after it
+  };
+
+  CompactionPlan plan_compaction() const;
+
+  // The new nodes, nullopt if a request fails. Does not touch the session.
+  static asio::awaitable<std::optional<std::vector<std::string>>> run_compaction(std::shared_ptr<llm::Provider> provider, std::string model,
+                                                                                 CompactionPlan plan, size_t max_leaves);
 
   // Doom loop detection
   bool detect_doom_loop(const std::string& tool_name, const json& args);
@@ -183,9 +252,13 @@ class Session : public std::enable_shared_from_this<Session> {
   std::shared_ptr<std::atomic<bool>> abort_signal_;
 
   std::vector<Message> messages_;
+  size_t history_begin_ = 0;  // Stored position of messages_[0]
+  size_t context_begin_ = 0;  // Index of the latest finished summary in messages_
+  int64_t context_tokens_ = 0;  // Estimated tokens of messages_[context_begin_..]
   TokenUsage total_usage_;
 
   std::shared_ptr<llm::Provider> provider_;
+  std::shared_ptr<const Tokenizer> tokenizer_;  // For the model's context size
   std::shared_ptr<MessageStore> store_;  // Persistent storage (optional)
 
   // Callbacks
@@ -198,6 +271,28 @@ class Session : public std::enable_shared_from_this<Session> {
   PermissionHandler permission_handler_;
   QuestionHandler question_handler_;
 
+  // Tool calls started while their response was still streaming, by tool call id
+  struct SpeculativeCall {
+    json arguments;
+    std::shared_future<ToolResult> result;
+  };
+  std::map<std::string, SpeculativeCall> speculative_calls_;
+
+  // Summary being written in the background; filled by its coroutine or
+  // thread and read once ready is (event is notified then)
+  struct PendingCompaction {
+    MessageId marker_id;
+    std::optional<std::vector<std::string>> nodes;  // nullopt if it failed
+    std::promise<void> done;
+    std::shared_future<void> ready;
+    AsyncEvent event;
+  };
+  std::shared_ptr<PendingCompaction> pending_compaction_;
+  std::shared_ptr<llm::Provider> compaction_provider_;  // Created on first use
+
+  // Executor of the running async_prompt(); unset under the blocking prompt()
+  std::optional<asio::any_io_executor> loop_executor_;
+
   // Doom loop tracking
   struct ToolCallRecord {
     std::string tool_name;
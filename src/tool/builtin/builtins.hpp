@@ -25,6 +25,14 @@ class ReadTool : public SimpleTool {
   std::vector<ParameterSchema> parameters() const override;
 
   std::future<ToolResult> execute(const json& args, const ToolContext& ctx) override;
+
+  bool parallel_safe() const override {
+    return true;
+  }
+
+  std::optional<std::string> resource_key(const json& args, const ToolContext& ctx) const override {
+    return file_resource_key(args, ctx);
+  }
 };
 
 // Write tool - write file contents
@@ -35,6 +43,10 @@ class WriteTool : public SimpleTool {
   std::vector<ParameterSchema> parameters() const override;
 
   std::future<ToolResult> execute(const json& args, const ToolContext& ctx) override;
+
+  std::optional<std::string> resource_key(const json& args, const ToolContext& ctx) const override {
+    return file_resource_key(args, ctx);
+  }
 };
 
 // Edit tool - edit file with search/replace
@@ -45,6 +57,10 @@ class EditTool : public SimpleTool {
   std::vector<ParameterSchema> parameters() const override;
 
   std::future<ToolResult> execute(const json& args, const ToolContext& ctx) override;
+
+  std::optional<std::string> resource_key(const json& args, const ToolContext& ctx) const override {
+    return file_resource_key(args, ctx);
+  }
 };
 
 // Glob tool - find files by pattern
@@ -55,6 +71,10 @@ class GlobTool : public SimpleTool {
   std::vector<ParameterSchema> parameters() const override;
 
   std::future<ToolResult> execute(const json& args, const ToolContext& ctx) override;
+
+  bool parallel_safe() const override {
+    return true;
+  }
 };
 
 // Grep tool - search file contents
@@ -65,6 +85,10 @@ class GrepTool : public SimpleTool {
   std::vector<ParameterSchema> parameters() const override;
 
   std::future<ToolResult> execute(const json& args, const ToolContext& ctx) override;
+
+  bool parallel_safe() const override {
+    return true;
+  }
 };
 
 // Question tool - ask user a question
@@ -98,6 +122,10 @@ class SkillTool : public SimpleTool {
   std::vector<ParameterSchema> parameters() const override;
 
   std::future<ToolResult> execute(const json& args, const ToolContext& ctx) override;
+
+  bool parallel_safe() const override {
+    return true;
+  }
 };
 
 // Register all builtin tools
@@ -0,0 +1,108 @@
+#include "executor.hpp"
+
+#include <algorithm>
+#include <future>
+#include <mutex>
+
+#include "core/async.hpp"
+
+namespace agent {
+
+bool tool_calls_conflict(const ToolInvocation& a, const ToolInvocation& b) {
+  if (a.tool->parallel_safe() && b.tool->parallel_safe()) {
+    return false;
+  }
+  auto a_key = a.tool->resource_key(a.arguments, a.ctx);
+  auto b_key = b.tool->resource_key(b.arguments, b.ctx);
+  return !a_key || !b_key || *a_key == *b_key;
+}
+
+std::vector<ToolResult> execute_tool_batch(const std::vector<ToolInvocation>& calls, size_t max_parallel,
+                                           const std::function<void(size_t index, const ToolResult& result)>& on_complete) {
+  return run_blocking(async_execute_tool_batch(calls, max_parallel, on_complete));
+}
+
+asio::awaitable<std::vector<ToolResult>> async_execute_tool_batch(const std::vector<ToolInvocation>& calls, size_t max_parallel,
+                                                                  std::function<void(size_t index, const ToolResult& result)> on_complete) {
+  enum class CallState { Pending, Running, Done };
+
+  size_t count = calls.size();
+  std::vector<ToolResult> results(count);
+  std::vector<CallState> states(count, CallState::Pending);
+  std::vector<std::future<void>> workers(count);
+  max_parallel = std::max<size_t>(max_parallel, 1);
+
+  // Conflicts do not change while the batch runs
+  std::vector<std::vector<size_t>> waits_for(count);
+  for (size_t i = 0; i < count; ++i) {
+    for (size_t j = 0; j < i; ++j) {
+      if (tool_calls_conflict(calls[j], calls[i])) {
+        waits_for[i].push_back(j);
+      }
+    }
+  }
+
+  // Shared with the worker threads
+  struct Completions {
+    std::mutex mutex;
+    std::vector<size_t> finished;  // Guarded by mutex
+    AsyncEvent event;
+  };
+  auto completions = std::make_shared<Completions>();
+  size_t running = 0;
+  size_t done = 0;
+
+  while (done < count) {
+    // Start calls in order while there is room
+    for (size_t i = 0; i < count && running < max_parallel; ++i) {
+      if (states[i] != CallState::Pending) continue;
+      bool ready = std::all_of(waits_for[i].begin(), waits_for[i].end(), [&](size_t j) {
+        return states[j] == CallState::Done;
+      });
+      if (!ready) continue;
+
+      states[i] = CallState::Running;
+      ++running;
+      workers[i] = std::async(std::launch::async, [&calls, &results, completions, i] {
+        ToolResult result;
+        try {
+          const auto& call = calls[i];
+          result = call.started.valid() ? call.started.get() : call.tool->execute(call.arguments, call.ctx).get();
+        } catch (const std::exception& e) {
+          result = ToolResult::error(std::string("Error: ") + e.what());
+        }
+
+        {
+          std::lock_guard lock(completions->mutex);
+          results[i] = std::move(result);
+          completions->finished.push_back(i);
+        }
+        completions->event.notify();
+      });
+    }
+
+    std::vector<size_t> batch;
+    for (;;) {
+      {
+        std::lock_guard lock(completions->mutex);
+        batch.swap(completions->finished);
+      }
+      if (!batch.empty()) break;
+      co_await completions->event.async_wait(asio::use_awaitable);
+    }
+
+    for (auto i : batch) {
+      workers[i].wait();
+      states[i] = CallState::Done;
+      --running;
+      ++done;
+      if (on_complete) {
+        on_complete(i, results[i]);
+      }
+    }
+  }
+
+  co_return results;
+}
+
+}  // namespace agent
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <asio.hpp>
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "tool.hpp"
+
+namespace agent {
+
+// One call in a batch of tool calls
+struct ToolInvocation {
+  std::shared_ptr<Tool> tool;
+  json arguments;
+  ToolContext ctx;
+  std::shared_future<ToolResult> started;  // Already running (speculative execution); awaited instead of executing again
+};
+
+// Whether two calls may interfere and so must keep their relative order:
+// false only for two parallel-safe calls, or calls with different resource keys
+bool tool_calls_conflict(const ToolInvocation& a, const ToolInvocation& b);
+
+// Runs the tool calls of one turn. A call starts once every earlier call it
+// conflicts with has finished, with at most max_parallel calls running; so
+// independent reads overlap while writes to one path, or a bash command and
+// anything around it, run in call order. An exception from a tool becomes an
+// error result. on_complete runs on the calling thread as each call finishes.
+// Results are returned in call order.
+std::vector<ToolResult> execute_tool_batch(const std::vector<ToolInvocation>& calls, size_t max_parallel,
+                                           const std::function<void(size_t index, const ToolResult& result)>& on_complete = nullptr);
+
+// Same as a coroutine: tools still run on threads of their own, but the
+// coroutine's thread is free while they do, and on_complete runs on the
+// coroutine's executor. calls must outlive the batch.
+asio::awaitable<std::vector<ToolResult>> async_execute_tool_batch(const std::vector<ToolInvocation>& calls, size_t max_parallel,
+                                                                  std::function<void(size_t index, const ToolResult& result)> on_complete = nullptr);
+
+}  // namespace agent
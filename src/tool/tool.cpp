@@ -1,7 +1,10 @@
 #include "tool.hpp"
 
+#include <spdlog/spdlog.h>
+
 #include <filesystem>
 #include <fstream>
+#include <mutex>
 #include <sstream>
 
 #include "core/types.hpp"
@@ -60,6 +63,17 @@ Result<json> Tool::validate_args(const json& args) const {
   return Result<json>::success(args);
 }
 
+std::optional<std::string> Tool::file_resource_key(const json& args, const ToolContext& ctx, const std::string& arg) {
+  if (!args.contains(arg) || !args[arg].is_string()) {
+    return std::nullopt;
+  }
+  fs::path path = args[arg].get<std::string>();
+  if (!path.is_absolute()) {
+    path = fs::path(ctx.working_dir) / path;
+  }
+  return path.lexically_normal().string();
+}
+
 // SimpleTool implementation
 SimpleTool::SimpleTool(std::string id, std::string description) : id_(std::move(id)), description_(std::move(description)) {}
 
@@ -72,11 +86,21 @@ ToolRegistry& ToolRegistry::instance() {
 void ToolRegistry::register_tool(std::shared_ptr<Tool> tool) {
   std::lock_guard lock(mutex_);
   tools_[tool->id()] = std::move(tool);
+  ++generation_;
+  schema_cache_.clear();
 }
 
 void ToolRegistry::unregister_tool(const std::string& id) {
   std::lock_guard lock(mutex_);
-  tools_.erase(id);
+  if (tools_.erase(id) > 0) {
+    ++generation_;
+    schema_cache_.clear();
+  }
+}
+
+uint64_t ToolRegistry::generation() const {
+  std::lock_guard lock(mutex_);
+  return generation_;
 }
 
 std::shared_ptr<Tool> ToolRegistry::get(const std::string& id) const {
@@ -132,6 +156,61 @@ std::vector<std::shared_ptr<Tool>> ToolRegistry::for_agent(const AgentConfig& ag
   return result;
 }
 
+std::shared_ptr<const ToolSchemaSet> ToolRegistry::schemas_for_agent(const AgentConfig& agent) const {
+  auto key = std::make_pair(agent.allowed_tools, agent.denied_tools);
+  uint64_t generation;
+  {
+    std::lock_guard lock(mutex_);
+    auto it = schema_cache_.find(key);
+    if (it != schema_cache_.end()) {
+      return it->second;
+    }
+    generation = generation_;
+  }
+
+  auto schemas = std::make_shared<const ToolSchemaSet>(for_agent(agent), generation);
+
+  std::lock_guard lock(mutex_);
+  // Not cached if the registry changed in the meantime
+  if (generation_ == generation) {
+    schema_cache_.emplace(std::move(key), schemas);
+  }
+  return schemas;
+}
+
+// --- Tool schemas ---
+
+json tool_definition(const Tool& tool, ToolSchemaFormat format) {
+  auto schema = tool.to_json_schema();
+  if (format != ToolSchemaFormat::OpenAI) {
+    return schema;
+  }
+
+  // OpenAI uses "parameters" instead of "input_schema"
+  json func = {{"name", schema["name"]}, {"description", schema["description"]}};
+  if (schema.contains("input_schema")) {
+    func["parameters"] = schema["input_schema"];
+  }
+  return {{"type", "function"}, {"function", func}};
+}
+
+ToolSchemaSet::ToolSchemaSet(std::vector<std::shared_ptr<Tool>> tools, uint64_t generation) : tools_(std::move(tools)), generation_(generation) {}
+
+const std::string& ToolSchemaSet::serialized(ToolSchemaFormat format) const {
+  auto index = static_cast<size_t>(format);
+  std::call_once(once_[index], [&] {
+    json definitions = json::array();
+    for (const auto& tool : tools_) {
+      definitions.push_back(tool_definition(*tool, format));
+    }
+    if (format == ToolSchemaFormat::AnthropicCached && !definitions.empty()) {
+      definitions.back()["cache_control"] = {{"type", "ephemeral"}};
+    }
+    serialized_[index] = definitions.dump();
+  });
+  return serialized_[index];
+}
+
 // Truncation helpers
 namespace Truncate {
 
@@ -180,21 +259,38 @@ TruncateResult output(const std::string& text, size_t max_lines, size_t max_byte
   return result;
 }
 
+static std::mutex blob_store_mutex;
+static std::shared_ptr<DirectoryBlobStore> shared_blob_store;
+
+void set_blob_store(std::shared_ptr<DirectoryBlobStore> blobs) {
+  if (blobs && blobs->compressed()) {
+    spdlog::warn("Not saving full tool outputs to compressed store {}", blobs->dir().string());
+    return;
+  }
+  std::lock_guard lock(blob_store_mutex);
+  shared_blob_store = std::move(blobs);
+}
+
+std::shared_ptr<DirectoryBlobStore> blob_store() {
+  std::lock_guard lock(blob_store_mutex);
+  if (!shared_blob_store) {
+    shared_blob_store = std::make_shared<DirectoryBlobStore>(fs::temp_directory_path() / "agent-sdk" / "tool_outputs");
+  }
+  return shared_blob_store;
+}
+
 TruncateResult save_and_truncate(const std::string& text, const std::string& tool_name, size_t max_lines, size_t max_bytes) {
   auto truncated = output(text, max_lines, max_bytes);
 
   if (truncated.truncated) {
-    // Save full output to temp file
-    auto temp_dir = fs::temp_directory_path() / "agent-sdk" / "tool_outputs";
-    fs::create_directories(temp_dir);
-
-    auto filename = tool_name + "_" + UUID::short_id() + ".txt";
-    auto path = temp_dir / filename;
-
-    std::ofstream file(path);
-    if (file.is_open()) {
-      file << text;
-      file.close();
+    // Save full output, named by content hash
+    auto blobs = blob_store();
+    auto ref = blobs->put(text);
+    auto path = blobs->path(ref);
+
+    std::error_code ec;
+    if (!ref.empty() && fs::exists(path, ec)) {
+      spdlog::debug("Full {} output saved to {}", tool_name, path.string());
       truncated.full_output_path = path.string();
       truncated.content += "\nFull output saved to: " + path.string();
     }
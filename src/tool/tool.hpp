@@ -1,9 +1,11 @@
 #pragma once
 
+#include <array>
 #include <functional>
 #include <future>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <nlohmann/json.hpp>
 #include <optional>
 #include <string>
@@ -100,11 +102,27 @@ class Tool {
   // Execution
   virtual std::future<ToolResult> execute(const json& args, const ToolContext& ctx) = 0;
 
+  // Concurrency metadata (see execute_tool_batch). Calls of parallel-safe
+  // (read-only) tools may run together. resource_key() names what a call
+  // touches; calls with different keys never interfere, nullopt may touch
+  // anything.
+  virtual bool parallel_safe() const {
+    return false;
+  }
+
+  virtual std::optional<std::string> resource_key(const json& args, const ToolContext& ctx) const {
+    return std::nullopt;
+  }
+
   // Generate JSON Schema for tool
   json to_json_schema() const;
 
   // Validate arguments
   Result<json> validate_args(const json& args) const;
+
+ protected:
+  // resource_key() for tools that take a file path argument: the normalized absolute path
+  static std::optional<std::string> file_resource_key(const json& args, const ToolContext& ctx, const std::string& arg = "filePath");
 };
 
 // Base class for simpler tool implementation
@@ -125,6 +143,43 @@ class SimpleTool : public Tool {
   std::string description_;
 };
 
+// Request format of tool definitions
+enum class ToolSchemaFormat {
+  Anthropic,
+  AnthropicCached,  // Anthropic with a prompt cache breakpoint on the last tool
+  OpenAI,
+};
+
+// One tool's definition in a request
+json tool_definition(const Tool& tool, ToolSchemaFormat format);
+
+// The tools an agent may use, with their definitions serialized once per
+// format (a JSON array to splice into a request body). Tools must not change
+// their description or parameters while registered.
+class ToolSchemaSet {
+ public:
+  ToolSchemaSet(std::vector<std::shared_ptr<Tool>> tools, uint64_t generation);
+
+  const std::vector<std::shared_ptr<Tool>>& tools() const {
+    return tools_;
+  }
+
+  // Registry generation the set was built from
+  uint64_t generation() const {
+    return generation_;
+  }
+
+  const std::string& serialized(ToolSchemaFormat format) const;
+
+ private:
+  static constexpr size_t FORMAT_COUNT = 3;
+
+  std::vector<std::shared_ptr<Tool>> tools_;
+  uint64_t generation_;
+  mutable std::array<std::once_flag, FORMAT_COUNT> once_;
+  mutable std::array<std::string, FORMAT_COUNT> serialized_;
+};
+
 // Tool registry
 class ToolRegistry {
  public:
@@ -145,6 +200,13 @@ class ToolRegistry {
   // Get tools filtered by agent config
   std::vector<std::shared_ptr<Tool>> for_agent(const AgentConfig& agent) const;
 
+  // for_agent() with serialized definitions, cached per tool filter until a
+  // tool is registered or unregistered
+  std::shared_ptr<const ToolSchemaSet> schemas_for_agent(const AgentConfig& agent) const;
+
+  // Changes whenever a tool is registered or unregistered
+  uint64_t generation() const;
+
   // Initialize builtin tools
   void init_builtins();
 
@@ -153,6 +215,9 @@ class ToolRegistry {
 
   mutable std::mutex mutex_;
   std::map<std::string, std::shared_ptr<Tool>> tools_;
+  uint64_t generation_ = 0;
+  // By allowed/denied tool lists; cleared when generation_ changes
+  mutable std::map<std::pair<std::vector<std::string>, std::vector<std::string>>, std::shared_ptr<const ToolSchemaSet>> schema_cache_;
 };
 
 // Truncation helper
@@ -166,8 +231,15 @@ struct TruncateResult {
 // Truncate output if too large
 TruncateResult output(const std::string& text, size_t max_lines = 2000, size_t max_bytes = 51200);
 
-// Save full output to file and return truncated version
+// Save full output to file and return truncated version. The file lives in a
+// content-addressed store, so identical outputs are written once.
 TruncateResult save_and_truncate(const std::string& text, const std::string& tool_name, size_t max_lines = 2000, size_t max_bytes = 51200);
+
+// Store for full outputs; defaults to <tmp>/agent-sdk/tool_outputs. The
+// model opens these files with ordinary tools (read, grep, bash), so they are
+// plain text: a compressed store is refused and the current one kept.
+void set_blob_store(std::shared_ptr<DirectoryBlobStore> blobs);
+std::shared_ptr<DirectoryBlobStore> blob_store();
 }  // namespace Truncate
 
 }  // namespace agent
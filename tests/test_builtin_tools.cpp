@@ -148,6 +148,29 @@ TEST_F(ReadToolTest, ReadWithOffset) {
   EXPECT_EQ(result.output.find("bbb"), std::string::npos);
 }
 
+TEST_F(ReadToolTest, SavedToolOutputIsPlainText) {
+  // 截断后保存的完整输出是纯文本，压缩的存储不会被采用
+  Truncate::set_blob_store(std::make_shared<DirectoryBlobStore>(tmp_.path() / "outputs"));
+  Truncate::set_blob_store(std::make_shared<DirectoryBlobStore>(tmp_.path() / "packed", true));
+  std::string long_text;
+  for (int i = 0; i < 300; ++i) {
+    long_text += "output line " + std::to_string(i) + "\n";
+  }
+  auto truncated = Truncate::save_and_truncate(long_text, "bash", 100);
+  Truncate::set_blob_store(nullptr);
+  ASSERT_TRUE(truncated.full_output_path.has_value());
+  EXPECT_EQ(fs::path(*truncated.full_output_path).parent_path(), tmp_.path() / "outputs");
+  std::ifstream saved(*truncated.full_output_path, std::ios::binary);
+  EXPECT_EQ(std::string(std::istreambuf_iterator<char>(saved), {}), long_text);
+
+  auto ctx = make_context(tmp_.str());
+  json args = {{"filePath", *truncated.full_output_path}, {"offset", 250}, {"limit", 1}};
+  auto result = tool_.execute(args, ctx).get();
+
+  EXPECT_FALSE(result.is_error);
+  EXPECT_NE(result.output.find("output line 250"), std::string::npos);
+}
+
 TEST_F(ReadToolTest, ReadNonexistentFile) {
   auto ctx = make_context(tmp_.str());
   json args = {{"filePath", (tmp_.path() / "nonexistent.txt").string()}};
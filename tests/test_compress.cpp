@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include "core/compress.hpp"
+#include "core/uuid.hpp"
+
+using namespace agent;
+namespace fs = std::filesystem;
+
+static std::string random_bytes(size_t size, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::string data(size, '\0');
+  for (auto& c : data) c = static_cast<char>(rng());
+  return data;
+}
+
+static std::string log_lines(size_t count) {
+  std::string text;
+  for (size_t i = 0; i < count; ++i) {
+    text += "[2025-01-01 12:00:" + std::to_string(i % 60) + "] INFO request " + std::to_string(i) + " handled in " + std::to_string(i % 97) +
+            "ms\n";
+  }
+  return text;
+}
+
+TEST(CompressTest, BlockRoundTrip) {
+  std::vector<std::string> inputs = {"",
+                                     "a",
+                                     "short text",
+                                     std::string(1000, 'x'),  // Overlapping matches
+                                     "abcabcabcabcabcabcabcabcabcabcabcabcabcabcabcabc",
+                                     log_lines(200),
+                                     random_bytes(5000, 1)};
+  for (const auto& input : inputs) {
+    auto packed = compress_block(input);
+    EXPECT_EQ(decompress_block(packed, input.size()), input);
+  }
+
+  auto text = log_lines(200);
+  EXPECT_LT(compress_block(text).size(), text.size() / 3);
+}
+
+TEST(CompressTest, FramedRoundTripAcrossBlocks) {
+  auto text = log_lines(2000) + random_bytes(3000, 2);
+  auto packed = compress(text, 4096);
+  EXPECT_TRUE(is_compressed(packed));
+  EXPECT_FALSE(is_compressed(text));
+  EXPECT_LT(packed.size(), text.size());
+  EXPECT_EQ(decompress(packed), text);
+
+  EXPECT_EQ(decompress(compress("")), "");
+  EXPECT_EQ(maybe_decompress("plain"), "plain");
+  EXPECT_EQ(maybe_decompress(packed), text);
+}
+
+TEST(CompressTest, CorruptInputIsRejected) {
+  auto text = log_lines(100);
+  auto block = compress_block(text);
+  EXPECT_THROW(decompress_block(block, text.size() + 1), std::runtime_error);
+  EXPECT_THROW(decompress_block(block.substr(0, block.size() / 2), text.size()), std::runtime_error);
+
+  auto packed = compress(text);
+  EXPECT_THROW(decompress(packed.substr(0, packed.size() - 10)), std::runtime_error);
+  packed[4] = 99;  // Version
+  EXPECT_THROW(decompress(packed), std::runtime_error);
+}
+
+TEST(CompressTest, CompressedFileReadsRanges) {
+  auto dir = fs::temp_directory_path() / ("agent_compress_test_" + UUID::generate());
+  fs::create_directories(dir);
+  auto text = log_lines(3000);
+
+  for (bool compressed : {true, false}) {
+    auto path = dir / (compressed ? "packed" : "plain");
+    {
+      std::ofstream out(path, std::ios::binary);
+      out << (compressed ? compress(text, 1024) : text);
+    }
+
+    CompressedFile file(path);
+    ASSERT_TRUE(file.is_open());
+    EXPECT_EQ(file.compressed(), compressed);
+    EXPECT_EQ(file.size(), text.size());
+    EXPECT_EQ(file.read(100, 50), text.substr(100, 50));
+    EXPECT_EQ(file.read(1000, 3000), text.substr(1000, 3000));  // Spans several blocks
+    EXPECT_EQ(file.read_all(), text);
+    EXPECT_THROW(file.read(text.size() - 10, 20), std::runtime_error);
+
+    auto stream = open_decompressed(path);
+    ASSERT_NE(stream, nullptr);
+    std::string line;
+    std::getline(*stream, line);
+    EXPECT_EQ(line + "\n", text.substr(0, text.find('\n') + 1));
+  }
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
@@ -69,6 +69,7 @@ TEST(ConfigTest, ContextSettings) {
   EXPECT_EQ(config.context.prune_minimum_tokens, 20000);
   EXPECT_EQ(config.context.truncate_max_lines, 2000u);
   EXPECT_EQ(config.context.truncate_max_bytes, 51200u);
+  EXPECT_LT(config.context.compact_background_ratio, config.context.compact_blocking_ratio);
 }
 
 // --- ConfigPathsTest ---
@@ -103,6 +104,27 @@ TEST(ConfigPathsTest, FindGitRoot) {
   // 不做严格断言，因为取决于环境，但不应崩溃
 }
 
+TEST(ConfigTest, ProviderHttp2IsOptIn) {
+  Config config;
+  ProviderConfig plain;
+  plain.name = "anthropic";
+  plain.api_key = "key";
+  config.providers["anthropic"] = plain;
+  ProviderConfig h2 = plain;
+  h2.name = "openai";
+  h2.http2 = true;
+  config.providers["openai"] = h2;
+
+  auto tmp_path = fs::temp_directory_path() / "test_provider_http2_config.json";
+  config.save(tmp_path);
+  auto loaded = Config::load(tmp_path);
+  fs::remove(tmp_path);
+
+  // 默认使用 HTTP/1.1，需在配置中显式开启 HTTP/2
+  EXPECT_FALSE(loaded.providers.at("anthropic").http2);
+  EXPECT_TRUE(loaded.providers.at("openai").http2);
+}
+
 TEST(ConfigTest, SaveAndLoadMcpServers) {
   Config config;
 
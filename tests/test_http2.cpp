@@ -0,0 +1,713 @@
+#include <gtest/gtest.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "net/hpack.hpp"
+#include "net/http2.hpp"
+#include "net/http_client.hpp"
+#include "net/tls.hpp"
+
+using namespace agent::net;
+using namespace agent::net::http2;
+
+namespace {
+
+std::string from_hex(std::string_view hex) {
+  std::string bytes;
+  for (size_t i = 0; i + 1 < hex.size(); i += 2) {
+    bytes.push_back(static_cast<char>(std::stoi(std::string(hex.substr(i, 2)), nullptr, 16)));
+  }
+  return bytes;
+}
+
+std::string to_hex(std::string_view bytes) {
+  static constexpr char DIGITS[] = "0123456789abcdef";
+  std::string hex;
+  for (unsigned char c : bytes) {
+    hex.push_back(DIGITS[c >> 4]);
+    hex.push_back(DIGITS[c & 0xf]);
+  }
+  return hex;
+}
+
+}  // namespace
+
+// ============================================================
+// HPACK 测试
+// ============================================================
+
+TEST(HpackTest, HuffmanEncodesRfcExample) {
+  // RFC 7541 C.4.1
+  std::string encoded;
+  huffman_encode("www.example.com", encoded);
+  EXPECT_EQ(to_hex(encoded), "f1e3c2e5f23a6ba0ab90f4ff");
+  EXPECT_EQ(huffman_encoded_size("www.example.com"), encoded.size());
+
+  std::string decoded;
+  ASSERT_TRUE(huffman_decode(encoded, decoded));
+  EXPECT_EQ(decoded, "www.example.com");
+}
+
+TEST(HpackTest, HuffmanRoundTripsEveryByte) {
+  std::string text;
+  for (int i = 0; i < 256; ++i) text.push_back(static_cast<char>(i));
+  text += "Bearer sk-0123456789abcdefghijklmnopqrstuvwxyz";
+
+  std::string encoded;
+  huffman_encode(text, encoded);
+  std::string decoded;
+  ASSERT_TRUE(huffman_decode(encoded, decoded));
+  EXPECT_EQ(decoded, text);
+}
+
+TEST(HpackTest, HuffmanRejectsBadPadding) {
+  std::string out;
+  // 填充超过 7 位
+  EXPECT_FALSE(huffman_decode(from_hex("ffff"), out));
+  // 填充不全是 1（'0' 的编码是 00000，补 000）
+  out.clear();
+  EXPECT_FALSE(huffman_decode(from_hex("00"), out));
+  // 字符串中出现 EOS
+  out.clear();
+  EXPECT_FALSE(huffman_decode(from_hex("ffffffff"), out));
+}
+
+TEST(HpackTest, DecodesRfcRequestExamples) {
+  // RFC 7541 C.4：三个请求共用一个动态表
+  HpackDecoder decoder;
+
+  HeaderList first;
+  ASSERT_TRUE(decoder.decode(from_hex("828684418cf1e3c2e5f23a6ba0ab90f4ff"), first));
+  HeaderList expected_first = {{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"}};
+  EXPECT_EQ(first, expected_first);
+  EXPECT_EQ(decoder.table_size(), 57);
+
+  HeaderList second;
+  ASSERT_TRUE(decoder.decode(from_hex("828684be5886a8eb10649cbf"), second));
+  HeaderList expected_second = {{":method", "GET"}, {":scheme", "http"}, {":path", "/"}, {":authority", "www.example.com"}, {"cache-control", "no-cache"}};
+  EXPECT_EQ(second, expected_second);
+  EXPECT_EQ(decoder.table_size(), 110);
+
+  HeaderList third;
+  ASSERT_TRUE(decoder.decode(from_hex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf"), third));
+  HeaderList expected_third = {{":method", "GET"}, {":scheme", "https"}, {":path", "/index.html"}, {":authority", "www.example.com"}, {"custom-key", "custom-value"}};
+  EXPECT_EQ(third, expected_third);
+  EXPECT_EQ(decoder.table_size(), 164);
+}
+
+TEST(HpackTest, TableSizeUpdateEvicts) {
+  HpackDecoder decoder;
+  // 表大小改为 100，再插入两个各 63 字节的条目：第一个被淘汰
+  std::string block = from_hex("3f45");
+  for (char name : {'a', 'b'}) {
+    block += from_hex("4001");
+    block.push_back(name);
+    block.push_back(30);
+    block += std::string(30, 'v');
+  }
+  HeaderList headers;
+  ASSERT_TRUE(decoder.decode(block, headers));
+  EXPECT_EQ(headers.size(), 2);
+  EXPECT_EQ(decoder.table_size(), 63);
+
+  HeaderList indexed;
+  ASSERT_TRUE(decoder.decode(from_hex("be"), indexed));
+  EXPECT_EQ(indexed[0].first, "b");
+  EXPECT_FALSE(decoder.decode(from_hex("bf"), indexed));
+}
+
+TEST(HpackTest, RejectsMalformedBlocks) {
+  auto fails = [](std::string_view hex) {
+    HpackDecoder decoder;
+    HeaderList headers;
+    return !decoder.decode(from_hex(hex), headers);
+  };
+  EXPECT_TRUE(fails("80"));  // 索引 0
+  EXPECT_TRUE(fails("ff00"));  // 超出表的索引
+  EXPECT_TRUE(fails("ffffffffffff7f"));  // 整数溢出
+  EXPECT_TRUE(fails("ff"));  // 整数被截断
+  EXPECT_TRUE(fails("400a61"));  // 字符串被截断
+  EXPECT_TRUE(fails("823f45"));  // 表大小更新不在开头
+  EXPECT_TRUE(fails("3fe21f"));  // 表大小超出设置
+}
+
+TEST(HpackTest, EncoderRoundTrips) {
+  HeaderList headers = {{":method", "POST"},
+                        {":scheme", "https"},
+                        {":authority", "api.anthropic.com"},
+                        {":path", "/v1/messages"},
+                        {"content-type", "application/json"},
+                        {"authorization", "Bearer secret"},
+                        {"x-custom", std::string(300, 'z')}};
+  HpackEncoder encoder;
+  HpackDecoder decoder;
+  for (int i = 0; i < 2; ++i) {
+    std::string block;
+    encoder.encode(headers, block);
+    HeaderList decoded;
+    ASSERT_TRUE(decoder.decode(block, decoded));
+    EXPECT_EQ(decoded, headers);
+  }
+  // 编码器不使用动态表
+  EXPECT_EQ(decoder.table_size(), 0);
+}
+
+TEST(HpackTest, EncoderMarksCredentialsNeverIndexed) {
+  HpackEncoder encoder;
+  std::string block;
+  encoder.encode({{"authorization", "x"}}, block);
+  // 表大小更新 0，然后是 authorization（静态表 23）的不索引字面量
+  EXPECT_EQ(to_hex(block.substr(0, 3)), "201f08");
+}
+
+// ============================================================
+// HTTP/2 帧测试
+// ============================================================
+
+TEST(Http2FrameTest, ParsesFrames) {
+  std::string data;
+  append_frame(data, FrameType::Data, FLAG_END_STREAM, 3, "hello");
+  append_frame(data, FrameType::Ping, 0, 0, "12345678");
+
+  std::string_view view = data;
+  Frame frame;
+  ASSERT_EQ(next_frame(view, DEFAULT_MAX_FRAME_SIZE, frame), FrameStatus::Complete);
+  EXPECT_EQ(frame.type, FrameType::Data);
+  EXPECT_EQ(frame.flags, FLAG_END_STREAM);
+  EXPECT_EQ(frame.stream_id, 3);
+  EXPECT_EQ(frame.payload, "hello");
+
+  ASSERT_EQ(next_frame(view, DEFAULT_MAX_FRAME_SIZE, frame), FrameStatus::Complete);
+  EXPECT_EQ(frame.type, FrameType::Ping);
+  EXPECT_EQ(frame.payload, "12345678");
+  EXPECT_TRUE(view.empty());
+}
+
+TEST(Http2FrameTest, WaitsForWholeFrame) {
+  std::string data;
+  append_frame(data, FrameType::Data, 0, 1, std::string(100, 'x'));
+  for (size_t size : {0, 5, 9, 108}) {
+    std::string_view view = std::string_view(data).substr(0, size);
+    Frame frame;
+    EXPECT_EQ(next_frame(view, DEFAULT_MAX_FRAME_SIZE, frame), FrameStatus::Incomplete);
+    EXPECT_EQ(view.size(), size);
+  }
+}
+
+TEST(Http2FrameTest, RejectsOversizedFrame) {
+  std::string data;
+  append_frame_header(data, FrameType::Data, 0, 1, DEFAULT_MAX_FRAME_SIZE + 1);
+  std::string_view view = data;
+  Frame frame;
+  EXPECT_EQ(next_frame(view, DEFAULT_MAX_FRAME_SIZE, frame), FrameStatus::TooLarge);
+}
+
+// ============================================================
+// HTTP/2 客户端测试
+// ============================================================
+
+namespace {
+
+// 本地 TLS 服务器（自签名证书）：ALPN 选 h2 时按 HTTP/2 服务，否则按
+// HTTP/1.1 对每个请求回复 "h1"
+class LocalH2Server {
+ public:
+  struct Request {
+    std::string method;
+    std::string path;
+    std::map<std::string, std::string> headers;
+    std::string body;
+  };
+
+  enum class Action {
+    Respond,
+    Refuse,  // RST_STREAM(REFUSED_STREAM)
+    RespondThenGoaway,  // 回复后发 GOAWAY，不再接受新的流
+    Ignore,  // 不回复
+  };
+
+  struct Response {
+    Action action = Action::Respond;
+    int status = 200;
+    std::string body;
+    std::map<std::string, std::string> headers;
+  };
+
+  using Handler = std::function<Response(const Request&)>;
+
+  // alpn: 服务器选择的协议，空则不选；batch: 凑齐这么多请求后再倒序回复
+  LocalH2Server(Handler handler, std::string alpn = "h2", size_t batch = 1)
+      : handler_(std::move(handler)), alpn_(std::move(alpn)), batch_(batch), context_(asio::ssl::context::tls_server),
+        acceptor_(ctx_, {asio::ip::address_v4::loopback(), 0}) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME_add_entry_by_txt(X509_get_subject_name(cert), "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, X509_get_subject_name(cert));
+    X509_sign(cert, key, EVP_sha256());
+    SSL_CTX_use_certificate(context_.native_handle(), cert);
+    SSL_CTX_use_PrivateKey(context_.native_handle(), key);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    SSL_CTX_set_alpn_select_cb(context_.native_handle(), select_alpn, this);
+
+    thread_ = std::thread([this] {
+      accept_loop();
+    });
+  }
+
+  ~LocalH2Server() {
+    stopping_ = true;
+    asio::ip::tcp::socket wake(ctx_);
+    asio::error_code ec;
+    wake.connect(acceptor_.local_endpoint(), ec);
+    thread_.join();
+    {
+      std::lock_guard lock(mutex_);
+      for (auto& stream : streams_) {
+        stream->lowest_layer().shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+      }
+    }
+    for (auto& worker : workers_) worker.join();
+  }
+
+  std::string url(const std::string& path) const {
+    return "https://127.0.0.1:" + std::to_string(acceptor_.local_endpoint().port()) + path;
+  }
+
+  int connections() const {
+    return accepted_;
+  }
+
+  int streams() const {
+    return streams_opened_;
+  }
+
+  int resets() const {
+    return resets_;
+  }
+
+ private:
+  using TlsStream = asio::ssl::stream<asio::ip::tcp::socket>;
+
+  static int select_alpn(SSL*, const unsigned char** out, unsigned char* out_len, const unsigned char* in, unsigned int in_len, void* arg) {
+    auto* self = static_cast<LocalH2Server*>(arg);
+    if (self->alpn_.empty()) return SSL_TLSEXT_ERR_NOACK;
+    std::string wanted;
+    wanted.push_back(static_cast<char>(self->alpn_.size()));
+    wanted += self->alpn_;
+    unsigned char* selected = nullptr;
+    int result = SSL_select_next_proto(&selected, out_len, reinterpret_cast<const unsigned char*>(wanted.data()), wanted.size(), in, in_len);
+    if (result != OPENSSL_NPN_NEGOTIATED) return SSL_TLSEXT_ERR_NOACK;
+    // 指向客户端列表中的同名协议，握手期间有效
+    for (unsigned int i = 0; i < in_len; i += in[i] + 1) {
+      if (std::string_view(reinterpret_cast<const char*>(in + i + 1), in[i]) == self->alpn_) {
+        *out = in + i + 1;
+        return SSL_TLSEXT_ERR_OK;
+      }
+    }
+    return SSL_TLSEXT_ERR_NOACK;
+  }
+
+  void accept_loop() {
+    while (true) {
+      auto stream = std::make_shared<TlsStream>(ctx_, context_);
+      asio::error_code ec;
+      acceptor_.accept(stream->lowest_layer(), ec);
+      if (ec || stopping_) return;
+      accepted_++;
+      std::lock_guard lock(mutex_);
+      streams_.push_back(stream);
+      workers_.emplace_back([this, stream] {
+        asio::error_code ec;
+        stream->handshake(asio::ssl::stream_base::server, ec);
+        if (ec) return;
+        if (Http2Session::negotiated(stream->native_handle())) {
+          serve_http2(*stream);
+        } else {
+          serve_http1(*stream);
+        }
+      });
+    }
+  }
+
+  void serve_http1(TlsStream& stream) {
+    asio::streambuf buffer;
+    while (true) {
+      asio::error_code ec;
+      size_t head_size = asio::read_until(stream, buffer, "\r\n\r\n", ec);
+      if (ec) return;
+      buffer.consume(head_size);
+      asio::write(stream, asio::buffer(std::string("HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nh1")), ec);
+      if (ec) return;
+    }
+  }
+
+  // --- HTTP/2 ---
+
+  struct Connection {
+    TlsStream& stream;
+    HpackEncoder encoder;
+    HpackDecoder decoder;
+    std::map<uint32_t, Request> open;
+    std::vector<std::pair<uint32_t, Request>> complete;  // 等待凑齐 batch
+    bool goaway = false;
+  };
+
+  void serve_http2(TlsStream& stream) {
+    Connection conn{stream};
+    std::string in;
+    char buffer[16384];
+    asio::error_code ec;
+
+    // 客户端前言
+    while (in.size() < CLIENT_PREFACE.size()) {
+      size_t bytes = stream.read_some(asio::buffer(buffer), ec);
+      if (ec) return;
+      in.append(buffer, bytes);
+    }
+    if (in.compare(0, CLIENT_PREFACE.size(), CLIENT_PREFACE) != 0) return;
+    in.erase(0, CLIENT_PREFACE.size());
+    write_frame(conn, FrameType::Settings, 0, 0, "");
+
+    while (true) {
+      std::string_view view = in;
+      Frame frame;
+      while (next_frame(view, 1 << 24, frame) == FrameStatus::Complete) {
+        if (!on_frame(conn, frame)) return;
+      }
+      in.erase(0, in.size() - view.size());
+
+      size_t bytes = stream.read_some(asio::buffer(buffer), ec);
+      if (ec) return;
+      in.append(buffer, bytes);
+    }
+  }
+
+  bool on_frame(Connection& conn, const Frame& frame) {
+    switch (frame.type) {
+      case FrameType::Settings:
+        if (!(frame.flags & FLAG_ACK)) write_frame(conn, FrameType::Settings, FLAG_ACK, 0, "");
+        return true;
+
+      case FrameType::Headers: {
+        HeaderList fields;
+        if (!conn.decoder.decode(frame.payload, fields)) return false;
+        streams_opened_++;
+        auto& request = conn.open[frame.stream_id];
+        for (auto& [name, value] : fields) {
+          if (name == ":method") {
+            request.method = value;
+          } else if (name == ":path") {
+            request.path = value;
+          } else {
+            request.headers[name] = value;
+          }
+        }
+        if (frame.flags & FLAG_END_STREAM) return on_request(conn, frame.stream_id);
+        return true;
+      }
+
+      case FrameType::Data: {
+        auto it = conn.open.find(frame.stream_id);
+        if (it == conn.open.end()) return true;
+        it->second.body.append(frame.payload);
+        if (!frame.payload.empty()) {
+          // 收到的数据即时归还窗口
+          std::string increment;
+          append_u32(increment, static_cast<uint32_t>(frame.payload.size()));
+          write_frame(conn, FrameType::WindowUpdate, 0, 0, increment);
+          write_frame(conn, FrameType::WindowUpdate, 0, frame.stream_id, increment);
+        }
+        if (frame.flags & FLAG_END_STREAM) return on_request(conn, frame.stream_id);
+        return true;
+      }
+
+      case FrameType::RstStream:
+        resets_++;
+        conn.open.erase(frame.stream_id);
+        return true;
+
+      case FrameType::Goaway:
+        return false;
+
+      default:
+        return true;
+    }
+  }
+
+  bool on_request(Connection& conn, uint32_t stream_id) {
+    conn.complete.emplace_back(stream_id, std::move(conn.open[stream_id]));
+    conn.open.erase(stream_id);
+    if (conn.complete.size() < batch_) return true;
+
+    auto complete = std::move(conn.complete);
+    conn.complete.clear();
+    for (auto it = complete.rbegin(); it != complete.rend(); ++it) {
+      respond(conn, it->first, handler_(it->second));
+    }
+    return true;
+  }
+
+  void respond(Connection& conn, uint32_t stream_id, const Response& response) {
+    if (response.action == Action::Ignore) return;
+    if (response.action == Action::Refuse) {
+      std::string code;
+      append_u32(code, static_cast<uint32_t>(ErrorCode::RefusedStream));
+      write_frame(conn, FrameType::RstStream, 0, stream_id, code);
+      return;
+    }
+
+    HeaderList fields = {{":status", std::to_string(response.status)}};
+    for (const auto& [name, value] : response.headers) fields.emplace_back(name, value);
+    std::string block;
+    conn.encoder.encode(fields, block);
+    // 大的头部块拆成 HEADERS + CONTINUATION
+    std::string_view rest = block;
+    auto type = FrameType::Headers;
+    do {
+      auto piece = rest.substr(0, DEFAULT_MAX_FRAME_SIZE);
+      rest.remove_prefix(piece.size());
+      write_frame(conn, type, rest.empty() ? FLAG_END_HEADERS : 0, stream_id, piece);
+      type = FrameType::Continuation;
+    } while (!rest.empty());
+
+    std::string_view body = response.body;
+    do {
+      auto piece = body.substr(0, DEFAULT_MAX_FRAME_SIZE);
+      body.remove_prefix(piece.size());
+      write_frame(conn, FrameType::Data, body.empty() ? FLAG_END_STREAM : 0, stream_id, piece);
+    } while (!body.empty());
+
+    if (response.action == Action::RespondThenGoaway) {
+      std::string payload;
+      append_u32(payload, stream_id);
+      append_u32(payload, static_cast<uint32_t>(ErrorCode::NoError));
+      write_frame(conn, FrameType::Goaway, 0, 0, payload);
+    }
+  }
+
+  void write_frame(Connection& conn, FrameType type, uint8_t flags, uint32_t stream_id, std::string_view payload) {
+    std::string frame;
+    append_frame(frame, type, flags, stream_id, payload);
+    asio::error_code ec;
+    asio::write(conn.stream, asio::buffer(frame), ec);
+  }
+
+  Handler handler_;
+  std::string alpn_;
+  size_t batch_;
+  asio::io_context ctx_;
+  asio::ssl::context context_;
+  asio::ip::tcp::acceptor acceptor_;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<int> accepted_{0};
+  std::atomic<int> streams_opened_{0};
+  std::atomic<int> resets_{0};
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<TlsStream>> streams_;
+  std::vector<std::thread> workers_;
+};
+
+LocalH2Server::Response echo(const LocalH2Server::Request& request) {
+  LocalH2Server::Response response;
+  response.body = request.method + " " + request.path + " " + std::to_string(request.body.size());
+  return response;
+}
+
+}  // namespace
+
+class Http2Test : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    tls_->context().set_verify_mode(asio::ssl::verify_none);  // 自签名证书
+    runner_ = std::thread([this] {
+      io_ctx_.run();
+    });
+  }
+
+  void TearDown() override {
+    work_.reset();
+    runner_.join();
+  }
+
+  HttpPoolOptions http2_options() const {
+    HttpPoolOptions options;
+    options.http2 = true;
+    return options;
+  }
+
+  asio::io_context io_ctx_;
+  asio::executor_work_guard<asio::io_context::executor_type> work_ = asio::make_work_guard(io_ctx_);
+  std::thread runner_;
+  std::shared_ptr<TlsContext> tls_ = std::make_shared<TlsContext>();
+};
+
+TEST_F(Http2Test, MultiplexesConcurrentRequests) {
+  // 服务器凑齐 4 个请求后才回复：只有并发的流才能完成
+  LocalH2Server server(echo, "h2", 4);
+  {
+    HttpClient client(io_ctx_, http2_options(), tls_);
+    std::vector<std::future<HttpResponse>> responses;
+    for (int i = 0; i < 4; ++i) {
+      responses.push_back(client.get(server.url("/item?i=" + std::to_string(i)), {{"Accept", "text/plain"}}));
+    }
+    for (int i = 0; i < 4; ++i) {
+      auto response = responses[i].get();
+      EXPECT_EQ(response.status_code, 200) << response.error;
+      EXPECT_EQ(response.body, "GET /item?i=" + std::to_string(i) + " 0");
+    }
+
+    EXPECT_EQ(server.connections(), 1);
+    auto stats = client.pool_stats();
+    EXPECT_EQ(stats.http2, 1);
+    EXPECT_EQ(stats.hits, 3);
+    EXPECT_EQ(stats.misses, 1);
+  }
+}
+
+TEST_F(Http2Test, StreamsLargeBodiesWithinFlowControl) {
+  // 请求体和响应体都超过默认的 64 KiB 窗口
+  LocalH2Server server([](const LocalH2Server::Request& request) {
+    LocalH2Server::Response response;
+    response.headers["content-type"] = "text/event-stream";
+    response.body = std::string(300000, 'd') + std::to_string(request.body.size());
+    return response;
+  });
+  HttpClient client(io_ctx_, http2_options(), tls_);
+
+  for (int i = 0; i < 2; ++i) {
+    std::promise<std::pair<int, std::string>> done;
+    std::string data;
+    client.request_stream(
+        server.url("/v1/messages"), HttpOptions{"POST", {{"Content-Type", "application/json"}}, std::string(200000, 'b')},
+        [&data](std::string_view chunk) {
+          data += chunk;
+        },
+        [&done](int status, const std::string& error) {
+          done.set_value({status, error});
+        });
+    auto [status, error] = done.get_future().get();
+    EXPECT_EQ(status, 200);
+    EXPECT_TRUE(error.empty()) << error;
+    EXPECT_EQ(data, std::string(300000, 'd') + "200000");
+  }
+  EXPECT_EQ(server.connections(), 1);
+}
+
+TEST_F(Http2Test, ReceivesContinuedHeaderBlock) {
+  LocalH2Server server([](const LocalH2Server::Request&) {
+    LocalH2Server::Response response;
+    response.headers["x-large"] = std::string(40000, 'h');
+    response.body = "ok";
+    return response;
+  });
+  HttpClient client(io_ctx_, http2_options(), tls_);
+
+  auto response = client.get(server.url("/")).get();
+  EXPECT_EQ(response.status_code, 200) << response.error;
+  EXPECT_EQ(response.headers["x-large"].size(), 40000);
+  EXPECT_EQ(response.body, "ok");
+}
+
+TEST_F(Http2Test, FallsBackToHttp11) {
+  for (std::string alpn : {"http/1.1", ""}) {
+    LocalH2Server server(echo, alpn);
+    HttpClient client(io_ctx_, http2_options(), tls_);
+
+    for (int i = 0; i < 2; ++i) {
+      auto response = client.get(server.url("/")).get();
+      EXPECT_EQ(response.status_code, 200) << response.error;
+      EXPECT_EQ(response.body, "h1");
+    }
+    EXPECT_EQ(server.connections(), 1);
+    EXPECT_EQ(client.pool_stats().http2, 0);
+    EXPECT_EQ(client.pool_stats().idle, 1);
+  }
+}
+
+TEST_F(Http2Test, DisabledUsesHttp11) {
+  LocalH2Server server(echo);
+  HttpClient client(io_ctx_, HttpPoolOptions{}, tls_);
+
+  auto response = client.get(server.url("/")).get();
+  EXPECT_EQ(response.body, "h1");
+  EXPECT_EQ(server.streams(), 0);
+}
+
+TEST_F(Http2Test, RetriesRefusedStream) {
+  std::atomic<int> requests{0};
+  LocalH2Server server([&requests](const LocalH2Server::Request& request) {
+    if (requests++ == 0) return LocalH2Server::Response{LocalH2Server::Action::Refuse};
+    return echo(request);
+  });
+  HttpClient client(io_ctx_, http2_options(), tls_);
+
+  auto response = client.post(server.url("/retry"), "{}").get();
+  EXPECT_EQ(response.status_code, 200) << response.error;
+  EXPECT_EQ(response.body, "POST /retry 2");
+  EXPECT_EQ(server.streams(), 2);
+  EXPECT_EQ(server.connections(), 1);
+}
+
+TEST_F(Http2Test, GoawayMovesToNewConnection) {
+  LocalH2Server server([](const LocalH2Server::Request& request) {
+    auto response = echo(request);
+    response.action = LocalH2Server::Action::RespondThenGoaway;
+    return response;
+  });
+  HttpClient client(io_ctx_, http2_options(), tls_);
+
+  for (int i = 0; i < 3; ++i) {
+    auto response = client.get(server.url("/")).get();
+    EXPECT_EQ(response.status_code, 200) << response.error;
+    EXPECT_EQ(response.body, "GET / 0");
+  }
+  EXPECT_EQ(server.connections(), 3);
+}
+
+TEST_F(Http2Test, TimeoutCancelsOnlyTheStream) {
+  LocalH2Server server([](const LocalH2Server::Request& request) {
+    if (request.path == "/slow") return LocalH2Server::Response{LocalH2Server::Action::Ignore};
+    return echo(request);
+  });
+  HttpClient client(io_ctx_, http2_options(), tls_);
+
+  HttpOptions options;
+  options.timeout = std::chrono::seconds(1);
+  auto slow = client.request(server.url("/slow"), options).get();
+  EXPECT_EQ(slow.status_code, 0);
+  EXPECT_EQ(slow.error, "Request timed out");
+
+  // 连接不受影响，超时的流已被重置
+  auto response = client.get(server.url("/fast")).get();
+  EXPECT_EQ(response.body, "GET /fast 0");
+  EXPECT_EQ(server.connections(), 1);
+  EXPECT_EQ(server.resets(), 1);
+}
+
+TEST_F(Http2Test, SharesConnectionAcrossClients) {
+  LocalH2Server server(echo);
+  HttpClient first(io_ctx_, http2_options(), tls_);
+  HttpClient second(io_ctx_, http2_options(), tls_);
+
+  EXPECT_EQ(first.get(server.url("/a")).get().body, "GET /a 0");
+  EXPECT_EQ(second.get(server.url("/b")).get().body, "GET /b 0");
+  EXPECT_EQ(server.connections(), 1);
+  EXPECT_EQ(second.pool_stats().http2, 1);
+  EXPECT_EQ(second.pool_stats().hits, 1);
+
+  // 其他 TLS 设置的客户端不共享
+  auto other_tls = std::make_shared<TlsContext>();
+  other_tls->context().set_verify_mode(asio::ssl::verify_none);
+  HttpClient third(io_ctx_, http2_options(), other_tls);
+  EXPECT_EQ(third.get(server.url("/c")).get().body, "GET /c 0");
+  EXPECT_EQ(server.connections(), 2);
+}
@@ -0,0 +1,409 @@
+#include <gtest/gtest.h>
+
+#include <random>
+#include <regex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "net/http_parser.hpp"
+
+using namespace agent::net;
+
+namespace {
+
+// 解析结果，便于比较不同切分方式下的输出
+struct Parsed {
+  bool complete = false;
+  bool failed = false;
+  bool keep_alive = false;
+  int status = 0;
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::string body;
+  size_t used = 0;
+
+  bool operator==(const Parsed&) const = default;
+};
+
+// 按给定切分点逐段喂入，连接在末尾关闭（若 close_at_end）
+Parsed parse_pieces(const std::string& response, const std::vector<size_t>& cuts, bool head_request = false, bool close_at_end = false) {
+  Parsed result;
+  HttpResponseParser parser(head_request);
+  parser.on_header = [&](std::string_view name, std::string_view value) {
+    result.headers.emplace_back(name, value);
+  };
+  parser.on_body = [&](std::string_view data) {
+    result.body.append(data);
+  };
+
+  size_t start = 0;
+  auto feed = [&](size_t end) {
+    result.used += parser.feed(std::string_view(response).substr(start, end - start));
+    start = end;
+  };
+  for (size_t cut : cuts) {
+    if (parser.complete() || parser.failed()) break;
+    feed(cut);
+  }
+  if (!parser.complete() && !parser.failed()) feed(response.size());
+  if (close_at_end) parser.finish();
+
+  result.complete = parser.complete();
+  result.failed = parser.failed();
+  result.keep_alive = parser.keep_alive();
+  result.status = parser.status_code();
+  return result;
+}
+
+Parsed parse_whole(const std::string& response, bool head_request = false, bool close_at_end = false) {
+  return parse_pieces(response, {}, head_request, close_at_end);
+}
+
+std::vector<size_t> random_cuts(std::mt19937& rng, size_t size) {
+  std::vector<size_t> cuts;
+  std::uniform_int_distribution<size_t> step(1, 8);
+  for (size_t at = step(rng); at < size; at += step(rng)) {
+    cuts.push_back(at);
+  }
+  return cuts;
+}
+
+const std::string CONTENT_LENGTH_RESPONSE =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: application/json\r\n"
+    "Content-Length: 13\r\n"
+    "\r\n"
+    "{\"ok\": true}\n";
+
+const std::string CHUNKED_RESPONSE =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n"
+    "19;name=value\r\n"
+    "data: {\"text\": \"hello\"}\n\n\r\n"
+    "B\r\n"
+    "data: done\n\r\n"
+    "0\r\n"
+    "X-Trailer: yes\r\n"
+    "\r\n";
+
+const std::string INTERIM_RESPONSES =
+    "HTTP/1.1 100 Continue\r\n"
+    "\r\n"
+    "HTTP/1.1 103 Early Hints\r\n"
+    "Link: </style.css>; rel=preload\r\n"
+    "Content-Length: 99\r\n"
+    "\r\n";
+
+}  // namespace
+
+// ============================================================
+// 基本解析
+// ============================================================
+
+TEST(HttpResponseParserTest, ContentLength) {
+  auto result = parse_whole(CONTENT_LENGTH_RESPONSE);
+  EXPECT_TRUE(result.complete);
+  EXPECT_TRUE(result.keep_alive);
+  EXPECT_EQ(result.status, 200);
+  EXPECT_EQ(result.body, "{\"ok\": true}\n");
+  ASSERT_EQ(result.headers.size(), 2u);
+  EXPECT_EQ(result.headers[0], std::make_pair(std::string("Content-Type"), std::string("application/json")));
+}
+
+TEST(HttpResponseParserTest, ChunkedWithExtensionsAndTrailers) {
+  auto result = parse_whole(CHUNKED_RESPONSE);
+  EXPECT_TRUE(result.complete);
+  EXPECT_TRUE(result.keep_alive);
+  EXPECT_EQ(result.body, "data: {\"text\": \"hello\"}\n\ndata: done\n");
+  ASSERT_EQ(result.headers.size(), 3u);
+  EXPECT_EQ(result.headers[2].first, "X-Trailer");
+}
+
+TEST(HttpResponseParserTest, StopsAtEndOfResponse) {
+  // 后续字节属于下一个响应，不应被消费
+  auto result = parse_whole(CONTENT_LENGTH_RESPONSE + "HTTP/1.1 204 No Content\r\n\r\n");
+  EXPECT_TRUE(result.complete);
+  EXPECT_EQ(result.used, CONTENT_LENGTH_RESPONSE.size());
+}
+
+TEST(HttpResponseParserTest, BodyUntilClose) {
+  std::string response = "HTTP/1.1 200 OK\r\n\r\npart one, part two";
+  auto open = parse_whole(response);
+  EXPECT_FALSE(open.complete);
+  EXPECT_EQ(open.body, "part one, part two");
+
+  auto closed = parse_whole(response, false, true);
+  EXPECT_TRUE(closed.complete);
+  EXPECT_FALSE(closed.keep_alive);
+  EXPECT_EQ(closed.body, "part one, part two");
+}
+
+TEST(HttpResponseParserTest, NoBodyResponses) {
+  auto head = parse_whole("HTTP/1.1 200 OK\r\nContent-Length: 100\r\n\r\n", true);
+  EXPECT_TRUE(head.complete);
+  EXPECT_TRUE(head.body.empty());
+
+  auto no_content = parse_whole("HTTP/1.1 204 No Content\r\n\r\n");
+  EXPECT_TRUE(no_content.complete);
+  EXPECT_TRUE(no_content.keep_alive);
+
+  auto not_modified = parse_whole("HTTP/1.1 304 Not Modified\r\nContent-Length: 10\r\n\r\n");
+  EXPECT_TRUE(not_modified.complete);
+}
+
+TEST(HttpResponseParserTest, KeepAlive) {
+  EXPECT_FALSE(parse_whole("HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 0\r\n\r\n").keep_alive);
+  EXPECT_FALSE(parse_whole("HTTP/1.0 200 OK\r\nContent-Length: 0\r\n\r\n").keep_alive);
+  EXPECT_TRUE(parse_whole("HTTP/1.0 200 OK\r\nConnection: Keep-Alive\r\nContent-Length: 0\r\n\r\n").keep_alive);
+  EXPECT_TRUE(parse_whole("HTTP/1.1 200 OK\r\nConnection: upgrade, keep-alive\r\nContent-Length: 0\r\n\r\n").keep_alive);
+}
+
+TEST(HttpResponseParserTest, LfLineEndings) {
+  auto result = parse_whole("HTTP/1.1 404 Not Found\nContent-Length: 4\n\nnope");
+  EXPECT_TRUE(result.complete);
+  EXPECT_EQ(result.status, 404);
+  EXPECT_EQ(result.body, "nope");
+}
+
+TEST(HttpResponseParserTest, StatusLineWithoutReason) {
+  auto result = parse_whole("HTTP/1.1 500\r\nContent-Length: 0\r\n\r\n");
+  EXPECT_TRUE(result.complete);
+  EXPECT_EQ(result.status, 500);
+}
+
+TEST(HttpResponseParserTest, SkipsInterimResponses) {
+  // 1xx 临时响应（101 除外）被跳过，其字段不计入最终响应
+  std::string response = INTERIM_RESPONSES + CONTENT_LENGTH_RESPONSE + "HTTP/1.1 204 No Content\r\n\r\n";
+  int headers_completed = 0;
+  HttpResponseParser parser;
+  std::vector<std::string> names;
+  parser.on_header = [&](std::string_view name, std::string_view) {
+    names.emplace_back(name);
+  };
+  parser.on_headers_complete = [&]() {
+    headers_completed++;
+    EXPECT_EQ(parser.status_code(), 200);
+  };
+  EXPECT_EQ(parser.feed(response), INTERIM_RESPONSES.size() + CONTENT_LENGTH_RESPONSE.size());
+  EXPECT_TRUE(parser.complete());
+  EXPECT_TRUE(parser.keep_alive());
+  EXPECT_EQ(parser.status_code(), 200);
+  EXPECT_EQ(headers_completed, 1);
+  EXPECT_EQ(names, (std::vector<std::string>{"Content-Type", "Content-Length"}));
+
+  auto chunked = parse_whole(INTERIM_RESPONSES + CHUNKED_RESPONSE);
+  auto expected = parse_whole(CHUNKED_RESPONSE);
+  expected.used += INTERIM_RESPONSES.size();
+  EXPECT_EQ(chunked, expected);
+
+  // 只有临时响应时尚未完成
+  auto pending = parse_whole(INTERIM_RESPONSES);
+  EXPECT_FALSE(pending.complete);
+  EXPECT_FALSE(pending.failed);
+  EXPECT_EQ(pending.status, 0);
+}
+
+TEST(HttpResponseParserTest, SwitchingProtocolsEndsResponse) {
+  auto result = parse_whole("HTTP/1.1 101 Switching Protocols\r\nUpgrade: h2c\r\nConnection: Upgrade\r\n\r\nnot http");
+  EXPECT_TRUE(result.complete);
+  EXPECT_EQ(result.status, 101);
+  EXPECT_TRUE(result.body.empty());
+}
+
+// ============================================================
+// 错误输入
+// ============================================================
+
+TEST(HttpResponseParserTest, RejectsMalformedInput) {
+  const char* bad[] = {
+      "HTTP/2 200 OK\r\n\r\n",
+      "HTTP/1.1 20 OK\r\n\r\n",
+      "HTTP/1.1 2000 OK\r\n\r\n",
+      "ICY 200 OK\r\n\r\n",
+      "HTTP/1.1 200 OK\r\nContent-Length: -1\r\n\r\n",
+      "HTTP/1.1 200 OK\r\nContent-Length: 1\r\nContent-Length: 2\r\n\r\n",
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n",
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n2\r\nabc\r\n0\r\n\r\n",
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nfffffffffffffffff\r\n",
+  };
+  for (const char* response : bad) {
+    HttpResponseParser parser;
+    parser.feed(response);
+    EXPECT_TRUE(parser.failed()) << response;
+    EXPECT_FALSE(parser.error().empty());
+  }
+}
+
+TEST(HttpResponseParserTest, ClosedEarly) {
+  HttpResponseParser headers;
+  headers.feed("HTTP/1.1 200 OK\r\nContent-");
+  EXPECT_FALSE(headers.finish());
+  EXPECT_FALSE(headers.headers_complete());
+  EXPECT_TRUE(headers.failed());
+
+  HttpResponseParser body;
+  body.feed("HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nshort");
+  EXPECT_TRUE(body.headers_complete());
+  EXPECT_FALSE(body.finish());
+  EXPECT_TRUE(body.failed());
+}
+
+TEST(HttpResponseParserTest, HeaderTooLarge) {
+  HttpResponseParser parser;
+  parser.feed("HTTP/1.1 200 OK\r\nX-Big: ");
+  std::string filler(4096, 'a');
+  for (int i = 0; i < 20 && !parser.failed(); ++i) {
+    parser.feed(filler);
+  }
+  EXPECT_TRUE(parser.failed());
+}
+
+// ============================================================
+// 随机切分与变异
+// ============================================================
+
+TEST(HttpResponseParserTest, RandomSplitsGiveSameResult) {
+  std::mt19937 rng(20240601);
+  const std::pair<std::string, bool> cases[] = {
+      {CONTENT_LENGTH_RESPONSE, false},
+      {CHUNKED_RESPONSE, false},
+      {"HTTP/1.1 200 OK\nConnection: close\n\nuntil the connection closes", true},
+      {"HTTP/1.1 204 No Content\r\nX-Id: 1\r\n\r\n", false},
+      {INTERIM_RESPONSES + CONTENT_LENGTH_RESPONSE, false},
+  };
+  for (const auto& [response, close_at_end] : cases) {
+    auto expected = parse_whole(response, false, close_at_end);
+    ASSERT_TRUE(expected.complete) << response;
+    for (int round = 0; round < 500; ++round) {
+      auto result = parse_pieces(response, random_cuts(rng, response.size()), false, close_at_end);
+      ASSERT_EQ(result, expected) << response;
+    }
+  }
+}
+
+TEST(HttpResponseParserTest, SplitAtEveryByte) {
+  std::vector<size_t> cuts;
+  for (size_t i = 1; i < CHUNKED_RESPONSE.size(); ++i) cuts.push_back(i);
+  EXPECT_EQ(parse_pieces(CHUNKED_RESPONSE, cuts), parse_whole(CHUNKED_RESPONSE));
+}
+
+TEST(HttpResponseParserTest, MutatedInputEndsCleanly) {
+  std::mt19937 rng(7);
+  const std::string alphabet = "HTP/1. 0123456789abcdefxz:;\r\n\t-";
+  for (int round = 0; round < 2000; ++round) {
+    const std::string bases[] = {CONTENT_LENGTH_RESPONSE, CHUNKED_RESPONSE, INTERIM_RESPONSES + CHUNKED_RESPONSE};
+    std::string response = bases[round % 3];
+    int mutations = std::uniform_int_distribution<int>(1, 6)(rng);
+    for (int i = 0; i < mutations; ++i) {
+      size_t at = std::uniform_int_distribution<size_t>(0, response.size() - 1)(rng);
+      char c = alphabet[std::uniform_int_distribution<size_t>(0, alphabet.size() - 1)(rng)];
+      switch (rng() % 3) {
+        case 0:
+          response[at] = c;
+          break;
+        case 1:
+          response.insert(response.begin() + static_cast<std::ptrdiff_t>(at), c);
+          break;
+        default:
+          response.erase(at, 1);
+          break;
+      }
+    }
+
+    auto whole = parse_whole(response, false, true);
+    EXPECT_NE(whole.complete, whole.failed) << response;
+    EXPECT_LE(whole.used, response.size());
+    // 切分方式不影响结果
+    EXPECT_EQ(parse_pieces(response, random_cuts(rng, response.size()), false, true), whole) << response;
+  }
+}
+
+TEST(HttpResponseParserTest, RandomBytesNeverCrash) {
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> byte(0, 255);
+  for (int round = 0; round < 1000; ++round) {
+    std::string data(std::uniform_int_distribution<size_t>(0, 256)(rng), '\0');
+    for (auto& c : data) c = static_cast<char>(byte(rng));
+    if (round % 2) data = "HTTP/1.1 200 OK\r\n" + data;
+
+    HttpResponseParser parser;
+    EXPECT_LE(parser.feed(data), data.size());
+    parser.finish();
+    EXPECT_NE(parser.complete(), parser.failed());
+  }
+}
+
+// ============================================================
+// 状态行
+// ============================================================
+
+TEST(StatusLineTest, ParsesFields) {
+  auto status = parse_status_line("HTTP/1.0 404 Not Found");
+  ASSERT_TRUE(status.has_value());
+  EXPECT_EQ(status->major, 1);
+  EXPECT_EQ(status->minor, 0);
+  EXPECT_EQ(status->code, 404);
+  EXPECT_EQ(status->reason, "Not Found");
+
+  auto bare = parse_status_line("HTTP/2.0 200");
+  ASSERT_TRUE(bare.has_value());
+  EXPECT_EQ(bare->major, 2);
+  EXPECT_EQ(bare->code, 200);
+  EXPECT_TRUE(bare->reason.empty());
+
+  auto empty_reason = parse_status_line("HTTP/1.1 200 ");
+  ASSERT_TRUE(empty_reason.has_value());
+  EXPECT_TRUE(empty_reason->reason.empty());
+}
+
+TEST(StatusLineTest, RejectsMalformed) {
+  const char* bad[] = {"", "HTTP/1.1", "HTTP/1.1 20", "HTTP/1.1 2000", "HTTP/1.1 20x OK", "HTTP/11 200 OK", "HTTP/1.1  200 OK",
+                       "http/1.1 200 OK", " HTTP/1.1 200 OK", "HTTP/1.1 200\tOK", "ICY 200 OK"};
+  for (const char* line : bad) {
+    EXPECT_FALSE(parse_status_line(line).has_value()) << line;
+  }
+}
+
+// 与此前 std::regex 的结果对照：解析成功的行，旧正则给出同一个状态码
+TEST(StatusLineTest, AgreesWithFormerRegex) {
+  const std::regex former(R"(HTTP/([\d.]+) (\d+))");
+  std::mt19937 rng(2025);
+  const std::string alphabet = "HTP/1.0 23459xOK\t";
+  const char* reasons[] = {"", " ", " OK", " Not Found", " Internal Server Error"};
+  int accepted = 0;
+  for (int round = 0; round < 5000; ++round) {
+    std::string line = "HTTP/" + std::to_string(rng() % 3) + "." + std::to_string(rng() % 2) + " " + std::to_string(100 + rng() % 500) +
+                       reasons[rng() % std::size(reasons)];
+    bool mutated = round % 2;
+    if (mutated) {
+      size_t at = std::uniform_int_distribution<size_t>(0, line.size() - 1)(rng);
+      char c = alphabet[std::uniform_int_distribution<size_t>(0, alphabet.size() - 1)(rng)];
+      switch (rng() % 3) {
+        case 0:
+          line[at] = c;
+          break;
+        case 1:
+          line.insert(line.begin() + static_cast<std::ptrdiff_t>(at), c);
+          break;
+        default:
+          line.erase(at, 1);
+          break;
+      }
+    }
+
+    auto status = parse_status_line(line);
+    std::smatch match;
+    bool regex_found = std::regex_search(line, match, former);
+    if (!mutated) {
+      ASSERT_TRUE(status.has_value()) << line;
+    }
+    if (!status) continue;
+    accepted++;
+    ASSERT_TRUE(regex_found) << line;
+    EXPECT_EQ(status->code, std::stoi(match[2].str())) << line;
+    EXPECT_EQ(std::to_string(status->major) + "." + std::to_string(status->minor), match[1].str()) << line;
+  }
+  EXPECT_GT(accepted, 2500);
+}
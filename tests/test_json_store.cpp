@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
 
 #include <filesystem>
+#include <fstream>
+#include <thread>
 
+#include "core/compress.hpp"
 #include "core/json_store.hpp"
 #include "session/session.hpp"
 
@@ -195,6 +198,213 @@ TEST_F(JsonStoreTest, ToolCallMessageRoundTrip) {
   EXPECT_EQ(loaded[0].finish_reason(), FinishReason::ToolCalls);
 }
 
+TEST_F(JsonStoreTest, MessageIndexPersisted) {
+  auto msg = Message::user("Indexed");
+  msg.set_session_id("session-idx");
+  store_->save(msg);
+
+  EXPECT_TRUE(fs::exists(test_dir_ / "message_index.bin"));
+
+  auto store2 = std::make_shared<JsonMessageStore>(test_dir_);
+  auto loaded = store2->get(msg.id());
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(loaded->session_id(), "session-idx");
+}
+
+TEST_F(JsonStoreTest, MessageIndexRebuiltWhenMissing) {
+  auto msg = Message::user("Rebuild me");
+  msg.set_session_id("session-idx");
+  store_->save(msg);
+  fs::remove(test_dir_ / "message_index.bin");
+
+  auto store2 = std::make_shared<JsonMessageStore>(test_dir_);
+  ASSERT_TRUE(store2->get(msg.id()).has_value());
+  EXPECT_TRUE(fs::exists(test_dir_ / "message_index.bin"));
+
+  store2->remove(msg.id());
+  EXPECT_TRUE(store2->list("session-idx").empty());
+  EXPECT_FALSE(store2->get(msg.id()).has_value());
+}
+
+TEST_F(JsonStoreTest, MessageIndexRebuiltWhenStale) {
+  auto msg = Message::user("Moved");
+  msg.set_session_id("session-a");
+  store_->save(msg);
+
+  // Move the session's messages behind the index's back
+  fs::rename(test_dir_ / "session-a", test_dir_ / "session-b");
+
+  auto loaded = store_->get(msg.id());
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(loaded->text(), "Moved");
+}
+
+TEST_F(JsonStoreTest, MessageIndexSeesOtherInstances) {
+  auto first = Message::user("First");
+  first.set_session_id("session-1");
+  store_->save(first);
+  ASSERT_TRUE(store_->get(first.id()).has_value());
+
+  JsonMessageStore other(test_dir_);
+  auto second = Message::user("Second");
+  second.set_session_id("session-2");
+  other.save(second);
+
+  auto loaded = store_->get(second.id());
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(loaded->text(), "Second");
+}
+
+TEST_F(JsonStoreTest, MessageIndexCompactionKeepsOtherInstancesEntries) {
+  JsonStoreOptions options;
+  options.mode = StoreMode::Journal;
+  JsonMessageStore store(test_dir_, options);
+  auto first = Message::user("First");
+  first.set_session_id("session-1");
+  store.save(first);
+
+  JsonMessageStore other(test_dir_, options);
+  auto second = Message::user("Second");
+  second.set_session_id("session-2");
+  other.save(second);
+  other.flush();
+
+  // Enough churn that this instance rewrites the index log
+  for (int i = 0; i < 600; ++i) {
+    auto msg = Message::user("churn");
+    msg.set_session_id("session-churn");
+    store.save(msg);
+  }
+  store.remove_session("session-churn");
+
+  JsonMessageStore reader(test_dir_, options);
+  ASSERT_TRUE(reader.get(second.id()).has_value());
+  ASSERT_TRUE(reader.get(first.id()).has_value());
+  EXPECT_TRUE(store.get(second.id()).has_value());
+}
+
+TEST_F(JsonStoreTest, RemoveSessionDropsIndexEntries) {
+  auto msg = Message::user("Gone");
+  msg.set_session_id("session-gone");
+  store_->save(msg);
+
+  store_->remove_session("session-gone");
+  EXPECT_FALSE(store_->get(msg.id()).has_value());
+
+  auto store2 = std::make_shared<JsonMessageStore>(test_dir_);
+  EXPECT_FALSE(store2->get(msg.id()).has_value());
+}
+
+TEST_F(JsonStoreTest, SessionIndexUpsertsAreJournaled) {
+  SessionMeta meta;
+  meta.id = "sess-j";
+  meta.title = "v1";
+  store_->save_session(meta);
+  meta.title = "v2";
+  store_->save_session(meta);
+
+  EXPECT_TRUE(fs::exists(test_dir_ / "sessions.jsonl"));
+
+  auto store2 = std::make_shared<JsonMessageStore>(test_dir_);
+  auto sessions = store2->list_sessions();
+  ASSERT_EQ(sessions.size(), 1);
+  EXPECT_EQ(sessions[0].title, "v2");
+}
+
+TEST_F(JsonStoreTest, SessionIndexCompacts) {
+  JsonStoreOptions options;
+  options.journal_compact_threshold = 4;
+  JsonMessageStore store(test_dir_, options);
+
+  for (int i = 0; i < 4; ++i) {
+    SessionMeta meta;
+    meta.id = "sess-" + std::to_string(i);
+    store.save_session(meta);
+  }
+
+  EXPECT_TRUE(fs::exists(test_dir_ / "sessions.json"));
+  EXPECT_FALSE(fs::exists(test_dir_ / "sessions.jsonl"));
+
+  JsonMessageStore reader(test_dir_);
+  EXPECT_EQ(reader.session_count(), 4);
+}
+
+TEST_F(JsonStoreTest, SessionIndexSeesOtherInstances) {
+  SessionMeta meta;
+  meta.id = "sess-1";
+  store_->save_session(meta);
+  ASSERT_EQ(store_->session_count(), 1);
+
+  JsonMessageStore other(test_dir_);
+  meta.id = "sess-2";
+  other.save_session(meta);
+  other.remove_session("sess-1");
+
+  auto sessions = store_->list_sessions();
+  ASSERT_EQ(sessions.size(), 1);
+  EXPECT_EQ(sessions[0].id, "sess-2");
+}
+
+TEST_F(JsonStoreTest, SessionIndexAppendsAfterOtherInstanceCompacts) {
+  SessionMeta meta;
+  meta.id = "sess-1";
+  store_->save_session(meta);
+
+  // The other instance folds sessions.jsonl into sessions.json and removes it
+  JsonStoreOptions options;
+  options.journal_compact_threshold = 1;
+  JsonMessageStore other(test_dir_, options);
+  meta.id = "sess-2";
+  other.save_session(meta);
+  ASSERT_FALSE(fs::exists(test_dir_ / "sessions.jsonl"));
+
+  meta.id = "sess-3";
+  store_->save_session(meta);
+
+  JsonMessageStore reader(test_dir_);
+  EXPECT_EQ(reader.session_count(), 3);
+  EXPECT_TRUE(reader.get_session("sess-3").has_value());
+}
+
+TEST_F(JsonStoreTest, ListSessionsPaginatedByUpdatedAt) {
+  auto now = std::chrono::system_clock::now();
+  for (int i = 0; i < 5; ++i) {
+    SessionMeta meta;
+    meta.id = "sess-" + std::to_string(i);
+    meta.updated_at = now + std::chrono::seconds(i);
+    store_->save_session(meta);
+  }
+
+  // Touch the oldest session so it moves to the front
+  auto oldest = store_->get_session("sess-0");
+  ASSERT_TRUE(oldest.has_value());
+  oldest->updated_at = now + std::chrono::seconds(10);
+  store_->save_session(*oldest);
+
+  EXPECT_EQ(store_->session_count(), 5);
+
+  auto first = store_->list_sessions(0, 2);
+  ASSERT_EQ(first.size(), 2);
+  EXPECT_EQ(first[0].id, "sess-0");
+  EXPECT_EQ(first[1].id, "sess-4");
+
+  auto second = store_->list_sessions(2, 2);
+  ASSERT_EQ(second.size(), 2);
+  EXPECT_EQ(second[0].id, "sess-3");
+  EXPECT_EQ(second[1].id, "sess-2");
+
+  auto last = store_->list_sessions(4, 2);
+  ASSERT_EQ(last.size(), 1);
+  EXPECT_EQ(last[0].id, "sess-1");
+
+  EXPECT_TRUE(store_->list_sessions(5, 2).empty());
+
+  // Unpaginated listing keeps creation order
+  auto all = store_->list_sessions();
+  ASSERT_EQ(all.size(), 5);
+  EXPECT_EQ(all[0].id, "sess-0");
+}
+
 // Integration test: Session with store
 class SessionResumeTest : public ::testing::Test {
  protected:
@@ -243,6 +453,61 @@ TEST_F(SessionResumeTest, ResumeFromStore) {
   EXPECT_EQ(resumed->messages()[1].text(), "Hi! How can I help?");
 }
 
+TEST_F(SessionResumeTest, ResumeFromLastSummary) {
+  asio::io_context io_ctx;
+
+  auto session = Session::create(io_ctx, config_, AgentType::Build, store_);
+  auto session_id = session->id();
+  session->add_message(Message::user("Old question"));
+  session->add_message(Message::assistant("Old answer"));
+  auto summary = Message::assistant("Summary of the old part");
+  summary.set_summary(true);
+  summary.set_finished(true);
+  session->add_message(summary);
+  session->add_message(Message::user("New question"));
+  session.reset();
+
+  auto resumed = Session::resume(io_ctx, config_, session_id, store_, true);
+  ASSERT_NE(resumed, nullptr);
+  ASSERT_EQ(resumed->messages().size(), 2);
+  EXPECT_TRUE(resumed->messages()[0].is_summary());
+  EXPECT_EQ(resumed->messages()[1].text(), "New question");
+
+  // Older history is loaded on demand
+  ASSERT_TRUE(resumed->has_older_messages());
+  EXPECT_EQ(resumed->load_older_messages(1), 1);
+  EXPECT_EQ(resumed->messages()[0].text(), "Old answer");
+  EXPECT_EQ(resumed->load_older_messages(10), 1);
+  EXPECT_EQ(resumed->messages()[0].text(), "Old question");
+  EXPECT_EQ(resumed->messages().size(), 4);
+  EXPECT_FALSE(resumed->has_older_messages());
+  EXPECT_EQ(resumed->load_older_messages(10), 0);
+}
+
+TEST_F(SessionResumeTest, ResumeDropsUnfinishedSummary) {
+  asio::io_context io_ctx;
+
+  auto session = Session::create(io_ctx, config_, AgentType::Build, store_);
+  auto session_id = session->id();
+  session->add_message(Message::user("Question"));
+  // Marker of a background summary; the process ends before it is filled in
+  Message marker(Role::Assistant, "");
+  marker.set_summary(true);
+  marker.set_synthetic(true);
+  session->add_message(std::move(marker));
+  session->add_message(Message::assistant("Answer"));
+  session.reset();
+
+  for (bool from_last_summary : {true, false}) {
+    auto resumed = Session::resume(io_ctx, config_, session_id, store_, from_last_summary);
+    ASSERT_NE(resumed, nullptr);
+    ASSERT_EQ(resumed->messages().size(), 2);
+    EXPECT_EQ(resumed->messages()[0].text(), "Question");
+    EXPECT_EQ(resumed->messages()[1].text(), "Answer");
+  }
+  EXPECT_EQ(store_->list(session_id).size(), 2);
+}
+
 TEST_F(SessionResumeTest, ResumeNonexistent) {
   asio::io_context io_ctx;
 
@@ -325,3 +590,642 @@ TEST_F(SessionResumeTest, MessageCreatedAtPersistence) {
   auto diff = std::chrono::duration_cast<std::chrono::seconds>(original_time - loaded_time).count();
   EXPECT_LE(std::abs(diff), 1);
 }
+
+// Journal mode: append-only messages.jsonl with periodic compaction
+class JournalStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    test_dir_ = fs::temp_directory_path() / ("agent_journal_test_" + UUID::generate());
+    options_.mode = StoreMode::Journal;
+    options_.journal_sync_every = 4;
+    options_.journal_compact_threshold = 8;
+    store_ = std::make_shared<JsonMessageStore>(test_dir_, options_);
+  }
+
+  void TearDown() override {
+    store_.reset();
+    std::error_code ec;
+    fs::remove_all(test_dir_, ec);
+  }
+
+  fs::path test_dir_;
+  JsonStoreOptions options_;
+  std::shared_ptr<JsonMessageStore> store_;
+};
+
+TEST_F(JournalStoreTest, SaveAppendsToJournal) {
+  auto msg = Message::user("Journaled");
+  msg.set_session_id("session-j");
+  store_->save(msg);
+
+  EXPECT_TRUE(fs::exists(test_dir_ / "session-j" / "messages.jsonl"));
+  EXPECT_FALSE(fs::exists(test_dir_ / "session-j" / "messages.json"));
+
+  auto loaded = store_->list("session-j");
+  ASSERT_EQ(loaded.size(), 1);
+  EXPECT_EQ(loaded[0].text(), "Journaled");
+}
+
+TEST_F(JournalStoreTest, UpdateAndRemoveReplay) {
+  SessionMeta meta;
+  meta.id = "session-j";
+  store_->save_session(meta);
+
+  auto msg1 = Message::user("First");
+  msg1.set_session_id("session-j");
+  auto msg2 = Message::assistant("Second");
+  msg2.set_session_id("session-j");
+  store_->save(msg1);
+  store_->save(msg2);
+
+  msg1.add_text("edited");
+  store_->update(msg1);
+  store_->remove(msg2.id());
+
+  auto loaded = store_->list("session-j");
+  ASSERT_EQ(loaded.size(), 1);
+  EXPECT_EQ(loaded[0].text(), "First\nedited");
+}
+
+TEST_F(JournalStoreTest, CompactsIntoSnapshot) {
+  for (int i = 0; i < 8; ++i) {
+    auto msg = Message::user("msg " + std::to_string(i));
+    msg.set_session_id("session-c");
+    store_->save(msg);
+  }
+
+  // Threshold reached: journal folded into messages.json
+  EXPECT_TRUE(fs::exists(test_dir_ / "session-c" / "messages.json"));
+  EXPECT_FALSE(fs::exists(test_dir_ / "session-c" / "messages.jsonl"));
+
+  auto extra = Message::user("after compaction");
+  extra.set_session_id("session-c");
+  store_->save(extra);
+
+  auto loaded = store_->list("session-c");
+  ASSERT_EQ(loaded.size(), 9);
+  EXPECT_EQ(loaded[0].text(), "msg 0");
+  EXPECT_EQ(loaded[8].text(), "after compaction");
+}
+
+TEST_F(JournalStoreTest, ReplayIsIdempotentAfterInterruptedCompaction) {
+  auto msg = Message::user("Only once");
+  msg.set_session_id("session-i");
+  store_->save(msg);
+  auto journal = fs::path(test_dir_ / "session-i" / "messages.jsonl");
+
+  std::string records;
+  {
+    store_->flush();
+    std::ifstream in(journal);
+    records.assign(std::istreambuf_iterator<char>(in), {});
+  }
+
+  // Simulate a crash after the snapshot was written but before the journal was dropped
+  store_->compact("session-i");
+  {
+    std::ofstream out(journal);
+    out << records;
+  }
+
+  auto loaded = store_->list("session-i");
+  ASSERT_EQ(loaded.size(), 1);
+  EXPECT_EQ(loaded[0].text(), "Only once");
+}
+
+TEST_F(JournalStoreTest, KeepsJournalWhenSnapshotWriteFails) {
+  auto msg = Message::user("Kept");
+  msg.set_session_id("session-f");
+  store_->save(msg);
+
+  // A directory in the way of the temp file makes the snapshot write fail
+  fs::create_directories(test_dir_ / "session-f" / "messages.json.tmp");
+  store_->compact("session-f");
+  EXPECT_FALSE(fs::exists(test_dir_ / "session-f" / "messages.json"));
+  EXPECT_TRUE(fs::exists(test_dir_ / "session-f" / "messages.jsonl"));
+
+  fs::remove(test_dir_ / "session-f" / "messages.json.tmp");
+  store_.reset();
+  JsonMessageStore reopened(test_dir_, options_);
+  auto loaded = reopened.list("session-f");
+  ASSERT_EQ(loaded.size(), 1);
+  EXPECT_EQ(loaded[0].text(), "Kept");
+}
+
+TEST_F(JournalStoreTest, AppendsAfterOtherInstanceCompacts) {
+  auto first = Message::user("First");
+  first.set_session_id("session-o");
+  store_->save(first);
+
+  JsonMessageStore other(test_dir_, options_);
+  other.compact("session-o");
+  ASSERT_FALSE(fs::exists(test_dir_ / "session-o" / "messages.jsonl"));
+
+  auto second = Message::user("Second");
+  second.set_session_id("session-o");
+  store_->save(second);
+  store_.reset();
+
+  JsonMessageStore reopened(test_dir_, options_);
+  auto loaded = reopened.list("session-o");
+  ASSERT_EQ(loaded.size(), 2);
+  EXPECT_EQ(loaded[1].text(), "Second");
+}
+
+TEST_F(JournalStoreTest, SkipsTornTrailingRecord) {
+  auto msg = Message::user("Intact");
+  msg.set_session_id("session-t");
+  store_->save(msg);
+  store_.reset();
+
+  {
+    std::ofstream out(test_dir_ / "session-t" / "messages.jsonl", std::ios::app);
+    out << R"({"op":"save","message":{"id":"x","ro)";
+  }
+
+  JsonMessageStore reopened(test_dir_, options_);
+  auto loaded = reopened.list("session-t");
+  ASSERT_EQ(loaded.size(), 1);
+  EXPECT_EQ(loaded[0].text(), "Intact");
+}
+
+TEST_F(JournalStoreTest, SnapshotModeReadsJournal) {
+  auto msg = Message::user("From journal");
+  msg.set_session_id("session-m");
+  store_->save(msg);
+  store_.reset();
+
+  JsonMessageStore snapshot_store(test_dir_);
+  ASSERT_EQ(snapshot_store.list("session-m").size(), 1);
+
+  // A snapshot-mode write folds the journal in
+  auto msg2 = Message::user("From snapshot");
+  msg2.set_session_id("session-m");
+  snapshot_store.save(msg2);
+  EXPECT_FALSE(fs::exists(test_dir_ / "session-m" / "messages.jsonl"));
+  ASSERT_EQ(snapshot_store.list("session-m").size(), 2);
+}
+
+TEST_F(JournalStoreTest, SessionResume) {
+  asio::io_context io_ctx;
+  auto config = Config::load_default();
+
+  auto session = Session::create(io_ctx, config, AgentType::Build, store_);
+  auto session_id = session->id();
+  session->add_message(Message::user("Hello journal"));
+  session->add_message(Message::assistant("Hi"));
+  session.reset();
+
+  auto resumed = Session::resume(io_ctx, config, session_id, store_);
+  ASSERT_NE(resumed, nullptr);
+  ASSERT_EQ(resumed->messages().size(), 2);
+  EXPECT_EQ(resumed->messages()[1].text(), "Hi");
+}
+
+// Write-back session cache
+class CachedStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    test_dir_ = fs::temp_directory_path() / ("agent_cache_test_" + UUID::generate());
+    options_.cache_max_sessions = 2;
+    options_.cache_flush_after_changes = 0;
+    options_.cache_flush_interval = std::chrono::milliseconds(0);
+    store_ = std::make_shared<JsonMessageStore>(test_dir_, options_);
+  }
+
+  void TearDown() override {
+    store_.reset();
+    std::error_code ec;
+    fs::remove_all(test_dir_, ec);
+  }
+
+  Message make_message(const SessionId& session_id, const std::string& text) {
+    auto msg = Message::user(text);
+    msg.set_session_id(session_id);
+    return msg;
+  }
+
+  fs::path test_dir_;
+  JsonStoreOptions options_;
+  std::shared_ptr<JsonMessageStore> store_;
+};
+
+TEST_F(CachedStoreTest, WritesStayInMemoryUntilFlush) {
+  auto msg = make_message("session-1", "Cached");
+  store_->save(msg);
+  msg.add_text("updated");
+  store_->update(msg);
+
+  EXPECT_FALSE(fs::exists(test_dir_ / "session-1" / "messages.json"));
+  auto loaded = store_->list("session-1");
+  ASSERT_EQ(loaded.size(), 1);
+  EXPECT_EQ(loaded[0].text(), "Cached\nupdated");
+
+  store_->flush();
+  JsonMessageStore reader(test_dir_);
+  auto on_disk = reader.list("session-1");
+  ASSERT_EQ(on_disk.size(), 1);
+  EXPECT_EQ(on_disk[0].text(), "Cached\nupdated");
+}
+
+TEST_F(CachedStoreTest, FlushAfterChanges) {
+  options_.cache_flush_after_changes = 3;
+  store_ = std::make_shared<JsonMessageStore>(test_dir_, options_);
+
+  store_->save(make_message("session-1", "a"));
+  store_->save(make_message("session-1", "b"));
+  EXPECT_FALSE(fs::exists(test_dir_ / "session-1" / "messages.json"));
+
+  store_->save(make_message("session-1", "c"));
+  EXPECT_TRUE(fs::exists(test_dir_ / "session-1" / "messages.json"));
+}
+
+TEST_F(CachedStoreTest, FlushAfterInterval) {
+  options_.cache_flush_interval = std::chrono::milliseconds(1);
+  store_ = std::make_shared<JsonMessageStore>(test_dir_, options_);
+
+  store_->save(make_message("session-1", "a"));
+  EXPECT_FALSE(fs::exists(test_dir_ / "session-1" / "messages.json"));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  store_->list("session-1");
+  EXPECT_TRUE(fs::exists(test_dir_ / "session-1" / "messages.json"));
+}
+
+TEST_F(CachedStoreTest, EvictionWritesBack) {
+  store_->save(make_message("session-1", "one"));
+  store_->save(make_message("session-2", "two"));
+  EXPECT_FALSE(fs::exists(test_dir_ / "session-1" / "messages.json"));
+
+  // Third session evicts the least recently used one
+  store_->save(make_message("session-3", "three"));
+  EXPECT_TRUE(fs::exists(test_dir_ / "session-1" / "messages.json"));
+  EXPECT_FALSE(fs::exists(test_dir_ / "session-2" / "messages.json"));
+
+  ASSERT_EQ(store_->list("session-1").size(), 1);
+}
+
+TEST_F(CachedStoreTest, GetAndRemoveUseCache) {
+  auto msg = make_message("session-1", "lookup");
+  store_->save(msg);
+
+  auto loaded = store_->get(msg.id());
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(loaded->text(), "lookup");
+
+  store_->remove(msg.id());
+  EXPECT_TRUE(store_->list("session-1").empty());
+  EXPECT_FALSE(store_->get(msg.id()).has_value());
+}
+
+TEST_F(CachedStoreTest, DestructorFlushes) {
+  store_->save(make_message("session-1", "persist me"));
+  store_.reset();
+
+  JsonMessageStore reader(test_dir_);
+  ASSERT_EQ(reader.list("session-1").size(), 1);
+}
+
+TEST_F(CachedStoreTest, JournalModeWritesThrough) {
+  options_.mode = StoreMode::Journal;
+  store_ = std::make_shared<JsonMessageStore>(test_dir_, options_);
+
+  auto msg = make_message("session-1", "through");
+  store_->save(msg);
+  msg.add_text("again");
+  store_->update(msg);
+  store_->flush();
+
+  JsonMessageStore reader(test_dir_);
+  auto on_disk = reader.list("session-1");
+  ASSERT_EQ(on_disk.size(), 1);
+  EXPECT_EQ(on_disk[0].text(), "through\nagain");
+}
+
+// Binary snapshot format
+TEST_F(JsonStoreTest, BinaryFormatRoundTrip) {
+  JsonStoreOptions options;
+  options.format = MessageFormat::Binary;
+  options.blob_inline_limit = 64;
+  JsonMessageStore store(test_dir_, options);
+
+  std::string big(500, 'z');
+  auto msg = Message::assistant("");
+  msg.set_session_id("session-bin");
+  msg.add_tool_result("tc_1", "read", big);
+  store.save(msg);
+
+  EXPECT_TRUE(fs::exists(test_dir_ / "session-bin" / "messages.bin"));
+  EXPECT_FALSE(fs::exists(test_dir_ / "session-bin" / "messages.json"));
+  EXPECT_FALSE(fs::is_empty(test_dir_ / "blobs"));
+
+  JsonMessageStore reader(test_dir_, options);
+  auto loaded = reader.list("session-bin");
+  ASSERT_EQ(loaded.size(), 1);
+  EXPECT_EQ(loaded[0].tool_results()[0]->output, big);
+}
+
+TEST_F(JsonStoreTest, CompressedSnapshotsAndBlobs) {
+  for (auto format : {MessageFormat::Json, MessageFormat::Binary}) {
+    auto session_id = std::string("session-lz-") + (format == MessageFormat::Json ? "json" : "bin");
+    JsonStoreOptions options;
+    options.format = format;
+    options.compress = true;
+    options.blob_inline_limit = 64;
+    JsonMessageStore store(test_dir_, options);
+
+    std::string big;
+    for (int i = 0; i < 100; ++i) big += "log line " + std::to_string(i) + "\n";
+    for (int i = 0; i < 20; ++i) {
+      auto msg = Message::assistant("answer " + std::to_string(i) + " " + std::string(200, 'a'));
+      msg.set_session_id(session_id);
+      if (i == 5) msg.add_tool_result("tc_1", "bash", big);
+      store.save(msg);
+    }
+
+    auto snapshot = test_dir_ / session_id / (format == MessageFormat::Json ? "messages.json" : "messages.bin");
+    std::ifstream file(snapshot, std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    EXPECT_TRUE(is_compressed(content));
+
+    JsonMessageStore reader(test_dir_);  // Reading does not need the option
+    auto loaded = reader.list(session_id);
+    ASSERT_EQ(loaded.size(), 20);
+    EXPECT_EQ(loaded[5].tool_results()[0]->output, big);
+
+    auto range = reader.list_range(session_id, 10, 2);
+    ASSERT_EQ(range.messages.size(), 2);
+    EXPECT_EQ(range.messages[0].id(), loaded[10].id());
+  }
+
+  for (const auto& entry : fs::directory_iterator(test_dir_ / "blobs")) {
+    EXPECT_LT(entry.file_size(), 1000);
+  }
+}
+
+// Streaming load and summary-tail load
+TEST_F(JsonStoreTest, StreamingLoadPreservesEveryField) {
+  std::vector<Message> saved;
+  for (int i = 0; i < 50; ++i) {
+    auto msg = i % 2 ? Message::assistant("answer " + std::to_string(i)) : Message::user("question " + std::to_string(i));
+    msg.set_session_id("session-stream");
+    if (i % 2) {
+      msg.add_tool_call("tc_" + std::to_string(i), "read", {{"path", "/tmp/x"}, {"nested", {1, 2, {{"a", "b"}}}}});
+      msg.add_tool_result("tc_" + std::to_string(i), "read", "out " + std::to_string(i));
+    }
+    store_->save(msg);
+    saved.push_back(msg);
+  }
+
+  JsonMessageStore reader(test_dir_);
+  auto loaded = reader.list("session-stream");
+  ASSERT_EQ(loaded.size(), saved.size());
+  for (size_t i = 0; i < saved.size(); ++i) {
+    EXPECT_EQ(loaded[i].to_json(), saved[i].to_json());
+  }
+}
+
+TEST_F(JsonStoreTest, ListSinceLastSummary) {
+  auto add = [this](const std::string& text, bool summary) {
+    auto msg = summary ? Message::assistant(text) : Message::user(text);
+    msg.set_session_id("session-tail");
+    msg.set_summary(summary);
+    msg.set_finished(true);
+    store_->save(msg);
+    return msg;
+  };
+
+  add("first", false);
+  add("summary 1", true);
+  add("second", false);
+  add("summary 2", true);
+  add("third", false);
+
+  auto tail = store_->list_since_last_summary("session-tail");
+  ASSERT_EQ(tail.messages.size(), 2);
+  EXPECT_EQ(tail.begin, 3);
+  EXPECT_EQ(tail.total, 5);
+  EXPECT_EQ(tail.messages[0].text(), "summary 2");
+  EXPECT_EQ(tail.messages[1].text(), "third");
+
+  // No summary: everything
+  add("alone", false).set_session_id("session-plain");
+  auto plain = Message::user("plain");
+  plain.set_session_id("session-plain");
+  store_->save(plain);
+  EXPECT_EQ(store_->list_since_last_summary("session-plain").messages.size(), 1);
+}
+
+TEST_F(JsonStoreTest, ListSinceLastSummaryHonorsJournalRemovals) {
+  JsonStoreOptions options;
+  options.mode = StoreMode::Journal;
+  options.journal_compact_threshold = 100;
+  JsonMessageStore store(test_dir_, options);
+
+  std::vector<Message> messages;
+  for (const auto* text : {"before", "summary 1", "middle", "summary 2", "after"}) {
+    auto msg = Message::assistant(text);
+    msg.set_session_id("session-j");
+    msg.set_summary(std::string(text).rfind("summary", 0) == 0);
+    msg.set_finished(true);
+    store.save(msg);
+    messages.push_back(msg);
+  }
+  store.compact("session-j");
+
+  // The newest summary is removed after the snapshot was written
+  store.remove(messages[3].id());
+  store.flush();
+
+  JsonMessageStore reader(test_dir_, options);
+  auto tail = reader.list_since_last_summary("session-j");
+  ASSERT_EQ(tail.messages.size(), 3);
+  EXPECT_EQ(tail.begin, 1);
+  EXPECT_EQ(tail.messages[0].text(), "summary 1");
+  EXPECT_EQ(tail.messages[2].text(), "after");
+}
+
+TEST_F(JsonStoreTest, ListRangeUsesSnapshotIndex) {
+  for (auto format : {MessageFormat::Json, MessageFormat::Binary}) {
+    auto session_id = std::string("session-range-") + (format == MessageFormat::Json ? "json" : "bin");
+    JsonStoreOptions options;
+    options.mode = StoreMode::Journal;
+    options.format = format;
+    options.journal_compact_threshold = 100;
+    JsonMessageStore store(test_dir_, options);
+
+    std::vector<Message> messages;
+    for (int i = 0; i < 10; ++i) {
+      auto msg = Message::user("message " + std::to_string(i));
+      msg.set_session_id(session_id);
+      store.save(msg);
+      messages.push_back(msg);
+    }
+    store.compact(session_id);
+    EXPECT_TRUE(fs::exists(test_dir_ / session_id / "messages.idx"));
+
+    // Journal on top of the indexed snapshot
+    messages[4].add_text(" (edited)");
+    store.update(messages[4]);
+    store.remove(messages[2].id());
+    auto extra = Message::user("message 10");
+    extra.set_session_id(session_id);
+    store.save(extra);
+    store.flush();
+
+    JsonMessageStore reader(test_dir_, options);
+    auto range = reader.list_range(session_id, 2, 3);
+    EXPECT_EQ(range.begin, 2);
+    EXPECT_EQ(range.total, 10);
+    ASSERT_EQ(range.messages.size(), 3);
+    EXPECT_EQ(range.messages[0].text(), "message 3");
+    EXPECT_EQ(range.messages[1].text(), messages[4].text());
+    EXPECT_EQ(range.messages[2].id(), messages[5].id());
+
+    auto end = reader.list_range(session_id, 8, 5);
+    ASSERT_EQ(end.messages.size(), 2);
+    EXPECT_EQ(end.messages[1].text(), "message 10");
+    EXPECT_TRUE(reader.list_range(session_id, 20, 5).messages.empty());
+  }
+}
+
+TEST_F(JsonStoreTest, ListRangeWithoutIndexReadsWholeSnapshot) {
+  std::vector<Message> messages;
+  for (int i = 0; i < 4; ++i) {
+    auto msg = Message::assistant("message " + std::to_string(i));
+    msg.set_session_id("session-noidx");
+    msg.set_summary(i == 1);
+    msg.set_finished(true);
+    store_->save(msg);
+  }
+
+  // The snapshot is still plain pretty-printed JSON
+  auto path = test_dir_ / "session-noidx" / "messages.json";
+  std::ifstream file(path);
+  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  EXPECT_EQ(json::parse(content).dump(2), content);
+
+  // Snapshots written before messages.idx existed
+  fs::remove(test_dir_ / "session-noidx" / "messages.idx");
+  JsonMessageStore reader(test_dir_);
+  auto tail = reader.list_since_last_summary("session-noidx");
+  EXPECT_EQ(tail.begin, 1);
+  ASSERT_EQ(tail.messages.size(), 3);
+  EXPECT_EQ(tail.messages[0].text(), "message 1");
+  EXPECT_EQ(reader.list_range("session-noidx", 0, 1).messages[0].text(), "message 0");
+}
+
+TEST_F(JsonStoreTest, IdenticalToolOutputsShareOneBlob) {
+  JsonStoreOptions options;
+  options.blob_inline_limit = 64;
+  auto store = std::make_shared<JsonMessageStore>(test_dir_, options);
+
+  std::string big(500, 'y');
+  for (const auto* session_id : {"session-a", "session-b"}) {
+    auto msg = Message::assistant("");
+    msg.set_session_id(session_id);
+    msg.add_tool_result("tc_1", "read", big);
+    store->save(msg);
+  }
+
+  size_t blob_count = 0;
+  for ([[maybe_unused]] const auto& entry : fs::directory_iterator(test_dir_ / "blobs")) ++blob_count;
+  EXPECT_EQ(blob_count, 1);
+
+  std::ifstream file(test_dir_ / "session-a" / "messages.json");
+  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  EXPECT_NE(content.find("output_blob"), std::string::npos);
+  EXPECT_EQ(content.find(big), std::string::npos);
+
+  // Loaded outputs stay references until read
+  JsonMessageStore reader(test_dir_, options);
+  auto loaded = reader.list("session-b");
+  ASSERT_EQ(loaded.size(), 1);
+  const auto& output = loaded[0].tool_results()[0]->output;
+  EXPECT_TRUE(output.is_blob_in(reader.blob_store().get()));
+  EXPECT_EQ(output.size(), big.size());
+  EXPECT_EQ(output, big);
+  EXPECT_FALSE(output.is_blob_in(reader.blob_store().get()));
+}
+
+TEST_F(JsonStoreTest, ToolOutputsStayInlineByDefault) {
+  std::string big(100 * 1024, 'y');
+  auto msg = Message::assistant("");
+  msg.set_session_id("session-inline");
+  msg.add_tool_result("tc_1", "read", big);
+  store_->save(msg);
+
+  EXPECT_FALSE(fs::exists(test_dir_ / "blobs"));
+  std::ifstream file(test_dir_ / "session-inline" / "messages.json");
+  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  EXPECT_EQ(content.find("output_blob"), std::string::npos);
+  EXPECT_EQ(store_->list("session-inline")[0].tool_results()[0]->output, big);
+}
+
+TEST_F(JsonStoreTest, ToolOutputStaysInlineWhenBlobWriteFails) {
+  JsonStoreOptions options;
+  options.blob_inline_limit = 64;
+  JsonMessageStore store(test_dir_, options);
+
+  // A file where the blobs/ directory should be makes every put fail
+  std::ofstream(test_dir_ / "blobs") << "not a directory";
+
+  std::string big(500, 'y');
+  auto msg = Message::assistant("");
+  msg.set_session_id("session-nob");
+  msg.add_tool_result("tc_1", "read", big);
+  store.save(msg);
+
+  JsonMessageStore reader(test_dir_, options);
+  auto loaded = reader.list("session-nob");
+  ASSERT_EQ(loaded.size(), 1);
+  EXPECT_EQ(loaded[0].tool_results()[0]->output, big);
+}
+
+TEST_F(JsonStoreTest, ConcurrentBlobPutsOfSamePayload) {
+  DirectoryBlobStore blobs(test_dir_ / "blobs");
+  std::string big(256 * 1024, 'q');
+
+  std::vector<std::string> refs(8);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < refs.size(); ++i) {
+    threads.emplace_back([&blobs, &big, &refs, i]() {
+      refs[i] = blobs.put(big);
+    });
+  }
+  for (auto& t : threads) t.join();
+
+  for (const auto& ref : refs) {
+    ASSERT_FALSE(ref.empty());
+    EXPECT_EQ(ref, refs[0]);
+  }
+  EXPECT_EQ(blobs.get(refs[0]), big);
+  size_t files = 0;
+  for ([[maybe_unused]] const auto& entry : fs::directory_iterator(test_dir_ / "blobs")) ++files;
+  EXPECT_EQ(files, 1);  // No temp files left behind
+}
+
+TEST_F(JsonStoreTest, BinaryFormatReadsLegacyJson) {
+  auto msg = Message::user("Legacy");
+  msg.set_session_id("session-legacy");
+  store_->save(msg);
+  ASSERT_TRUE(fs::exists(test_dir_ / "session-legacy" / "messages.json"));
+
+  JsonStoreOptions options;
+  options.format = MessageFormat::Binary;
+  JsonMessageStore store(test_dir_, options);
+  auto loaded = store.list("session-legacy");
+  ASSERT_EQ(loaded.size(), 1);
+  EXPECT_EQ(loaded[0].text(), "Legacy");
+
+  // Next write converts the session
+  auto msg2 = Message::user("Converted");
+  msg2.set_session_id("session-legacy");
+  store.save(msg2);
+  EXPECT_TRUE(fs::exists(test_dir_ / "session-legacy" / "messages.bin"));
+  EXPECT_FALSE(fs::exists(test_dir_ / "session-legacy" / "messages.json"));
+
+  // And the default JSON store still reads it
+  JsonMessageStore json_store(test_dir_);
+  ASSERT_EQ(json_store.list("session-legacy").size(), 2);
+}
@@ -0,0 +1,52 @@
+#include <gtest/gtest.h>
+
+#include "core/json_writer.hpp"
+
+using namespace agent;
+
+static std::string escaped(std::string_view text) {
+  std::string out;
+  write_json_string(out, text);
+  return out;
+}
+
+TEST(JsonWriterTest, EscapesLikeDump) {
+  for (std::string text : {std::string(""), std::string("plain ascii text that is longer than one word"), std::string("quote \" and \\ backslash"),
+                           std::string("\b\f\n\r\t"), std::string("\x01\x1f\x7f"), std::string("你好, héllo 😀"),
+                           std::string("12345678\"12345678\n12345678")}) {
+    EXPECT_EQ(escaped(text), json(text).dump()) << text;
+  }
+}
+
+TEST(JsonWriterTest, ReplacesInvalidUtf8) {
+  EXPECT_EQ(escaped("a\xFF" "b"), "\"a\xEF\xBF\xBD" "b\"");
+  EXPECT_EQ(escaped("\xC3"), "\"\xEF\xBF\xBD\"");  // Truncated sequence
+  EXPECT_EQ(escaped("\xED\xA0\x80"), "\"\xEF\xBF\xBD\xEF\xBF\xBD\xEF\xBF\xBD\"");  // Surrogate
+  EXPECT_EQ(escaped("\xC0\xAF"), "\"\xEF\xBF\xBD\xEF\xBF\xBD\"");  // Overlong
+}
+
+TEST(JsonWriterTest, WritesNestedContainers) {
+  std::string out;
+  JsonWriter writer(out);
+  writer.begin_object();
+  writer.member("model", "m").member("max_tokens", 8192).member("stream", true).member("temperature", 0.5);
+  writer.key("messages").begin_array();
+  writer.begin_object().member("role", "user").end_object();
+  writer.begin_object().key("content").begin_array().value("a").null().end_array().end_object();
+  writer.end_array();
+  writer.key("empty").begin_object().end_object();
+  writer.key("cached").raw(R"({"type":"ephemeral"})");
+  writer.end_object();
+
+  EXPECT_EQ(out, R"({"model":"m","max_tokens":8192,"stream":true,"temperature":0.5,"messages":[{"role":"user"},{"content":["a",null]}],)"
+                 R"("empty":{},"cached":{"type":"ephemeral"}})");
+  EXPECT_TRUE(json::accept(out));
+}
+
+TEST(JsonWriterTest, JsonValueMatchesDump) {
+  json value = {{"path", "/tmp/a b"}, {"lines", {1, 2, 3}}, {"offset", -4}, {"ratio", 0.1}, {"big", 18446744073709551615ull},
+                {"nested", {{"flag", false}, {"none", nullptr}, {"text", "x\ny"}}}};
+  std::string out;
+  JsonWriter(out).value(value);
+  EXPECT_EQ(out, value.dump());
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include "bus/bus.hpp"
 #include "llm/anthropic.hpp"
 #include "llm/openai.hpp"
 #include "llm/provider.hpp"
@@ -275,6 +276,92 @@ TEST(LlmRequestTest, AnthropicFormatToolCallMessage) {
   EXPECT_EQ(content[1]["input"]["query"], "cats");
 }
 
+TEST(LlmRequestTest, AnthropicFormatCacheBreakpoints) {
+  LlmRequest request;
+  request.model = "claude-sonnet-4-20250514";
+  request.system_prompt = "You are a coding assistant.";
+  request.tools.push_back(std::make_shared<MockTool>());
+  request.messages.push_back(Message::user("First"));
+  request.messages.push_back(Message::assistant("Answer"));
+  request.messages.push_back(Message::user("Second"));
+  Message call(Role::Assistant, "");
+  call.add_tool_call("tc_001", "mock_tool", json{{"query", "cats"}});
+  request.messages.push_back(call);
+  Message result(Role::User, "");
+  result.add_tool_result("tc_001", "mock_tool", "cats found");
+  request.messages.push_back(result);
+
+  // No breakpoints unless asked for
+  auto plain = request.to_anthropic_format();
+  EXPECT_EQ(plain["system"], "You are a coding assistant.");
+  EXPECT_EQ(plain.dump().find("cache_control"), std::string::npos);
+
+  request.prompt_cache = PromptCachePolicy{};
+  auto j = request.to_anthropic_format();
+  json breakpoint = {{"type", "ephemeral"}};
+
+  ASSERT_TRUE(j["system"].is_array());
+  EXPECT_EQ(j["system"][0]["text"], "You are a coding assistant.");
+  EXPECT_EQ(j["system"][0]["cache_control"], breakpoint);
+  EXPECT_EQ(j["tools"].back()["cache_control"], breakpoint);
+
+  // Rolling breakpoints: the last message and the user message before it
+  auto& msgs = j["messages"];
+  ASSERT_EQ(msgs.size(), 5);
+  EXPECT_EQ(msgs[4]["content"].back()["cache_control"], breakpoint);
+  ASSERT_TRUE(msgs[2]["content"].is_array());
+  EXPECT_EQ(msgs[2]["content"][0]["text"], "Second");
+  EXPECT_EQ(msgs[2]["content"][0]["cache_control"], breakpoint);
+  EXPECT_EQ(msgs[0]["content"], "First");
+  EXPECT_EQ(msgs[3]["content"][0].count("cache_control"), 0);
+
+  // The API allows at most four
+  auto dumped = j.dump();
+  size_t breakpoints = 0;
+  for (auto pos = dumped.find("cache_control"); pos != std::string::npos; pos = dumped.find("cache_control", pos + 1)) ++breakpoints;
+  EXPECT_EQ(breakpoints, 4);
+
+  // Each breakpoint can be switched off
+  request.prompt_cache = PromptCachePolicy{false, false, false};
+  EXPECT_EQ(request.to_anthropic_format().dump().find("cache_control"), std::string::npos);
+}
+
+TEST(LlmRequestTest, BodiesSpliceCachedToolDefinitions) {
+  LlmRequest request;
+  request.model = "claude-sonnet-4-20250514";
+  request.system_prompt = "You are a coding assistant.";
+  request.messages.push_back(Message::user("Hello"));
+  request.tools.push_back(std::make_shared<MockTool>());
+
+  // Same document as the json formats, with or without a schema cache
+  for (bool cached : {false, true}) {
+    request.tool_schemas = cached ? std::make_shared<const ToolSchemaSet>(request.tools, 0) : nullptr;
+    request.prompt_cache = cached ? std::optional<PromptCachePolicy>(PromptCachePolicy{}) : std::nullopt;
+
+    auto anthropic = request.to_anthropic_format();
+    anthropic["stream"] = true;
+    EXPECT_EQ(json::parse(request.anthropic_body(true)), anthropic);
+    EXPECT_EQ(json::parse(request.openai_body(false)), request.to_openai_format());
+  }
+
+  request.tools.clear();
+  request.tool_schemas = nullptr;
+  EXPECT_FALSE(json::parse(request.anthropic_body(false)).contains("tools"));
+}
+
+TEST(LlmRequestTest, CacheHitRatio) {
+  TokenUsage usage;
+  EXPECT_DOUBLE_EQ(usage.cache_hit_ratio(), 0.0);
+  usage.input_tokens = 100;
+  usage.cache_read_tokens = 800;
+  usage.cache_write_tokens = 100;
+  EXPECT_EQ(usage.prompt_tokens(), 1000);
+  EXPECT_DOUBLE_EQ(usage.cache_hit_ratio(), 0.8);
+
+  events::TokensUsed event{"s", 100, 20, 800, 100};
+  EXPECT_DOUBLE_EQ(event.cache_hit_ratio(), 0.8);
+}
+
 // ============================================================
 // LlmRequestTest — OpenAI format
 // ============================================================
@@ -0,0 +1,234 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include "core/log_store.hpp"
+#include "core/uuid.hpp"
+
+using namespace agent;
+namespace fs = std::filesystem;
+
+class LogStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    test_dir_ = fs::temp_directory_path() / ("agent_log_test_" + UUID::generate());
+    options_.fsync = false;
+    store_ = std::make_shared<LogMessageStore>(test_dir_, options_);
+  }
+
+  void TearDown() override {
+    store_.reset();
+    std::error_code ec;
+    fs::remove_all(test_dir_, ec);
+  }
+
+  Message make(const std::string& text, const SessionId& session_id = "session-1") {
+    auto msg = Message::user(text);
+    msg.set_session_id(session_id);
+    return msg;
+  }
+
+  size_t segment_count() const {
+    size_t count = 0;
+    for (const auto& entry : fs::directory_iterator(test_dir_)) {
+      if (entry.path().extension() == ".seg") ++count;
+    }
+    return count;
+  }
+
+  fs::path test_dir_;
+  LogStoreOptions options_;
+  std::shared_ptr<LogMessageStore> store_;
+};
+
+TEST_F(LogStoreTest, SaveGetAndList) {
+  auto first = make("first");
+  auto second = make("second");
+  auto other = make("other", "session-2");
+  store_->save(first);
+  store_->save(second);
+  store_->save(other);
+
+  auto loaded = store_->get(second.id());
+  ASSERT_TRUE(loaded.has_value());
+  EXPECT_EQ(loaded->text(), "second");
+  EXPECT_EQ(loaded->session_id(), "session-1");
+
+  auto messages = store_->list("session-1");
+  ASSERT_EQ(messages.size(), 2);
+  EXPECT_EQ(messages[0].id(), first.id());
+  EXPECT_EQ(messages[1].id(), second.id());
+  EXPECT_EQ(store_->list("session-2").size(), 1);
+  EXPECT_FALSE(store_->get("missing").has_value());
+}
+
+TEST_F(LogStoreTest, UpdateKeepsPositionAndRemoveDrops) {
+  auto first = make("first");
+  auto second = make("second");
+  store_->save(first);
+  store_->save(second);
+
+  first.add_text(" edited");
+  store_->update(first);
+  store_->remove(second.id());
+
+  // Update of an unknown id is ignored
+  store_->update(make("never saved"));
+
+  auto messages = store_->list("session-1");
+  ASSERT_EQ(messages.size(), 1);
+  EXPECT_EQ(messages[0].id(), first.id());
+  EXPECT_EQ(messages[0].text(), first.text());
+  EXPECT_FALSE(store_->get(second.id()).has_value());
+}
+
+TEST_F(LogStoreTest, PersistsAcrossInstances) {
+  auto msg = make("durable");
+  store_->save(msg);
+  store_.reset();
+
+  LogMessageStore reopened(test_dir_, options_);
+  auto messages = reopened.list("session-1");
+  ASSERT_EQ(messages.size(), 1);
+  EXPECT_EQ(messages[0].text(), "durable");
+}
+
+TEST_F(LogStoreTest, InstancesSeeEachOthersWrites) {
+  // Separate instances hold separate lock files, like separate processes
+  LogMessageStore other(test_dir_, options_);
+
+  auto a = make("from a");
+  store_->save(a);
+  EXPECT_EQ(other.list("session-1").size(), 1);
+
+  auto b = make("from b");
+  other.save(b);
+  auto messages = store_->list("session-1");
+  ASSERT_EQ(messages.size(), 2);
+  EXPECT_EQ(messages[1].id(), b.id());
+
+  other.remove(a.id());
+  EXPECT_FALSE(store_->get(a.id()).has_value());
+}
+
+TEST_F(LogStoreTest, TornTailIsIgnoredAndOverwritten) {
+  store_->save(make("one"));
+  store_->save(make("two"));
+  store_.reset();
+
+  {
+    std::ofstream segment(test_dir_ / "00000001.seg", std::ios::binary | std::ios::app);
+    segment << "\x40\x00\x00\x00garbage";
+  }
+
+  store_ = std::make_shared<LogMessageStore>(test_dir_, options_);
+  EXPECT_EQ(store_->list("session-1").size(), 2);
+
+  store_->save(make("three"));
+  store_.reset();
+
+  LogMessageStore reopened(test_dir_, options_);
+  auto messages = reopened.list("session-1");
+  ASSERT_EQ(messages.size(), 3);
+  EXPECT_EQ(messages[2].text(), "three");
+}
+
+TEST_F(LogStoreTest, RotatesSegments) {
+  options_.segment_max_bytes = 512;
+  store_ = std::make_shared<LogMessageStore>(test_dir_, options_);
+
+  for (int i = 0; i < 20; ++i) {
+    store_->save(make("message " + std::to_string(i)));
+  }
+  EXPECT_GT(segment_count(), 1);
+
+  LogMessageStore reopened(test_dir_, options_);
+  auto messages = reopened.list("session-1");
+  ASSERT_EQ(messages.size(), 20);
+  EXPECT_EQ(messages[19].text(), "message 19");
+}
+
+TEST_F(LogStoreTest, CompactDropsSupersededRecords) {
+  LogMessageStore other(test_dir_, options_);
+
+  auto msg = make("v0");
+  auto removed = make("gone");
+  store_->save(msg);
+  store_->save(removed);
+  for (int i = 1; i <= 50; ++i) {
+    msg.add_text(".");
+    store_->update(msg);
+  }
+  store_->remove(removed.id());
+  EXPECT_EQ(other.list("session-1").size(), 1);
+
+  auto before = store_->disk_usage();
+  store_->compact();
+  EXPECT_LT(store_->disk_usage(), before);
+  EXPECT_EQ(segment_count(), 1);
+
+  // The other instance notices its segments are gone and re-indexes
+  auto messages = other.list("session-1");
+  ASSERT_EQ(messages.size(), 1);
+  EXPECT_EQ(messages[0].text(), msg.text());
+
+  other.save(make("after compaction"));
+  EXPECT_EQ(store_->list("session-1").size(), 2);
+}
+
+TEST_F(LogStoreTest, CompressedRecordsShrinkSegments) {
+  std::string text;
+  for (int i = 0; i < 50; ++i) text += "repeated log line " + std::to_string(i % 5) + "\n";
+
+  store_->save(make(text));
+  auto plain_size = store_->disk_usage();
+  store_.reset();
+  fs::remove_all(test_dir_);
+
+  options_.compress = true;
+  store_ = std::make_shared<LogMessageStore>(test_dir_, options_);
+  auto msg = make(text);
+  store_->save(msg);
+  store_->save(make("tiny"));
+  EXPECT_LT(store_->disk_usage() * 2, plain_size);
+
+  msg.add_text("more");
+  store_->update(msg);
+  store_->compact();
+
+  // A reader without the option reads compressed records too
+  options_.compress = false;
+  LogMessageStore reopened(test_dir_, options_);
+  auto messages = reopened.list("session-1");
+  ASSERT_EQ(messages.size(), 2);
+  EXPECT_EQ(messages[0].text(), msg.text());
+  EXPECT_EQ(messages[1].text(), "tiny");
+}
+
+TEST_F(LogStoreTest, ConcurrentWritersAreGroupCommitted) {
+  options_.fsync = true;
+  store_ = std::make_shared<LogMessageStore>(test_dir_, options_);
+
+  constexpr int THREADS = 8;
+  constexpr int PER_THREAD = 25;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; ++t) {
+    threads.emplace_back([this, t] {
+      for (int i = 0; i < PER_THREAD; ++i) {
+        store_->save(make("t" + std::to_string(t) + "-" + std::to_string(i), "session-" + std::to_string(t)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  LogMessageStore reopened(test_dir_, options_);
+  for (int t = 0; t < THREADS; ++t) {
+    auto messages = reopened.list("session-" + std::to_string(t));
+    ASSERT_EQ(messages.size(), PER_THREAD);
+    EXPECT_EQ(messages[PER_THREAD - 1].text(), "t" + std::to_string(t) + "-" + std::to_string(PER_THREAD - 1));
+  }
+}
@@ -49,3 +49,135 @@ TEST(MessageTest, JsonSerialization) {
   EXPECT_EQ(j["role"], "user");
   EXPECT_TRUE(j.contains("parts"));
 }
+
+namespace {
+
+// BlobStore keeping payloads in memory
+class MemoryBlobStore : public BlobStore {
+ public:
+  std::string put(std::string_view data) override {
+    auto ref = "blob-" + std::to_string(blobs_.size());
+    blobs_[ref] = std::string(data);
+    return ref;
+  }
+
+  std::optional<std::string> get(const std::string& ref) override {
+    auto it = blobs_.find(ref);
+    if (it == blobs_.end()) return std::nullopt;
+    return it->second;
+  }
+
+  std::map<std::string, std::string> blobs_;
+};
+
+}  // namespace
+
+TEST(MessageTest, BinaryRoundTripAllParts) {
+  auto msg = Message::assistant("Hello");
+  msg.set_session_id("session-bin");
+  msg.set_parent_id("parent-1");
+  msg.set_finished(true);
+  msg.set_finish_reason(FinishReason::ToolCalls);
+  msg.set_summary(true);
+  msg.set_usage({10, 20, 30, 40});
+  msg.add_tool_call("tc_1", "read", {{"path", "/tmp/x"}, {"limit", 5}});
+
+  ToolResultPart tr{"tc_1", "read", "file contents", true, "Read x", {{"lines", 1}}, true, std::chrono::system_clock::now()};
+  msg.add_part(tr);
+  msg.add_part(ImagePart{"data:image/png;base64,AAAA", "image/png"});
+  msg.add_part(FilePart{"/tmp/y", "y contents", true});
+  msg.add_part(CompactionPart{"msg-0", true});
+  msg.add_part(SubtaskPart{"task-1", "do it", AgentType::Explore, true, "done"});
+
+  auto loaded = Message::from_binary(msg.to_binary());
+
+  EXPECT_EQ(loaded.id(), msg.id());
+  EXPECT_EQ(loaded.role(), Role::Assistant);
+  EXPECT_EQ(loaded.session_id(), "session-bin");
+  ASSERT_TRUE(loaded.parent_id().has_value());
+  EXPECT_EQ(*loaded.parent_id(), "parent-1");
+  EXPECT_TRUE(loaded.is_finished());
+  EXPECT_TRUE(loaded.is_summary());
+  EXPECT_FALSE(loaded.is_synthetic());
+  EXPECT_EQ(loaded.finish_reason(), FinishReason::ToolCalls);
+  EXPECT_EQ(loaded.usage().cache_write_tokens, 40);
+  EXPECT_EQ(std::chrono::duration_cast<std::chrono::milliseconds>(loaded.created_at() - msg.created_at()).count(), 0);
+
+  ASSERT_EQ(loaded.parts().size(), 7);
+  EXPECT_EQ(std::get<TextPart>(loaded.parts()[0]).text, "Hello");
+
+  const auto& tc = std::get<ToolCallPart>(loaded.parts()[1]);
+  EXPECT_EQ(tc.arguments["path"], "/tmp/x");
+  EXPECT_EQ(tc.arguments["limit"], 5);
+
+  const auto& loaded_tr = std::get<ToolResultPart>(loaded.parts()[2]);
+  EXPECT_EQ(loaded_tr.output, "file contents");
+  EXPECT_TRUE(loaded_tr.is_error);
+  EXPECT_TRUE(loaded_tr.compacted);
+  ASSERT_TRUE(loaded_tr.title.has_value());
+  EXPECT_EQ(*loaded_tr.title, "Read x");
+  EXPECT_TRUE(loaded_tr.compacted_at.has_value());
+  EXPECT_EQ(loaded_tr.metadata["lines"], 1);
+
+  EXPECT_EQ(std::get<ImagePart>(loaded.parts()[3]).media_type, "image/png");
+  EXPECT_TRUE(std::get<FilePart>(loaded.parts()[4]).truncated);
+  EXPECT_EQ(std::get<CompactionPart>(loaded.parts()[5]).parent_id, "msg-0");
+
+  const auto& st = std::get<SubtaskPart>(loaded.parts()[6]);
+  EXPECT_EQ(st.agent_type, AgentType::Explore);
+  ASSERT_TRUE(st.result.has_value());
+  EXPECT_EQ(*st.result, "done");
+}
+
+TEST(MessageTest, BinaryLargePayloadsOutOfLine) {
+  MemoryBlobStore blobs;
+  std::string big(1000, 'x');
+
+  auto msg = Message::user("small");
+  msg.add_tool_result("tc_1", "bash", big);
+
+  auto data = msg.to_binary(&blobs, 100);
+  EXPECT_LT(data.size(), big.size());
+  EXPECT_EQ(blobs.blobs_.size(), 1);
+
+  auto loaded = Message::from_binary(data, &blobs);
+  EXPECT_EQ(loaded.tool_results()[0]->output, big);
+
+  // Unresolvable reference
+  EXPECT_THROW(Message::from_binary(data), std::runtime_error);
+}
+
+TEST(MessageTest, BinaryToolOutputResolvesLazily) {
+  auto blobs = std::make_shared<MemoryBlobStore>();
+  std::string big(1000, 'x');
+
+  auto msg = Message::user("small");
+  msg.add_tool_result("tc_1", "bash", big);
+  auto loaded = Message::from_binary(msg.to_binary(blobs.get(), 100), blobs.get());
+
+  const auto& output = loaded.tool_results()[0]->output;
+  EXPECT_TRUE(output.is_blob_in(blobs.get()));
+  EXPECT_EQ(output.size(), big.size());
+
+  // Re-encoding keeps the reference without reading the blob
+  loaded.to_binary(blobs.get(), 100);
+  EXPECT_TRUE(output.is_blob_in(blobs.get()));
+  EXPECT_EQ(blobs->blobs_.size(), 1);
+
+  EXPECT_EQ(output, big);
+  EXPECT_FALSE(output.is_blob_in(blobs.get()));
+}
+
+TEST(MessageTest, BinaryMessageList) {
+  std::vector<Message> messages = {Message::user("one"), Message::assistant("two")};
+  auto data = messages_to_binary(messages);
+  EXPECT_TRUE(is_binary_messages(data));
+  EXPECT_FALSE(is_binary_messages("[]"));
+
+  auto loaded = messages_from_binary(data);
+  ASSERT_EQ(loaded.size(), 2);
+  EXPECT_EQ(loaded[1].text(), "two");
+
+  // Truncated input is rejected rather than misread
+  EXPECT_THROW(messages_from_binary(std::string_view(data).substr(0, data.size() - 3)), std::runtime_error);
+}
@@ -1,6 +1,13 @@
 #include <gtest/gtest.h>
+#include <openssl/evp.h>
+#include <openssl/x509.h>
+
+#include <atomic>
+#include <mutex>
+#include <thread>
 
 #include "net/http_client.hpp"
+#include "net/tls.hpp"
 
 using namespace agent::net;
 
@@ -118,3 +125,332 @@ TEST(HttpResponseTest, ErrorStatusCodes) {
   resp500.status_code = 500;
   EXPECT_FALSE(resp500.ok());
 }
+
+// ============================================================
+// 连接池测试
+// ============================================================
+
+namespace {
+
+// 本地 HTTP/1.1 服务器：每个连接上依次处理请求，handler 返回完整的响应
+class LocalHttpServer {
+ public:
+  using Handler = std::function<std::string(const std::string& head)>;
+
+  explicit LocalHttpServer(Handler handler) : handler_(std::move(handler)), acceptor_(ctx_, {asio::ip::address_v4::loopback(), 0}) {
+    thread_ = std::thread([this] {
+      accept_loop();
+    });
+  }
+
+  ~LocalHttpServer() {
+    stopping_ = true;
+    // 连一次，唤醒阻塞在 accept 上的线程
+    asio::ip::tcp::socket wake(ctx_);
+    asio::error_code ec;
+    wake.connect(acceptor_.local_endpoint(), ec);
+    thread_.join();
+    close_connections();
+    for (auto& worker : workers_) worker.join();
+  }
+
+  std::string url(const std::string& path) const {
+    return "http://127.0.0.1:" + std::to_string(acceptor_.local_endpoint().port()) + path;
+  }
+
+  int connections() const {
+    return accepted_;
+  }
+
+  // 服务端主动关闭所有连接
+  void close_connections() {
+    std::lock_guard lock(mutex_);
+    for (auto& socket : sockets_) {
+      asio::error_code ec;
+      socket->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    }
+  }
+
+ private:
+  void accept_loop() {
+    while (true) {
+      auto socket = std::make_shared<asio::ip::tcp::socket>(ctx_);
+      asio::error_code ec;
+      acceptor_.accept(*socket, ec);
+      if (ec || stopping_) return;
+      accepted_++;
+      std::lock_guard lock(mutex_);
+      sockets_.push_back(socket);
+      workers_.emplace_back([this, socket] {
+        serve(*socket);
+      });
+    }
+  }
+
+  void serve(asio::ip::tcp::socket& socket) {
+    asio::streambuf buffer;
+    while (true) {
+      asio::error_code ec;
+      size_t head_size = asio::read_until(socket, buffer, "\r\n\r\n", ec);
+      if (ec) return;
+      std::string head(asio::buffers_begin(buffer.data()), asio::buffers_begin(buffer.data()) + head_size);
+      buffer.consume(head_size);
+
+      // 丢弃请求体
+      auto length = head.find("Content-Length: ");
+      if (length != std::string::npos) {
+        size_t body_size = std::stoul(head.substr(length + 16));
+        if (buffer.size() < body_size) asio::read(socket, buffer, asio::transfer_exactly(body_size - buffer.size()), ec);
+        buffer.consume(body_size);
+      }
+
+      auto response = handler_(head);
+      asio::write(socket, asio::buffer(response), ec);
+      if (ec || response.find("Connection: close") != std::string::npos) {
+        socket.shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+        return;
+      }
+    }
+  }
+
+  Handler handler_;
+  asio::io_context ctx_;
+  asio::ip::tcp::acceptor acceptor_;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<int> accepted_{0};
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<asio::ip::tcp::socket>> sockets_;
+  std::vector<std::thread> workers_;
+};
+
+const std::string OK_RESPONSE = "HTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok";
+const std::string CHUNKED_RESPONSE =
+    "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+    "5\r\nhello\r\n6;ext=1\r\n world\r\n0\r\nX-Trailer: 1\r\n\r\n";
+
+}  // namespace
+
+class HttpPoolTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    runner_ = std::thread([this] {
+      io_ctx_.run();
+    });
+  }
+
+  void TearDown() override {
+    work_.reset();
+    runner_.join();
+  }
+
+  asio::io_context io_ctx_;
+  asio::executor_work_guard<asio::io_context::executor_type> work_ = asio::make_work_guard(io_ctx_);
+  std::thread runner_;
+};
+
+TEST_F(HttpPoolTest, ReusesConnection) {
+  LocalHttpServer server([](const std::string&) {
+    return OK_RESPONSE;
+  });
+  HttpClient client(io_ctx_);
+
+  for (int i = 0; i < 3; ++i) {
+    auto response = client.get(server.url("/ping")).get();
+    EXPECT_TRUE(response.ok()) << response.error;
+    EXPECT_EQ(response.body, "ok");
+  }
+
+  EXPECT_EQ(server.connections(), 1);
+  auto stats = client.pool_stats();
+  EXPECT_EQ(stats.hits, 2);
+  EXPECT_EQ(stats.misses, 1);
+  EXPECT_EQ(stats.idle, 1);
+}
+
+TEST_F(HttpPoolTest, DecodesChunkedBody) {
+  LocalHttpServer server([](const std::string&) {
+    return CHUNKED_RESPONSE;
+  });
+  HttpClient client(io_ctx_);
+
+  for (int i = 0; i < 2; ++i) {
+    auto response = client.post(server.url("/chunked"), "{}").get();
+    EXPECT_EQ(response.status_code, 200);
+    EXPECT_EQ(response.body, "hello world");
+  }
+  EXPECT_EQ(server.connections(), 1);
+}
+
+TEST_F(HttpPoolTest, StreamsThroughPool) {
+  LocalHttpServer server([](const std::string&) {
+    return CHUNKED_RESPONSE;
+  });
+  HttpClient client(io_ctx_);
+
+  for (int i = 0; i < 2; ++i) {
+    std::promise<std::pair<int, std::string>> done;
+    std::string data;
+    client.request_stream(
+        server.url("/stream"), HttpOptions{"POST", {}, "{}"},
+        [&data](std::string_view chunk) {
+          data += chunk;
+        },
+        [&done](int status, const std::string& error) {
+          done.set_value({status, error});
+        });
+    auto [status, error] = done.get_future().get();
+    EXPECT_EQ(status, 200);
+    EXPECT_TRUE(error.empty()) << error;
+    EXPECT_EQ(data, "hello world");
+  }
+  EXPECT_EQ(server.connections(), 1);
+  EXPECT_EQ(client.pool_stats().hits, 1);
+}
+
+TEST_F(HttpPoolTest, ConnectionCloseIsNotReused) {
+  LocalHttpServer server([](const std::string&) {
+    return "HTTP/1.1 200 OK\r\nConnection: close\r\nContent-Length: 2\r\n\r\nok";
+  });
+  HttpClient client(io_ctx_);
+
+  EXPECT_EQ(client.get(server.url("/")).get().body, "ok");
+  EXPECT_EQ(client.get(server.url("/")).get().body, "ok");
+  EXPECT_EQ(server.connections(), 2);
+  EXPECT_EQ(client.pool_stats().hits, 0);
+  EXPECT_EQ(client.pool_stats().idle, 0);
+}
+
+TEST_F(HttpPoolTest, ReplacesConnectionClosedByServer) {
+  LocalHttpServer server([](const std::string&) {
+    return OK_RESPONSE;
+  });
+  HttpClient client(io_ctx_);
+
+  EXPECT_EQ(client.get(server.url("/")).get().body, "ok");
+  server.close_connections();
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+  // 复用前的健康检查发现连接已关闭，改用新连接
+  auto response = client.get(server.url("/")).get();
+  EXPECT_TRUE(response.error.empty()) << response.error;
+  EXPECT_EQ(response.body, "ok");
+  EXPECT_EQ(server.connections(), 2);
+}
+
+TEST_F(HttpPoolTest, IdleTimeoutClosesConnection) {
+  LocalHttpServer server([](const std::string&) {
+    return OK_RESPONSE;
+  });
+  HttpClient client(io_ctx_, HttpPoolOptions{std::chrono::seconds(0), 6});
+
+  EXPECT_EQ(client.get(server.url("/")).get().body, "ok");
+  EXPECT_EQ(client.get(server.url("/")).get().body, "ok");
+  EXPECT_EQ(server.connections(), 2);
+}
+
+TEST_F(HttpPoolTest, LimitsConnectionsPerHost) {
+  LocalHttpServer server([](const std::string&) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    return OK_RESPONSE;
+  });
+  HttpClient client(io_ctx_, HttpPoolOptions{std::chrono::seconds(30), 1});
+
+  // 超出上限的请求等待已有连接空闲
+  std::vector<std::future<HttpResponse>> responses;
+  for (int i = 0; i < 4; ++i) {
+    responses.push_back(client.get(server.url("/")));
+  }
+  for (auto& response : responses) {
+    EXPECT_EQ(response.get().body, "ok");
+  }
+  EXPECT_EQ(server.connections(), 1);
+  EXPECT_EQ(client.pool_stats().hits, 3);
+}
+
+// ============================================================
+// TLS 会话缓存测试
+// ============================================================
+
+namespace {
+
+// 本地 TLS 服务器（自签名证书）：握手后发送一个字节，等待客户端关闭
+class LocalTlsServer {
+ public:
+  LocalTlsServer() : context_(asio::ssl::context::tls_server), acceptor_(ctx_, {asio::ip::address_v4::loopback(), 0}) {
+    EVP_PKEY* key = EVP_EC_gen("P-256");
+    X509* cert = X509_new();
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME_add_entry_by_txt(X509_get_subject_name(cert), "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, X509_get_subject_name(cert));
+    X509_sign(cert, key, EVP_sha256());
+    SSL_CTX_use_certificate(context_.native_handle(), cert);
+    SSL_CTX_use_PrivateKey(context_.native_handle(), key);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+
+    thread_ = std::thread([this] {
+      while (true) {
+        asio::ssl::stream<asio::ip::tcp::socket> stream(ctx_, context_);
+        asio::error_code ec;
+        acceptor_.accept(stream.lowest_layer(), ec);
+        if (ec || stopping_) return;
+        stream.handshake(asio::ssl::stream_base::server, ec);
+        if (ec) continue;
+        asio::write(stream, asio::buffer("x", 1), ec);
+        char byte;
+        stream.read_some(asio::buffer(&byte, 1), ec);
+      }
+    });
+  }
+
+  ~LocalTlsServer() {
+    stopping_ = true;
+    asio::ip::tcp::socket wake(ctx_);
+    asio::error_code ec;
+    wake.connect(acceptor_.local_endpoint(), ec);
+    thread_.join();
+  }
+
+  // 连接并握手，读取服务器的字节（TLS 1.3 的会话票据随之处理）；返回是否复用了会话
+  bool connect(TlsContext& tls) {
+    asio::ssl::stream<asio::ip::tcp::socket> stream(ctx_, tls.context());
+    tls.prepare(stream.native_handle(), "localhost");
+    stream.lowest_layer().connect(acceptor_.local_endpoint());
+    stream.handshake(asio::ssl::stream_base::client);
+    char byte;
+    stream.read_some(asio::buffer(&byte, 1));
+    return SSL_session_reused(stream.native_handle()) == 1;
+  }
+
+ private:
+  asio::io_context ctx_;
+  asio::ssl::context context_;
+  asio::ip::tcp::acceptor acceptor_;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+};
+
+}  // namespace
+
+TEST(TlsContextTest, SharedIsProcessWide) {
+  EXPECT_EQ(TlsContext::shared(), TlsContext::shared());
+}
+
+TEST(TlsContextTest, ResumesCachedSession) {
+  LocalTlsServer server;
+  TlsContext tls;
+  tls.context().set_verify_mode(asio::ssl::verify_none);  // 自签名证书
+
+  EXPECT_FALSE(server.connect(tls));
+  EXPECT_EQ(tls.cached_sessions(), 1);
+
+  // 连接未发送 close_notify 就关闭，缓存的会话仍可复用
+  EXPECT_TRUE(server.connect(tls));
+  EXPECT_TRUE(server.connect(tls));
+
+  tls.clear_sessions();
+  EXPECT_FALSE(server.connect(tls));
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <thread>
+
+#include "llm/anthropic.hpp"
 #include "session/session.hpp"
 
 using namespace agent;
@@ -87,3 +90,492 @@ TEST_F(SessionTest, GetContextMessagesNoSummary) {
   auto context = session->get_context_messages();
   ASSERT_EQ(context.size(), 2);
 }
+
+TEST_F(SessionTest, ContextTokensTrackMessages) {
+  asio::io_context io_ctx;
+  auto session = Session::create(io_ctx, config_, AgentType::Build);
+  EXPECT_EQ(session->estimated_context_tokens(), 0);
+
+  session->add_message(Message::user(std::string(400, 'a')));
+  auto result = Message::user("");
+  result.add_tool_result("tc_1", "read", std::string(800, 'b'));
+  session->add_message(std::move(result));
+  EXPECT_EQ(session->estimated_context_tokens(), 300);
+
+  // A summary starts a new context window
+  Message summary(Role::Assistant, "");
+  summary.add_text(std::string(40, 's'));
+  summary.set_summary(true);
+  summary.set_finished(true);
+  session->add_message(std::move(summary));
+  session->add_message(Message::assistant(std::string(80, 'c')));
+
+  EXPECT_EQ(session->estimated_context_tokens(), 30);
+  auto view = session->context_view();
+  ASSERT_EQ(view.size(), 2);
+  EXPECT_EQ(view.data(), &session->messages()[2]);  // No copy
+}
+
+// ============================================================================
+// Speculative tool execution
+// ============================================================================
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Read-only tool recording when it started
+class ProbeTool : public SimpleTool {
+ public:
+  ProbeTool() : SimpleTool("spec_probe", "records its start time") {}
+
+  std::vector<ParameterSchema> parameters() const override {
+    return {};
+  }
+
+  bool parallel_safe() const override {
+    return true;
+  }
+
+  std::future<ToolResult> execute(const json&, const ToolContext&) override {
+    runs++;
+    started = Clock::now();
+    std::promise<ToolResult> promise;
+    promise.set_value(ToolResult::success("probed"));
+    return promise.get_future();
+  }
+
+  std::atomic<int> runs{0};
+  Clock::time_point started;
+};
+
+// First turn: a spec_probe call, then a slow rest of the response (or an
+// error); second turn: plain text
+class ScriptedProvider : public llm::Provider {
+ public:
+  explicit ScriptedProvider(bool fail) : fail_(fail) {}
+
+  std::string name() const override {
+    return "anthropic";
+  }
+
+  std::vector<ModelInfo> models() const override {
+    return {};
+  }
+
+  std::future<llm::LlmResponse> complete(const llm::LlmRequest&) override {
+    return {};
+  }
+
+  void stream(const llm::LlmRequest&, llm::StreamCallback callback, std::function<void()> on_complete) override {
+    if (turn_++ == 0) {
+      callback(llm::ToolCallComplete{"tc_1", "spec_probe", json::object()});
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+      stream_finished = Clock::now();
+      if (fail_) {
+        callback(llm::StreamError{"connection reset"});
+      } else {
+        callback(llm::FinishStep{FinishReason::ToolCalls, {}});
+      }
+    } else {
+      callback(llm::TextDelta{"done"});
+      callback(llm::FinishStep{FinishReason::Stop, {}});
+    }
+    on_complete();
+  }
+
+  void cancel() override {}
+
+  inline static Clock::time_point stream_finished;
+
+ private:
+  bool fail_;
+  int turn_ = 0;
+};
+
+}  // namespace
+
+class SpeculativeToolTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    config_ = Config::load_default();
+    config_.providers["anthropic"] = ProviderConfig{"anthropic", "test-key", "", std::nullopt, {}};
+    auto agent = config_.get_or_create_agent(AgentType::Build);
+    agent.model = "claude-test";
+    agent.permissions["spec_probe"] = Permission::Allow;
+    config_.agents[agent.id] = agent;
+
+    probe_ = std::make_shared<ProbeTool>();
+    ToolRegistry::instance().register_tool(probe_);
+  }
+
+  void TearDown() override {
+    ToolRegistry::instance().unregister_tool("spec_probe");
+    llm::ProviderFactory::instance().register_provider("anthropic", [](const ProviderConfig& cfg, asio::io_context& ctx) {
+      return std::make_shared<llm::AnthropicProvider>(cfg, ctx);
+    });
+  }
+
+  std::shared_ptr<Session> run(bool speculative, bool fail, std::vector<std::string>* errors = nullptr) {
+    config_.tools.speculative = speculative;
+    // Make sure the built-in factories are registered before replacing one
+    llm::ProviderFactory::instance().create("anthropic", config_.providers["anthropic"], io_ctx_);
+    llm::ProviderFactory::instance().register_provider("anthropic", [fail](const ProviderConfig&, asio::io_context&) {
+      return std::make_shared<ScriptedProvider>(fail);
+    });
+
+    auto session = Session::create(io_ctx_, config_, AgentType::Build);
+    if (errors) {
+      session->on_error([errors](const std::string& error) {
+        errors->push_back(error);
+      });
+    }
+    session->prompt("probe it");
+    return session;
+  }
+
+  asio::io_context io_ctx_;
+  Config config_;
+  std::shared_ptr<ProbeTool> probe_;
+};
+
+TEST_F(SpeculativeToolTest, ReadOnlyCallStartsBeforeStreamEnds) {
+  auto session = run(true, false);
+
+  EXPECT_EQ(probe_->runs, 1);
+  EXPECT_LT(probe_->started, ScriptedProvider::stream_finished);
+
+  // The speculative result is used as the tool result
+  ASSERT_GE(session->messages().size(), 3);
+  auto results = session->messages()[2].tool_results();
+  ASSERT_EQ(results.size(), 1);
+  EXPECT_EQ(results[0]->output, "probed");
+}
+
+TEST_F(SpeculativeToolTest, OffByDefault) {
+  run(false, false);
+
+  EXPECT_EQ(probe_->runs, 1);
+  EXPECT_GT(probe_->started, ScriptedProvider::stream_finished);
+}
+
+TEST_F(SpeculativeToolTest, StreamErrorDiscardsResults) {
+  std::vector<std::string> errors;
+  auto session = run(true, true, &errors);
+
+  // The call ran while streaming, but the failed response never reaches the history
+  ASSERT_EQ(errors.size(), 1);
+  EXPECT_EQ(probe_->runs, 1);
+  for (const auto& msg : session->messages()) {
+    EXPECT_TRUE(msg.tool_results().empty());
+  }
+}
+
+// ============================================================================
+// Background compaction
+// ============================================================================
+
+namespace {
+
+// Model with a 1000-token window. Summaries ("summary <n>") stream on a
+// thread of their own once release is set; other requests answer "reply"
+// right away.
+struct CompactionScript {
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+  std::atomic<int> summaries{0};
+  std::vector<std::string> summary_prompts;
+  std::vector<llm::LlmRequest> main_requests;
+};
+
+class CompactingProvider : public llm::Provider {
+ public:
+  explicit CompactingProvider(std::shared_ptr<CompactionScript> script) : script_(std::move(script)) {}
+
+  ~CompactingProvider() override {
+    if (worker_.joinable()) worker_.join();
+  }
+
+  std::string name() const override {
+    return "anthropic";
+  }
+
+  std::vector<ModelInfo> models() const override {
+    ModelInfo model;
+    model.id = "claude-test";
+    model.context_window = 1000;
+    return {model};
+  }
+
+  std::future<llm::LlmResponse> complete(const llm::LlmRequest&) override {
+    return {};
+  }
+
+  void stream(const llm::LlmRequest& request, llm::StreamCallback callback, std::function<void()> on_complete) override {
+    if (!request.system_prompt.starts_with("You are a conversation summarizer")) {
+      script_->main_requests.push_back(request);
+      callback(llm::TextDelta{"reply"});
+      callback(llm::FinishStep{FinishReason::Stop, {}});
+      on_complete();
+      return;
+    }
+    script_->summary_prompts.push_back(request.messages.at(0).text());
+    if (worker_.joinable()) worker_.join();
+    worker_ = std::thread([script = script_, callback, on_complete] {
+      script->released.wait();
+      callback(llm::TextDelta{"summary " + std::to_string(++script->summaries)});
+      callback(llm::FinishStep{FinishReason::Stop, {}});
+      on_complete();
+    });
+  }
+
+  void cancel() override {}
+
+ private:
+  std::shared_ptr<CompactionScript> script_;
+  std::thread worker_;
+};
+
+}  // namespace
+
+class BackgroundCompactionTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    config_ = Config::load_default();
+    config_.providers["anthropic"] = ProviderConfig{"anthropic", "test-key", "", std::nullopt, {}};
+    auto agent = config_.get_or_create_agent(AgentType::Build);
+    agent.model = "claude-test";
+    config_.agents[agent.id] = agent;
+    config_.context.compact_background_ratio = 0.5;
+    config_.context.compact_blocking_ratio = 0.9;
+
+    script_ = std::make_shared<CompactionScript>();
+    // Make sure the built-in factories are registered before replacing one
+    llm::ProviderFactory::instance().create("anthropic", config_.providers["anthropic"], io_ctx_);
+    llm::ProviderFactory::instance().register_provider("anthropic", [script = script_](const ProviderConfig&, asio::io_context&) {
+      return std::make_shared<CompactingProvider>(script);
+    });
+  }
+
+  void TearDown() override {
+    llm::ProviderFactory::instance().register_provider("anthropic", [](const ProviderConfig& cfg, asio::io_context& ctx) {
+      return std::make_shared<llm::AnthropicProvider>(cfg, ctx);
+    });
+  }
+
+  asio::io_context io_ctx_;
+  Config config_;
+  std::shared_ptr<CompactionScript> script_;
+};
+
+TEST_F(BackgroundCompactionTest, LoopContinuesWhileSummaryIsWritten) {
+  auto session = Session::create(io_ctx_, config_, AgentType::Build);
+
+  // 600 tokens: above the background watermark, below the blocking one
+  session->prompt(std::string(2400, 'a'));
+
+  // The turn finished without waiting; the marker is not sent to the model
+  EXPECT_EQ(script_->summaries, 0);
+  ASSERT_EQ(session->messages().size(), 3);
+  EXPECT_TRUE(session->messages()[1].is_summary());
+  EXPECT_FALSE(session->messages()[1].is_finished());
+  EXPECT_EQ(session->messages()[2].text(), "reply");
+  ASSERT_EQ(script_->main_requests.size(), 1);
+  EXPECT_EQ(script_->main_requests[0].messages.size(), 1);
+
+  script_->release.set_value();
+  while (session->compaction_in_progress()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+  // The next turn starts from the summary and keeps what followed the marker
+  session->prompt("next");
+  ASSERT_EQ(script_->main_requests.size(), 2);
+  const auto& sent = script_->main_requests[1].messages;
+  ASSERT_EQ(sent.size(), 3);
+  EXPECT_TRUE(sent[0].is_summary());
+  EXPECT_EQ(sent[0].text(), "summary 1");
+  EXPECT_EQ(sent[1].text(), "reply");
+  EXPECT_EQ(sent[2].text(), "next");
+  EXPECT_LT(session->estimated_context_tokens(), 500);
+}
+
+TEST_F(BackgroundCompactionTest, BlockingThresholdWaitsForPendingSummary) {
+  auto session = Session::create(io_ctx_, config_, AgentType::Build);
+  session->prompt(std::string(2400, 'a'));
+  ASSERT_FALSE(session->messages()[1].is_finished());
+
+  // Crossing the blocking threshold waits for the summary in flight instead
+  // of starting a second one
+  std::thread release([this] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    script_->release.set_value();
+  });
+  session->prompt(std::string(1200, 'b'));
+  release.join();
+
+  EXPECT_EQ(script_->summaries, 1);
+  EXPECT_TRUE(session->messages()[1].is_finished());
+  ASSERT_EQ(script_->main_requests.size(), 2);
+  EXPECT_TRUE(script_->main_requests[1].messages[0].is_summary());
+}
+
+class RollingCompactionTest : public BackgroundCompactionTest {
+ protected:
+  void SetUp() override {
+    BackgroundCompactionTest::SetUp();
+    // Synchronous compaction above 500 tokens, 150-token chunks, two leaves
+    config_.context.compact_background_ratio = 0.9;
+    config_.context.compact_blocking_ratio = 0.5;
+    config_.context.compact_chunk_tokens = 150;
+    config_.context.compact_max_leaves = 2;
+    script_->release.set_value();
+  }
+
+  // 200-token user and assistant messages
+  static void add_turns(Session& session, char first, int turns) {
+    for (int i = 0; i < turns; ++i) {
+      session.add_message(Message::user(std::string(800, static_cast<char>(first + 2 * i))));
+      session.add_message(Message::assistant(std::string(800, static_cast<char>(first + 2 * i + 1))));
+    }
+  }
+
+  static int count_of(const std::string& text, const std::string& needle) {
+    int count = 0;
+    for (auto pos = text.find(needle); pos != std::string::npos; pos = text.find(needle, pos + 1)) count++;
+    return count;
+  }
+};
+
+TEST_F(RollingCompactionTest, SummarizesBoundedChunksIntoTree) {
+  auto session = Session::create(io_ctx_, config_, AgentType::Build);
+  add_turns(*session, 'a', 3);
+  session->prompt("go");
+
+  // 7 chunks (each message is larger than a chunk), then two merges down to a root and two leaves
+  ASSERT_EQ(script_->summary_prompts.size(), 9);
+  for (size_t i = 0; i < 7; ++i) {
+    EXPECT_LT(script_->summary_prompts[i].size(), 150 * 4 + 100) << i;
+  }
+  for (size_t i = 7; i < 9; ++i) {
+    EXPECT_EQ(count_of(script_->summary_prompts[i], "[Summary "), 3) << i;
+  }
+
+  const auto& summary = session->context_view().front();
+  ASSERT_TRUE(summary.is_summary());
+  ASSERT_EQ(summary.parts().size(), 3);
+  EXPECT_EQ(std::get<TextPart>(summary.parts()[0]).text, "summary 9");
+  EXPECT_EQ(std::get<TextPart>(summary.parts()[1]).text, "summary 6");
+  EXPECT_EQ(std::get<TextPart>(summary.parts()[2]).text, "summary 7");
+}
+
+TEST_F(RollingCompactionTest, KeepsEarlierNodes) {
+  auto session = Session::create(io_ctx_, config_, AgentType::Build);
+  add_turns(*session, 'a', 3);
+  session->prompt("go");
+  ASSERT_EQ(script_->summary_prompts.size(), 9);
+
+  add_turns(*session, 'k', 2);
+  session->prompt("again");
+
+  // Only the new messages are summarized; the old root is merged, not re-read
+  ASSERT_GT(script_->summary_prompts.size(), 9);
+  EXPECT_EQ(script_->summary_prompts[9].find(std::string(100, 'a')), std::string::npos);
+  EXPECT_EQ(script_->summary_prompts[9].find("summary 9"), std::string::npos);
+  bool root_merged = false;
+  for (size_t i = 10; i < script_->summary_prompts.size(); ++i) {
+    root_merged |= script_->summary_prompts[i].find("summary 9") != std::string::npos;
+  }
+  EXPECT_TRUE(root_merged);
+  EXPECT_EQ(session->context_view().front().parts().size(), 3);
+}
+
+namespace {
+
+// Replies after a delay, on a timer of the session's io_context
+class DelayedProvider : public llm::Provider {
+ public:
+  explicit DelayedProvider(asio::io_context& io_ctx) : io_ctx_(io_ctx) {}
+
+  std::string name() const override {
+    return "anthropic";
+  }
+
+  std::vector<ModelInfo> models() const override {
+    return {};
+  }
+
+  std::future<llm::LlmResponse> complete(const llm::LlmRequest&) override {
+    return {};
+  }
+
+  void stream(const llm::LlmRequest&, llm::StreamCallback callback, std::function<void()> on_complete) override {
+    auto timer = std::make_shared<asio::steady_timer>(io_ctx_, DELAY);
+    timer->async_wait([timer, callback, on_complete](const std::error_code&) {
+      callback(llm::TextDelta{"reply"});
+      callback(llm::FinishStep{FinishReason::Stop, {}});
+      on_complete();
+    });
+  }
+
+  void cancel() override {}
+
+  static constexpr auto DELAY = std::chrono::milliseconds(50);
+
+ private:
+  asio::io_context& io_ctx_;
+};
+
+}  // namespace
+
+class AsyncSessionTest : public BackgroundCompactionTest {
+ protected:
+  void SetUp() override {
+    BackgroundCompactionTest::SetUp();
+    llm::ProviderFactory::instance().register_provider("anthropic", [](const ProviderConfig&, asio::io_context& ctx) {
+      return std::make_shared<DelayedProvider>(ctx);
+    });
+  }
+};
+
+TEST_F(AsyncSessionTest, ManySessionsShareOneThread) {
+  constexpr int SESSIONS = 50;
+  std::vector<std::shared_ptr<Session>> sessions;
+  int completed = 0;
+  for (int i = 0; i < SESSIONS; ++i) {
+    auto session = Session::create(io_ctx_, config_, AgentType::Build);
+    session->on_complete([&completed](FinishReason reason) {
+      EXPECT_EQ(reason, FinishReason::Stop);
+      completed++;
+    });
+    session->start_prompt(Message::user("hello " + std::to_string(i)));
+    sessions.push_back(session);
+  }
+
+  // The waits overlap: all loops finish in about one delay, not fifty
+  auto start = std::chrono::steady_clock::now();
+  io_ctx_.run();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  EXPECT_EQ(completed, SESSIONS);
+  EXPECT_LT(elapsed, DelayedProvider::DELAY * SESSIONS / 5);
+  for (const auto& session : sessions) {
+    ASSERT_EQ(session->messages().size(), 2);
+    EXPECT_EQ(session->messages()[1].text(), "reply");
+  }
+}
+
+TEST_F(AsyncSessionTest, AsyncPromptRunsOnCallerExecutor) {
+  auto session = Session::create(io_ctx_, config_, AgentType::Build);
+  bool done = false;
+  asio::co_spawn(
+      io_ctx_,
+      [&]() -> asio::awaitable<void> {
+        co_await session->async_prompt(Message::user("hello"));
+        done = true;
+      },
+      asio::detached);
+  io_ctx_.run();
+
+  EXPECT_TRUE(done);
+  EXPECT_EQ(session->state(), SessionState::Completed);
+  EXPECT_EQ(session->messages().back().text(), "reply");
+}
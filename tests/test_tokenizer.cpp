@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <fstream>
+
+#include "core/tokenizer.hpp"
+#include "core/uuid.hpp"
+
+using namespace agent;
+namespace fs = std::filesystem;
+
+static std::vector<std::string> pieces(std::string_view text, PieceRules rules = PieceRules::Cl100k) {
+  std::vector<std::string> result;
+  for (size_t pos = 0; pos < text.size();) {
+    auto end = next_piece(text, pos, rules);
+    result.emplace_back(text.substr(pos, end - pos));
+    pos = end;
+  }
+  return result;
+}
+
+// Tiny vocabulary: single bytes, then "ab", " ab", "abc"
+static std::shared_ptr<BpeTokenizer> tiny_bpe() {
+  return std::make_shared<BpeTokenizer>(
+      "tiny", std::vector<std::pair<std::string, uint32_t>>{{"a", 0}, {"b", 1}, {"c", 2}, {" ", 3}, {"ab", 4}, {" ab", 5}, {"abc", 6}});
+}
+
+namespace {
+
+class CountingTokenizer : public Tokenizer {
+ public:
+  const std::string& name() const override {
+    return name_;
+  }
+
+  size_t count(std::string_view text) const override {
+    ++calls;
+    return text.size();
+  }
+
+  mutable int calls = 0;
+
+ private:
+  std::string name_ = "counting";
+};
+
+}  // namespace
+
+TEST(TokenizerTest, ApproximateCountsByCharacter) {
+  ApproximateTokenizer tokenizer;
+  EXPECT_EQ(tokenizer.count(std::string(400, 'a')), 100);
+  EXPECT_EQ(tokenizer.count("你好世界"), 4);  // One per CJK character, not 12 / 4
+  EXPECT_EQ(tokenizer.count("héllo wörld, ça va"), 5);
+  EXPECT_EQ(tokenizer.count(""), 0);
+}
+
+TEST(TokenizerTest, PiecesFollowCl100kRules) {
+  EXPECT_EQ(pieces("Hello world's  123456 foo!!\n\n  bar"),
+            (std::vector<std::string>{"Hello", " world", "'s", " ", " ", "123", "456", " foo", "!!\n\n", " ", " bar"}));
+  EXPECT_EQ(pieces("你好 world(x)"), (std::vector<std::string>{"你好", " world", "(x", ")"}));
+  EXPECT_EQ(pieces("  \n  x\t"), (std::vector<std::string>{"  \n", " ", " x", "\t"}));
+
+  // Letter runs longer than one 8-byte word
+  EXPECT_EQ(pieces("abcdefghijklmnopqrstuvwxyz0"), (std::vector<std::string>{"abcdefghijklmnopqrstuvwxyz", "0"}));
+  EXPECT_EQ(pieces("abcdefgh\xC3\xA9ijklmnop@"), (std::vector<std::string>{"abcdefgh\xC3\xA9ijklmnop", "@"}));
+}
+
+TEST(TokenizerTest, PiecesFollowO200kRules) {
+  // Case changes split words, contractions stay on the word, slashes end punctuation
+  EXPECT_EQ(pieces("CamelCase getHTTPResponse they're HTMLParser I'M a:\n/", PieceRules::O200k),
+            (std::vector<std::string>{"Camel", "Case", " get", "HTTPResponse", " they're", " HTMLParser", " I'M", " a", ":\n/"}));
+  EXPECT_EQ(pieces("CamelCase getHTTPResponse they're HTMLParser I'M a:\n/"),
+            (std::vector<std::string>{"CamelCase", " getHTTPResponse", " they", "'re", " HTMLParser", " I", "'M", " a", ":\n", "/"}));
+
+  // Non-ASCII letters have no case: they join either run
+  EXPECT_EQ(pieces("Ünïcode你好World", PieceRules::O200k), (std::vector<std::string>{"Ünïcode你好", "World"}));
+  EXPECT_EQ(pieces("123456 foo!!\n\n  bar", PieceRules::O200k),
+            (std::vector<std::string>{"123", "456", " foo", "!!\n\n", " ", " bar"}));
+}
+
+TEST(TokenizerTest, O200kVocabularyUsesO200kPieces) {
+  std::vector<std::pair<std::string, uint32_t>> ranks{{"a", 0}, {"B", 1}, {"aB", 2}};
+  // One piece "aB" under cl100k, "a" and "B" under o200k
+  EXPECT_EQ(BpeTokenizer("cl100k_tiny", ranks).count("aB"), 1);
+  EXPECT_EQ(BpeTokenizer("o200k_tiny", ranks).count("aB"), 2);
+}
+
+TEST(TokenizerTest, BpeMergesLowestRankFirst) {
+  auto tokenizer = tiny_bpe();
+  // "ab" is a token; " abc" merges "ab" (4), then " ab" (5), leaving "c"
+  EXPECT_EQ(tokenizer->encode("ab abc"), (std::vector<uint32_t>{4, 5, 2}));
+  EXPECT_EQ(tokenizer->count("ab abc"), 3);
+  EXPECT_EQ(tokenizer->count(""), 0);
+}
+
+TEST(TokenizerTest, LoadsTiktokenFile) {
+  auto dir = fs::temp_directory_path() / ("agent_tokenizer_test_" + UUID::generate());
+  fs::create_directories(dir);
+
+  {
+    std::ofstream out(dir / "tiny.tiktoken");
+    out << "YQ== 0\nYg== 1\nYw== 2\nIA== 3\nYWI= 4\nIGFi 5\nYWJj 6\n";
+  }
+  auto tokenizer = BpeTokenizer::load(dir / "tiny.tiktoken", "tiny");
+  ASSERT_NE(tokenizer, nullptr);
+  EXPECT_EQ(tokenizer->name(), "tiny");
+  EXPECT_EQ(tokenizer->vocab_size(), 7);
+  EXPECT_EQ(tokenizer->encode("ab abc"), (std::vector<uint32_t>{4, 5, 2}));
+
+  {
+    std::ofstream out(dir / "bad.tiktoken");
+    out << "YQ== 0\nnot base64! 1\n";
+  }
+  EXPECT_EQ(BpeTokenizer::load(dir / "bad.tiktoken", "bad"), nullptr);
+  EXPECT_EQ(BpeTokenizer::load(dir / "missing.tiktoken", "missing"), nullptr);
+
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+TEST(TokenizerTest, RegistryFallsBackToApproximate) {
+  auto& registry = TokenizerRegistry::instance();
+  EXPECT_EQ(registry.get("")->name(), "approximate");
+  EXPECT_EQ(registry.get("no_such_vocabulary")->name(), "approximate");
+
+  registry.register_tokenizer(tiny_bpe());
+  EXPECT_EQ(registry.get("tiny")->count("ab abc"), 3);
+}
+
+TEST(TokenizerTest, PartCountsAreCached) {
+  CountingTokenizer tokenizer;
+  auto msg = Message::assistant("hello");
+  msg.add_tool_call("tc_1", "read", {{"filePath", "/a"}});
+  auto result = Message::user("");
+  result.add_tool_result("tc_1", "read", "file contents");
+
+  auto first = count_message_tokens(tokenizer, msg) + count_message_tokens(tokenizer, result);
+  EXPECT_EQ(first, 5 + 4 + json({{"filePath", "/a"}}).dump().size() + 13);
+  int calls = tokenizer.calls;
+  EXPECT_EQ(count_message_tokens(tokenizer, msg) + count_message_tokens(tokenizer, result), first);
+  EXPECT_EQ(tokenizer.calls, calls);
+
+  // Copies keep the count; changed text is counted again
+  auto copy = msg;
+  count_message_tokens(tokenizer, copy);
+  EXPECT_EQ(tokenizer.calls, calls);
+  std::get<TextPart>(copy.parts()[0]).text = "hello again";
+  EXPECT_EQ(count_part_tokens(tokenizer, copy.parts()[0]), 11);
+
+  // Compacted results no longer count
+  std::get<ToolResultPart>(result.parts()[0]).compacted = true;
+  EXPECT_EQ(count_message_tokens(tokenizer, result), 0);
+}
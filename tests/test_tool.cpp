@@ -1,9 +1,15 @@
 #include <gtest/gtest.h>
 
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
 #include "tool/builtin/builtins.hpp"
+#include "tool/executor.hpp"
 #include "tool/tool.hpp"
 
 using namespace agent;
+namespace fs = std::filesystem;
 
 TEST(ToolTest, ToolRegistration) {
   auto& registry = ToolRegistry::instance();
@@ -52,6 +58,38 @@ TEST(ToolTest, ToolJsonSchema) {
   EXPECT_TRUE(schema.contains("input_schema"));
 }
 
+TEST(ToolTest, SchemaSetCachedPerGeneration) {
+  tools::register_builtins();
+  auto& registry = ToolRegistry::instance();
+
+  AgentConfig agent;
+  agent.allowed_tools = {"read", "glob"};
+  auto schemas = registry.schemas_for_agent(agent);
+  EXPECT_EQ(registry.schemas_for_agent(agent), schemas);
+  ASSERT_EQ(schemas->tools().size(), 2);
+
+  auto openai = json::parse(schemas->serialized(ToolSchemaFormat::OpenAI));
+  ASSERT_EQ(openai.size(), 2);
+  EXPECT_EQ(openai[0]["function"]["name"], schemas->tools()[0]->id());
+  EXPECT_TRUE(openai[0]["function"].contains("parameters"));
+  auto cached = json::parse(schemas->serialized(ToolSchemaFormat::AnthropicCached));
+  EXPECT_FALSE(cached[0].contains("cache_control"));
+  EXPECT_EQ(cached[1]["cache_control"]["type"], "ephemeral");
+
+  // Another filter gets its own set
+  AgentConfig other;
+  other.allowed_tools = {"read"};
+  EXPECT_EQ(registry.schemas_for_agent(other)->tools().size(), 1);
+
+  // Registering a tool invalidates the cache
+  auto generation = registry.generation();
+  registry.register_tool(registry.get("read"));
+  EXPECT_GT(registry.generation(), generation);
+  auto rebuilt = registry.schemas_for_agent(agent);
+  EXPECT_NE(rebuilt, schemas);
+  EXPECT_EQ(rebuilt->generation(), registry.generation());
+}
+
 TEST(TruncateTest, NoTruncationNeeded) {
   std::string short_text = "Hello, world!";
   auto result = Truncate::output(short_text);
@@ -71,3 +109,164 @@ TEST(TruncateTest, TruncateByLines) {
   EXPECT_TRUE(result.truncated);
   EXPECT_LT(result.content.size(), long_text.size());
 }
+
+TEST(TruncateTest, SaveAndTruncateStoresIdenticalOutputsOnce) {
+  auto dir = fs::temp_directory_path() / ("agent_truncate_test_" + UUID::generate());
+  Truncate::set_blob_store(std::make_shared<DirectoryBlobStore>(dir));
+
+  std::string long_text;
+  for (int i = 0; i < 200; ++i) {
+    long_text += "Line " + std::to_string(i) + "\n";
+  }
+
+  auto first = Truncate::save_and_truncate(long_text, "bash", 100);
+  auto second = Truncate::save_and_truncate(long_text, "read", 100);
+  ASSERT_TRUE(first.full_output_path.has_value());
+  EXPECT_EQ(first.full_output_path, second.full_output_path);
+
+  std::ifstream file(*first.full_output_path);
+  std::string saved((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  EXPECT_EQ(saved, long_text);
+
+  Truncate::set_blob_store(nullptr);
+  std::error_code ec;
+  fs::remove_all(dir, ec);
+}
+
+namespace {
+
+// Tool that sleeps, records the order calls start in and how many overlap
+class SleepTool : public SimpleTool {
+ public:
+  SleepTool(std::string id, bool parallel_safe) : SimpleTool(std::move(id), "sleeps"), parallel_safe_(parallel_safe) {}
+
+  std::vector<ParameterSchema> parameters() const override {
+    return {};
+  }
+
+  bool parallel_safe() const override {
+    return parallel_safe_;
+  }
+
+  std::optional<std::string> resource_key(const json& args, const ToolContext& ctx) const override {
+    return file_resource_key(args, ctx, "path");
+  }
+
+  std::future<ToolResult> execute(const json& args, const ToolContext&) override {
+    return std::async(std::launch::async, [this, args] {
+      {
+        std::lock_guard lock(mutex_);
+        started_.push_back(args.value("name", ""));
+        max_running_ = std::max(max_running_, ++running_);
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(args.value("ms", 50)));
+      {
+        std::lock_guard lock(mutex_);
+        --running_;
+      }
+      if (args.value("fail", false)) throw std::runtime_error("boom");
+      return ToolResult::success(args.value("name", ""));
+    });
+  }
+
+  std::mutex mutex_;
+  std::vector<std::string> started_;
+  int running_ = 0;
+  int max_running_ = 0;
+
+ private:
+  bool parallel_safe_;
+};
+
+ToolInvocation invoke(std::shared_ptr<Tool> tool, json args) {
+  ToolContext ctx;
+  ctx.working_dir = "/work";
+  return {std::move(tool), std::move(args), ctx};
+}
+
+}  // namespace
+
+TEST(ToolBatchTest, IndependentReadsOverlapAndKeepOrder) {
+  auto reader = std::make_shared<SleepTool>("reader", true);
+  std::vector<ToolInvocation> calls;
+  for (int i = 0; i < 6; ++i) {
+    calls.push_back(invoke(reader, {{"name", "r" + std::to_string(i)}, {"ms", 100 - i * 10}}));
+  }
+
+  std::vector<size_t> completed;
+  auto start = std::chrono::steady_clock::now();
+  auto results = execute_tool_batch(calls, 8, [&](size_t index, const ToolResult&) {
+    completed.push_back(index);
+  });
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  EXPECT_LT(elapsed, std::chrono::milliseconds(300));
+  EXPECT_EQ(reader->max_running_, 6);
+  ASSERT_EQ(results.size(), 6);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(results[i].output, "r" + std::to_string(i));
+  }
+  EXPECT_EQ(completed.size(), 6);
+}
+
+TEST(ToolBatchTest, ConcurrencyLimit) {
+  auto reader = std::make_shared<SleepTool>("reader", true);
+  std::vector<ToolInvocation> calls;
+  for (int i = 0; i < 6; ++i) {
+    calls.push_back(invoke(reader, {{"name", "r" + std::to_string(i)}, {"ms", 20}}));
+  }
+
+  execute_tool_batch(calls, 2);
+  EXPECT_EQ(reader->max_running_, 2);
+
+  reader->max_running_ = 0;
+  execute_tool_batch(calls, 1);
+  EXPECT_EQ(reader->max_running_, 1);
+}
+
+TEST(ToolBatchTest, WritesToOnePathStayInOrder) {
+  auto reader = std::make_shared<SleepTool>("reader", true);
+  auto writer = std::make_shared<SleepTool>("writer", false);
+
+  // read a | write a | write b | read a | read c
+  std::vector<ToolInvocation> calls = {invoke(reader, {{"name", "read-a"}, {"path", "a"}, {"ms", 80}}),
+                                       invoke(writer, {{"name", "write-a"}, {"path", "/work/./a"}, {"ms", 10}}),
+                                       invoke(writer, {{"name", "write-b"}, {"path", "b"}, {"ms", 10}}),
+                                       invoke(reader, {{"name", "read-a-again"}, {"path", "a"}, {"ms", 10}}),
+                                       invoke(reader, {{"name", "read-c"}, {"path", "c"}, {"ms", 10}})};
+
+  EXPECT_TRUE(tool_calls_conflict(calls[0], calls[1]));
+  EXPECT_FALSE(tool_calls_conflict(calls[1], calls[2]));
+  EXPECT_FALSE(tool_calls_conflict(calls[0], calls[3]));
+
+  std::vector<std::string> finished;
+  execute_tool_batch(calls, 8, [&](size_t, const ToolResult& result) {
+    finished.push_back(result.output);
+  });
+
+  auto position = [&](const std::string& name) {
+    return std::find(finished.begin(), finished.end(), name) - finished.begin();
+  };
+  EXPECT_LT(position("read-a"), position("write-a"));
+  EXPECT_LT(position("write-a"), position("read-a-again"));
+  // Unrelated calls did not wait for the slow read
+  EXPECT_LT(position("write-b"), position("read-a"));
+  EXPECT_LT(position("read-c"), position("read-a"));
+}
+
+TEST(ToolBatchTest, UnkeyedCallIsABarrierAndErrorsAreResults) {
+  auto reader = std::make_shared<SleepTool>("reader", true);
+  auto shell = std::make_shared<SleepTool>("shell", false);
+
+  std::vector<ToolInvocation> calls = {invoke(reader, {{"name", "before"}, {"ms", 30}}),
+                                       invoke(shell, {{"name", "shell"}, {"ms", 10}, {"fail", true}}),
+                                       invoke(reader, {{"name", "after"}, {"ms", 10}})};
+
+  auto results = execute_tool_batch(calls, 8);
+  EXPECT_EQ(reader->max_running_, 1);
+  EXPECT_EQ(shell->started_.size(), 1);
+  EXPECT_EQ(reader->started_, (std::vector<std::string>{"before", "after"}));
+  EXPECT_TRUE(results[1].is_error);
+  EXPECT_EQ(results[1].output, "Error: boom");
+  EXPECT_FALSE(results[2].is_error);
+}
@@ -103,9 +103,11 @@ void load_history_to_chat_log(AppState& state, const std::shared_ptr<agent::Sess
     // 跳过系统消息
     if (msg.role() == agent::Role::System) continue;
 
-    // 显示摘要消息
+    // 显示摘要消息（后台压缩尚未完成的摘要不显示）
     if (msg.is_summary()) {
-      state.chat_log.push({EntryKind::SystemInfo, "[Summary] " + msg.text(), ""});
+      if (msg.is_finished()) {
+        state.chat_log.push({EntryKind::SystemInfo, "[Summary] " + msg.text(), ""});
+      }
       continue;
     }
 
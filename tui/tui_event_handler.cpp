@@ -4,6 +4,7 @@
 #include <chrono>
 #include <cstdio>
 #include <ftxui/component/component.hpp>
+#include <optional>
 #include <sstream>
 #include <string>
 #include <thread>
@@ -245,12 +246,39 @@ void handle_submit(AppState& state, AppContext& ctx, ScreenInteractive& screen)
 // 会话命令处理
 // ============================================================
 
-void handle_sessions_command(AppState& state, AppContext& ctx, const std::string& arg) {
-  auto sessions_list = ctx.store->list_sessions();
+// 加载下一页会话，返回是否有新条目
+static bool load_more_sessions(AppState& state, AppContext& ctx) {
+  if (state.sessions_cache.size() >= state.sessions_total) return false;
+  auto page = ctx.store->list_sessions(state.sessions_cache.size(), AppState::SESSIONS_PAGE_SIZE);
+  if (page.empty()) return false;
+  state.sessions_cache.insert(state.sessions_cache.end(), page.begin(), page.end());
+  return true;
+}
+
+// 选中下一个会话，到达已加载末尾时先尝试加载下一页
+static void select_next_session(AppState& state, AppContext& ctx) {
+  int count = static_cast<int>(state.sessions_cache.size());
+  if (count == 0) return;
+  if (state.sessions_selected + 1 >= count && load_more_sessions(state, ctx)) {
+    state.sessions_selected++;
+  } else {
+    state.sessions_selected = (state.sessions_selected + 1) % count;
+  }
+}
 
+// 按编号（从 1 开始，最近更新在前）查找会话
+static std::optional<agent::SessionMeta> session_by_number(AppContext& ctx, int number) {
+  if (number < 1) return std::nullopt;
+  auto page = ctx.store->list_sessions(static_cast<size_t>(number - 1), 1);
+  if (page.empty()) return std::nullopt;
+  return page.front();
+}
+
+void handle_sessions_command(AppState& state, AppContext& ctx, const std::string& arg) {
   if (arg.empty()) {
     // 打开会话列表面板
-    state.sessions_cache = sessions_list;
+    state.sessions_total = ctx.store->session_count();
+    state.sessions_cache = ctx.store->list_sessions(0, AppState::SESSIONS_PAGE_SIZE);
     state.sessions_selected = 0;
     for (size_t si = 0; si < state.sessions_cache.size(); ++si) {
       if (state.sessions_cache[si].id == state.agent_state.session_id()) {
@@ -265,11 +293,11 @@ void handle_sessions_command(AppState& state, AppContext& ctx, const std::string
     if (d_arg.empty() || !std::all_of(d_arg.begin(), d_arg.end(), ::isdigit)) {
       state.chat_log.push({EntryKind::Error, "Usage: /s d <N>", ""});
     } else {
-      int d_idx = std::stoi(d_arg);
-      if (d_idx < 1 || d_idx > static_cast<int>(sessions_list.size())) {
+      auto found = session_by_number(ctx, std::stoi(d_arg));
+      if (!found) {
         state.chat_log.push({EntryKind::Error, "Invalid session number: " + d_arg, ""});
       } else {
-        const auto& meta = sessions_list[d_idx - 1];
+        const auto& meta = *found;
         bool was_current = (meta.id == state.agent_state.session_id());
         ctx.store->remove_session(meta.id);
         state.chat_log.push({EntryKind::SystemInfo, "Deleted session: " + (meta.title.empty() ? "(untitled)" : meta.title), ""});
@@ -283,11 +311,11 @@ void handle_sessions_command(AppState& state, AppContext& ctx, const std::string
     }
   } else if (std::all_of(arg.begin(), arg.end(), ::isdigit)) {
     // 加载会话
-    int s_idx = std::stoi(arg);
-    if (s_idx < 1 || s_idx > static_cast<int>(sessions_list.size())) {
+    auto found = session_by_number(ctx, std::stoi(arg));
+    if (!found) {
       state.chat_log.push({EntryKind::Error, "Invalid session number: " + arg, ""});
     } else {
-      const auto& meta = sessions_list[s_idx - 1];
+      const auto& meta = *found;
       ctx.session->cancel();
       auto resumed = agent::Session::resume(ctx.io_ctx, ctx.config, meta.id, ctx.store);
       if (resumed) {
@@ -326,7 +354,7 @@ bool handle_sessions_panel_event(AppState& state, AppContext& ctx, Event event)
     return true;
   }
   if (event == Event::ArrowDown || event == Event::Character('j')) {
-    if (count > 0) state.sessions_selected = (state.sessions_selected + 1) % count;
+    select_next_session(state, ctx);
     return true;
   }
 
@@ -337,7 +365,7 @@ bool handle_sessions_panel_event(AppState& state, AppContext& ctx, Event event)
       return true;
     }
     if (mouse.button == Mouse::WheelDown) {
-      if (count > 0) state.sessions_selected = (state.sessions_selected + 1) % count;
+      select_next_session(state, ctx);
       return true;
     }
     if (mouse.button == Mouse::Left && mouse.motion == Mouse::Pressed && count > 0) {
@@ -388,7 +416,8 @@ bool handle_sessions_panel_event(AppState& state, AppContext& ctx, Event event)
         setup_tui_callbacks(state, ctx);
         state.chat_log.push({EntryKind::SystemInfo, "Created new session", ""});
       }
-      state.sessions_cache = ctx.store->list_sessions();
+      state.sessions_total = ctx.store->session_count();
+      state.sessions_cache = ctx.store->list_sessions(0, std::max(state.sessions_cache.size(), AppState::SESSIONS_PAGE_SIZE));
       if (state.sessions_selected >= static_cast<int>(state.sessions_cache.size())) {
         state.sessions_selected = std::max(0, static_cast<int>(state.sessions_cache.size()) - 1);
       }
@@ -426,8 +426,13 @@ Element build_sessions_panel(AppState& state) {
                       | yframe               //
                       | flex;
 
+  std::string panel_title = " Sessions ";
+  if (state.sessions_total > state.sessions_cache.size()) {
+    panel_title += "(" + std::to_string(state.sessions_cache.size()) + "/" + std::to_string(state.sessions_total) + ") ";
+  }
+
   auto panel_header = hbox({
-      text(" Sessions ") | bold,
+      text(panel_title) | bold,
       filler(),
       text(" ↑↓ navigate  Enter load  d delete  n new  Esc close ") | dim,
   });
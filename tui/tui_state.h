@@ -57,7 +57,9 @@ struct AppState {
   // ----- 会话列表面板 -----
   bool show_sessions_panel = false;
   int sessions_selected = 0;
-  std::vector<agent::SessionMeta> sessions_cache;
+  std::vector<agent::SessionMeta> sessions_cache;  // 已加载的会话（按 updated_at 倒序分页加载）
+  size_t sessions_total = 0;                       // store 中的会话总数
+  static constexpr size_t SESSIONS_PAGE_SIZE = 50;
   std::vector<ftxui::Box> session_item_boxes;
 
   // ----- Question 面板（用于 question 工具交互） -----